@@ -0,0 +1,86 @@
+#! /bin/sh
+# Benchmark for SSRB of span 1 data of a scanner with a long axial FOV.
+# It creates a template and (noisy) data, and then runs SSRB to 2D and to
+# a larger span for different numbers of OpenMP threads, reporting the timings.
+# The results for the different numbers of threads should be identical.
+#
+# STIR utilities need to be in your PATH.
+# You can set the following environment variables to change the size of the data:
+#   max_ring_diff (default 39), view_mash_factor (default 8), num_threads_list (default "1 2 4 8")
+#
+#  Copyright (C) 2026, agent
+#  This file is part of STIR.
+#
+#  SPDX-License-Identifier: Apache-2.0
+#
+#  See STIR/LICENSE.txt for details
+#
+# Author agent
+#
+
+# first need to set this to the C locale, as this is what the STIR utilities use
+LC_ALL=C
+export LC_ALL
+
+: ${max_ring_diff:=39}
+: ${view_mash_factor:=8}
+: ${num_threads_list:="1 2 4 8"}
+
+mkdir -p output
+cd output
+
+echo "===  create template sinogram (UPENN_6rings_no_gaps, span 1, max ring diff ${max_ring_diff}, view mash factor ${view_mash_factor})"
+template_sino=my_span1_template.hs
+cat > my_input.txt <<EOT
+UPENN_6rings_no_gaps
+
+${view_mash_factor}
+n
+
+1
+${max_ring_diff}
+EOT
+create_projdata_template ${template_sino} < my_input.txt > my_create_template.log 2>&1
+if [ $? -ne 0 ]; then
+  echo "ERROR running create_projdata_template. Check my_create_template.log"; exit 1;
+fi
+
+echo "===  create data"
+# find the size of the data from the header, and write zeroes to the data file of the template
+num_sinograms=`grep 'matrix size \[2\]' ${template_sino} | sed -e 's/.*{//' -e 's/}.*//' | tr ',' '\n' | awk '{s+=$1} END {print s}'`
+num_views=`grep 'matrix size \[3\]' ${template_sino} | sed -e 's/.*:= *//'`
+num_tangential_poss=`grep 'matrix size \[1\]' ${template_sino} | sed -e 's/.*:= *//'`
+truncate -s `expr ${num_sinograms} \* ${num_views} \* ${num_tangential_poss} \* 4` my_span1_template.s
+stir_math -s --including-first --add-scalar 10 my_uniform.hs ${template_sino} > my_create_data.log 2>&1 &&
+  poisson_noise my_span1 my_uniform.hs 1 1 >> my_create_data.log 2>&1
+if [ $? -ne 0 ]; then
+  echo "ERROR creating data. Check my_create_data.log"; exit 1;
+fi
+rm -f my_uniform.* my_span1_template.s
+
+num_segments=`expr 2 \* ${max_ring_diff} + 1`
+for num_threads in ${num_threads_list}; do
+  OMP_NUM_THREADS=${num_threads}
+  export OMP_NUM_THREADS
+  for num_segments_to_combine in ${num_segments} 11; do
+    output=my_SSRB_${num_segments_to_combine}_${num_threads}threads
+    echo "===  SSRB combining ${num_segments_to_combine} segments with ${num_threads} threads"
+    start=`date +%s`
+    SSRB ${output} my_span1.hs ${num_segments_to_combine} > ${output}.log 2>&1
+    if [ $? -ne 0 ]; then
+      echo "ERROR running SSRB. Check ${output}.log"; exit 1;
+    fi
+    end=`date +%s`
+    echo "This took `expr $end - $start` seconds (wall-clock)"
+    first_output=my_SSRB_${num_segments_to_combine}_`echo ${num_threads_list} | cut -d ' ' -f 1`threads
+    if [ ${output} != ${first_output} ]; then
+      if compare_projdata ${first_output}.hs ${output}.hs > my_compare_${output}.log 2>&1; then
+        echo "Result is identical to the one with the first number of threads"
+      else
+        echo "Result is different from the one with the first number of threads. Check my_compare_${output}.log"
+      fi
+    fi
+  done
+done
+
+cd ..
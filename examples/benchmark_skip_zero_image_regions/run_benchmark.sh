@@ -0,0 +1,68 @@
+#! /bin/sh
+# Benchmark for forward projection with and without skipping zero image regions.
+# It generates a phantom of a part of the body (which does not fill the whole
+# image), forward projects it with several projectors and reports the timings.
+# The projections with and without skipping should be identical.
+#
+# STIR utilities need to be in your PATH.
+#
+#  Copyright (C) 2026, agent
+#  This file is part of STIR.
+#
+#  SPDX-License-Identifier: Apache-2.0
+#
+#  See STIR/LICENSE.txt for details
+#
+# Author agent
+#
+
+# first need to set this to the C locale, as this is what the STIR utilities use
+LC_ALL=C
+export LC_ALL
+
+mkdir -p output
+cd output
+
+echo "===  make phantom"
+generate_image ../generate_whole_body_phantom.par > my_generate_image.log 2>&1
+if [ $? -ne 0 ]; then
+  echo "ERROR running generate_image. Check my_generate_image.log"; exit 1;
+fi
+
+echo "===  create template sinogram (DSTE in 3D with max ring diff 1)"
+template_sino=my_DSTE_3D_rd1_template.hs
+cat > my_input.txt <<EOT
+Discovery STE
+
+1
+n
+
+0
+1
+EOT
+create_projdata_template ${template_sino} < my_input.txt > my_create_template.log 2>&1
+if [ $? -ne 0 ]; then
+  echo "ERROR running create_projdata_template. Check my_create_template.log"; exit 1;
+fi
+
+for projector in ray_tracing proj_matrix_ray_tracing; do
+  for skip in "" _skip_zero_image_regions; do
+    par=forward_projector_${projector}${skip}.par
+    echo "===  forward project with ${par}"
+    start=`date +%s`
+    forward_project my_fwd_${projector}${skip}.hs my_whole_body_phantom.hv ${template_sino} ../${par} > my_fwd_${projector}${skip}.log 2>&1
+    if [ $? -ne 0 ]; then
+      echo "ERROR running forward_project. Check my_fwd_${projector}${skip}.log"; exit 1;
+    fi
+    end=`date +%s`
+    echo "This took `expr $end - $start` seconds (wall-clock)"
+  done
+  echo "===  compare projections of ${projector}"
+  if compare_projdata my_fwd_${projector}.hs my_fwd_${projector}_skip_zero_image_regions.hs > my_compare_${projector}.log 2>&1; then
+    echo "Projections are identical"
+  else
+    echo "Projections are different. Check my_compare_${projector}.log"
+  fi
+done
+
+cd ..
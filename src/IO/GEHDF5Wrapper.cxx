@@ -742,6 +742,18 @@ Succeeded GEHDF5Wrapper::read_list_data( char* output,
     return Succeeded::yes;
 }
 
+hsize_t GEHDF5Wrapper::get_list_data_chunk_size() const
+{
+    if(!is_list_file())
+        error("The file provided is not list data. Aborting");
+    const H5::DSetCreatPropList create_plist = m_dataset_sptr->getCreatePlist();
+    if (create_plist.getLayout() != H5D_CHUNKED)
+        return 0;
+    hsize_t chunk_dims[m_max_dataset_dims];
+    create_plist.getChunk(m_dataset_list_Ndims, chunk_dims);
+    return chunk_dims[0];
+}
+
 // Developed for ProjData
 Succeeded GEHDF5Wrapper::read_sinogram(Array<3, unsigned char> &output,
                                           const std::array<hsize_t, 3>& offset,
@@ -29,6 +29,7 @@
 #include "stir/Bin.h"
 #include "stir/Succeeded.h"
 #include "stir/numerics/overlap_interpolate.h"
+#include "stir/IndexRange2D.h"
 #include <typeinfo>
 
 START_NAMESPACE_STIR
@@ -158,6 +159,48 @@ set_up(const shared_ptr<const ProjDataInfo>& noarc_corr_proj_data_info_sptr,
     _arccorr_coords[tang_pos_num] =
       (tang_pos_num+.5F)*tangential_sampling;
   }
+  // The weights used by overlap_interpolate only depend on the coordinates, so we find them
+  // once here by interpolating every non-arc-corrected tangential position separately.
+  {
+    const int min_in_tang_pos_num = _noarc_corr_proj_data_info_sptr->get_min_tangential_pos_num();
+    const int max_in_tang_pos_num = _noarc_corr_proj_data_info_sptr->get_max_tangential_pos_num();
+    const int min_out_tang_pos_num = _arc_corr_proj_data_info_sptr->get_min_tangential_pos_num();
+    const int max_out_tang_pos_num = _arc_corr_proj_data_info_sptr->get_max_tangential_pos_num();
+    Array<2,float> all_weights(IndexRange2D(min_out_tang_pos_num, max_out_tang_pos_num,
+                                            min_in_tang_pos_num, max_in_tang_pos_num));
+    Array<1,float> in(min_in_tang_pos_num, max_in_tang_pos_num);
+    Array<1,float> out(min_out_tang_pos_num, max_out_tang_pos_num);
+    for (int in_tang_pos_num = min_in_tang_pos_num; in_tang_pos_num <= max_in_tang_pos_num; ++in_tang_pos_num)
+      {
+        in.fill(0);
+        in[in_tang_pos_num] = 1;
+        overlap_interpolate(out.begin(), out.end(),
+                            _arccorr_coords.begin(), _arccorr_coords.end(),
+                            in.begin(), in.end(),
+                            _noarccorr_coords.begin(), _noarccorr_coords.end());
+        for (int out_tang_pos_num = min_out_tang_pos_num; out_tang_pos_num <= max_out_tang_pos_num; ++out_tang_pos_num)
+          all_weights[out_tang_pos_num][in_tang_pos_num] = out[out_tang_pos_num];
+      }
+    // store only the range of non-zero weights for every output position
+    _arc_correction_weights.recycle();
+    _arc_correction_weights.grow(min_out_tang_pos_num, max_out_tang_pos_num);
+    for (int out_tang_pos_num = min_out_tang_pos_num; out_tang_pos_num <= max_out_tang_pos_num; ++out_tang_pos_num)
+      {
+        const Array<1,float>& row = all_weights[out_tang_pos_num];
+        int first = min_in_tang_pos_num;
+        while (first <= max_in_tang_pos_num && row[first] == 0)
+          ++first;
+        int last = max_in_tang_pos_num;
+        while (last >= first && row[last] == 0)
+          --last;
+        Array<1,float>& weights = _arc_correction_weights[out_tang_pos_num];
+        if (first > last)
+          continue; // leave empty
+        weights.grow(first, last);
+        for (int in_tang_pos_num = first; in_tang_pos_num <= last; ++in_tang_pos_num)
+          weights[in_tang_pos_num] = row[in_tang_pos_num] / tangential_sampling;
+      }
+  }
   return Succeeded::yes;
 }
     
@@ -225,14 +268,17 @@ ArcCorrection::
 do_arc_correction(Array<1,float>& out, const Array<1,float>& in) const
 {
   assert(in.get_index_range() == _noarccorr_bin_sizes.get_index_range());
-  assert(out.get_min_index() == _arccorr_coords.get_min_index());
-  assert(out.get_max_index() == _arccorr_coords.get_max_index()-1);
-
-  overlap_interpolate(out.begin(), out.end(),
-		      _arccorr_coords.begin(), _arccorr_coords.end(),
-		      in.begin(), in.end(),
-		      _noarccorr_coords.begin(), _noarccorr_coords.end());
-  out /= tangential_sampling;
+  assert(out.get_min_index() == _arc_correction_weights.get_min_index());
+  assert(out.get_max_index() == _arc_correction_weights.get_max_index());
+
+  for (int out_tang_pos_num = out.get_min_index(); out_tang_pos_num <= out.get_max_index(); ++out_tang_pos_num)
+    {
+      const Array<1,float>& weights = _arc_correction_weights[out_tang_pos_num];
+      float value = 0.F;
+      for (int in_tang_pos_num = weights.get_min_index(); in_tang_pos_num <= weights.get_max_index(); ++in_tang_pos_num)
+        value += weights[in_tang_pos_num] * in[in_tang_pos_num];
+      out[out_tang_pos_num] = value;
+    }
 }
 
 void
@@ -309,6 +355,9 @@ do_arc_correction(SegmentBySinogram<float>& out, const SegmentBySinogram<float>&
   assert(*in.get_proj_data_info_sptr() == *_noarc_corr_proj_data_info_sptr);
   assert(*out.get_proj_data_info_sptr() == *_arc_corr_proj_data_info_sptr);
   assert(out.get_segment_num() == in.get_segment_num());
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
   for (int axial_pos_num=in.get_min_axial_pos_num(); axial_pos_num<=in.get_max_axial_pos_num(); ++axial_pos_num)
     for (int view_num=in.get_min_view_num(); view_num<=in.get_max_view_num(); ++view_num)
       do_arc_correction(out[axial_pos_num][view_num], in[axial_pos_num][view_num]);
@@ -332,6 +381,9 @@ do_arc_correction(SegmentByView<float>& out, const SegmentByView<float>& in) con
   assert(*in.get_proj_data_info_sptr() == *_noarc_corr_proj_data_info_sptr);
   assert(*out.get_proj_data_info_sptr() == *_arc_corr_proj_data_info_sptr);
   assert(out.get_segment_num() == in.get_segment_num());
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
   for (int view_num=in.get_min_view_num(); view_num<=in.get_max_view_num(); ++view_num)
     for (int axial_pos_num=in.get_min_axial_pos_num(); axial_pos_num<=in.get_max_axial_pos_num(); ++axial_pos_num)
       do_arc_correction(out[view_num][axial_pos_num], in[view_num][axial_pos_num]);
@@ -355,19 +407,16 @@ do_arc_correction(ProjData& out, const ProjData& in) const
 {
   assert(*in.get_proj_data_info_sptr() == *_noarc_corr_proj_data_info_sptr);
   assert(*out.get_proj_data_info_sptr() == *_arc_corr_proj_data_info_sptr);
-  // Declare temporary viewgram out of the loop to avoid reallocation
-  // There is no default constructor, so we need to set it to some junk first.
-  Viewgram<float> viewgram = 
-    _arc_corr_proj_data_info_sptr->get_empty_viewgram(in.get_min_view_num(), in.get_min_segment_num());
+  // Every segment is read only once, and its viewgrams are arc-corrected in parallel
   for (int segment_num=in.get_min_segment_num(); segment_num<=in.get_max_segment_num(); ++segment_num)
-    for (int view_num=in.get_min_view_num(); view_num<=in.get_max_view_num(); ++view_num)
-      {
-	viewgram = 
-	  _arc_corr_proj_data_info_sptr->get_empty_viewgram(view_num, segment_num);
-	do_arc_correction(viewgram, in.get_viewgram(view_num, segment_num));
-	if (out.set_viewgram(viewgram) == Succeeded::no)
-	  return Succeeded::no;
-      }
+    {
+      const SegmentByView<float> in_segment = in.get_segment_by_view(segment_num);
+      SegmentByView<float> out_segment =
+        _arc_corr_proj_data_info_sptr->get_empty_segment_by_view(segment_num);
+      do_arc_correction(out_segment, in_segment);
+      if (out.set_segment(out_segment) == Succeeded::no)
+        return Succeeded::no;
+    }
   return Succeeded::yes;
 }
 
@@ -17,14 +17,19 @@
 
 #include "stir/ArrayFilter3DUsingConvolution.h"
 //#include "stir/ArrayFilter2DUsingConvolution.h"
+#include "stir/ArrayFilterUsingRealDFTWithPadding.h"
+#include "stir/ArrayFunction.h"
 #include "stir/IndexRange.h"
 #include "stir/VectorWithOffset.h"
 #include "stir/Array.h"
 #include "stir/IndexRange3D.h"
 #include "stir/IndexRange2D.h"
+#include "stir/Succeeded.h"
+#include "stir/error.h"
 
 #include <iostream>
 #include <fstream>
+#include <cmath>
 
 #include <algorithm>
 using std::max;
@@ -40,10 +45,65 @@ using std::endl;
 
 START_NAMESPACE_STIR
 
+namespace { // private namespace for row-wise helpers
+
+//! out_row[x] += sum_i kernel[i]*in_row[x-i], only using indices that are in range
+/*! The loop over \a x is split such that the innermost loop needs no bound checks. */
+template <typename elemT>
+inline void
+add_convolved_row(Array<1,elemT>& out_row, const Array<1,elemT>& in_row, const Array<1,float>& kernel)
+{
+  const int out_min = out_row.get_min_index();
+  const int out_max = out_row.get_max_index();
+  const int in_min = in_row.get_min_index();
+  const int in_max = in_row.get_max_index();
+  for (int i=kernel.get_min_index(); i<=kernel.get_max_index(); ++i)
+    {
+      const int min_x = max(out_min, in_min+i);
+      const int max_x = min(out_max, in_max+i);
+      if (min_x > max_x)
+        continue;
+      const float coefficient = kernel[i];
+      elemT * out_ptr = &out_row[min_x];
+      const elemT * in_ptr = &in_row[min_x-i];
+      for (int n=max_x-min_x+1; n>0; --n)
+        *out_ptr++ += coefficient * *in_ptr++;
+    }
+}
+
+//! out_row[x] += coefficient*in_row[x] (both rows have the same index range)
+template <typename elemT>
+inline void
+add_scaled_row(Array<1,elemT>& out_row, const Array<1,elemT>& in_row, const float coefficient)
+{
+  assert(out_row.get_index_range() == in_row.get_index_range());
+  if (out_row.size() == 0)
+    return;
+  elemT * out_ptr = &out_row[out_row.get_min_index()];
+  const elemT * in_ptr = &in_row[in_row.get_min_index()];
+  for (int n=out_row.get_length(); n>0; --n)
+    *out_ptr++ += coefficient * *in_ptr++;
+}
+
+//! smallest power of 2 which is at least \a n (and at least 2)
+inline int
+power_of_2_at_least(const int n)
+{
+  int result = 2;
+  while (result < n)
+    result *= 2;
+  return result;
+}
+
+} // end of private namespace
+
 template <typename elemT>
 ArrayFilter3DUsingConvolution<elemT>::
 ArrayFilter3DUsingConvolution()
-: filter_coefficients()
+: filter_coefficients(),
+  _kernel_is_separable(false),
+  method(automatic),
+  DFT_kernel_size_threshold(2000)
 {
   
 }
@@ -51,11 +111,103 @@ ArrayFilter3DUsingConvolution()
 template <typename elemT>
 ArrayFilter3DUsingConvolution<elemT>::
 ArrayFilter3DUsingConvolution(const Array <3, float> &filter_coefficients_v)
-: filter_coefficients(filter_coefficients_v)
+: filter_coefficients(filter_coefficients_v),
+  _kernel_is_separable(false),
+  method(automatic),
+  DFT_kernel_size_threshold(2000)
 {
   // TODO: remove 0 elements at the outside
+  check_separability();
+}
+
+template <typename elemT>
+void
+ArrayFilter3DUsingConvolution<elemT>::
+check_separability()
+{
+  _kernel_is_separable = false;
+  if (filter_coefficients.get_length() == 0)
+    return;
+  BasicCoordinate<3,int> min_indices, max_indices;
+  if (!filter_coefficients.get_regular_range(min_indices, max_indices))
+    return;
+
+  // find the element with the largest absolute value
+  BasicCoordinate<3,int> max_location = min_indices;
+  float max_abs_value = 0;
+  for (int k=min_indices[1]; k<=max_indices[1]; ++k)
+    for (int j=min_indices[2]; j<=max_indices[2]; ++j)
+      for (int i=min_indices[3]; i<=max_indices[3]; ++i)
+        if (std::fabs(filter_coefficients[k][j][i]) > max_abs_value)
+          {
+            max_abs_value = std::fabs(filter_coefficients[k][j][i]);
+            max_location[1] = k; max_location[2] = j; max_location[3] = i;
+          }
+  if (max_abs_value == 0)
+    return;
+
+  // a rank-1 kernel satisfies K[k][j][i] = K[k][j0][i0] K[k0][j][i0] K[k0][j0][i] / K[k0][j0][i0]^2
+  const float max_value = filter_coefficients[max_location];
+  kernel_z.recycle(); kernel_z.grow(min_indices[1], max_indices[1]);
+  kernel_y.recycle(); kernel_y.grow(min_indices[2], max_indices[2]);
+  kernel_x.recycle(); kernel_x.grow(min_indices[3], max_indices[3]);
+  for (int k=min_indices[1]; k<=max_indices[1]; ++k)
+    kernel_z[k] = filter_coefficients[k][max_location[2]][max_location[3]] / max_value;
+  for (int j=min_indices[2]; j<=max_indices[2]; ++j)
+    kernel_y[j] = filter_coefficients[max_location[1]][j][max_location[3]] / max_value;
+  for (int i=min_indices[3]; i<=max_indices[3]; ++i)
+    kernel_x[i] = filter_coefficients[max_location[1]][max_location[2]][i];
+
+  const float tolerance = max_abs_value * 1.E-6F;
+  for (int k=min_indices[1]; k<=max_indices[1]; ++k)
+    for (int j=min_indices[2]; j<=max_indices[2]; ++j)
+      for (int i=min_indices[3]; i<=max_indices[3]; ++i)
+        if (std::fabs(filter_coefficients[k][j][i] - kernel_z[k]*kernel_y[j]*kernel_x[i]) > tolerance)
+          return;
+  _kernel_is_separable = true;
+}
+
+template <typename elemT>
+bool
+ArrayFilter3DUsingConvolution<elemT>::
+kernel_is_separable() const
+{
+  return _kernel_is_separable;
+}
+
+template <typename elemT>
+void
+ArrayFilter3DUsingConvolution<elemT>::
+set_method(const Method arg)
+{
+  if (arg == separable && !_kernel_is_separable)
+    error("ArrayFilter3DUsingConvolution: cannot use separable convolution as the kernel is not separable");
+  this->method = arg;
+}
+
+template <typename elemT>
+typename ArrayFilter3DUsingConvolution<elemT>::Method
+ArrayFilter3DUsingConvolution<elemT>::
+get_method() const
+{
+  return this->method;
 }
 
+template <typename elemT>
+void
+ArrayFilter3DUsingConvolution<elemT>::
+set_DFT_kernel_size_threshold(const int arg)
+{
+  this->DFT_kernel_size_threshold = arg;
+}
+
+template <typename elemT>
+int
+ArrayFilter3DUsingConvolution<elemT>::
+get_DFT_kernel_size_threshold() const
+{
+  return this->DFT_kernel_size_threshold;
+}
 
 template <typename elemT>
 bool 
@@ -97,30 +249,30 @@ get_influenced_indices(IndexRange<1>& influenced_index_range,
   return Succeeded::yes;
 }
 
-#if 1
 template <typename elemT>
 void
 ArrayFilter3DUsingConvolution<elemT>::
 do_it(Array<3,elemT>& out_array, const Array<3,elemT>& in_array) const
 {
-
-  const int in_min_z = in_array.get_min_index();
-  const int in_max_z = in_array.get_max_index();
-  const int in_min_y = in_array[in_min_z].get_min_index();
-  const int in_max_y = in_array[in_min_z].get_max_index();
-  const int in_min_x = in_array[in_min_z][in_min_y].get_min_index();
-  const int in_max_x = in_array[in_min_z][in_min_y].get_max_index();
-  
-  
-  const int out_min_z = out_array.get_min_index();
-  const int out_max_z = out_array.get_max_index();
-  const int out_min_y = out_array[out_min_z].get_min_index();
-  const int out_max_y = out_array[out_min_z].get_max_index();
-  const int out_min_x = out_array[out_min_z][out_min_y].get_min_index();
-  const int out_max_x = out_array[out_min_z][out_min_y].get_max_index();
-  
   if (is_trivial())
     {    
+      const int in_min_z = in_array.get_min_index();
+      const int in_max_z = in_array.get_max_index();
+      const int in_min_y = in_array[in_min_z].get_min_index();
+      const int in_max_y = in_array[in_min_z].get_max_index();
+      const int in_min_x = in_array[in_min_z][in_min_y].get_min_index();
+      const int in_max_x = in_array[in_min_z][in_min_y].get_max_index();
+
+      const int out_min_z = out_array.get_min_index();
+      const int out_max_z = out_array.get_max_index();
+      const int out_min_y = out_array[out_min_z].get_min_index();
+      const int out_max_y = out_array[out_min_z].get_max_index();
+      const int out_min_x = out_array[out_min_z][out_min_y].get_min_index();
+      const int out_max_x = out_array[out_min_z][out_min_y].get_max_index();
+
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
       for (int z=out_min_z; z<=out_max_z; z++) 
 	for (int y=out_min_y; y<=out_max_y; y++) 
 	  for (int x=out_min_x; x<=out_max_x; x++) 
@@ -129,49 +281,153 @@ do_it(Array<3,elemT>& out_array, const Array<3,elemT>& in_array) const
 	    out_array[z][y][x] = ((z>=in_min_z && z <= in_max_z ) && (y>=in_min_y && y <= in_max_y ) && 
 	      (x>=in_min_x && x <= in_max_x ) ? in_array[z][y][x] : 0);   
 	  }
-	  return;
+      return;
     }
+
+  switch (this->method)
+    {
+    case direct:
+      do_it_direct(out_array, in_array); break;
+    case separable:
+      do_it_separable(out_array, in_array); break;
+    case DFT:
+      do_it_DFT(out_array, in_array); break;
+    case automatic:
+    default:
+      if (_kernel_is_separable)
+        do_it_separable(out_array, in_array);
+      else if (static_cast<int>(filter_coefficients.size_all()) > this->DFT_kernel_size_threshold)
+        do_it_DFT(out_array, in_array);
+      else
+        do_it_direct(out_array, in_array);
+      break;
+    }
+}
+
+template <typename elemT>
+void
+ArrayFilter3DUsingConvolution<elemT>::
+do_it_direct(Array<3,elemT>& out_array, const Array<3,elemT>& in_array) const
+{
+
+  const int in_min_z = in_array.get_min_index();
+  const int in_max_z = in_array.get_max_index();
+  const int in_min_y = in_array[in_min_z].get_min_index();
+  const int in_max_y = in_array[in_min_z].get_max_index();
+  
+  
+  const int out_min_z = out_array.get_min_index();
+  const int out_max_z = out_array.get_max_index();
+  const int out_min_y = out_array[out_min_z].get_min_index();
+  const int out_max_y = out_array[out_min_z].get_max_index();
   
   const int k_min = filter_coefficients.get_min_index();
   const int k_max = filter_coefficients.get_max_index();
  
   const int j_min = filter_coefficients[k_min].get_min_index();
   const int j_max = filter_coefficients[k_min].get_max_index();
-  const int i_min = filter_coefficients[k_min][j_min].get_min_index();
-  const int i_max = filter_coefficients[k_min][j_min].get_max_index();
-  
   
-  if (true)//k_min != k_max)
-  {  
-    
-   for (int z=out_min_z; z<=out_max_z; z++) 
-      for (int y=out_min_y; y<=out_max_y; y++) 
-	for (int x=out_min_x; x<=out_max_x; x++) 
-	{
-	  out_array[z][y][x] = 0;
- 	  
-   for (int k=max(k_min, z-in_max_z); k<=min(k_max, z-in_min_z); k++) 
-     for (int j=max(j_min, y-in_max_y); j<=min(j_max, y-in_min_y); j++)  
-       for (int i=max(i_min, x-in_max_x); i<=min(i_max, x-in_min_x); i++) 
-		
-		out_array[z][y][x] += filter_coefficients[k][j][i]*in_array[z-k][y-j][x-i];   
-    }
-    
-  }
-  else
-  {
-    if (out_min_y!= out_max_y || out_min_x!=out_max_x)
-      error("3D convolution. check code\n");
-    Array<2,float> array_out_tmp (IndexRange2D(out_min_y,out_max_y,out_min_x,out_max_x));
-    do_it_2d(array_out_tmp, in_array[out_min_z]);
-    out_array[out_min_z][out_min_y][out_min_x] =  array_out_tmp[out_min_y][out_min_x];
-	
-  }
-
+  // Note: for every output element, contributions are added in the same order (k,j,i)
+  // as in a straightforward implementation, but the loop over x is innermost
+  // such that it can be done without bound checks (see add_convolved_row).
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z=out_min_z; z<=out_max_z; z++) 
+    for (int y=out_min_y; y<=out_max_y; y++) 
+      {
+        Array<1,elemT>& out_row = out_array[z][y];
+        out_row.fill(0);
+        for (int k=max(k_min, z-in_max_z); k<=min(k_max, z-in_min_z); k++) 
+          for (int j=max(j_min, y-in_max_y); j<=min(j_max, y-in_min_y); j++)  
+            add_convolved_row(out_row, in_array[z-k][y-j], filter_coefficients[k][j]);
+      }
 }
 
+template <typename elemT>
+void
+ArrayFilter3DUsingConvolution<elemT>::
+do_it_separable(Array<3,elemT>& out_array, const Array<3,elemT>& in_array) const
+{
+  const int in_min_z = in_array.get_min_index();
+  const int in_max_z = in_array.get_max_index();
+  const int in_min_y = in_array[in_min_z].get_min_index();
+  const int in_max_y = in_array[in_min_z].get_max_index();
+
+  const int out_min_z = out_array.get_min_index();
+  const int out_max_z = out_array.get_max_index();
+  const int out_min_y = out_array[out_min_z].get_min_index();
+  const int out_max_y = out_array[out_min_z].get_max_index();
+  const int out_min_x = out_array[out_min_z][out_min_y].get_min_index();
+  const int out_max_x = out_array[out_min_z][out_min_y].get_max_index();
+
+  // convolve along x: z,y in input range, x in output range
+  Array<3,elemT> tmp_x(IndexRange3D(in_min_z, in_max_z, in_min_y, in_max_y, out_min_x, out_max_x));
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int z=in_min_z; z<=in_max_z; z++) 
+    for (int y=in_min_y; y<=in_max_y; y++) 
+      add_convolved_row(tmp_x[z][y], in_array[z][y], kernel_x);
+
+  // convolve along y: z in input range, y,x in output range
+  Array<3,elemT> tmp_y(IndexRange3D(in_min_z, in_max_z, out_min_y, out_max_y, out_min_x, out_max_x));
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int z=in_min_z; z<=in_max_z; z++) 
+    for (int y=out_min_y; y<=out_max_y; y++) 
+      for (int j=max(kernel_y.get_min_index(), y-in_max_y); j<=min(kernel_y.get_max_index(), y-in_min_y); j++)
+        add_scaled_row(tmp_y[z][y], tmp_x[z][y-j], kernel_y[j]);
+
+  tmp_x.recycle();
+
+  // convolve along z
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
 #endif
+  for (int z=out_min_z; z<=out_max_z; z++) 
+    for (int y=out_min_y; y<=out_max_y; y++) 
+      {
+        Array<1,elemT>& out_row = out_array[z][y];
+        out_row.fill(0);
+        for (int k=max(kernel_z.get_min_index(), z-in_max_z); k<=min(kernel_z.get_max_index(), z-in_min_z); k++)
+          add_scaled_row(out_row, tmp_y[z-k][y], kernel_z[k]);
+      }
+}
+
+template <typename elemT>
+void
+ArrayFilter3DUsingConvolution<elemT>::
+do_it_DFT(Array<3,elemT>& out_array, const Array<3,elemT>& in_array) const
+{
+  BasicCoordinate<3,int> in_min, in_max, out_min, out_max, kernel_min, kernel_max;
+  if (!in_array.get_regular_range(in_min, in_max) ||
+      !out_array.get_regular_range(out_min, out_max) ||
+      !filter_coefficients.get_regular_range(kernel_min, kernel_max))
+    {
+      // fall back to direct convolution
+      do_it_direct(out_array, in_array);
+      return;
+    }
 
+  // find size of padded (periodic) arrays such that no aliasing occurs.
+  // We need that all input indices and all indices (out - kernel) are different modulo the size.
+  BasicCoordinate<3,int> padded_sizes;
+  for (int d=1; d<=3; ++d)
+    {
+      const int lowest = min(in_min[d], out_min[d]-kernel_max[d]);
+      const int highest = max(in_max[d], out_max[d]-kernel_min[d]);
+      padded_sizes[d] = power_of_2_at_least(highest - lowest + 1);
+    }
+
+  Array<3,float> padded_kernel(IndexRange3D(padded_sizes[1], padded_sizes[2], padded_sizes[3]));
+  transform_array_to_periodic_indices(padded_kernel, filter_coefficients);
+  ArrayFilterUsingRealDFTWithPadding<3,elemT> DFT_filter;
+  if (DFT_filter.set_kernel(padded_kernel) == Succeeded::no)
+    error("ArrayFilter3DUsingConvolution: error setting kernel for DFT");
+  DFT_filter(out_array, in_array);
+}
 
 #if 0
 template <typename elemT>
@@ -23,8 +23,16 @@
 #include "stir/DetectorCoordinateMap.h"
 #include "stir/modulo.h"
 #include "stir/Succeeded.h"
+#include "stir/warning.h"
+#include <algorithm>
+#include <cmath>
 
 START_NAMESPACE_STIR
+
+namespace {
+  //! maximum distance (in mm) between a coordinate and the crystal centre for find_detection_position_given_cartesian_coordinate()
+  const float max_distance_for_lookup = 0.1F;
+}
 	
 DetectorCoordinateMap::det_pos_to_coord_type DetectorCoordinateMap::read_detectormap_from_file_help( const std::string& filename )
 {
@@ -115,26 +123,24 @@ void DetectorCoordinateMap::set_detector_map( const DetectorCoordinateMap::det_p
               "\nOveral  size: " + std::to_string(coord_map.size()));
 
 //    std::sort(coords_to_be_sorted.begin(), coords_to_be_sorted.end());
+    input_index_to_det_pos.resize(coord_map.size());
+    det_pos_to_coord.resize(coord_map.size());
     stir::DetectionPosition<> detpos(0,0,0);
     for(std::vector<double>::iterator it = coords_to_be_sorted.begin(); it != coords_to_be_sorted.end();++it)
       {
+        const unsigned index = get_flat_index(detpos);
 #if 0
-        input_index_to_det_pos[map_for_sorting_coordinates[*it]] = detpos;
+        input_index_to_det_pos[get_flat_index(map_for_sorting_coordinates[*it])] = detpos;
         auto cart_coord = coord_map.at(map_for_sorting_coordinates[*it]);
 #else
-        input_index_to_det_pos[detpos] = detpos;
+        input_index_to_det_pos[index] = detpos;
         auto cart_coord = coord_map.at(detpos);
 #endif
-        // rounding cart_coord to 3 and 2 decimal points then filling maps
+        // rounding cart_coord to 3 decimal points
         cart_coord.z() = (round(cart_coord.z()*1000.0F))/1000.0F;
         cart_coord.y() = (round(cart_coord.y()*1000.0F))/1000.0F;
         cart_coord.x() = (round(cart_coord.x()*1000.0F))/1000.0F;
-	det_pos_to_coord[detpos] = cart_coord;
-        detection_position_map_given_cartesian_coord_keys_3_decimal[cart_coord] = detpos; //used to find bin from listmode data
-        cart_coord.z() = (round(cart_coord.z()*100.0F))/100.0F;
-        cart_coord.y() = (round(cart_coord.y()*100.0F))/100.0F;
-        cart_coord.x() = (round(cart_coord.x()*100.0F))/100.0F;
-        detection_position_map_given_cartesian_coord_keys_2_decimal[cart_coord] = detpos;
+        det_pos_to_coord[index] = cart_coord;
 
         ++detpos.tangential_coord();
         if (detpos.tangential_coord() == num_tangential_coords)
@@ -148,6 +154,56 @@ void DetectorCoordinateMap::set_detector_map( const DetectorCoordinateMap::det_p
               }
           }
       }
+    build_grid();
+}
+
+void DetectorCoordinateMap::build_grid()
+{
+  // find bounding box
+  CartesianCoordinate3D<float> min_coord = det_pos_to_coord[0];
+  CartesianCoordinate3D<float> max_coord = det_pos_to_coord[0];
+  for (const auto& coord : det_pos_to_coord)
+    for (int d=1; d<=3; ++d)
+      {
+        min_coord[d] = std::min(min_coord[d], coord[d]);
+        max_coord[d] = std::max(max_coord[d], coord[d]);
+      }
+  // choose the cell size such that there is about 1 crystal per cell on average over the bounding box,
+  // but not smaller than the search distance (such that we only need to search neighbouring cells)
+  const float num_crystals = static_cast<float>(det_pos_to_coord.size());
+  float volume = 1.F;
+  for (int d=1; d<=3; ++d)
+    volume *= std::max(max_coord[d] - min_coord[d], max_distance_for_lookup);
+  grid_cell_size = std::max(std::cbrt(volume/num_crystals), max_distance_for_lookup);
+  grid_origin = min_coord;
+  std::size_t num_cells = 1;
+  for (int d=1; d<=3; ++d)
+    {
+      grid_size[d] = static_cast<int>(std::floor((max_coord[d] - min_coord[d])/grid_cell_size)) + 1;
+      num_cells *= grid_size[d];
+    }
+
+  // sort crystals into cells (in compressed row storage)
+  std::vector<unsigned> cell_of_crystal(det_pos_to_coord.size());
+  grid_cell_start.assign(num_cells+1, 0U);
+  for (unsigned i=0; i<det_pos_to_coord.size(); ++i)
+    {
+      std::size_t cell = 0;
+      for (int d=1; d<=3; ++d)
+        {
+          const int cell_d =
+            std::min(static_cast<int>((det_pos_to_coord[i][d] - grid_origin[d])/grid_cell_size), grid_size[d]-1);
+          cell = cell*grid_size[d] + cell_d;
+        }
+      cell_of_crystal[i] = static_cast<unsigned>(cell);
+      ++grid_cell_start[cell+1];
+    }
+  for (std::size_t c=0; c<num_cells; ++c)
+    grid_cell_start[c+1] += grid_cell_start[c];
+  grid_crystal_indices.resize(det_pos_to_coord.size());
+  std::vector<unsigned> fill_position(grid_cell_start.begin(), grid_cell_start.end()-1);
+  for (unsigned i=0; i<det_pos_to_coord.size(); ++i)
+    grid_crystal_indices[fill_position[cell_of_crystal[i]]++] = i;
 }
 
 // creates maps to convert between stir and 3d coordinates
@@ -163,47 +219,39 @@ DetectorCoordinateMap::
 find_detection_position_given_cartesian_coordinate(DetectionPosition<>& det_pos,
                                                    const CartesianCoordinate3D<float>& cart_coord) const
 {
-  /*! first round the cartesian coordinates, it might happen that the cart_coord
-   is not precisely pointing to the center of the crystal and
-   then the det_pos cannot be found using the map
-  */
-  //rounding cart_coord to 3 decimal place and find det_pos
-  CartesianCoordinate3D<float> rounded_cart_coord;
-  rounded_cart_coord.z() = round(cart_coord.z()*1000.0F)/1000.0F;
-  rounded_cart_coord.y() = round(cart_coord.y()*1000.0F)/1000.0F;
-  rounded_cart_coord.x() = round(cart_coord.x()*1000.0F)/1000.0F;
-	if (detection_position_map_given_cartesian_coord_keys_3_decimal.count(rounded_cart_coord))
-	{
-          det_pos =	detection_position_map_given_cartesian_coord_keys_3_decimal.at(rounded_cart_coord);
-          return Succeeded::yes;
-	}
-	else
-	{
-          //rounding cart_coord to 2 decimal place and find det_pos
-		rounded_cart_coord.z() = round(cart_coord.z()*100.0F)/100.0F;
-		rounded_cart_coord.y() = round(cart_coord.y()*100.0f)/100.0F;
-		rounded_cart_coord.x() = round(cart_coord.x()*100.0F)/100.0F;
-		if (detection_position_map_given_cartesian_coord_keys_2_decimal.count(rounded_cart_coord))
-		{
-                  det_pos =	detection_position_map_given_cartesian_coord_keys_2_decimal.at(rounded_cart_coord);
-                  return Succeeded::yes;
-		}
-		else
-		{
-			rounded_cart_coord.z() = round(cart_coord.z()*10.0F)/10.0F;
-			rounded_cart_coord.y() = round(cart_coord.y()*10.0f)/10.0F;
-			rounded_cart_coord.x() = round(cart_coord.x()*10.0F)/10.0F;
-			if (detection_position_map_given_cartesian_coord_keys_2_decimal.count(rounded_cart_coord))
-			{
-                  det_pos =	detection_position_map_given_cartesian_coord_keys_2_decimal.at(rounded_cart_coord);
-                  return Succeeded::yes;
-			}else{
-				warning("cartesian coordinate (x, y, z)=(%f, %f, %f) does not exist in the inner map",
-							cart_coord.x(), cart_coord.y(), cart_coord.z());
-				return Succeeded::no;
-			}
-		}
-	}
+  // find the cell, and search it and its neighbours for the closest crystal
+  BasicCoordinate<3,int> min_cell, max_cell;
+  for (int d=1; d<=3; ++d)
+    {
+      const int cell_d = static_cast<int>(std::floor((cart_coord[d] - grid_origin[d])/grid_cell_size));
+      min_cell[d] = std::max(cell_d-1, 0);
+      max_cell[d] = std::min(cell_d+1, grid_size[d]-1);
+    }
+  float min_distance_squared = square(max_distance_for_lookup);
+  bool found = false;
+  for (int c1=min_cell[1]; c1<=max_cell[1]; ++c1)
+    for (int c2=min_cell[2]; c2<=max_cell[2]; ++c2)
+      for (int c3=min_cell[3]; c3<=max_cell[3]; ++c3)
+        {
+          const std::size_t cell = (static_cast<std::size_t>(c1)*grid_size[2] + c2)*grid_size[3] + c3;
+          for (unsigned i=grid_cell_start[cell]; i<grid_cell_start[cell+1]; ++i)
+            {
+              const unsigned index = grid_crystal_indices[i];
+              const float distance_squared = norm_squared(det_pos_to_coord[index] - cart_coord);
+              if (distance_squared <= min_distance_squared)
+                {
+                  min_distance_squared = distance_squared;
+                  det_pos = input_index_to_det_pos[index];
+                  found = true;
+                }
+            }
+        }
+  if (found)
+    return Succeeded::yes;
+
+  warning("cartesian coordinate (x, y, z)=(%f, %f, %f) does not exist in the inner map",
+          cart_coord.x(), cart_coord.y(), cart_coord.z());
+  return Succeeded::no;
 }
 
 END_NAMESPACE_STIR
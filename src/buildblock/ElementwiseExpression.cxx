@@ -0,0 +1,333 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup buildblock
+
+  \brief Implementation of class stir::ElementwiseExpression
+
+  \author agent
+*/
+
+#include "stir/ElementwiseExpression.h"
+#include "stir/error.h"
+#include <boost/format.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <cassert>
+
+START_NAMESPACE_STIR
+
+ElementwiseExpression::
+ElementwiseExpression(const std::string& expression_v)
+  : expression(expression_v), num_inputs(0), max_stack_size(0)
+{
+  std::size_t pos = 0;
+  parse_sum(pos);
+  skip_spaces(pos);
+  if (pos != expression.size())
+    parse_error(pos, "unexpected character");
+
+  // find how many intermediate results we need to store
+  int stack_size = 0;
+  for (std::vector<Operation>::const_iterator iter = operations.begin(); iter != operations.end(); ++iter)
+    {
+      switch (iter->type)
+        {
+        case constant_op:
+        case variable_op:
+          ++stack_size;
+          break;
+        case add_op: case subtract_op: case multiply_op: case divide_op:
+        case power_op: case min_op: case max_op:
+          --stack_size;
+          break;
+        default:
+          break;
+        }
+      max_stack_size = std::max(max_stack_size, stack_size);
+    }
+}
+
+void
+ElementwiseExpression::
+parse_error(const std::size_t pos, const std::string& message) const
+{
+  error(boost::format("ElementwiseExpression: %1% at position %2% in expression '%3%'")
+        % message % (pos+1) % expression);
+}
+
+void
+ElementwiseExpression::
+skip_spaces(std::size_t& pos) const
+{
+  while (pos < expression.size() && std::isspace(static_cast<unsigned char>(expression[pos])))
+    ++pos;
+}
+
+void
+ElementwiseExpression::
+add_operation(const OperationType type, const float value, const int variable_index)
+{
+  Operation operation;
+  operation.type = type;
+  operation.value = value;
+  operation.variable_index = variable_index;
+  operations.push_back(operation);
+}
+
+// sum := product (('+'|'-') product)*
+void
+ElementwiseExpression::
+parse_sum(std::size_t& pos)
+{
+  parse_product(pos);
+  while (true)
+    {
+      skip_spaces(pos);
+      if (pos >= expression.size() || (expression[pos] != '+' && expression[pos] != '-'))
+        return;
+      const OperationType type = expression[pos] == '+' ? add_op : subtract_op;
+      ++pos;
+      parse_product(pos);
+      add_operation(type);
+    }
+}
+
+// product := unary (('*'|'/') unary)*
+void
+ElementwiseExpression::
+parse_product(std::size_t& pos)
+{
+  parse_unary(pos);
+  while (true)
+    {
+      skip_spaces(pos);
+      if (pos >= expression.size() || (expression[pos] != '*' && expression[pos] != '/'))
+        return;
+      const OperationType type = expression[pos] == '*' ? multiply_op : divide_op;
+      ++pos;
+      parse_unary(pos);
+      add_operation(type);
+    }
+}
+
+// unary := '-' unary | power
+void
+ElementwiseExpression::
+parse_unary(std::size_t& pos)
+{
+  skip_spaces(pos);
+  if (pos < expression.size() && expression[pos] == '-')
+    {
+      ++pos;
+      parse_unary(pos);
+      add_operation(negate_op);
+    }
+  else
+    parse_power(pos);
+}
+
+// power := primary ('^' unary)?
+void
+ElementwiseExpression::
+parse_power(std::size_t& pos)
+{
+  parse_primary(pos);
+  skip_spaces(pos);
+  if (pos < expression.size() && expression[pos] == '^')
+    {
+      ++pos;
+      // note: this makes ^ right-associative
+      parse_unary(pos);
+      add_operation(power_op);
+    }
+}
+
+// primary := number | variable | function '(' sum (',' sum)? ')' | '(' sum ')'
+void
+ElementwiseExpression::
+parse_primary(std::size_t& pos)
+{
+  skip_spaces(pos);
+  if (pos >= expression.size())
+    parse_error(pos, "unexpected end");
+
+  const char c = expression[pos];
+  if (c == '(')
+    {
+      ++pos;
+      parse_sum(pos);
+      skip_spaces(pos);
+      if (pos >= expression.size() || expression[pos] != ')')
+        parse_error(pos, "expected ')'");
+      ++pos;
+      return;
+    }
+  if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+    {
+      const char * const start = expression.c_str() + pos;
+      char * end;
+      const double value = std::strtod(start, &end);
+      if (end == start)
+        parse_error(pos, "invalid number");
+      pos += end - start;
+      add_operation(constant_op, static_cast<float>(value));
+      return;
+    }
+  if (!std::isalpha(static_cast<unsigned char>(c)))
+    parse_error(pos, "unexpected character");
+
+  std::size_t end = pos;
+  while (end < expression.size() && std::isalpha(static_cast<unsigned char>(expression[end])))
+    ++end;
+  const std::string name = expression.substr(pos, end - pos);
+  const std::size_t name_pos = pos;
+  pos = end;
+  if (name.size() == 1 && std::islower(static_cast<unsigned char>(c)))
+    {
+      const int variable_index = c - 'a';
+      num_inputs = std::max(num_inputs, variable_index + 1);
+      add_operation(variable_op, 0.F, variable_index);
+      return;
+    }
+
+  OperationType type;
+  int num_arguments = 1;
+  if (name == "min")
+    { type = min_op; num_arguments = 2; }
+  else if (name == "max")
+    { type = max_op; num_arguments = 2; }
+  else if (name == "exp")
+    type = exp_op;
+  else if (name == "log")
+    type = log_op;
+  else if (name == "sqrt")
+    type = sqrt_op;
+  else if (name == "abs")
+    type = abs_op;
+  else
+    {
+      parse_error(name_pos, "unknown function or variable '" + name + "'");
+      return;
+    }
+  skip_spaces(pos);
+  if (pos >= expression.size() || expression[pos] != '(')
+    parse_error(pos, "expected '(' after function name");
+  ++pos;
+  for (int argument_num = 0; argument_num < num_arguments; ++argument_num)
+    {
+      if (argument_num > 0)
+        {
+          skip_spaces(pos);
+          if (pos >= expression.size() || expression[pos] != ',')
+            parse_error(pos, "expected ','");
+          ++pos;
+        }
+      parse_sum(pos);
+    }
+  skip_spaces(pos);
+  if (pos >= expression.size() || expression[pos] != ')')
+    parse_error(pos, "expected ')'");
+  ++pos;
+  add_operation(type);
+}
+
+void
+ElementwiseExpression::
+evaluate(float * const output,
+         const std::vector<const float *>& inputs,
+         const std::size_t num_elements) const
+{
+  if (static_cast<int>(inputs.size()) < num_inputs)
+    error(boost::format("ElementwiseExpression: expression '%1%' needs %2% inputs, but only %3% are given")
+          % expression % num_inputs % inputs.size());
+
+  // intermediate results are stored in blocks of this size
+  const std::size_t block_size = 64;
+  std::vector<float> stack(max_stack_size*block_size);
+  for (std::size_t start = 0; start < num_elements; start += block_size)
+    {
+      const std::size_t size = std::min(block_size, num_elements - start);
+      // index of the last block on the stack (-1 if the stack is empty)
+      int top_idx = -1;
+      for (std::vector<Operation>::const_iterator iter = operations.begin(); iter != operations.end(); ++iter)
+        {
+          switch (iter->type)
+            {
+            case constant_op:
+              {
+                float * const top = &stack[++top_idx * block_size];
+                std::fill(top, top + size, iter->value);
+                break;
+              }
+            case variable_op:
+              {
+                float * const top = &stack[++top_idx * block_size];
+                const float * const input = inputs[iter->variable_index] + start;
+                std::copy(input, input + size, top);
+                break;
+              }
+#define STIR_BINARY_OPERATION(op_type, expr)                        \
+            case op_type:                                           \
+              {                                                     \
+                float * const x = &stack[(top_idx-1) * block_size]; \
+                const float * const y = x + block_size;             \
+                for (std::size_t i = 0; i < size; ++i)              \
+                  x[i] = expr;                                      \
+                --top_idx;                                          \
+                break;                                              \
+              }
+              STIR_BINARY_OPERATION(add_op, x[i] + y[i])
+              STIR_BINARY_OPERATION(subtract_op, x[i] - y[i])
+              STIR_BINARY_OPERATION(multiply_op, x[i] * y[i])
+              STIR_BINARY_OPERATION(divide_op, x[i] / y[i])
+              STIR_BINARY_OPERATION(power_op, std::pow(x[i], y[i]))
+              STIR_BINARY_OPERATION(min_op, std::min(x[i], y[i]))
+              STIR_BINARY_OPERATION(max_op, std::max(x[i], y[i]))
+#undef STIR_BINARY_OPERATION
+#define STIR_UNARY_OPERATION(op_type, expr)                         \
+            case op_type:                                           \
+              {                                                     \
+                float * const x = &stack[top_idx * block_size];     \
+                for (std::size_t i = 0; i < size; ++i)              \
+                  x[i] = expr;                                      \
+                break;                                              \
+              }
+              STIR_UNARY_OPERATION(negate_op, -x[i])
+              STIR_UNARY_OPERATION(exp_op, std::exp(x[i]))
+              STIR_UNARY_OPERATION(log_op, std::log(x[i]))
+              STIR_UNARY_OPERATION(sqrt_op, std::sqrt(x[i]))
+              STIR_UNARY_OPERATION(abs_op, std::fabs(x[i]))
+#undef STIR_UNARY_OPERATION
+            }
+        }
+      // only the final result is left on the stack
+      assert(top_idx == 0);
+      std::copy(stack.begin(), stack.begin() + size, output + start);
+    }
+}
+
+float
+ElementwiseExpression::
+evaluate(const std::vector<float>& inputs) const
+{
+  std::vector<const float *> input_ptrs(inputs.size());
+  for (std::size_t i = 0; i < inputs.size(); ++i)
+    input_ptrs[i] = &inputs[i];
+  float output;
+  this->evaluate(&output, input_ptrs, 1);
+  return output;
+}
+
+END_NAMESPACE_STIR
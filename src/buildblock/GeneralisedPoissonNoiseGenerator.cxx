@@ -25,11 +25,10 @@
 #include <boost/random/normal_distribution.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/variate_generator.hpp>
+#include <boost/cstdint.hpp>
 
 START_NAMESPACE_STIR
 
-GeneralisedPoissonNoiseGenerator::base_generator_type GeneralisedPoissonNoiseGenerator::generator;
-
 GeneralisedPoissonNoiseGenerator::
 GeneralisedPoissonNoiseGenerator(const float scaling_factor,
                                  const bool preserve_mean)
@@ -48,15 +47,41 @@ seed(unsigned int value)
   this->generator.seed(static_cast<poisson_result_type>(value));
 }
 
+//! "splitmix64" finaliser, such that neighbouring values give unrelated results
+static inline
+boost::uint64_t
+mix_bits(boost::uint64_t z)
+{
+  z += 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+unsigned int
+GeneralisedPoissonNoiseGenerator::
+get_stream_seed(const boost::uint64_t call_seed, const int realisation_num, const int segment_num, const int view_num)
+{
+  // mix in every number in turn (using all of its bits)
+  boost::uint64_t z = mix_bits(call_seed);
+  z = mix_bits(z ^ static_cast<boost::uint64_t>(static_cast<boost::uint32_t>(realisation_num)));
+  z = mix_bits(z ^ static_cast<boost::uint64_t>(static_cast<boost::uint32_t>(segment_num)));
+  z = mix_bits(z ^ static_cast<boost::uint64_t>(static_cast<boost::uint32_t>(view_num)));
+  const unsigned int stream_seed = static_cast<unsigned int>(z ^ (z >> 32));
+  // the generator does not accept 0
+  return stream_seed==0U ? 1U : stream_seed;
+}
+
 // function that generates a Poisson noise realisation, i.e. without
 // using the scaling_factor
 unsigned int
 GeneralisedPoissonNoiseGenerator::
-generate_poisson_random(const float mu)
+generate_poisson_random(const float mu, base_generator_type& generator)
 {  
-  static boost::uniform_01<base_generator_type> random01(generator);
+  // note: use a reference such that the state of the generator is updated
+  boost::uniform_01<base_generator_type&> random01(generator);
   // normal distribution with mean=0 and sigma=1
-  static boost::normal_distribution<double> normal_distrib01(0., 1.);
+  boost::normal_distribution<double> normal_distrib01(0., 1.);
 
   // check if mu is large. If so, use the normal distribution
   // note: the threshold must be such that exp(threshold) is still a floating point number
@@ -99,9 +124,10 @@ generate_poisson_random(const float mu)
 
 float
 GeneralisedPoissonNoiseGenerator::
-generate_scaled_poisson_random(const float mu, const float scaling_factor, const bool preserve_mean)
+generate_scaled_poisson_random(const float mu, const float scaling_factor, const bool preserve_mean,
+                               base_generator_type& generator)
 {
-  const unsigned int random_poisson = generate_poisson_random(mu*scaling_factor);
+  const unsigned int random_poisson = generate_poisson_random(mu*scaling_factor, generator);
   return
     preserve_mean
     ? random_poisson / scaling_factor
@@ -113,7 +139,7 @@ GeneralisedPoissonNoiseGenerator::
 generate_random(const float mu)
 {
   return
-    generate_scaled_poisson_random(mu, scaling_factor, preserve_mean);
+    generate_scaled_poisson_random(mu, scaling_factor, preserve_mean, this->generator);
 }
 
 
@@ -121,19 +147,52 @@ void
 GeneralisedPoissonNoiseGenerator::
 generate_random(ProjData& output_projdata, 
                 const ProjData& input_projdata)
+{
+  // we do not own output_projdata, so use a shared_ptr with a no-op deleter
+  std::vector<shared_ptr<ProjData> > output_projdata_sptrs(1, shared_ptr<ProjData>(&output_projdata, [](ProjData*){}));
+  this->generate_random(output_projdata_sptrs, input_projdata);
+}
+
+void 
+GeneralisedPoissonNoiseGenerator::
+generate_random(const std::vector<shared_ptr<ProjData> >& output_projdata_sptrs,
+                const ProjData& input_projdata)
 {  
+  const int num_realisations = static_cast<int>(output_projdata_sptrs.size());
+  // draw a seed for this call from our generator, such that every call gives new realisations
+  const boost::uint64_t call_seed =
+    (static_cast<boost::uint64_t>(this->generator()) << 32) | static_cast<boost::uint64_t>(this->generator());
   for (int seg= input_projdata.get_min_segment_num(); 
        seg<=input_projdata.get_max_segment_num();
        seg++)  
   {
-    SegmentByView<float> seg_output= 
-      output_projdata.get_empty_segment_by_view(seg);
-  
-    this->generate_random(seg_output, input_projdata.get_segment_by_view(seg));
-    if (output_projdata.set_segment(seg_output) == Succeeded::no)
-      error("Problem writing to projection data");
+    // read input only once for all realisations
+    const SegmentByView<float> seg_input = input_projdata.get_segment_by_view(seg);
+
+    for (int r=0; r<num_realisations; ++r)
+      {
+        SegmentByView<float> seg_output =
+          output_projdata_sptrs[r]->get_empty_segment_by_view(seg);
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for (int view=seg_input.get_min_view_num(); view<=seg_input.get_max_view_num(); ++view)
+          {
+            // every viewgram has its own stream, such that results do not depend on
+            // the number of threads
+            base_generator_type view_generator(static_cast<poisson_result_type>(get_stream_seed(call_seed, r, seg, view)));
+            Array<2,float>& out = seg_output[view];
+            const Array<2,float>& in = seg_input[view];
+            Array<2,float>::full_iterator out_iter = out.begin_all();
+            for (Array<2,float>::const_full_iterator in_iter = in.begin_all();
+                 in_iter != in.end_all();
+                 ++in_iter, ++out_iter)
+              *out_iter = generate_scaled_poisson_random(*in_iter, this->scaling_factor, this->preserve_mean, view_generator);
+          }
+        if (output_projdata_sptrs[r]->set_segment(seg_output) == Succeeded::no)
+          error("Problem writing to projection data");
+      }
   }
 }
 
 END_NAMESPACE_STIR
-
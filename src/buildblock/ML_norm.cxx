@@ -25,6 +25,10 @@
 #include "stir/ML_norm.h"
 #include "stir/SegmentBySinogram.h"
 #include "stir/stream.h"
+#include <vector>
+#ifdef STIR_OPENMP
+#include <omp.h>
+#endif
 
 #include <algorithm>
 using std::min;
@@ -787,6 +791,14 @@ is_in_data(const int ra, const int a, const int rb, const int b) const
     return b+num_detectors_per_ring<=get_max_b(a);
 }
 
+const Array<1,float>&
+FanProjData::
+get_fan(const int ra, const int a, const int rb) const
+{
+  assert(ra<rb);
+  return (*this)[ra][a][rb];
+}
+
 void FanProjData::fill(const float d)
 {
   base_type::fill(d);
@@ -1174,6 +1186,11 @@ void apply_block_norm(FanProjData& fan_data, const BlockData3D& block_data, cons
   const int num_tangential_crystals_per_block = num_tangential_detectors/num_tangential_blocks;
   assert(num_tangential_blocks * num_tangential_crystals_per_block == num_tangential_detectors);
   
+  // Note: as we loop rb from ra, every ra only modifies elements stored in fan_data[ra]
+  // so we can parallelise over ra.
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       // loop rb from ra to avoid double counting
@@ -1290,6 +1307,9 @@ void apply_geo_norm(FanProjData& fan_data, const GeoData3D& geo_data, const bool
                     }
                 }
     
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
     for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
         for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
         //    for (int rb = fan_data.get_min_ra(); rb <= fan_data.get_max_ra(); ++rb)
@@ -1311,6 +1331,10 @@ void apply_geo_norm(FanProjData& fan_data, const GeoData3D& geo_data, const bool
 void apply_efficiencies(FanProjData& fan_data, const DetectorEfficiencies& efficiencies, const bool apply)
 {
   const int num_detectors_per_ring = fan_data.get_num_detectors_per_ring();
+  // see apply_block_norm for parallelisation
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       // loop rb from ra to avoid double counting
@@ -1330,6 +1354,9 @@ void apply_efficiencies(FanProjData& fan_data, const DetectorEfficiencies& effic
 
 void make_fan_sum_data(Array<2,float>& data_fan_sums, const FanProjData& fan_data)
 {
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       data_fan_sums[ra][a] = fan_data.sum(ra,a);
@@ -1385,6 +1412,9 @@ void make_fan_sum_data(Array<2,float>& data_fan_sums,
   const int num_detectors_per_ring = 
     data_fan_sums[0].get_length();
 
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = data_fan_sums.get_min_index(); ra <= data_fan_sums.get_max_index(); ++ra)
     for (int a = data_fan_sums[ra].get_min_index(); a <= data_fan_sums[ra].get_max_index(); ++a)
       {
@@ -1413,6 +1443,10 @@ void make_geo_data(GeoData3D& geo_data, const FanProjData& fan_data)
     FanProjData work = fan_data;
     work.fill(0);
     
+    // every ra only writes in work[ra] (as rb>=ra), so we can parallelise over ra
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
     for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
         for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
            //1// for (int rb = fan_data.get_min_ra(); rb <= fan_data.get_max_ra(); ++rb)
@@ -1436,7 +1470,14 @@ void make_geo_data(GeoData3D& geo_data, const FanProjData& fan_data)
     
     geo_data.fill(0);
     
-    
+    // every (ra,a) only writes in geo_data[ra][a]
+#ifdef STIR_OPENMP
+#  if _OPENMP >= 200711
+#pragma omp parallel for collapse(2) schedule(dynamic)
+#  else
+#pragma omp parallel for schedule(dynamic)
+#  endif
+#endif
     for (int ra = 0; ra < num_axial_crystals_per_block; ++ra)
       //  for (int a = 0; a <= num_transaxial_detectors/2; ++a)
         for (int a = 0; a <num_transaxial_crystals_per_block/2; ++a)
@@ -1484,7 +1525,18 @@ void make_block_data(BlockData3D& block_data, const FanProjData& fan_data)
   assert(num_transaxial_blocks * num_transaxial_crystals_per_block == num_transaxial_detectors);
   
   block_data.fill(0);
-  for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
+  // All contributions to block_data[ra_block] come from rings in that axial block
+  // (as we loop rb from ra). We therefore parallelise over axial blocks, and
+  // keep the serial loop over the rings in each block, such that the order of
+  // summation (and therefore the result) is the same as for the serial version.
+  assert(fan_data.get_min_ra() == 0);
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int axial_block_num = 0; axial_block_num < num_axial_blocks; ++axial_block_num)
+  for (int ra = axial_block_num*num_axial_crystals_per_block;
+       ra < min((axial_block_num+1)*num_axial_crystals_per_block, fan_data.get_max_ra()+1);
+       ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       // loop rb from ra to avoid double counting
       for (int rb = max(ra,fan_data.get_min_rb(ra)); rb <= fan_data.get_max_rb(ra); ++rb)
@@ -1505,19 +1557,49 @@ void iterate_efficiencies(DetectorEfficiencies& efficiencies,
   assert(model.get_max_ra() == data_fan_sums.get_max_index());
   assert(model.get_min_a() == data_fan_sums[data_fan_sums.get_min_index()].get_min_index());
   assert(model.get_max_a() == data_fan_sums[data_fan_sums.get_min_index()].get_max_index());
-  for (int ra = model.get_min_ra(); ra <= model.get_max_ra(); ++ra)
-    for (int a = model.get_min_a(); a <= model.get_max_a(); ++a)
+  // Note: efficiencies are updated in place, so the order of the updates matters.
+  // The fan of detector a does not contain a itself. Therefore, the efficiencies of all
+  // rings for the same a can be updated independently, and we parallelise over ra.
+  // The result does not depend on the number of threads.
+#ifdef STIR_OPENMP
+  const bool rings_are_independent =
+    model.get_min_b(model.get_min_a()) > model.get_min_a() &&
+    model.get_max_b(model.get_min_a()) < model.get_min_a() + num_detectors_per_ring;
+#pragma omp parallel if(rings_are_independent)
+#endif
+  for (int a = model.get_min_a(); a <= model.get_max_a(); ++a)
     {
-      if (data_fan_sums[ra][a] == 0)
-	efficiencies[ra][a] = 0;
-      else
-	{
-     	  float denominator = 0;
-           for (int rb = model.get_min_rb(ra); rb <= model.get_max_rb(ra); ++rb)
-             for (int b = model.get_min_b(a); b <= model.get_max_b(a); ++b)
-  	       denominator += efficiencies[rb][b%num_detectors_per_ring]*model(ra,a,rb,b);
-	  efficiencies[ra][a] = data_fan_sums[ra][a] / denominator;
-	}
+      const int min_b = model.get_min_b(a);
+      const int max_b = model.get_max_b(a);
+#ifdef STIR_OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (int ra = model.get_min_ra(); ra <= model.get_max_ra(); ++ra)
+        {
+          if (data_fan_sums[ra][a] == 0)
+            {
+              efficiencies[ra][a] = 0;
+              continue;
+            }
+          float denominator = 0;
+          for (int rb = model.get_min_rb(ra); rb <= model.get_max_rb(ra); ++rb)
+            {
+              const Array<1,float>& efficiencies_rb = efficiencies[rb];
+              if (rb > ra)
+                {
+                  // use contiguous storage
+                  const Array<1,float>& fan = model.get_fan(ra,a,rb);
+                  for (int b = min_b; b <= max_b; ++b)
+                    denominator += efficiencies_rb[b%num_detectors_per_ring]*fan[b];
+                }
+              else
+                {
+                  for (int b = min_b; b <= max_b; ++b)
+                    denominator += efficiencies_rb[b%num_detectors_per_ring]*model(ra,a,rb,b);
+                }
+            }
+          efficiencies[ra][a] = data_fan_sums[ra][a] / denominator;
+        }
     }
 }
 
@@ -1531,39 +1613,56 @@ void iterate_efficiencies(DetectorEfficiencies& efficiencies,
 #ifdef WRITE_ALL
   static int sub_iter_num = 0;
 #endif
-  for (int ra = data_fan_sums.get_min_index(); ra <= data_fan_sums.get_max_index(); ++ra)
-    for (int a = data_fan_sums[ra].get_min_index(); a <= data_fan_sums[ra].get_max_index(); ++a)
+  // see other iterate_efficiencies for parallelisation
+  const int min_a = data_fan_sums[data_fan_sums.get_min_index()].get_min_index();
+  const int max_a = data_fan_sums[data_fan_sums.get_min_index()].get_max_index();
+#ifdef STIR_OPENMP
+  const bool rings_are_independent = 2*half_fan_size < num_detectors_per_ring - 1;
+#pragma omp parallel if(rings_are_independent)
+#endif
+  for (int a = min_a; a <= max_a; ++a)
     {
-      if (data_fan_sums[ra][a] == 0)
-	efficiencies[ra][a] = 0;
-      else
-	{
-     	  float denominator = 0;
-	  for (int rb = max(ra-max_ring_diff, 0); rb <= min(ra+max_ring_diff, num_rings-1); ++rb)
-             for (int b = a+num_detectors_per_ring/2-half_fan_size; b <= a+num_detectors_per_ring/2+half_fan_size; ++b)
-  	       denominator += efficiencies[rb][b%num_detectors_per_ring];
-	  efficiencies[ra][a] = data_fan_sums[ra][a] / denominator;
-	}
-#ifdef WRITE_ALL
-          {
-            char out_filename[100];
-            sprintf(out_filename, "MLresult_subiter_eff_1_%d.out", 
-		    sub_iter_num++);
-            ofstream out(out_filename);
-	    if (!out)
-	      {
-		warning("Error opening output file %s\n", out_filename);
-		exit(EXIT_FAILURE);
-	      }
-            out << efficiencies;
-	    if (!out)
-	      {
-		warning("Error writing data to output file %s\n", out_filename);
-		exit(EXIT_FAILURE);
-	      }
-          }
+#ifdef STIR_OPENMP
+#pragma omp for schedule(static)
 #endif
+      for (int ra = data_fan_sums.get_min_index(); ra <= data_fan_sums.get_max_index(); ++ra)
+        {
+          if (data_fan_sums[ra][a] == 0)
+            {
+              efficiencies[ra][a] = 0;
+              continue;
+            }
+          const int min_rb = max(ra-max_ring_diff, 0);
+          const int max_rb = min(ra+max_ring_diff, num_rings-1);
+          float denominator = 0;
+          for (int rb = min_rb; rb <= max_rb; ++rb)
+            {
+              const Array<1,float>& efficiencies_rb = efficiencies[rb];
+              for (int b = a+num_detectors_per_ring/2-half_fan_size; b <= a+num_detectors_per_ring/2+half_fan_size; ++b)
+                denominator += efficiencies_rb[b%num_detectors_per_ring];
+            }
+          efficiencies[ra][a] = data_fan_sums[ra][a] / denominator;
+        }
     }
+#ifdef WRITE_ALL
+  {
+    char out_filename[100];
+    sprintf(out_filename, "MLresult_subiter_eff_1_%d.out", 
+            sub_iter_num++);
+    ofstream out(out_filename);
+    if (!out)
+      {
+        warning("Error opening output file %s\n", out_filename);
+        exit(EXIT_FAILURE);
+      }
+    out << efficiencies;
+    if (!out)
+      {
+        warning("Error writing data to output file %s\n", out_filename);
+        exit(EXIT_FAILURE);
+      }
+  }
+#endif
 }
 
 void iterate_geo_norm(GeoData3D& norm_geo_data,
@@ -1578,6 +1677,13 @@ void iterate_geo_norm(GeoData3D& norm_geo_data,
     
     const float threshold = measured_geo_data.find_max()/10000.F;
     
+#ifdef STIR_OPENMP
+#  if _OPENMP >= 200711
+#pragma omp parallel for collapse(2) schedule(dynamic)
+#  else
+#pragma omp parallel for schedule(dynamic)
+#  endif
+#endif
     for (int ra = 0; ra < num_axial_crystals_per_block; ++ra)
         for (int a = 0; a <num_transaxial_crystals_per_block/2; ++a)
             // loop rb from ra to avoid double counting
@@ -1598,6 +1704,9 @@ void iterate_block_norm(BlockData3D& norm_block_data,
   make_block_data(norm_block_data, model);
   //norm_block_data = measured_block_data / norm_block_data;
   const float threshold = measured_block_data.find_max()/10000.F;
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = norm_block_data.get_min_ra(); ra <= norm_block_data.get_max_ra(); ++ra)
     for (int a = norm_block_data.get_min_a(); a <= norm_block_data.get_max_a(); ++a)
       // loop rb from ra to avoid double counting
@@ -1615,7 +1724,11 @@ void iterate_block_norm(BlockData3D& norm_block_data,
 
 double KL(const FanProjData& d1, const FanProjData& d2, const double threshold)
 {
-  double sum=0;
+  // compute sums per ra in parallel, and add them in order afterwards
+  std::vector<double> asums(d1.get_max_ra() - d1.get_min_ra() + 1);
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = d1.get_min_ra(); ra <= d1.get_max_ra(); ++ra)
     {
       double asum=0;
@@ -1631,8 +1744,11 @@ double KL(const FanProjData& d1, const FanProjData& d2, const double threshold)
             }
           asum += rbsum;
         }
-      sum += asum;
+      asums[ra - d1.get_min_ra()] = asum;
     }
+  double sum=0;
+  for (std::vector<double>::const_iterator iter = asums.begin(); iter != asums.end(); ++iter)
+    sum += *iter;
   return static_cast<double>(sum);
 }
 
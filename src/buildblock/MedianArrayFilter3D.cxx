@@ -27,14 +27,128 @@
 #include "stir/MedianArrayFilter3D.h"
 #include "stir/Coordinate3D.h"
 
+#include <boost/cstdint.hpp>
 #include <algorithm>
-
-#ifndef STIR_NO_NAMESPACES
-using std::nth_element;
-#endif
+#include <utility>
+#include <vector>
 
 START_NAMESPACE_STIR
 
+namespace {
+
+//! count the number of bits that are set in \a w
+inline int
+count_bits(boost::uint64_t w)
+{
+  w = w - ((w >> 1) & 0x5555555555555555ULL);
+  w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+  w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast<int>((w * 0x0101010101010101ULL) >> 56);
+}
+
+/* Set of ranks in [0,num_ranks), used as the sliding window of the median filter.
+
+   The ranks are stored as a bitset, together with the number of elements in every block
+   of 1024 ranks. Inserting and removing a rank therefore takes constant time. To find
+   the k-th smallest rank, we start from the block found by the previous call (the median of
+   neighbouring voxels is usually close), and then count the bits of at most 16 words.
+*/
+class RankWindow
+{
+public:
+  explicit RankWindow(const int num_ranks)
+    : bits(((num_ranks + block_size - 1)/block_size)*words_per_block, 0),
+      block_counts((num_ranks + block_size - 1)/block_size, 0),
+      current_block(0), count_before_current_block(0), count(0)
+  {}
+
+  void insert(const int rank)
+  {
+    bits[rank >> 6] |= static_cast<boost::uint64_t>(1) << (rank & 63);
+    ++block_counts[rank >> log2_block_size];
+    if ((rank >> log2_block_size) < current_block)
+      ++count_before_current_block;
+    ++count;
+  }
+
+  void remove(const int rank)
+  {
+    assert(bits[rank >> 6] & (static_cast<boost::uint64_t>(1) << (rank & 63)));
+    bits[rank >> 6] &= ~(static_cast<boost::uint64_t>(1) << (rank & 63));
+    --block_counts[rank >> log2_block_size];
+    if ((rank >> log2_block_size) < current_block)
+      --count_before_current_block;
+    --count;
+  }
+
+  int size() const
+  { return count; }
+
+  //! find the \a k-th smallest rank in the window (starting from 0)
+  int find(int k)
+  {
+    assert(k >= 0 && k < count);
+    while (count_before_current_block > k)
+      {
+        --current_block;
+        count_before_current_block -= block_counts[current_block];
+      }
+    while (count_before_current_block + block_counts[current_block] <= k)
+      {
+        count_before_current_block += block_counts[current_block];
+        ++current_block;
+      }
+    k -= count_before_current_block;
+    int word = current_block*words_per_block;
+    for (int num_bits = count_bits(bits[word]); k >= num_bits; num_bits = count_bits(bits[word]))
+      {
+        k -= num_bits;
+        ++word;
+      }
+    // clear the k lowest bits, and find the position of the next one
+    boost::uint64_t w = bits[word];
+    for (; k > 0; --k)
+      w &= w - 1;
+    return word*64 + count_bits((w & (~w + 1)) - 1);
+  }
+
+private:
+  static const int log2_block_size = 10;
+  static const int block_size = 1 << log2_block_size;
+  static const int words_per_block = block_size/64;
+  std::vector<boost::uint64_t> bits;
+  std::vector<int> block_counts;
+  int current_block;
+  int count_before_current_block;
+  int count;
+};
+
+//! insert (or remove) the ranks of all neighbours in the mask with the given \a x
+void
+update_column(RankWindow& window, const Array<3,int>& ranks,
+              const int z_centre, const int y_centre, const int x,
+              const int mask_radius_z, const int mask_radius_y,
+              const bool insert)
+{
+  for (int z = std::max(z_centre-mask_radius_z, ranks.get_min_index());
+       z <= std::min(z_centre+mask_radius_z, ranks.get_max_index());
+       ++z)
+    for (int y = std::max(y_centre-mask_radius_y, ranks[z].get_min_index());
+         y <= std::min(y_centre+mask_radius_y, ranks[z].get_max_index());
+         ++y)
+      {
+        const Array<1,int>& row = ranks[z][y];
+        if (x < row.get_min_index() || x > row.get_max_index())
+          continue;
+        if (insert)
+          window.insert(row[x]);
+        else
+          window.remove(row[x]);
+      }
+}
+
+} // end of unnamed namespace
+
 
 template <typename elemT>
 MedianArrayFilter3D<elemT>::MedianArrayFilter3D(const Coordinate3D<int>& mask_radius)
@@ -96,23 +210,94 @@ do_it(Array<3,elemT>& out_array, const Array<3,elemT>& in_array) const
 {
   assert(out_array.get_index_range() == in_array.get_index_range());
 
-  Array<1,elemT> neighbours (0,(2*mask_radius_x+1)*(2*mask_radius_y+1)*(2*mask_radius_z+1)-1);
+  const int mask_size = (2*mask_radius_x+1)*(2*mask_radius_y+1)*(2*mask_radius_z+1);
+  if (mask_size < 64)
+    {
+      // for small masks, finding the median of all neighbours is faster than sorting all values first
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (int z=out_array.get_min_index();z<= out_array.get_max_index();++z)
+        {
+          Array<1,elemT> neighbours(0, mask_size-1);
+          for (int y=out_array[z].get_min_index();y <= out_array[z].get_max_index();++y)
+            for (int x=out_array[z][y].get_min_index();x <= out_array[z][y].get_max_index();++x)
+              {
+                const int num_neighbours =
+                  extract_neighbours(neighbours, in_array, Coordinate3D<int>(z,y,x));
+                if (num_neighbours==0)
+                  continue;
+                const typename Array<1,elemT>::iterator begin = neighbours.begin();
+                std::nth_element(begin, begin + num_neighbours/2, begin + num_neighbours);
+                if (num_neighbours%2==1)
+                  out_array[z][y][x] = *(begin + num_neighbours/2);
+                else
+                  out_array[z][y][x] = (*(begin + num_neighbours/2) +
+                                        *std::max_element(begin, begin + num_neighbours/2))/2;
+              }
+        }
+      return;
+    }
 
+  // Replace every value by its rank in the sorted list of all values (ties are broken by
+  // position), such that every rank occurs only once. The sliding window along a row is then
+  // a RankWindow: when going to the next voxel, we insert the ranks of the "column"
+  // of neighbours that enters the mask, and remove the ones of the column that leaves it.
+  // The cost per voxel is therefore proportional to the size of a column, not of the mask.
+  const int num_elements = static_cast<int>(in_array.size_all());
+  std::vector<elemT> sorted_values(num_elements);
+  Array<3,int> ranks(in_array.get_index_range());
+  {
+    std::vector<std::pair<elemT,int> > values_and_positions(num_elements);
+    {
+      typename Array<3,elemT>::const_full_iterator in_iter = in_array.begin_all();
+      for (int i=0; i<num_elements; ++i, ++in_iter)
+        values_and_positions[i] = std::make_pair(*in_iter, i);
+    }
+    std::sort(values_and_positions.begin(), values_and_positions.end());
+    std::vector<int> ranks_in_order(num_elements);
+    for (int rank=0; rank<num_elements; ++rank)
+      {
+        sorted_values[rank] = values_and_positions[rank].first;
+        ranks_in_order[values_and_positions[rank].second] = rank;
+      }
+    std::copy(ranks_in_order.begin(), ranks_in_order.end(), ranks.begin_all());
+  }
+
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
   for (int z=out_array.get_min_index();z<= out_array.get_max_index();++z)
-   for (int y=out_array[z].get_min_index();y <= out_array[z].get_max_index();++y)
-     for (int x=out_array[z][y].get_min_index();x <= out_array[z][y].get_max_index();++x)
-     {
-       const int num_neighbours =
-	 extract_neighbours(neighbours,in_array,Coordinate3D<int>(z,y,x));
-       if (num_neighbours==0)
-         continue;
-       nth_element(neighbours.begin(), neighbours.begin()+num_neighbours/2, neighbours.end());
-       if (num_neighbours%2==1)
-	 out_array[z][y][x] = neighbours[num_neighbours/2]; 
-       else
-	 out_array[z][y][x] = (neighbours[num_neighbours/2]+
-			       neighbours[num_neighbours/2 - 1])/2; 
-     } 
+    {
+      RankWindow window(num_elements);
+      for (int y=out_array[z].get_min_index();y <= out_array[z].get_max_index();++y)
+        {
+          const int min_x = out_array[z][y].get_min_index();
+          const int max_x = out_array[z][y].get_max_index();
+          for (int x=min_x-mask_radius_x; x<min_x+mask_radius_x; ++x)
+            update_column(window, ranks, z, y, x, mask_radius_z, mask_radius_y, /*insert=*/true);
+          for (int x=min_x; x<=max_x; ++x)
+            {
+              update_column(window, ranks, z, y, x+mask_radius_x, mask_radius_z, mask_radius_y, /*insert=*/true);
+
+              const int num_neighbours = window.size();
+              if (num_neighbours>0)
+                {
+                  if (num_neighbours%2==1)
+                    out_array[z][y][x] = sorted_values[window.find(num_neighbours/2)];
+                  else
+                    out_array[z][y][x] = (sorted_values[window.find(num_neighbours/2)]+
+                                          sorted_values[window.find(num_neighbours/2 - 1)])/2;
+                }
+
+              update_column(window, ranks, z, y, x-mask_radius_x, mask_radius_z, mask_radius_y, /*insert=*/false);
+            }
+          // empty the window for the next row
+          for (int x=max_x-mask_radius_x+1; x<=max_x+mask_radius_x; ++x)
+            update_column(window, ranks, z, y, x, mask_radius_z, mask_radius_y, /*insert=*/false);
+          assert(window.size() == 0);
+        }
+    }
 }
 
 
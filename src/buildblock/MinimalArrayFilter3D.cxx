@@ -19,7 +19,10 @@
 */
 #include "stir/MinimalArrayFilter3D.h"
 #include "stir/Coordinate3D.h"
+#include "stir/detail/min_max_filter.h"
 #include <algorithm>
+#include <functional>
+#include <limits>
 #include <numeric>
 
 START_NAMESPACE_STIR
@@ -76,19 +79,36 @@ do_it(Array<3,elemT>& out_array, const Array<3,elemT>& in_array) const
 {
   assert(out_array.get_index_range() == in_array.get_index_range());
 
-  Array<1,elemT> neighbours (0,(2*mask_radius_x+1)*(2*mask_radius_y+1)*(2*mask_radius_z+1)-1);
+  if (in_array.is_regular())
+    {
+      // use the separable van Herk/Gil-Werman algorithm
+      out_array = in_array;
+      detail::separable_min_max_filter_3D(out_array, Coordinate3D<int>(mask_radius_z, mask_radius_y, mask_radius_x),
+                                          std::less<elemT>(), std::numeric_limits<elemT>::max());
+      return;
+    }
+
+#ifdef STIR_OPENMP
+#pragma omp parallel
+#endif
+  {
+    Array<1,elemT> neighbours (0,(2*mask_radius_x+1)*(2*mask_radius_y+1)*(2*mask_radius_z+1)-1);
 
-  for (int z=out_array.get_min_index();z<= out_array.get_max_index();++z)
-   for (int y=out_array[z].get_min_index();y <= out_array[z].get_max_index();++y)
-     for (int x=out_array[z][y].get_min_index();x <= out_array[z][y].get_max_index();++x)
-     {
-       const int num_neighbours =
+#ifdef STIR_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (int z=out_array.get_min_index();z<= out_array.get_max_index();++z)
+     for (int y=out_array[z].get_min_index();y <= out_array[z].get_max_index();++y)
+       for (int x=out_array[z][y].get_min_index();x <= out_array[z][y].get_max_index();++x)
+       {
+         const int num_neighbours =
 	 extract_neighbours(neighbours,in_array,Coordinate3D<int>(z,y,x));
-       if (num_neighbours==0)
-         continue;
-       out_array[z][y][x] = 
+         if (num_neighbours==0)
+           continue;
+         out_array[z][y][x] = 
 	 *std::min_element(neighbours.begin(), neighbours.begin() + num_neighbours);
-     } 
+       } 
+  }
 }
 
 template <typename elemT>
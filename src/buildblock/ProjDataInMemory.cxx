@@ -79,6 +79,30 @@ create_buffer(const bool initialise_with_0)
 #endif
 }
 
+ProjDataInMemory::
+ProjDataInMemory(shared_ptr<const ExamInfo> const& exam_info_sptr,
+		 shared_ptr<const ProjDataInfo> const& proj_data_info_ptr, float * const data_ptr)
+  :
+  ProjDataFromStream(exam_info_sptr, proj_data_info_ptr, shared_ptr<iostream>(), // trick: first initialise sino_stream_ptr to 0
+                     std::streamoff(0),
+                     ProjData::standard_segment_sequence(*proj_data_info_ptr),
+                     Segment_AxialPos_View_TangPos)
+{
+  this->create_buffer(data_ptr);
+  this->create_stream();
+}
+
+void
+ProjDataInMemory::
+create_buffer(float * const data_ptr)
+{
+  if (is_null_ptr(data_ptr))
+    error("ProjDataInMemory: constructor called with a null pointer for the data");
+  Array<1,float> existing_buffer(IndexRange<1>(0, static_cast<int>(this->size_all())-1), data_ptr);
+  // note: assignment would copy the data, so swap instead
+  this->buffer.swap(existing_buffer);
+}
+
 void
 ProjDataInMemory::
 create_stream()
@@ -39,6 +39,7 @@
 #include "stir/IndexRange2D.h"
 #include "stir/IndexRange3D.h"
 #include "stir/Bin.h"
+#include "stir/LORCoordinates.h"
 // include for ask and ask_num
 #include "stir/utilities.h"
 
@@ -98,6 +99,7 @@ ProjDataInfo::set_num_views(const int num_views)
 {
   min_view_num = 0;
   max_view_num = num_views-1;
+  invalidate_LOR_endpoints_cache();
 }
 
 void 
@@ -106,6 +108,7 @@ ProjDataInfo::set_num_tangential_poss(const int num_tang_poss)
 
   min_tangential_pos_num = -(num_tang_poss/2);
   max_tangential_pos_num = min_tangential_pos_num + num_tang_poss-1;
+  invalidate_LOR_endpoints_cache();
 }
 
 /*! Sets min_axial_pos_per_seg to 0 */
@@ -124,7 +127,7 @@ ProjDataInfo::set_num_axial_poss_per_segment(const VectorWithOffset<int>& num_ax
     min_axial_pos_per_seg[i]=0;
     max_axial_pos_per_seg[i]=num_axial_poss_per_segment[i]-1;
   }
-    
+  invalidate_LOR_endpoints_cache();
 }
 
 /*! No checks are done on validity of the min_ax_pos_num argument */
@@ -132,12 +135,14 @@ void
 ProjDataInfo::set_min_axial_pos_num(const int min_ax_pos_num, const int segment_num)
 {
   min_axial_pos_per_seg[segment_num] = min_ax_pos_num;
+  invalidate_LOR_endpoints_cache();
 }
 /*! No checks are done on validity of the max_ax_pos_num argument */
 void 
 ProjDataInfo::set_max_axial_pos_num(const int max_ax_pos_num, const int segment_num)
 {
   max_axial_pos_per_seg[segment_num] = max_ax_pos_num;
+  invalidate_LOR_endpoints_cache();
 }
 
 
@@ -145,12 +150,14 @@ void
 ProjDataInfo::set_min_tangential_pos_num(const int min_tang_poss)
 {
   min_tangential_pos_num = min_tang_poss;
+  invalidate_LOR_endpoints_cache();
 }
 
 void
 ProjDataInfo::set_max_tangential_pos_num(const int max_tang_poss)
 {
   max_tangential_pos_num = max_tang_poss;
+  invalidate_LOR_endpoints_cache();
 }
 
 void
@@ -160,7 +167,8 @@ ProjDataInfo::set_tof_mash_factor(const int)
 }
 
 ProjDataInfo::ProjDataInfo()
-  : bed_position_horizontal(0.F), bed_position_vertical(0.F)
+  : bed_position_horizontal(0.F), bed_position_vertical(0.F),
+    LOR_endpoints_cache_enabled(false)
 {}
 
 
@@ -170,13 +178,110 @@ ProjDataInfo::ProjDataInfo(const shared_ptr<Scanner>& scanner_ptr_v,
                            const VectorWithOffset<int>& num_axial_pos_per_segment_v, 
                            const int num_views_v, 
                            const int num_tangential_poss_v)
-	: scanner_ptr(scanner_ptr_v), bed_position_horizontal(0.F), bed_position_vertical(0.F)
+	: scanner_ptr(scanner_ptr_v), bed_position_horizontal(0.F), bed_position_vertical(0.F),
+          LOR_endpoints_cache_enabled(false)
 { 
   set_num_views(num_views_v);
   set_num_tangential_poss(num_tangential_poss_v);
   set_num_axial_poss_per_segment(num_axial_pos_per_segment_v);
 }
 
+void
+ProjDataInfo::set_LOR_endpoints_cache_enabled(const bool value)
+{
+  LOR_endpoints_cache_enabled = value;
+  invalidate_LOR_endpoints_cache();
+}
+
+void
+ProjDataInfo::invalidate_LOR_endpoints_cache()
+{
+  // shared_ptrs are reset, so copies of this object keep their cache
+  LOR_endpoints_cache =
+    VectorWithOffset<shared_ptr<const vector<LOREndPoints> > >(get_min_segment_num(), get_max_segment_num());
+}
+
+void
+ProjDataInfo::compute_LOR_endpoints(LOREndPoints& end_points, const int view_num, const int segment_num) const
+{
+  const int num_tangential_poss = get_num_tangential_poss();
+  end_points.resize(static_cast<std::size_t>(get_num_axial_poss(segment_num))*num_tangential_poss);
+  const float radius = get_scanner_ptr()->get_inner_ring_radius();
+
+  LORInAxialAndNoArcCorrSinogramCoordinates<float> lor;
+  LORAs2Points<float> lor_points;
+  Bin bin(segment_num, view_num, 0, 0);
+  std::size_t index = 0;
+  for (bin.axial_pos_num() = get_min_axial_pos_num(segment_num);
+       bin.axial_pos_num() <= get_max_axial_pos_num(segment_num);
+       ++bin.axial_pos_num())
+    for (bin.tangential_pos_num() = get_min_tangential_pos_num();
+         bin.tangential_pos_num() <= get_max_tangential_pos_num();
+         ++bin.tangential_pos_num(), ++index)
+      {
+        get_LOR(lor, bin);
+        lor.get_intersections_with_cylinder(lor_points, radius);
+        end_points.z1[index] = lor_points.p1().z();
+        end_points.y1[index] = lor_points.p1().y();
+        end_points.x1[index] = lor_points.p1().x();
+        end_points.z2[index] = lor_points.p2().z();
+        end_points.y2[index] = lor_points.p2().y();
+        end_points.x2[index] = lor_points.p2().x();
+      }
+}
+
+shared_ptr<const LOREndPoints>
+ProjDataInfo::get_LOR_endpoints(const int view_num, const int segment_num) const
+{
+  if (!LOR_endpoints_cache_enabled)
+    {
+      shared_ptr<LOREndPoints> end_points_sptr(new LOREndPoints);
+      compute_LOR_endpoints(*end_points_sptr, view_num, segment_num);
+      return end_points_sptr;
+    }
+
+  shared_ptr<const vector<LOREndPoints> > segment_cache_sptr;
+  if (segment_num < get_min_segment_num() || segment_num > get_max_segment_num() ||
+      view_num < get_min_view_num() || view_num > get_max_view_num())
+    error(boost::format("ProjDataInfo::get_LOR_endpoints: view_num %d or segment_num %d out of range")
+          % view_num % segment_num);
+
+#ifdef STIR_OPENMP
+#pragma omp critical(PROJDATAINFOLORENDPOINTSCACHE)
+#endif
+  {
+    // derived classes could have changed the segment range without calling invalidate_LOR_endpoints_cache()
+    if (LOR_endpoints_cache.get_min_index() != get_min_segment_num() ||
+        LOR_endpoints_cache.get_max_index() != get_max_segment_num())
+      LOR_endpoints_cache =
+        VectorWithOffset<shared_ptr<const vector<LOREndPoints> > >(get_min_segment_num(), get_max_segment_num());
+    segment_cache_sptr = LOR_endpoints_cache[segment_num];
+  }
+
+  if (!segment_cache_sptr)
+    {
+      // compute outside the critical section, such that other segments remain accessible
+      shared_ptr<vector<LOREndPoints> > new_cache_sptr(new vector<LOREndPoints>(get_num_views()));
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (int v = get_min_view_num(); v <= get_max_view_num(); ++v)
+        compute_LOR_endpoints((*new_cache_sptr)[v - get_min_view_num()], v, segment_num);
+
+#ifdef STIR_OPENMP
+#pragma omp critical(PROJDATAINFOLORENDPOINTSCACHE)
+#endif
+      {
+        // another thread might have filled it in the mean time
+        if (!LOR_endpoints_cache[segment_num])
+          LOR_endpoints_cache[segment_num] = new_cache_sptr;
+        segment_cache_sptr = LOR_endpoints_cache[segment_num];
+      }
+    }
+  // point into the cache, sharing ownership of the whole segment
+  return shared_ptr<const LOREndPoints>(segment_cache_sptr, &(*segment_cache_sptr)[view_num - get_min_view_num()]);
+}
+
 string
 ProjDataInfo::parameter_info()  const
 {
@@ -228,7 +333,7 @@ reduce_segment_range(const int min_segment_num, const int max_segment_num)
 
   min_axial_pos_per_seg = new_min_axial_pos_per_seg;
   max_axial_pos_per_seg = new_max_axial_pos_per_seg;
-  
+  invalidate_LOR_endpoints_cache();
 }
 
 
@@ -354,6 +354,7 @@ ProjDataInfoCylindrical::
 set_azimuthal_angle_offset(const float angle_v)
 {
   azimuthal_angle_offset =  angle_v;
+  this->invalidate_LOR_endpoints_cache();
 }
 
 void
@@ -361,6 +362,7 @@ ProjDataInfoCylindrical::
 set_azimuthal_angle_sampling(const float angle_v)
 {
 	azimuthal_angle_sampling =  angle_v;
+  this->invalidate_LOR_endpoints_cache();
 }
 
 //void
@@ -385,6 +387,7 @@ set_min_ring_difference( int min_ring_diff_v, int segment_num)
 {
   ring_diff_arrays_computed = false;
   min_ring_diff[segment_num] = min_ring_diff_v;
+  this->invalidate_LOR_endpoints_cache();
 }
 
 void
@@ -393,6 +396,7 @@ set_max_ring_difference( int max_ring_diff_v, int segment_num)
 {
   ring_diff_arrays_computed = false;
   max_ring_diff[segment_num] = max_ring_diff_v;
+  this->invalidate_LOR_endpoints_cache();
 }
 
 void
@@ -401,6 +405,7 @@ set_ring_spacing(float ring_spacing_v)
 {
   ring_diff_arrays_computed = false;
   ring_spacing = ring_spacing_v;
+  this->invalidate_LOR_endpoints_cache();
 }
 
 void
@@ -64,7 +64,10 @@ ProjDataInfoCylindricalArcCorr:: ProjDataInfoCylindricalArcCorr(const shared_ptr
 
 void
 ProjDataInfoCylindricalArcCorr::set_tangential_sampling(const float new_tangential_sampling)
-{bin_size = new_tangential_sampling;}
+{
+  bin_size = new_tangential_sampling;
+  this->invalidate_LOR_endpoints_cache();
+}
 
 
 
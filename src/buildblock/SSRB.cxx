@@ -22,8 +22,9 @@
 #include "stir/ProjDataInterfile.h"
 #include "stir/ProjDataInfoCylindrical.h"
 #include "stir/SSRB.h"
-#include "stir/Sinogram.h"
+#include "stir/SegmentBySinogram.h"
 #include "stir/Bin.h"
+#include "stir/Succeeded.h"
 #include "stir/round.h"
 #include <fstream>
 #include <algorithm>
@@ -222,6 +223,11 @@ SSRB(ProjData& out_proj_data,
     error ("SSRB can only mash views when min_view_num==0\n");
   if (in_proj_data.get_num_views() % out_proj_data.get_num_views())
     error ("SSRB can only mash views when out_num_views divides in_num_views\n");
+
+  const int min_tangential_pos_num =
+    max(in_proj_data.get_min_tangential_pos_num(), out_proj_data.get_min_tangential_pos_num());
+  const int max_tangential_pos_num =
+    min(in_proj_data.get_max_tangential_pos_num(), out_proj_data.get_max_tangential_pos_num());
   
   for (int out_segment_num = out_proj_data.get_min_segment_num(); 
        out_segment_num <= out_proj_data.get_max_segment_num();
@@ -268,62 +274,110 @@ SSRB(ProjData& out_proj_data,
 		      in_segment_num, out_min_ring_diff, out_max_ring_diff);
 	      }
 	  }
+      }
 
-	// keep sinograms out of the loop to avoid reallocations
-	// initialise to something because there's no default constructor
-	Sinogram<float> out_sino = 
-	  out_proj_data.get_empty_sinogram(out_proj_data.get_min_axial_pos_num(out_segment_num),out_segment_num);
-	Sinogram<float> in_sino = 
-	  in_proj_data.get_empty_sinogram(in_proj_data.get_min_axial_pos_num(out_segment_num),out_segment_num);
+      // Every input segment contributes to only one output segment. We therefore keep the
+      // output segment in memory, and read every input segment only once. While the sinograms
+      // of one input segment are added (in parallel over axial positions), one thread reads the next one.
+      SegmentBySinogram<float> out_segment =
+        out_proj_data.get_empty_segment_by_sinogram(out_segment_num);
+      const int out_min_ax_pos_num = out_segment.get_min_axial_pos_num();
+      const int out_max_ax_pos_num = out_segment.get_max_axial_pos_num();
+      // get_m could be replaced by get_t  
+      const float out_min_m = out_proj_data_info_sptr->get_m(Bin(out_segment_num, 0, out_min_ax_pos_num, 0));
+      const float out_axial_sampling = out_proj_data_info_sptr->get_axial_sampling(out_segment_num);
+      VectorWithOffset<int> num_in_ax_poss(out_min_ax_pos_num, out_max_ax_pos_num);
+      num_in_ax_poss.fill(0);
 
-	for (int out_ax_pos_num = out_proj_data.get_min_axial_pos_num(out_segment_num); 
-	     out_ax_pos_num  <= out_proj_data.get_max_axial_pos_num(out_segment_num);
-	     ++out_ax_pos_num )
-	  {
-	    out_sino= out_proj_data.get_empty_sinogram(out_ax_pos_num, out_segment_num);
-            // get_m could be replaced by get_t  
-	    const float out_m = out_proj_data_info_sptr->get_m(Bin(out_segment_num,0, out_ax_pos_num, 0));
-	  
-	    unsigned int num_in_ax_pos = 0;
+      shared_ptr<SegmentBySinogram<float> > next_in_segment_sptr;
+      if (in_min_segment_num <= in_max_segment_num)
+        next_in_segment_sptr.reset(new SegmentBySinogram<float>(in_proj_data.get_segment_by_sinogram(in_min_segment_num)));
+      for (int in_segment_num = in_min_segment_num; 
+           in_segment_num <= in_max_segment_num;
+           ++in_segment_num)
+        {
+          const shared_ptr<const SegmentBySinogram<float> > in_segment_sptr = next_in_segment_sptr;
+          next_in_segment_sptr.reset();
 
-	    for (int in_segment_num = in_min_segment_num; 
-		 in_segment_num <= in_max_segment_num;
-		 ++in_segment_num)
-	      for (int in_ax_pos_num = in_proj_data.get_min_axial_pos_num(in_segment_num); 
-		   in_ax_pos_num  <= in_proj_data.get_max_axial_pos_num(in_segment_num);
-		   ++in_ax_pos_num )
-		{
-		  const float in_m = in_proj_data_info_sptr->get_m(Bin(in_segment_num,0, in_ax_pos_num, 0));
-		  if (fabs(out_m - in_m) < 1E-4)
-		    {
-		      ++num_in_ax_pos;
-		      
-		      in_sino = in_proj_data.get_sinogram(in_ax_pos_num, in_segment_num);
-		      for (int in_view_num=in_proj_data.get_min_view_num();
-			   in_view_num <= in_proj_data.get_max_view_num();
-			   ++in_view_num)
-			for (int tangential_pos_num=
-			       max(in_proj_data.get_min_tangential_pos_num(),
-				   out_proj_data.get_min_tangential_pos_num());
-			     tangential_pos_num <= 
-			       min(in_proj_data.get_max_tangential_pos_num(),
-				   out_proj_data.get_max_tangential_pos_num());
-			     ++tangential_pos_num)
-			  out_sino[in_view_num/num_views_to_combine][tangential_pos_num] += 
-			      in_sino[in_view_num][tangential_pos_num];
-		  
-		      break; // out of loop over ax_pos as we found where to put it
-		    }
-		}
-	    if (do_norm && num_in_ax_pos!=0)
-	      out_sino /= static_cast<float>(num_in_ax_pos*num_views_to_combine);
-	    if (num_in_ax_pos==0)
-	      warning("SSRB: no sinograms contributing to output segment %d, ax_pos %d\n",
-		      out_segment_num, out_ax_pos_num);
+          // find where every input sinogram goes (out_min_ax_pos_num-1 if nowhere)
+          // This is done before the parallel loop, as get_m() is not thread-safe when first called.
+          const int in_min_ax_pos_num = in_segment_sptr->get_min_axial_pos_num();
+          const int in_max_ax_pos_num = in_segment_sptr->get_max_axial_pos_num();
+          VectorWithOffset<int> out_ax_pos_nums(in_min_ax_pos_num, in_max_ax_pos_num);
+          for (int in_ax_pos_num = in_min_ax_pos_num; in_ax_pos_num <= in_max_ax_pos_num; ++in_ax_pos_num)
+            {
+              const float in_m = in_proj_data_info_sptr->get_m(Bin(in_segment_num, 0, in_ax_pos_num, 0));
+              const int out_ax_pos_num = out_min_ax_pos_num + round((in_m - out_min_m)/out_axial_sampling);
+              if (out_ax_pos_num >= out_min_ax_pos_num && out_ax_pos_num <= out_max_ax_pos_num &&
+                  fabs(out_proj_data_info_sptr->get_m(Bin(out_segment_num, 0, out_ax_pos_num, 0)) - in_m) < 1E-4)
+                out_ax_pos_nums[in_ax_pos_num] = out_ax_pos_num;
+              else
+                out_ax_pos_nums[in_ax_pos_num] = out_min_ax_pos_num - 1;
+            }
 
-	    out_proj_data.set_sinogram(out_sino);
-	  }
-      }
+          bool reading_failed = false;
+#ifdef STIR_OPENMP
+#pragma omp parallel
+#endif
+          {
+#ifdef STIR_OPENMP
+#pragma omp single nowait
+#endif
+            if (in_segment_num < in_max_segment_num)
+              {
+                // exceptions cannot leave a parallel region, but error() has already written the message
+                try
+                  {
+                    next_in_segment_sptr.reset(new SegmentBySinogram<float>(in_proj_data.get_segment_by_sinogram(in_segment_num+1)));
+                  }
+                catch (...)
+                  {
+                    reading_failed = true;
+                  }
+              }
+
+            // in_ax_pos_nums that go to the same out_ax_pos_num have different m, so 
+            // no two threads will write to the same output sinogram
+#ifdef STIR_OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+            for (int in_ax_pos_num = in_min_ax_pos_num; in_ax_pos_num <= in_max_ax_pos_num; ++in_ax_pos_num)
+              {
+                const int out_ax_pos_num = out_ax_pos_nums[in_ax_pos_num];
+                if (out_ax_pos_num < out_min_ax_pos_num)
+                  continue;
+                ++num_in_ax_poss[out_ax_pos_num];
+                const Array<2,float>& in_sino = (*in_segment_sptr)[in_ax_pos_num];
+                Array<2,float>& out_sino = out_segment[out_ax_pos_num];
+                for (int in_view_num=in_sino.get_min_index();
+                     in_view_num <= in_sino.get_max_index();
+                     ++in_view_num)
+                  {
+                    const Array<1,float>& in_row = in_sino[in_view_num];
+                    Array<1,float>& out_row = out_sino[in_view_num/num_views_to_combine];
+                    for (int tangential_pos_num= min_tangential_pos_num;
+                         tangential_pos_num <= max_tangential_pos_num;
+                         ++tangential_pos_num)
+                      out_row[tangential_pos_num] += in_row[tangential_pos_num];
+                  }
+              }
+          } // end of parallel region
+          if (reading_failed)
+            error("SSRB: error reading segment %d of the input data", in_segment_num+1);
+        }
+
+      for (int out_ax_pos_num = out_min_ax_pos_num; out_ax_pos_num <= out_max_ax_pos_num; ++out_ax_pos_num)
+        {
+          const int num_in_ax_pos = num_in_ax_poss[out_ax_pos_num];
+	  if (do_norm && num_in_ax_pos!=0)
+	    out_segment[out_ax_pos_num] /= static_cast<float>(num_in_ax_pos*num_views_to_combine);
+	  if (num_in_ax_pos==0)
+	    warning("SSRB: no sinograms contributing to output segment %d, ax_pos %d\n",
+		    out_segment_num, out_ax_pos_num);
+        }
+
+      if (out_proj_data.set_segment(out_segment) == Succeeded::no)
+        error("SSRB: error writing segment %d of the output data", out_segment_num);
     }
 }
 END_NAMESPACE_STIR
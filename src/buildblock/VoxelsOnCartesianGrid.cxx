@@ -173,6 +173,23 @@ VoxelsOnCartesianGrid<elemT> ::VoxelsOnCartesianGrid()
  : DiscretisedDensityOnCartesianGrid<3,elemT>()
 {}
 
+template<class elemT>
+VoxelsOnCartesianGrid<elemT>::VoxelsOnCartesianGrid(const VoxelsOnCartesianGrid& other)
+ : DiscretisedDensityOnCartesianGrid<3,elemT>(other)
+{
+  if (other.is_contiguous())
+    this->make_contiguous();
+}
+
+template<class elemT>
+VoxelsOnCartesianGrid<elemT>&
+VoxelsOnCartesianGrid<elemT>::operator=(const VoxelsOnCartesianGrid& other)
+{
+  // note: _contiguous_data is not assigned, as our rows might still use it
+  DiscretisedDensityOnCartesianGrid<3,elemT>::operator=(other);
+  return *this;
+}
+
 template<class elemT>
 VoxelsOnCartesianGrid<elemT>::VoxelsOnCartesianGrid
                       (const Array<3,elemT>& v,
@@ -331,10 +348,14 @@ VoxelsOnCartesianGrid<elemT>*
 VoxelsOnCartesianGrid<elemT>::get_empty_voxels_on_cartesian_grid() const
 
 {
-  return new VoxelsOnCartesianGrid(this->get_exam_info().create_shared_clone(),
-                                   this->get_index_range(),
-                                   this->get_origin(), 
-                                   this->get_grid_spacing());
+  VoxelsOnCartesianGrid* empty_ptr =
+    new VoxelsOnCartesianGrid(this->get_exam_info().create_shared_clone(),
+                              this->get_index_range(),
+                              this->get_origin(), 
+                              this->get_grid_spacing());
+  if (this->is_contiguous())
+    empty_ptr->make_contiguous();
+  return empty_ptr;
 }
 
 
@@ -397,6 +418,65 @@ VoxelsOnCartesianGrid<elemT>::set_plane(const PixelsOnCartesianGrid<elemT>& plan
   this->operator[](z) = plane;    
 }
 
+template<class elemT>
+void
+VoxelsOnCartesianGrid<elemT>::set_row_memory(elemT* data_ptr, const bool copy_values)
+{
+  for (int z=this->get_min_index(); z<=this->get_max_index(); ++z)
+    for (int y=(*this)[z].get_min_index(); y<=(*this)[z].get_max_index(); ++y)
+      {
+        Array<1,elemT>& row = (*this)[z][y];
+        Array<1,elemT> new_row(row.get_index_range(), data_ptr);
+        if (copy_values)
+          std::copy(row.begin(), row.end(), new_row.begin());
+        // let row use the new memory (its old memory is released when new_row goes out of scope)
+        row.swap(new_row);
+        data_ptr += row.size();
+      }
+}
+
+template<class elemT>
+void
+VoxelsOnCartesianGrid<elemT>::make_contiguous()
+{
+  if (this->is_contiguous())
+    return;
+
+  std::vector<elemT> new_data(this->size_all());
+  this->set_row_memory(new_data.empty() ? 0 : &new_data[0], /* copy_values = */ true);
+  // this might release memory of a previous call, but no row uses that anymore
+  this->_contiguous_data.swap(new_data);
+}
+
+template<class elemT>
+void
+VoxelsOnCartesianGrid<elemT>::use_existing_contiguous_data(elemT* const data_ptr)
+{
+  if (this->size_all() > 0 && data_ptr == 0)
+    error("VoxelsOnCartesianGrid::use_existing_contiguous_data called with a null pointer");
+  this->set_row_memory(data_ptr, /* copy_values = */ false);
+  // release memory of a previous call to make_contiguous(), no row uses that anymore
+  std::vector<elemT>().swap(this->_contiguous_data);
+}
+
+template<class elemT>
+elemT*
+VoxelsOnCartesianGrid<elemT>::get_contiguous_data_ptr()
+{
+  if (this->size_all() == 0 || !this->is_contiguous())
+    return 0;
+  return &(*this->begin_all());
+}
+
+template<class elemT>
+const elemT*
+VoxelsOnCartesianGrid<elemT>::get_contiguous_data_ptr() const
+{
+  if (this->size_all() == 0 || !this->is_contiguous())
+    return 0;
+  return &(*this->begin_all_const());
+}
+
 template<class elemT>   
 void                                          
 VoxelsOnCartesianGrid<elemT>::grow_z_range(const int min_z, const int max_z)
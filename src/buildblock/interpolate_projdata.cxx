@@ -296,11 +296,11 @@ interpolate_projdata(ProjData& proj_data_out,
     proj_data_interpolator.set_coef(extended);
   }
         
-  // now do interpolation               
+  // now do interpolation
+  // (this uses the version for B-splines, which precomputes the weights for every dimension)
   SegmentBySinogram<float> sino_3D_out = proj_data_out.get_empty_segment_by_sinogram(0) ;
   sample_function_on_regular_grid(sino_3D_out, proj_data_interpolator, offset, step);
 
-  proj_data_out.set_segment(sino_3D_out);
   if (proj_data_out.set_segment(sino_3D_out) == Succeeded::no)
     return Succeeded::no;          
   return Succeeded::yes;
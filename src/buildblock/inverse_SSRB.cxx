@@ -20,7 +20,7 @@
 #include "stir/ProjData.h"
 #include "stir/ProjDataInfo.h"
 #include "stir/inverse_SSRB.h"
-#include "stir/Sinogram.h"
+#include "stir/SegmentBySinogram.h"
 #include "stir/Bin.h"
 #include "stir/Succeeded.h"
 
@@ -53,63 +53,88 @@ inverse_SSRB(ProjData& proj_data_4D,
 	    return Succeeded::no;
 	  }
 
- 	// keep sinograms out of the loop to avoid reallocations
-	// initialise to something because there's no default constructor
-	Sinogram<float> sino_4D = 
-		proj_data_4D.
-		get_empty_sinogram(proj_data_4D.get_min_axial_pos_num(0) , 0);
-	Sinogram<float> sino_3D = 
-		proj_data_3D.
-		get_empty_sinogram(proj_data_3D.get_min_axial_pos_num(0) , 0);
-	
+	// All output sinograms are found from segment 0 of the 3D data, so we read it only once.
+	const SegmentBySinogram<float> segment_3D = proj_data_3D.get_segment_by_sinogram(0);
+	const int in_min_ax_pos_num = segment_3D.get_min_axial_pos_num();
+	const int in_max_ax_pos_num = segment_3D.get_max_axial_pos_num();
+	VectorWithOffset<float> in_ms(in_min_ax_pos_num, in_max_ax_pos_num);
+	for (int in_ax_pos_num = in_min_ax_pos_num; in_ax_pos_num <= in_max_ax_pos_num; ++in_ax_pos_num)
+		in_ms[in_ax_pos_num] = proj_data_3D_info_sptr->get_m(Bin(0, 0, in_ax_pos_num, 0));
+
 	for (int out_segment_num = proj_data_4D.get_min_segment_num(); 
 	     out_segment_num <= proj_data_4D.get_max_segment_num();
 	     ++out_segment_num)
 	  {
-		for (int out_ax_pos_num = proj_data_4D.get_min_axial_pos_num(out_segment_num); 
-		     out_ax_pos_num  <= proj_data_4D.get_max_axial_pos_num(out_segment_num);
-		     ++out_ax_pos_num )
-			{		
-				sino_4D = proj_data_4D.get_empty_sinogram(out_ax_pos_num, out_segment_num);				
+		const int out_min_ax_pos_num = proj_data_4D.get_min_axial_pos_num(out_segment_num);
+		const int out_max_ax_pos_num = proj_data_4D.get_max_axial_pos_num(out_segment_num);
+		// For every output sinogram, find the first input sinogram that contributes and
+		// how many do (1, or 2 when it lies half-way between 2 input sinograms).
+		// This is done before the parallel loop, as get_m() is not thread-safe when first called.
+		VectorWithOffset<int> in_ax_pos_nums(out_min_ax_pos_num, out_max_ax_pos_num);
+		VectorWithOffset<int> num_contributing_sinos(out_min_ax_pos_num, out_max_ax_pos_num);
+		num_contributing_sinos.fill(0);
+		bool all_sinos_found = true;
+		for (int out_ax_pos_num = out_min_ax_pos_num; out_ax_pos_num <= out_max_ax_pos_num; ++out_ax_pos_num)
+			{
 				const float out_m = 
 					proj_data_4D_info_sptr->
-					get_m(Bin(out_segment_num, 0, out_ax_pos_num, 0));				
-				int num_contributing_sinos = 0;
-								
-				for (int in_ax_pos_num = proj_data_3D.get_min_axial_pos_num(0); 
-				     in_ax_pos_num  <= proj_data_3D.get_max_axial_pos_num(0);
-				     ++in_ax_pos_num )
+					get_m(Bin(out_segment_num, 0, out_ax_pos_num, 0));
+				for (int in_ax_pos_num = in_min_ax_pos_num; in_ax_pos_num <= in_max_ax_pos_num; ++in_ax_pos_num)
 				{
-					sino_3D = proj_data_3D.get_sinogram(in_ax_pos_num,0);					
-					const float in_m = 
-						proj_data_3D_info_sptr->get_m(Bin(0, 0, in_ax_pos_num, 0));
-
+					const float in_m = in_ms[in_ax_pos_num];
 					if (fabs(out_m - in_m) < 1E-2)
 					{
-					        ++num_contributing_sinos;
-						sino_4D += sino_3D;	
-						if (proj_data_4D.set_sinogram(sino_4D) == Succeeded::no)
-							return Succeeded::no;
+						in_ax_pos_nums[out_ax_pos_num] = in_ax_pos_num;
+						num_contributing_sinos[out_ax_pos_num] = 1;
 						break;
 					}
-					const float in_m_next = in_ax_pos_num == proj_data_3D.get_max_axial_pos_num(0) ? 
-						-1000000.F : proj_data_3D_info_sptr->get_m(Bin(0, 0, in_ax_pos_num+1, 0));
-
+					const float in_m_next = in_ax_pos_num == in_max_ax_pos_num ?
+						-1000000.F : in_ms[in_ax_pos_num+1];
 					if (fabs(out_m - .5F*(in_m + in_m_next)) < 1E-2)
 					{
-					        ++num_contributing_sinos;
-						sino_4D += sino_3D;
-						sino_4D += proj_data_3D.get_sinogram(in_ax_pos_num+1,0);
-						sino_4D *= .5F;
-						if (proj_data_4D.set_sinogram(sino_4D) == Succeeded::no)
-							return Succeeded::no;
+						in_ax_pos_nums[out_ax_pos_num] = in_ax_pos_num;
+						num_contributing_sinos[out_ax_pos_num] = 2;
 						break;
 					}
 				}
-				if (num_contributing_sinos == 0)
-				  warning("inverse_SSRB: no sinogram contributes to segment %d, axial_pos_num %d",
-					  out_segment_num, out_ax_pos_num);
-		}
+				if (num_contributing_sinos[out_ax_pos_num] == 0)
+				  {
+				    warning("inverse_SSRB: no sinogram contributes to segment %d, axial_pos_num %d",
+					    out_segment_num, out_ax_pos_num);
+				    all_sinos_found = false;
+				  }
+			}
+
+		// sinograms without contribution are left as they were in the output
+		SegmentBySinogram<float> segment_4D =
+			all_sinos_found
+			? proj_data_4D.get_empty_segment_by_sinogram(out_segment_num)
+			: proj_data_4D.get_segment_by_sinogram(out_segment_num);
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int out_ax_pos_num = out_min_ax_pos_num; out_ax_pos_num <= out_max_ax_pos_num; ++out_ax_pos_num)
+			{
+				const int in_ax_pos_num = in_ax_pos_nums[out_ax_pos_num];
+				Array<2,float>& sino_4D = segment_4D[out_ax_pos_num];
+				switch (num_contributing_sinos[out_ax_pos_num])
+					{
+					case 1:
+						sino_4D.fill(0.F);
+						sino_4D += segment_3D[in_ax_pos_num];
+						break;
+					case 2:
+						sino_4D.fill(0.F);
+						sino_4D += segment_3D[in_ax_pos_num];
+						sino_4D += segment_3D[in_ax_pos_num+1];
+						sino_4D *= .5F;
+						break;
+					default:
+						break;
+					}
+			}
+		if (proj_data_4D.set_segment(segment_4D) == Succeeded::no)
+			return Succeeded::no;
 	}
 	return Succeeded::yes;
 }
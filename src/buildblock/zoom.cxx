@@ -233,6 +233,118 @@ zoom_viewgram (Viewgram<float>& out_view,
 
 
 
+/* Helper functions for zooming images.
+
+   overlap_interpolate is linear, and the weights only depend on the geometry. For images,
+   we therefore compute the weights once per dimension, and apply them to all rows/planes.
+*/
+
+//! weights for every output index (only the range of non-zero weights is stored)
+typedef VectorWithOffset<Array<1,float> > OverlapWeights;
+
+/*! \brief compute the weights such that out[i] = sum_j weights[i][j]*in[j]*scale
+  is equivalent to overlap_interpolate(out, in, zoom, offset) (followed by multiplying with \a scale)
+*/
+static
+OverlapWeights
+compute_overlap_weights(const int min_out_index, const int max_out_index,
+                        const int min_in_index, const int max_in_index,
+                        const float zoom, const float offset,
+                        const float scale = 1.F)
+{
+  OverlapWeights weights(min_out_index, max_out_index);
+  if (min_in_index > max_in_index)
+    return weights;
+  // find the weights by interpolating unit vectors
+  Array<2,float> all_weights(IndexRange2D(min_out_index, max_out_index, min_in_index, max_in_index));
+  {
+    Array<1,float> in(min_in_index, max_in_index);
+    Array<1,float> out(min_out_index, max_out_index);
+    for (int in_index = min_in_index; in_index <= max_in_index; ++in_index)
+      {
+        in.fill(0.F);
+        in[in_index] = 1.F;
+        overlap_interpolate(out, in, zoom, offset);
+        for (int out_index = min_out_index; out_index <= max_out_index; ++out_index)
+          all_weights[out_index][in_index] = out[out_index];
+      }
+  }
+  for (int out_index = min_out_index; out_index <= max_out_index; ++out_index)
+    {
+      const Array<1,float>& row = all_weights[out_index];
+      int first = min_in_index;
+      while (first <= max_in_index && row[first] == 0)
+        ++first;
+      int last = max_in_index;
+      while (last >= first && row[last] == 0)
+        --last;
+      if (first > last)
+        continue; // leave empty
+      weights[out_index].grow(first, last);
+      for (int in_index = first; in_index <= last; ++in_index)
+        weights[out_index][in_index] = row[in_index] * scale;
+    }
+  return weights;
+}
+
+//! check if every output index gets exactly one input index with weight 1 (or nothing)
+static
+bool
+is_shift(const OverlapWeights& weights)
+{
+  for (int out_index = weights.get_min_index(); out_index <= weights.get_max_index(); ++out_index)
+    if (weights[out_index].size() > 1 ||
+        (weights[out_index].size() == 1 && weights[out_index][weights[out_index].get_min_index()] != 1.F))
+      return false;
+  return true;
+}
+
+//! out += weight*in for rows of length \a num_elements (written such that the compiler can vectorise it)
+static inline
+void
+add_weighted_row(float * const out, const float * const in, const float weight, const int num_elements)
+{
+  for (int i=0; i<num_elements; ++i)
+    out[i] += in[i] * weight;
+}
+
+//! zoom a plane in x and y, using a temporary of the size of one plane
+static
+void
+zoom_plane(Array<2,float>& out_plane, const Array<2,float>& in_plane,
+           const OverlapWeights& weights_x, const OverlapWeights& weights_y)
+{
+  const int min_out_x = weights_x.get_min_index();
+  const int num_out_x = weights_x.get_length();
+  Array<2,float> temp(IndexRange2D(in_plane.get_min_index(), in_plane.get_max_index(),
+                                   min_out_x, weights_x.get_max_index()));
+  // interpolate along x: a sparse dot product for every output voxel
+  for (int y = in_plane.get_min_index(); y <= in_plane.get_max_index(); ++y)
+    {
+      const Array<1,float>& in_row = in_plane[y];
+      Array<1,float>& temp_row = temp[y];
+      for (int x = min_out_x; x <= weights_x.get_max_index(); ++x)
+        {
+          const Array<1,float>& weights = weights_x[x];
+          float value = 0.F;
+          for (int in_x = weights.get_min_index(); in_x <= weights.get_max_index(); ++in_x)
+            value += weights[in_x] * in_row[in_x];
+          temp_row[x] = value;
+        }
+    }
+  // interpolate along y: add weighted rows
+  for (int y = out_plane.get_min_index(); y <= out_plane.get_max_index(); ++y)
+    {
+      Array<1,float>& out_row = out_plane[y];
+      out_row.fill(0.F);
+      if (num_out_x == 0)
+        continue;
+      const Array<1,float>& weights = weights_y[y];
+      for (int in_y = weights.get_min_index(); in_y <= weights.get_max_index(); ++in_y)
+        add_weighted_row(&out_row[min_out_x], &temp[in_y][min_out_x], weights[in_y], num_out_x);
+    }
+}
+
 static
 VoxelsOnCartesianGrid<float>
 construct_new_image_from_zoom_parameters(const VoxelsOnCartesianGrid<float> &image,
@@ -320,14 +432,46 @@ zoom_image(const VoxelsOnCartesianGrid<float> &image,
 					     offsets_in_mm,
 					     new_sizes);
 
-  PixelsOnCartesianGrid<float> 
-    new_image2D = new_image.get_plane(new_image.get_min_z());
-  for (int plane = image.get_min_z(); plane <= image.get_max_z(); plane++)
+  new_image.set_exam_info(image.get_exam_info());
+  // same conventions as in the 2D version of zoom_image
+  const float zoom_x =
+    image.get_voxel_size().x() / new_image.get_voxel_size().x();
+  const float zoom_y =
+    image.get_voxel_size().y() / new_image.get_voxel_size().y();
+  const float x_offset =
+    (new_image.get_origin().x() - image.get_origin().x())
+    / image.get_voxel_size().x();
+  const float y_offset =
+    (new_image.get_origin().y() - image.get_origin().y())
+    / image.get_voxel_size().y();
+
+  float scale_image = 1.F;
+  switch (zoom_options.get_scaling_option())
     {
-      zoom_image(new_image2D, image.get_plane(plane), zoom_options);
-      new_image.set_plane(new_image2D, plane);
+    case ZoomOptions::preserve_values:
+      scale_image = zoom_x*zoom_y; break;
+    case ZoomOptions::preserve_projections:
+      scale_image = zoom_y; break;
+    case ZoomOptions::preserve_sum:
+      break;
     }
-    
+
+  const OverlapWeights weights_x =
+    compute_overlap_weights(new_image.get_min_x(), new_image.get_max_x(),
+                            image.get_min_x(), image.get_max_x(),
+                            zoom_x, x_offset, scale_image);
+  const OverlapWeights weights_y =
+    compute_overlap_weights(new_image.get_min_y(), new_image.get_max_y(),
+                            image.get_min_y(), image.get_max_y(),
+                            zoom_y, y_offset);
+
+  // planes are independent, so we zoom them directly into the new image
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int plane = image.get_min_z(); plane <= image.get_max_z(); plane++)
+    zoom_plane(new_image[plane], image[plane], weights_x, weights_y);
+
   assert(norm(new_image.get_voxel_size() - image.get_voxel_size()/zooms)<1);
 
   return new_image;
@@ -421,27 +565,6 @@ zoom_image(VoxelsOnCartesianGrid<float> &image_out,
       return;
     }
 
-  // TODO creating a lot of new images here...
-  Array<3,float> 
-    temp(IndexRange3D(image_in.get_min_z(), image_in.get_max_z(),
-		      image_in.get_min_y(), image_in.get_max_y(),
-		      image_out.get_min_x(), image_out.get_max_x()));
-
-  for (int z=image_in.get_min_z(); z<=image_in.get_max_z(); z++)
-    for (int y=image_in.get_min_y(); y<=image_in.get_max_y(); y++)
-      overlap_interpolate(temp[z][y], image_in[z][y], zoom_x, x_offset);
-
-  Array<3,float> temp2(IndexRange3D(image_in.get_min_z(), image_in.get_max_z(),
-				    image_out.get_min_y(), image_out.get_max_y(),
-				    image_out.get_min_x(), image_out.get_max_x()));
-
-  for (int z=image_in.get_min_z(); z<=image_in.get_max_z(); z++)
-    overlap_interpolate(temp2[z], temp[z], zoom_y, y_offset);
-
-  temp.recycle();
-
-  overlap_interpolate(image_out, temp2, zoom_z, z_offset);
-
   float scale_image = 1.F;
 
   switch (zoom_options.get_scaling_option())
@@ -461,14 +584,71 @@ zoom_image(VoxelsOnCartesianGrid<float> &image_out,
 
     case ZoomOptions::preserve_sum:
       {
-        return; // no need to scale
+        break; // no need to scale
       }
 
     }
 
-  if (scale_image != 1.F)
-    image_out*= scale_image;
+  // compute the weights once per dimension (the scale factor is included in the x-weights)
+  const OverlapWeights weights_x =
+    compute_overlap_weights(image_out.get_min_x(), image_out.get_max_x(),
+                            image_in.get_min_x(), image_in.get_max_x(),
+                            zoom_x, x_offset, scale_image);
+  const OverlapWeights weights_y =
+    compute_overlap_weights(image_out.get_min_y(), image_out.get_max_y(),
+                            image_in.get_min_y(), image_in.get_max_y(),
+                            zoom_y, y_offset);
+  const OverlapWeights weights_z =
+    compute_overlap_weights(image_out.get_min_z(), image_out.get_max_z(),
+                            image_in.get_min_z(), image_in.get_max_z(),
+                            zoom_z, z_offset);
+
+  if (is_shift(weights_z))
+    {
+      // every output plane corresponds to (at most) one input plane,
+      // so we can zoom the planes directly into the output image
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (int z=image_out.get_min_z(); z<=image_out.get_max_z(); z++)
+        {
+          if (weights_z[z].size() == 0)
+            image_out[z].fill(0.F);
+          else
+            zoom_plane(image_out[z], image_in[weights_z[z].get_min_index()], weights_x, weights_y);
+        }
+      return;
+    }
+
+  // zoom every input plane in x and y
+  Array<3,float> temp(IndexRange3D(image_in.get_min_z(), image_in.get_max_z(),
+                                   image_out.get_min_y(), image_out.get_max_y(),
+                                   image_out.get_min_x(), image_out.get_max_x()));
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z=image_in.get_min_z(); z<=image_in.get_max_z(); z++)
+    zoom_plane(temp[z], image_in[z], weights_x, weights_y);
 
+  // interpolate along z: add weighted rows
+  const int min_out_x = image_out.get_min_x();
+  const int num_out_x = image_out.get_x_size();
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z=image_out.get_min_z(); z<=image_out.get_max_z(); z++)
+    {
+      const Array<1,float>& weights = weights_z[z];
+      for (int y=image_out.get_min_y(); y<=image_out.get_max_y(); y++)
+        {
+          Array<1,float>& out_row = image_out[z][y];
+          out_row.fill(0.F);
+          if (num_out_x == 0)
+            continue;
+          for (int in_z = weights.get_min_index(); in_z <= weights.get_max_index(); ++in_z)
+            add_weighted_row(&out_row[min_out_x], &temp[in_z][y][min_out_x], weights[in_z], num_out_x);
+        }
+    }
 }
 
 void
@@ -503,15 +683,6 @@ zoom_image(PixelsOnCartesianGrid<float> &image2D_out,
     return;
   }
 
-  Array<2,float> 
-    temp(IndexRange2D(image2D_in.get_min_y(), image2D_in.get_max_y(),
-		      image2D_out.get_min_x(), image2D_out.get_max_x()));
-
-  for (int y=image2D_in.get_min_y(); y<=image2D_in.get_max_y(); y++)
-    overlap_interpolate(temp[y], image2D_in[y], zoom_x, x_offset);
-
-  overlap_interpolate(image2D_out, temp, zoom_y, y_offset);   
-
   float scale_image = 1.F;
 
   switch (zoom_options.get_scaling_option())
@@ -531,14 +702,20 @@ zoom_image(PixelsOnCartesianGrid<float> &image2D_out,
 
     case ZoomOptions::preserve_sum:
       {
-        return; // no need to scale
+        break; // no need to scale
       }
 
     }
 
-  if (scale_image != 1.F)
-    image2D_out*= scale_image;
-
+  const OverlapWeights weights_x =
+    compute_overlap_weights(image2D_out.get_min_x(), image2D_out.get_max_x(),
+                            image2D_in.get_min_x(), image2D_in.get_max_x(),
+                            zoom_x, x_offset, scale_image);
+  const OverlapWeights weights_y =
+    compute_overlap_weights(image2D_out.get_min_y(), image2D_out.get_max_y(),
+                            image2D_in.get_min_y(), image2D_in.get_max_y(),
+                            zoom_y, y_offset);
+  zoom_plane(image2D_out, image2D_in, weights_x, weights_y);
 }
 
 END_NAMESPACE_STIR
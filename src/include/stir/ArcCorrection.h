@@ -50,6 +50,12 @@ class ProjData;
   and then divided by the new sampling. This ensures that the normalisation 
   is preserved. Also, uniform data will result in uniform output.
 
+  As the interpolation only depends on the geometry, the interpolation weights are
+  computed in set_up() and stored as a sparse matrix (for every arc-corrected tangential position,
+  the weights of the non-arc-corrected tangential positions that overlap with it).
+  Arc-correction of a segment or of a ProjData object is done in parallel
+  (over axial positions or views) when using OpenMP.
+
   \warning You <strong>have</strong> to call one of the set_up() functions
   before use of any other member function.
 */
@@ -150,6 +156,11 @@ private:
   Array<1,float> _noarccorr_coords;
   Array<1,float> _noarccorr_bin_sizes;
   float tangential_sampling;
+  //! interpolation weights (already divided by \c tangential_sampling)
+  /*! Indexed by the arc-corrected tangential position. Every element is indexed by the
+      non-arc-corrected tangential positions that contribute to it.
+  */
+  VectorWithOffset<Array<1,float> > _arc_correction_weights;
 
   void do_arc_correction(Array<1,float>& out, const Array<1,float>& in) const;
 };
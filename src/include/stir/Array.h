@@ -201,6 +201,16 @@ public:
   */
   inline bool is_regular() const;
 
+  //! checks if all elements are stored in one contiguous block of memory
+  /*! This is normally not the case, as every 1D array allocates its own memory. It can
+      be arranged for images, see VoxelsOnCartesianGrid::make_contiguous().
+
+      The elements are then stored in the order of the full_iterator.
+      The check takes the pointers of all 1D arrays into account, so its cost is
+      proportional to the number of 1D arrays.
+  */
+  inline bool is_contiguous() const;
+
   //! find regular range, returns \c false if the range is not regular
   /*! \see class IndexRange for a definition of (ir)regular ranges */
   bool get_regular_range(
@@ -320,6 +330,13 @@ public:
   //! constructor given first and last indices, initialising elements to 0
   inline Array(const int min_index, const int max_index);
 
+  //! constructor given an IndexRange<1>, using existing data (no initialisation)
+  /*! The memory starting at \a data_ptr has to stay valid while it is used by this object,
+      and will not be deallocated by this object.
+      \see VectorWithOffset::owns_memory_for_data()
+  */
+  inline Array(const IndexRange<1>& range, elemT * const data_ptr);
+
   //! constructor from basetype
   inline Array(const NumericVectorWithOffset<elemT,elemT> &il);
   
@@ -374,6 +391,9 @@ public:
   
   //! checks if the index range is 'regular' (always \c true as this is the 1D case)
   inline bool is_regular() const;
+
+  //! checks if all elements are stored in one contiguous block of memory (always \c true as this is the 1D case)
+  inline bool is_contiguous() const;
   
   //! find regular range, returns \c false if the range is not regular
   bool get_regular_range(
@@ -278,6 +278,27 @@ Array<num_dimensions, elemT>::is_regular() const
   return get_index_range().is_regular();
 }
 
+template <int num_dimensions, typename elemT>
+bool
+Array<num_dimensions, elemT>::is_contiguous() const
+{
+  const elemT* next_ptr = 0;
+  for (int i=this->get_min_index(); i<=this->get_max_index(); ++i)
+    {
+      const Array<num_dimensions-1, elemT>& sub_array = (*this)[i];
+      if (!sub_array.is_contiguous())
+        return false;
+      const size_t sub_size = sub_array.size_all();
+      if (sub_size == 0)
+        continue;
+      const elemT* first_ptr = &(*sub_array.begin_all_const());
+      if (next_ptr != 0 && first_ptr != next_ptr)
+        return false;
+      next_ptr = first_ptr + sub_size;
+    }
+  return true;
+}
+
 //TODO terribly inefficient at the moment
 template <int num_dimensions, typename elemT>
 bool
@@ -476,6 +497,12 @@ Array<1, elemT>::Array(const int min_index, const int max_index)
 }
 
 
+template <class elemT>
+Array<1, elemT>::Array(const IndexRange<1>& range, elemT * const data_ptr)
+: base_type(range.get_min_index(), range.get_max_index(),
+            data_ptr, data_ptr + range.get_length())
+{}
+
 template <class elemT>
 Array<1, elemT>::Array(const base_type &il)
 : base_type(il)
@@ -621,6 +648,13 @@ Array<1, elemT>::is_regular() const
   return true;
 }
 
+template <class elemT>
+bool
+Array<1, elemT>::is_contiguous() const
+{
+  return true;
+}
+
 template <typename elemT>
 bool
 Array<1, elemT>::get_regular_range(
@@ -26,11 +26,35 @@ START_NAMESPACE_STIR
 
 template <typename elemT> class VectorWithOffset;
 
+/*!
+  \ingroup Array
+  \brief Convolution of a 3D array with an arbitrary 3D kernel
+
+  Elements of the input array that are outside its index range are considered to be 0.
+
+  Depending on the kernel (and the chosen Method), the convolution is computed in
+  different ways (which all give the same result up to numerical rounding error):
+  - \c direct: the standard sum over all kernel elements. Loops are organised
+     such that the innermost loop does not need to check boundaries.
+  - \c separable: if the kernel is the outer product of 3 1D kernels (i.e. rank-1),
+     the convolution is done as 3 consecutive 1D convolutions.
+  - \c DFT: the convolution is computed by using ArrayFilterUsingRealDFTWithPadding,
+     with enough zero-padding to avoid aliasing.
+
+  By default (\c automatic), separability of the kernel is detected, and the DFT is used
+  when the number of non-separable kernel elements is larger than
+  get_DFT_kernel_size_threshold().
+
+  When STIR is compiled with OpenMP, the direct and separable versions are parallelised over
+  the first (z) index.
+*/
 template <typename elemT>
 class ArrayFilter3DUsingConvolution : 
   public ArrayFunctionObject_2ArgumentImplementation<3,elemT>
 {
 public:
+  //! Methods used to compute the convolution
+  enum Method { automatic, direct, separable, DFT };
 
   //! Construct the filter given the kernel coefficients
   /*! 
@@ -42,6 +66,18 @@ public:
   
   bool is_trivial() const;
 
+  //! Set the method used for the convolution
+  /*! Will call error() if \c separable is requested but the kernel is not separable. */
+  void set_method(const Method);
+  Method get_method() const;
+
+  //! Set the number of kernel elements above which the DFT will be used in \c automatic mode
+  void set_DFT_kernel_size_threshold(const int);
+  int get_DFT_kernel_size_threshold() const;
+
+  //! Returns \c true if the kernel is the outer product of 3 1D kernels
+  bool kernel_is_separable() const;
+
  virtual Succeeded 
     get_influencing_indices(IndexRange<1>& influencing_indices, 
                             const IndexRange<1>& output_indices) const;
@@ -52,7 +88,19 @@ public:
 
 private:
   Array <3, float>  filter_coefficients;
+  //! 1D kernels such that filter_coefficients[k][j][i] = kernel_z[k]*kernel_y[j]*kernel_x[i] (if separable)
+  Array<1,float> kernel_z, kernel_y, kernel_x;
+  bool _kernel_is_separable;
+  Method method;
+  int DFT_kernel_size_threshold;
+
+  //! sets \c kernel_z etc and \c _kernel_is_separable
+  void check_separability();
+
   void do_it(Array<3,elemT>& out_array, const Array<3,elemT>& in_array) const;
+  void do_it_direct(Array<3,elemT>& out_array, const Array<3,elemT>& in_array) const;
+  void do_it_separable(Array<3,elemT>& out_array, const Array<3,elemT>& in_array) const;
+  void do_it_DFT(Array<3,elemT>& out_array, const Array<3,elemT>& in_array) const;
   void do_it_2d(Array<2,elemT>& out_array, const Array<2,elemT>& in_array) const;
 
 };
@@ -24,12 +24,12 @@
 #include <string>
 #include <vector>
 #include <random>
-#include <map>
 #include <boost/algorithm/string.hpp>
 #include <boost/unordered_map.hpp>
 
 #include "stir/CartesianCoordinate3D.h"
 #include "stir/DetectionPosition.h"
+#include "stir/error.h"
 
 #ifndef __stir_DetectorCoordinateMap_H__
 #define __stir_DetectorCoordinateMap_H__
@@ -45,6 +45,11 @@ class Succeeded;
 	An empty line will terminate the reading at that line.
 
     Optionally LOR end-points can be randomly displaced using a Gaussian distribution with standard deviation \sigma (in mm).
+
+    Internally, coordinates are stored in a flat array indexed by the detection position, such that
+    get_coordinate_for_det_pos() does not need any look-up in a map. For
+    find_detection_position_given_cartesian_coordinate(), the crystals are sorted into a uniform
+    spatial grid, such that only neighbouring cells need to be searched.
 */
 class DetectorCoordinateMap
 {
@@ -83,15 +88,18 @@ public:
 
 	stir::DetectionPosition<> get_det_pos_for_index(const stir::DetectionPosition<>& index) const
 	{
-		return input_index_to_det_pos.at(index);
+		return input_index_to_det_pos[get_flat_index(index)];
     }
 	//! Returns a cartesian coordinate given a detection position.
 	stir::CartesianCoordinate3D<float> get_coordinate_for_det_pos( const stir::DetectionPosition<>& det_pos ) const
 	{ 
-		auto coord = det_pos_to_coord.at(det_pos);
-		coord.x() += static_cast<float>(distribution(generator));
-		coord.y() += static_cast<float>(distribution(generator));
-		coord.z() += static_cast<float>(distribution(generator));
+		auto coord = det_pos_to_coord[get_flat_index(det_pos)];
+		if (sigma != 0.0)
+		  {
+		    coord.x() += static_cast<float>(distribution(generator));
+		    coord.y() += static_cast<float>(distribution(generator));
+		    coord.z() += static_cast<float>(distribution(generator));
+		  }
 		return coord;
 	}
 	//! Returns a cartesian coordinate given an (unsorted) index.
@@ -100,6 +108,10 @@ public:
 		return get_coordinate_for_det_pos(get_det_pos_for_index(index));
 	}
 
+        //! Finds the detection position of the crystal closest to \a cart_coord
+        /*! Only crystals within 0.1 mm of \a cart_coord are considered. If there are none,
+            a warning is written and Succeeded::no is returned.
+        */
         Succeeded
           find_detection_position_given_cartesian_coordinate(DetectionPosition<>& det_pos,
                                                              const CartesianCoordinate3D<float>& cart_coord) const;
@@ -121,12 +133,31 @@ private:
   unsigned num_tangential_coords;
   unsigned num_axial_coords;
   unsigned num_radial_coords;
-  unordered_to_ordered_det_pos_type input_index_to_det_pos;
-  det_pos_to_coord_type det_pos_to_coord;
-  std::map<stir::CartesianCoordinate3D<float>,
-    stir::DetectionPosition<>> detection_position_map_given_cartesian_coord_keys_3_decimal;
-  std::map<stir::CartesianCoordinate3D<float>,
-    stir::DetectionPosition<>> detection_position_map_given_cartesian_coord_keys_2_decimal;
+  //! all following arrays are indexed with get_flat_index()
+  std::vector<stir::DetectionPosition<> > input_index_to_det_pos;
+  std::vector<stir::CartesianCoordinate3D<float> > det_pos_to_coord;
+
+  //! @name uniform grid used for finding the crystal given a coordinate
+  /*! Crystals in cell \c c are <code>grid_crystal_indices[grid_cell_start[c]..grid_cell_start[c+1]-1]</code> */
+  //@{
+  stir::CartesianCoordinate3D<float> grid_origin;
+  float grid_cell_size;
+  stir::BasicCoordinate<3,int> grid_size;
+  std::vector<unsigned> grid_cell_start;
+  std::vector<unsigned> grid_crystal_indices;
+  //@}
+
+  //! index in the flat arrays, calls error() if \a det_pos is out of range
+  unsigned get_flat_index(const stir::DetectionPosition<>& det_pos) const
+  {
+    if (det_pos.tangential_coord() >= num_tangential_coords ||
+        det_pos.axial_coord() >= num_axial_coords ||
+        det_pos.radial_coord() >= num_radial_coords)
+      error("DetectorCoordinateMap: detection position out of range");
+    return (det_pos.radial_coord()*num_axial_coords + det_pos.axial_coord())*num_tangential_coords
+      + det_pos.tangential_coord();
+  }
+  void build_grid();
 
   const double sigma;
   mutable std::default_random_engine generator;
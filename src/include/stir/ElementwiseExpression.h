@@ -0,0 +1,110 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup buildblock
+
+  \brief Declaration of class stir::ElementwiseExpression
+
+  \author agent
+*/
+#ifndef __stir_ElementwiseExpression_H__
+#define __stir_ElementwiseExpression_H__
+
+#include "stir/common.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup buildblock
+  \brief An arithmetic expression that is evaluated element-by-element on one or more arrays
+
+  The expression is parsed once and stored in reverse Polish notation. It is evaluated on
+  blocks of elements, such that the cost of interpreting the expression is small compared to
+  the arithmetic, and the loops over the elements can be vectorised by the compiler. This
+  allows computing compound operations (such as <tt>(a*b + c)^2</tt> with thresholds) in a
+  single pass over the data.
+
+  \par Syntax
+  - numbers, e.g. \c 2, \c 1.5 or \c 3e-2
+  - variables \c a, \c b, ..., \c z, referring to the first, second, ... input
+  - binary operators \c +, \c -, \c *, \c / and \c ^ (power) with the usual precedence.
+    \c ^ is right-associative and binds more strongly than unary minus, i.e. <tt>-a^2</tt> is <tt>-(a^2)</tt>.
+  - unary minus
+  - parentheses
+  - functions \c min(x,y), \c max(x,y), \c exp(x), \c log(x), \c sqrt(x) and \c abs(x)
+
+  Spaces are ignored. Thresholding \c a to the interval [0,10] can be written as
+  <tt>min(max(a,0),10)</tt>.
+*/
+class ElementwiseExpression
+{
+public:
+  //! Parse the expression
+  /*! Calls error() if \a expression is not valid. */
+  explicit ElementwiseExpression(const std::string& expression);
+
+  //! Number of inputs needed to evaluate the expression
+  /*! This is 1 + the index of the last variable used, e.g. 3 if \c c is used. */
+  int get_num_inputs() const { return num_inputs; }
+
+  //! Evaluate the expression for \a num_elements elements
+  /*! \a inputs[i] has to point to the elements of input \c i, for \c i up to get_num_inputs().
+      \a output can be equal to one of the inputs.
+
+      This function can be called by several threads at the same time.
+  */
+  void evaluate(float * const output,
+                const std::vector<const float *>& inputs,
+                const std::size_t num_elements) const;
+
+  //! Evaluate the expression for a single element
+  float evaluate(const std::vector<float>& inputs) const;
+
+private:
+  enum OperationType
+    {
+      constant_op, variable_op,
+      add_op, subtract_op, multiply_op, divide_op, power_op, min_op, max_op,
+      negate_op, exp_op, log_op, sqrt_op, abs_op
+    };
+  struct Operation
+  {
+    OperationType type;
+    float value;
+    int variable_index;
+  };
+
+  const std::string expression;
+  //! operations in reverse Polish notation
+  std::vector<Operation> operations;
+  int num_inputs;
+  //! maximum number of intermediate results during evaluation
+  int max_stack_size;
+
+  // functions for the recursive descent parser
+  // All of these advance \a pos beyond the part of the expression that they parse.
+  void parse_sum(std::size_t& pos);
+  void parse_product(std::size_t& pos);
+  void parse_unary(std::size_t& pos);
+  void parse_power(std::size_t& pos);
+  void parse_primary(std::size_t& pos);
+  void skip_spaces(std::size_t& pos) const;
+  void add_operation(const OperationType type, const float value = 0.F, const int variable_index = 0);
+  void parse_error(const std::size_t pos, const std::string& message) const;
+};
+
+END_NAMESPACE_STIR
+
+#endif
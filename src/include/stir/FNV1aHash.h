@@ -0,0 +1,87 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup buildblock
+  \brief Declaration of class stir::FNV1aHash
+
+  \author agent
+*/
+
+#ifndef __stir_FNV1aHash_H__
+#define __stir_FNV1aHash_H__
+
+#include "stir/common.h"
+#include "boost/cstdint.hpp"
+#include <cstddef>
+#include <string>
+
+START_NAMESPACE_STIR
+
+/*! \ingroup buildblock
+  \brief Incremental 64-bit FNV-1a hash
+
+  Used to construct the names of files in on-disk caches (e.g. for system or
+  kernel matrices) from all the parameters that determine their content.
+  This is not a cryptographic hash. Values are hashed as their binary
+  representation, so the result depends on the platform's byte-order.
+
+  \code
+    FNV1aHash hash;
+    hash.add(num_voxels);
+    hash.add_bytes(image_ptr, num_voxels*sizeof(float));
+    const boost::uint64_t value = hash.get_value();
+  \endcode
+*/
+class FNV1aHash
+{
+public:
+  FNV1aHash()
+    : hash(14695981039346656037ULL)
+  {}
+
+  //! add a block of memory
+  inline void add_bytes(const void* data, const std::size_t num_bytes)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i=0; i<num_bytes; ++i)
+      {
+        this->hash ^= bytes[i];
+        this->hash *= 1099511628211ULL;
+      }
+  }
+
+  //! add the binary representation of a value
+  template <typename T>
+  inline void add(const T& value)
+  {
+    this->add_bytes(&value, sizeof(T));
+  }
+
+  //! add the characters of a string
+  inline void add(const std::string& text)
+  {
+    this->add_bytes(text.data(), text.size());
+  }
+
+  //! get the hash of everything added so far
+  boost::uint64_t get_value() const
+  {
+    return this->hash;
+  }
+
+private:
+  boost::uint64_t hash;
+};
+
+END_NAMESPACE_STIR
+
+#endif
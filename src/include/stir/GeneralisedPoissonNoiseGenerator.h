@@ -15,11 +15,14 @@
 */
 
 #include "stir/ProjData.h"
+#include "stir/shared_ptr.h"
 
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/variate_generator.hpp>
+#include <boost/cstdint.hpp>
 #include <algorithm>
 #include <functional>
+#include <vector>
 // boost::serialization::make_array was moved in boost 1.64
 #if BOOST_VERSION == 106400
 #include <boost/serialization/array_wrapper.hpp>
@@ -40,6 +43,19 @@ START_NAMESPACE_STIR
   be equal to <tt>scaling_factor*mean_of_input</tt>, otherwise it
   will be equal to mean_of_input, but then the output is no longer Poisson
   distributed.
+
+  \par Random streams for projection data
+
+  When generating noise for projection data, every viewgram uses its own random number
+  generator, seeded with a value derived from a seed for the call, the realisation number and the
+  segment and view numbers. Viewgrams are therefore processed in parallel (when
+  using OpenMP), and the result is independent of the number of threads
+  and of the order in which viewgrams are processed. Several realisations can be generated
+  in a single pass over the input data.
+
+  The seed for the call is drawn from the generator of this object. Subsequent calls therefore
+  give different realisations, while the same seed() and the same sequence of calls give the
+  same results.
 */
 class GeneralisedPoissonNoiseGenerator
 {
@@ -63,20 +79,38 @@ class GeneralisedPoissonNoiseGenerator
     {
       std::transform(array_in.begin_all(), array_in.end_all(),
                      array_out.begin_all(),
-                     std::bind(generate_scaled_poisson_random, std::placeholders::_1, this->scaling_factor, this->preserve_mean));
+                     std::bind(generate_scaled_poisson_random, std::placeholders::_1, this->scaling_factor, this->preserve_mean,
+                               std::ref(this->generator)));
     }
 
+  //! generate a noise realisation for projection data
+  /*! Equivalent to the first realisation generated by the version with multiple outputs
+      (when called with the same state of the generator).
+  */
   void
     generate_random(ProjData& output_projdata, 
                     const ProjData& input_projdata);
 
+  //! generate multiple noise realisations for projection data in one pass over the input
+  /*! Realisation \c r will be written in \c output_projdata_sptrs[r]. Realisations are
+      independent of each other (but reproducible for a given seed).
+  */
+  void
+    generate_random(const std::vector<shared_ptr<ProjData> >& output_projdata_sptrs,
+                    const ProjData& input_projdata);
+
  private:
-  static base_generator_type generator;
+  base_generator_type generator;
   const float scaling_factor;
   const bool preserve_mean;
 
-  static unsigned int generate_poisson_random(const float mu);
-  static float generate_scaled_poisson_random(const float mu, const float scaling_factor, const bool preserve_mean);
+  //! compute seed for the random stream used for a viewgram
+  static unsigned int
+    get_stream_seed(const boost::uint64_t call_seed, const int realisation_num, const int segment_num, const int view_num);
+
+  static unsigned int generate_poisson_random(const float mu, base_generator_type& generator);
+  static float generate_scaled_poisson_random(const float mu, const float scaling_factor, const bool preserve_mean,
+                                              base_generator_type& generator);
 
 };
 
@@ -106,6 +106,12 @@ public:
                              const std::streampos offset,
                              const hsize_t size) const;
 
+    //! size of the chunks (in bytes) in which the listmode data are stored in the file
+    /*! \return 0 if the dataset is not chunked.
+        initialise_listmode_data() has to be called first.
+    */
+    hsize_t get_list_data_chunk_size() const;
+
     //! read singles at time slice \c current_id
     /*! \param[in] current_id is a 1-based index */
     Succeeded read_singles(Array<1, unsigned int> &output,
@@ -34,6 +34,7 @@
 #include <string>
 #include <iostream>
 #include <vector>
+#include <future>
 
 START_NAMESPACE_STIR
 
@@ -66,6 +67,13 @@ namespace RDF_HDF5 {
                          const OptionsT options);
     \endcode
 
+    \par Buffering
+    Data are read from the HDF5 dataset in large blocks (see set_buffer_size()). Optionally,
+    the block following the current one is read in a background thread while records are
+    decoded from the current one (see set_asynchronous_reading()), such that decoding does not
+    have to wait for the HDF5 library after every block. Only this background thread
+    accesses the HDF5 file while it is reading.
+
     \todo Allow choosing between allocation with \c new or on the stack.
 */
 template <class RecordT>
@@ -81,13 +89,16 @@ public:
 //                           const std::size_t size_of_record_signature,
 //                           const std::size_t max_size_of_record);
 
+  /*! \see set_buffer_size() for the meaning of \a buffer_size */
   explicit
     InputStreamWithRecordsFromHDF5(const std::string& filename,
                            const std::size_t size_of_record_signature,
-                           const std::size_t max_size_of_record);
+                           const std::size_t max_size_of_record,
+                           const std::size_t buffer_size = 0);
 
 
-  virtual ~InputStreamWithRecordsFromHDF5() {}
+  //! Waits for the background read (if any) to finish
+  virtual ~InputStreamWithRecordsFromHDF5();
 
   inline
   virtual 
@@ -126,6 +137,28 @@ public:
   inline
     void set_saved_get_positions(const std::vector<std::streampos>& );
 
+  //! Set the size (in bytes) of the blocks read from the file
+  /*! If \a buffer_size is 0 (the default), a size of about 10 MB is used, rounded up to a multiple
+      of the chunk size of the HDF5 dataset (if it is chunked), such that every read accesses
+      complete chunks. Otherwise, \a buffer_size is used as given.
+
+      Two buffers of this size are allocated when using asynchronous reading.
+  */
+  void set_buffer_size(const std::size_t buffer_size);
+  //! Get the size (in bytes) of the blocks read from the file
+  std::size_t get_buffer_size() const;
+
+  //! Enable or disable reading the next block in a background thread
+  /*! This is enabled by default only if the HDF5 library is built to be thread-safe, as otherwise
+      other threads accessing HDF5 files at the same time (e.g. via another stream) would corrupt its state.
+      Enabling it for a library that is not thread-safe writes a warning.
+  */
+  void set_asynchronous_reading(const bool);
+  bool get_asynchronous_reading() const;
+
+  //! Check if the HDF5 library was built to be thread-safe
+  static bool is_HDF5_library_threadsafe();
+
 private:
 
   shared_ptr<GEHDF5Wrapper> input_sptr;
@@ -146,12 +179,33 @@ private:
   void read_data(char* output,const std::streampos offset, const hsize_t size) const;
   // members for buffering
 
-  boost::shared_array<char> buffer;
+  mutable boost::shared_array<char> buffer;
+  //! buffer size as passed to set_buffer_size()
+  std::size_t requested_buffer_size;
   std::size_t max_buffer_size;
   //! currently filled size
   mutable std::size_t buffer_size;
   mutable std::streampos start_of_buffer_offset;
   void fill_buffer(const std::streampos offset) const;
+  //! allocate the buffer(s) according to requested_buffer_size
+  void allocate_buffers();
+
+  // members for asynchronous reading
+
+  bool asynchronous_reading;
+  //! buffer that is filled in the background with the block following the current buffer
+  mutable boost::shared_array<char> next_buffer;
+  mutable std::size_t next_buffer_size;
+  mutable std::streampos start_of_next_buffer_offset;
+  //! result of the background read into next_buffer (not valid if none was started)
+  mutable std::future<void> next_buffer_future;
+  //! start reading the block following the current buffer in a background thread
+  void start_reading_next_buffer() const;
+  //! wait for the background read to finish
+  /*! \return \c true if next_buffer now contains valid data.
+      Exceptions thrown while reading are passed on.
+  */
+  bool wait_for_next_buffer() const;
 };
 
 } // namespace
@@ -27,9 +27,12 @@
 #include "stir/Succeeded.h"
 #include "stir/is_null_ptr.h"
 #include "stir/shared_ptr.h"
+#include "stir/warning.h"
 
 #include <fstream>
 #include <string.h>
+#include <algorithm>
+#include <system_error>
 START_NAMESPACE_STIR
 
 namespace GE {
@@ -57,24 +60,45 @@ template <class RecordT>
         InputStreamWithRecordsFromHDF5<RecordT>::
         InputStreamWithRecordsFromHDF5(const std::string& filename,
                                        const std::size_t size_of_record_signature,
-                                       const std::size_t max_size_of_record):
+                                       const std::size_t max_size_of_record,
+                                       const std::size_t buffer_size):
     m_filename(filename),
     size_of_record_signature(size_of_record_signature),
-    max_size_of_record(max_size_of_record)
+    max_size_of_record(max_size_of_record),
+    requested_buffer_size(buffer_size),
+    asynchronous_reading(is_HDF5_library_threadsafe())
 {
     assert(size_of_record_signature<=max_size_of_record);
 
-    this->max_buffer_size =10000000;
-    this->buffer.reset(new char[this->max_buffer_size]);
-
     set_up();
 }
 
+template <class RecordT>
+InputStreamWithRecordsFromHDF5<RecordT>::
+~InputStreamWithRecordsFromHDF5()
+{
+  // the background thread might still be writing into next_buffer
+  try
+    {
+      this->wait_for_next_buffer();
+    }
+  catch (...)
+    {}
+}
+
 template <class RecordT>
 Succeeded
 InputStreamWithRecordsFromHDF5<RecordT>::
 set_up()
 {
+    // make sure the background thread no longer uses the file
+    try
+      {
+        this->wait_for_next_buffer();
+      }
+    catch (...)
+      {}
+
     input_sptr.reset(new GEHDF5Wrapper(m_filename));
     data_sptr.reset(new char[this->max_size_of_record]);
     starting_stream_position = 0;
@@ -83,20 +107,153 @@ set_up()
     input_sptr->initialise_listmode_data();
     m_list_size = input_sptr->get_dataset_size() - this->size_of_record_signature;
 
-    this->buffer_size = 0;
+    this->allocate_buffers();
     return Succeeded::yes;
 }
 
 template <class RecordT>
 void
 InputStreamWithRecordsFromHDF5<RecordT>::
-fill_buffer(const std::streampos offset) const
+allocate_buffers()
+{
+  if (this->requested_buffer_size > 0)
+    this->max_buffer_size = this->requested_buffer_size;
+  else
+    {
+      this->max_buffer_size = 10000000;
+      // use complete chunks
+      const std::size_t chunk_size = static_cast<std::size_t>(input_sptr->get_list_data_chunk_size());
+      if (chunk_size > 0)
+        this->max_buffer_size = ((this->max_buffer_size + chunk_size - 1)/chunk_size)*chunk_size;
+    }
+  this->buffer.reset(new char[this->max_buffer_size]);
+  // will be allocated when necessary
+  this->next_buffer.reset();
+  this->buffer_size = 0;
+  this->next_buffer_size = 0;
+}
+
+template <class RecordT>
+void
+InputStreamWithRecordsFromHDF5<RecordT>::
+set_buffer_size(const std::size_t buffer_size)
+{
+  this->wait_for_next_buffer();
+  this->requested_buffer_size = buffer_size;
+  this->allocate_buffers();
+}
+
+template <class RecordT>
+std::size_t
+InputStreamWithRecordsFromHDF5<RecordT>::
+get_buffer_size() const
+{
+  return this->max_buffer_size;
+}
+
+template <class RecordT>
+bool
+InputStreamWithRecordsFromHDF5<RecordT>::
+is_HDF5_library_threadsafe()
+{
+  hbool_t is_threadsafe = 0;
+  return H5is_library_threadsafe(&is_threadsafe) >= 0 && is_threadsafe;
+}
+
+template <class RecordT>
+void
+InputStreamWithRecordsFromHDF5<RecordT>::
+set_asynchronous_reading(const bool arg)
+{
+  if (!arg)
+    this->wait_for_next_buffer();
+  else if (!this->asynchronous_reading && !is_HDF5_library_threadsafe())
+    warning("InputStreamWithRecordsFromHDF5: the HDF5 library is not thread-safe. Reading in a background thread\n"
+            "is only safe if no other thread uses the HDF5 library at the same time.");
+  this->asynchronous_reading = arg;
+}
+
+template <class RecordT>
+bool
+InputStreamWithRecordsFromHDF5<RecordT>::
+get_asynchronous_reading() const
+{
+  return this->asynchronous_reading;
+}
+
+template <class RecordT>
+bool
+InputStreamWithRecordsFromHDF5<RecordT>::
+wait_for_next_buffer() const
+{
+  if (!this->next_buffer_future.valid())
+    return false;
+  // note: get() passes on any exception, and invalidates the future
+  this->next_buffer_future.get();
+  return true;
+}
+
+template <class RecordT>
+void
+InputStreamWithRecordsFromHDF5<RecordT>::
+start_reading_next_buffer() const
 {
-  this->buffer_size =
+  if (!this->asynchronous_reading)
+    return;
+  const uint64_t next_offset =
+    static_cast<uint64_t>(std::streamoff(this->start_of_buffer_offset)) + this->buffer_size;
+  if (next_offset >= m_list_size)
+    return;
+  if (!this->next_buffer)
+    this->next_buffer.reset(new char[this->max_buffer_size]);
+  this->next_buffer_size =
     static_cast<std::size_t>(std::min(static_cast<uint64_t>(this->max_buffer_size),
-                                      m_list_size - offset));
-  input_sptr->read_list_data(buffer.get(), offset, hsize_t(this->buffer_size));
-  this->start_of_buffer_offset =  offset;
+                                      m_list_size - next_offset));
+  this->start_of_next_buffer_offset = static_cast<std::streamoff>(next_offset);
+
+  // copy everything the thread needs, such that it does not access any of our members
+  const shared_ptr<GEHDF5Wrapper> input_sptr_copy = this->input_sptr;
+  const boost::shared_array<char> next_buffer_copy = this->next_buffer;
+  const std::streampos offset = this->start_of_next_buffer_offset;
+  const hsize_t size = hsize_t(this->next_buffer_size);
+  try
+    {
+      this->next_buffer_future =
+        std::async(std::launch::async,
+                   [input_sptr_copy, next_buffer_copy, offset, size]()
+                   {
+                     input_sptr_copy->read_list_data(next_buffer_copy.get(), offset, size);
+                   });
+    }
+  catch (std::system_error&)
+    {
+      // no thread could be started. We will read synchronously in fill_buffer().
+    }
+}
+
+template <class RecordT>
+void
+InputStreamWithRecordsFromHDF5<RecordT>::
+fill_buffer(const std::streampos offset) const
+{
+  if (this->wait_for_next_buffer() &&
+      offset >= this->start_of_next_buffer_offset &&
+      offset < (this->start_of_next_buffer_offset + static_cast<std::streampos>(this->next_buffer_size)))
+    {
+      // the background thread has read what we need
+      std::swap(this->buffer, this->next_buffer);
+      this->buffer_size = this->next_buffer_size;
+      this->start_of_buffer_offset = this->start_of_next_buffer_offset;
+    }
+  else
+    {
+      this->buffer_size =
+        static_cast<std::size_t>(std::min(static_cast<uint64_t>(this->max_buffer_size),
+                                          m_list_size - offset));
+      input_sptr->read_list_data(buffer.get(), offset, hsize_t(this->buffer_size));
+      this->start_of_buffer_offset =  offset;
+    }
+  this->start_reading_next_buffer();
 }
 
 template <class RecordT>
@@ -32,6 +32,10 @@
 #include "stir/RegisteredParsingObject.h"
 #include "stir/OSMAPOSL/OSMAPOSLReconstruction.h"
 #include "stir/CartesianCoordinate3D.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "boost/cstdint.hpp"
 
 START_NAMESPACE_STIR
 
@@ -85,6 +89,20 @@ class PoissonLogLikelihoodWithLinearModelForMean;
 
   is the part coming from the emission iterative update. Here, the Gaussian kernel functions have been modulated by the distance between voxels in the image space.
 
+  \par Implementation
+
+  The kernel matrix is stored as a sparse matrix in compressed sparse row (CSR) format, with
+  one row per voxel. Instead of column indices, we store the index of the neighbour in the patch,
+  as the column index is then given by the row index plus an offset that depends only on the position
+  in the patch. The anatomical part of the kernel is computed only once during set_up(). The emission
+  part is updated once per subiteration (until the kernel is frozen). Applying the kernel is then
+  a (parallel) sparse matrix-vector multiplication.
+
+  If a cache directory is set, the anatomical part of the kernel matrix is written to a file in that
+  directory. Its name contains a hash of the anatomical images and the kernel parameters, such that
+  subsequent reconstructions with the same anatomical images can read it instead of recomputing it.
+  The file uses native byte order.
+
   \par Parameters for parsing
 
   Defaults are indicated below
@@ -103,6 +121,7 @@ class PoissonLogLikelihoodWithLinearModelForMean;
                                              ;This makes you choose the size of your feature vector by default we only have one element;
 
   only_2D:=0                                 ;=1 if you want to reconstruct 2D images;
+  kernel matrix cache directory:=            ;directory to store/read the anatomical kernel matrix (no caching if empty)
 
   ; other OSMAPOSL parameters
   End KOSMAPOSL Parameters :=
@@ -160,6 +179,10 @@ public:
   const bool get_only_2D() const;
   const bool get_hybrid()const;
   const int get_freeze_iterative_kernel_at_subiter_num()const;
+  const std::string get_kernel_matrix_cache_directory() const;
+  //! name of the file used to cache the anatomical kernel matrix (empty if not caching)
+  /*! Only valid after set_up(). */
+  const std::string get_kernel_matrix_cache_filename() const;
 
   std::vector<shared_ptr<TargetT> > get_anatomical_prior_sptrs();
 //@}
@@ -188,6 +211,8 @@ public:
   void set_only_2D(const bool);
   void set_hybrid(const bool);
   void set_freeze_iterative_kernel_at_subiter_num(const int);
+  void set_kernel_matrix_cache_directory(const std::string&);
+  void set_kernelised_output_filename_prefix(const std::string&);
   //@}
 
   //! prompts the user to enter parameter values manually
@@ -213,6 +238,10 @@ public:
   double sigma_dp, sigma_dm;
   BasicCoordinate<3,int> min_ind, max_ind;
   shared_ptr<TargetT> iterative_kernel_image_frozen_sptr;
+  //! directory used to cache the anatomical kernel matrix
+  std::string kernel_matrix_cache_directory;
+  //! file used to cache the anatomical kernel matrix (set by set_up())
+  std::string kernel_matrix_cache_filename;
 
   virtual void set_defaults();
   virtual void initialise_keymap();
@@ -233,6 +262,32 @@ private:
 
   std::vector<double> anatomical_sd;
   mutable Array<3,float> distance;
+
+  /*! \name Sparse kernel matrix in CSR format
+  */
+  //@{
+  //! start of every row (i.e. voxel) in the arrays with patch indices and kernel values (size num_voxels+1)
+  std::vector<std::size_t> kernel_row_starts;
+  //! index in the patch of every non-zero element
+  std::vector<std::uint16_t> kernel_patch_indices;
+  //! offset of the ravelled index of every patch element w.r.t. the centre voxel
+  std::vector<int> patch_ravelled_offsets;
+  //! anatomical part of the kernel matrix
+  std::vector<float> anatomical_kernel_values;
+  //! current kernel matrix (anatomical and emission part)
+  std::vector<float> kernel_values;
+  //! sum of the kernel values for every row
+  std::vector<double> kernel_row_sums;
+  //! image used for the emission part of the current kernel matrix
+  shared_ptr<const TargetT> kernel_values_image_sptr;
+  //@}
+
+  //! set the sparsity pattern of the kernel matrix and compute (or read) its anatomical part
+  void set_up_kernel_matrix(const TargetT& target_image);
+  //! compute the kernel matrix for the current iterative kernel image (if needed)
+  void update_kernel_values(const shared_ptr<const TargetT>& iterative_kernel_image_sptr);
+  //! hash of the anatomical images and kernel parameters, used for the cache filename
+  boost::uint64_t compute_anatomical_kernel_hash(const TargetT& target_image) const;
   /*! Create a matrix containing the norm of the difference between two feature vectors, \f$ \|  \boldsymbol{z}^{(n)}_j-\boldsymbol{z}^{(n)}_l \| \f$. */
   /*! This is done for the emission image which keeps changing*/
     void  calculate_norm_matrix(TargetT &normp,
@@ -261,10 +316,11 @@ private:
 //                                        const TargetT& image_to_kernelise,
 //                                        const TargetT& current_alpha_estimate);
 #endif
-  /*! choose between compact_compute_kernelised_image() and  full_compute_kernelised_image()*/
+  /*! Multiply \a image_to_kernelise with the (normalised) kernel matrix computed by update_kernel_values() */
+  /*! \a current_alpha_estimate has to be the image used for update_kernel_values(). */
     void compute_kernelised_image(TargetT& kernelised_image_out,
                                 const TargetT& image_to_kernelise,
-                                const TargetT& current_alpha_estimate);
+                                const TargetT& current_alpha_estimate) const;
 
   double calc_emission_kernel(const double current_alpha_estimate_zyx,
                          const double current_alpha_estimate_zyx_dr,
@@ -0,0 +1,56 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup LOR
+
+  \brief Declaration of class stir::LOREndPoints
+
+  \author agent
+*/
+#ifndef __stir_LOREndPoints_H__
+#define __stir_LOREndPoints_H__
+
+#include "stir/common.h"
+#include <vector>
+#include <cstddef>
+
+START_NAMESPACE_STIR
+
+/*! \ingroup LOR
+  \brief A structure-of-arrays container for the end-points of a set of LORs
+
+  LOR \c i goes from <code>(z1[i], y1[i], x1[i])</code> to <code>(z2[i], y2[i], x2[i])</code>
+  (in mm). Storing every coordinate in a separate contiguous array allows loops over
+  many LORs to be vectorised by the compiler, and the arrays can be passed directly
+  to external libraries.
+
+  \see ProjDataInfo::get_LOR_endpoints()
+*/
+struct LOREndPoints
+{
+  std::vector<float> z1, y1, x1;
+  std::vector<float> z2, y2, x2;
+
+  //! Number of LORs
+  std::size_t size() const { return z1.size(); }
+
+  //! Change the number of LORs (new elements are set to 0)
+  void resize(const std::size_t num_lors)
+  {
+    z1.resize(num_lors); y1.resize(num_lors); x1.resize(num_lors);
+    z2.resize(num_lors); y2.resize(num_lors); x2.resize(num_lors);
+  }
+};
+
+END_NAMESPACE_STIR
+
+#endif
@@ -183,6 +183,13 @@ public:
     float& operator()(const int ra, const int a, const int rb, const int b);
     
     float operator()(const int ra, const int a, const int rb, const int b) const;
+
+    //! Access to the contiguous storage of the fan for \a ra < \a rb
+    /*! The returned array is indexed with \c b from get_min_b(a) to get_max_b(a), and
+        <code>get_fan(ra,a,rb)[b] == (*this)(ra,a,rb,b)</code>. This avoids the index
+        computations of operator() in inner loops.
+    */
+    const Array<1,float>& get_fan(const int ra, const int a, const int rb) const;
     
     void fill(const float d);
     
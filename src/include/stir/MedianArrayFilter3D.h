@@ -37,8 +37,15 @@ template <typename coordT> class Coordinate3D;
   of the sorted array. For 2n elements, we use (sorted[n-1]+sorted[n])/2
   (starting indices from 0).
 
-  For 3D images, the current filter works by extracting all neigbours (given by 
-  the mask) to a 1D array, and getting the median of that array.
+  For 3D images, the current filter first replaces every value by its rank in the
+  sorted list of all values. The neighbours of a voxel are then kept in a bitset over
+  these ranks, with a count for every block of ranks. When moving to the next voxel along
+  a row, the neighbours that leave the mask are removed, and the new ones are inserted,
+  each in constant time. The median is found by starting from the one of the previous voxel.
+  The cost per voxel is therefore proportional to the number of neighbours with the same x,
+  not to the size of the mask. For small masks (less than 64 elements), the median of all
+  neighbours of every voxel is found directly instead, as this is faster.
+  Planes are processed in parallel when using OpenMP.
 
   This implementation of the median filter handles edges by taking a median of 
   all available pixels. For instance, when a 3x3 mask is used, and the 
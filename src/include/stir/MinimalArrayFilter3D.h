@@ -35,8 +35,11 @@ template <typename coordT> class Coordinate3D;
   The minimum value for a 1D array of 2n+1 elements is defined as the minimum element
   of the sorted array. 
 
-  For 3D images, the current filter works by extracting all neigbours (given by 
-  the mask) to a 1D array, and getting the minimal of that array.
+  For regular 3D arrays, the filter is computed by 1D filters in every direction
+  (as the mask is a box), using the van Herk/Gil-Werman algorithm. This needs only a few
+  comparisons per voxel, independent of the mask size. For irregular arrays, the filter works
+  by extracting all neigbours (given by the mask) to a 1D array, and getting the minimal of that array.
+  Planes are processed in parallel when using OpenMP.
 
   This implementation of the minimal filter handles edges by taking the minimum of 
   all available pixels. For instance, when a 3x3 mask is used, and the 
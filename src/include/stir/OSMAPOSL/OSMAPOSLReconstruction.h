@@ -216,6 +216,8 @@ private:
     objective_function() const;
 
   unique_ptr<TargetT> multiplicative_update_image_ptr;
+  //! work image for the prior gradient, re-used between subiterations
+  unique_ptr<TargetT> prior_gradient_image_ptr;
 };
 
 END_NAMESPACE_STIR
@@ -66,6 +66,20 @@ public:
 		    shared_ptr<const ProjDataInfo> const& proj_data_info_ptr,
                     const bool initialise_with_0 = true);
 
+  //! constructor with info, using existing memory for the data (no initialisation)
+  /*!
+    \param data_ptr points to the first element of a block of memory of size_all() floats.
+      The data are stored in the order used by copy_to() and fill_from(), i.e. sinogram
+      by sinogram with segments in the order of standard_segment_sequence().
+      The memory has to stay valid while it is used by this object, and will not be deallocated
+      by this object.
+
+    This can be used to share data with other libraries (such as NumPy) without copying.
+  */
+  ProjDataInMemory (shared_ptr<const ExamInfo> const& exam_info_sptr,
+		    shared_ptr<const ProjDataInfo> const& proj_data_info_ptr,
+                    float * const data_ptr);
+
   //! constructor that copies data from another ProjData
   ProjDataInMemory (const ProjData& proj_data);
 
@@ -179,6 +193,9 @@ private:
   //! allocates buffer for storing the data. Has to be called by constructors before create_stream()
   void create_buffer(const bool initialise_with_0 = false);
 
+  //! lets the buffer use existing memory. Has to be called by constructors before create_stream()
+  void create_buffer(float * const data_ptr);
+
   //! Create a new stream
   void create_stream();
 };
@@ -28,8 +28,10 @@
 #include "stir/Scanner.h"
 #include "stir/shared_ptr.h"
 #include "stir/unique_ptr.h"
+#include "stir/LOREndPoints.h"
 #include <string>
 #include <memory>
+#include <vector>
 
 START_NAMESPACE_STIR
 
@@ -322,6 +324,37 @@ public:
     Bin
     get_bin(const LOR<float>&) const = 0;
 
+  //! \name Bulk access to the end-points of the LORs
+  //@{
+  //! Get the end-points of all LORs in a viewgram
+  /*! The end-points are the intersections of the LOR returned by get_LOR() with a
+      cylinder of radius Scanner::get_inner_ring_radius(), in the same coordinate system.
+      The LOR for a given \c axial_pos_num and \c tangential_pos_num is stored at index
+      \code
+      (axial_pos_num - get_min_axial_pos_num(segment_num)) * get_num_tangential_poss()
+      + tangential_pos_num - get_min_tangential_pos_num()
+      \endcode
+
+      If the cache is enabled (see set_LOR_endpoints_cache_enabled()), the end-points are
+      computed once for the whole segment when it is first accessed. The returned pointer then
+      points into the cache, so no copy is made. It remains valid (and unchanged) even when the
+      cache is invalidated or this object is destroyed. The cache is shared between all users of
+      this object, e.g. all projectors holding a <code>shared_ptr<const ProjDataInfo></code>.
+      Otherwise, the end-points are computed on every call.
+
+      This function is thread-safe.
+  */
+  shared_ptr<const LOREndPoints> get_LOR_endpoints(const int view_num, const int segment_num) const;
+
+  //! Enable or disable caching of the LOR end-points
+  /*! Disabled by default, as the cache uses 6 floats per bin. Disabling it frees the memory.
+      \warning This function is not thread-safe.
+   */
+  void set_LOR_endpoints_cache_enabled(const bool value);
+  //! Return if the LOR end-points are cached
+  bool get_LOR_endpoints_cache_enabled() const { return LOR_endpoints_cache_enabled; }
+  //@}
+
   //! \name Equality of ProjDataInfo objects
   //@{
   //! check equality
@@ -391,6 +424,12 @@ public:
 protected:
   virtual bool blindly_equals(const root_type * const) const = 0;
 
+  //! Remove all cached LOR end-points
+  /*! Has to be called by every function that changes the geometry of the LORs. This is done by
+      all set_* functions of this class. Derived classes need to call it in their own set_* functions.
+  */
+  void invalidate_LOR_endpoints_cache();
+
 private:
   shared_ptr<Scanner> scanner_ptr;
   int min_view_num;
@@ -401,7 +440,14 @@ private:
   VectorWithOffset<int> max_axial_pos_per_seg;
   float bed_position_horizontal;
   float bed_position_vertical;
-  
+
+  bool LOR_endpoints_cache_enabled;
+  //! cached LOR end-points, indexed by segment_num and view_num
+  /*! The shared_ptr is null for segments that have not been accessed yet. Its content is never
+      modified, such that it can be shared between copies of this object. */
+  mutable VectorWithOffset<shared_ptr<const std::vector<LOREndPoints> > > LOR_endpoints_cache;
+
+  void compute_LOR_endpoints(LOREndPoints& end_points, const int view_num, const int segment_num) const;
 };
 
 END_NAMESPACE_STIR
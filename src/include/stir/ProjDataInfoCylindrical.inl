@@ -175,6 +175,7 @@ ProjDataInfoCylindrical::set_ring_radii_for_all_views(const VectorWithOffset<flo
     }
 
   this->ring_radius = new_ring_radius;
+  this->invalidate_LOR_endpoints_cache();
 }
 
 VectorWithOffset<float>
@@ -118,10 +118,14 @@ SSRB(const std::string& output_filename,
   \ingroup projdata
   \param out_projdata Output projection data. Its projection_data_info is used to 
   determine output characteristics. Data will be 'put' in here using 
-  ProjData::set_sinogram().
+  ProjData::set_segment().
   \param in_projdata input data
   \param do_normalisation (default true) wether to normalise the output sinograms 
   corresponding to how many input sinograms contribute to them.
+
+  Every input segment is read only once. One output segment is kept in memory
+  while its input segments are added to it. When compiled with OpenMP, the sinograms of an input
+  segment are added in parallel, while the next input segment is read.
   
   \warning in_proj_data_info has to be (at least) of type ProjDataInfoCylindrical
 */  
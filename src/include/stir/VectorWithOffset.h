@@ -159,6 +159,12 @@ public:
   */
   inline void recycle();
 
+  //! swap content (and ownership of the memory) with another vector
+  /*! This is a cheap operation, as no data is copied. It can be used to let
+      a VectorWithOffset use a block of existing memory, see VoxelsOnCartesianGrid::make_contiguous().
+  */
+  inline void swap(VectorWithOffset& other);
+
   //! assignment operator with another vector
   inline VectorWithOffset & operator= (const VectorWithOffset &il) ;
 
@@ -92,6 +92,25 @@ VectorWithOffset<T>::recycle()
   this->init();
 }
 
+template <class T>
+void
+VectorWithOffset<T>::swap(VectorWithOffset& other)
+{
+  this->check_state();
+  other.check_state();
+  // check if data is being accessed via a pointer (see get_data_ptr())
+  assert(this->pointer_access == false);
+  assert(other.pointer_access == false);
+  std::swap(this->length, other.length);
+  std::swap(this->start, other.start);
+  std::swap(this->num, other.num);
+  std::swap(this->begin_allocated_memory, other.begin_allocated_memory);
+  std::swap(this->end_allocated_memory, other.end_allocated_memory);
+  std::swap(this->_owns_memory_for_data, other._owns_memory_for_data);
+  this->check_state();
+  other.check_state();
+}
+
 template <class T>
 int VectorWithOffset<T>::get_min_index() const 
 { 
@@ -27,6 +27,7 @@
 */
 #include "stir/DiscretisedDensityOnCartesianGrid.h"
 #include "stir/CartesianCoordinate3D.h"
+#include <vector>
 
 START_NAMESPACE_STIR
 
@@ -39,6 +40,17 @@ template <typename elemT> class PixelsOnCartesianGrid;
   grid (3D).
 
   This class represents 'normal' data. Basisfunctions are just voxels.
+
+  \par Contiguous storage
+
+  As for any Array, every row of voxels normally allocates its own memory. Calling
+  make_contiguous() moves all voxels into one block of memory (in the order z, y, x,
+  with x running fastest). This improves the locality of memory accesses for the projectors,
+  which can then use get_contiguous_data_ptr() to avoid the nested indexing.
+  The copy constructor (and therefore clone()) and get_empty_copy() preserve this storage
+  mode (allocating new memory). use_existing_contiguous_data() lets the image use memory
+  that is owned by somebody else. Changing the index range of the image (or one of its rows) will
+  allocate new memory for the affected rows, such that the image is no longer contiguous.
 */
 template<class elemT>
 class VoxelsOnCartesianGrid:public DiscretisedDensityOnCartesianGrid<3,elemT>
@@ -54,6 +66,15 @@ static VoxelsOnCartesianGrid ask_parameters();
 //! Construct an empty VoxelsOnCartesianGrid (empty range, 0 origin, 0 grid_spacing)
 VoxelsOnCartesianGrid();
 
+//! Copy constructor
+/*! The copy stores its data contiguously if \a other does (see make_contiguous()). */
+VoxelsOnCartesianGrid(const VoxelsOnCartesianGrid& other);
+
+//! Assignment operator
+/*! Elements are copied into the existing memory when the index ranges are the same,
+    so the storage mode of this object is not changed in that case. */
+VoxelsOnCartesianGrid& operator=(const VoxelsOnCartesianGrid& other);
+
 //! Construct a VoxelsOnCartesianGrid, initialising data from the Array<3,elemT> object.
 VoxelsOnCartesianGrid(const Array<3,elemT>& v,
 		      const CartesianCoordinate3D<float>& origin,
@@ -193,7 +214,46 @@ void grow_z_range(const int min_z, const int max_z);
 
   //@}
 
+  //! \name Contiguous storage
+  //@{
+  //! Move all elements into one contiguous block of memory
+  /*! Does nothing if the elements are already stored contiguously. Otherwise, the elements are
+      moved to new memory, and memory allocated by a previous call is released, such that pointers
+      obtained before (e.g. via get_contiguous_data_ptr()) are no longer valid.
+      \see Array::is_contiguous()
+  */
+  void make_contiguous();
+
+  //! Let all elements use existing memory
+  /*! After this call, the elements are stored contiguously (see make_contiguous()) in the memory
+      starting at \a data_ptr, which has to hold at least size_all() elements. This memory has to
+      stay valid while it is used by this object, and will not be deallocated by this object.
+      The current values of the elements are discarded, i.e. the image now has the values stored at
+      \a data_ptr.
+
+      This can be used to share data with other libraries (such as NumPy) without copying.
+  */
+  void use_existing_contiguous_data(elemT* const data_ptr);
+
+  //! Returns a pointer to the first element if the elements are stored contiguously, 0 otherwise
+  /*! The element with indices <tt>(z,y,x)</tt> is then found at offset
+      <tt>((z-get_min_z())*get_y_size() + y-get_min_y())*get_x_size() + x-get_min_x()</tt>.
+      The pointer is only valid until the index range of the image is changed.
+
+      As this calls Array::is_contiguous(), it is best to call it only once for many voxel accesses.
+  */
+  elemT* get_contiguous_data_ptr();
+  //! Returns a pointer to the first element if the elements are stored contiguously, 0 otherwise
+  const elemT* get_contiguous_data_ptr() const;
+  //@}
+
 private:
+  //! memory used for the elements after make_contiguous(), empty otherwise
+  std::vector<elemT> _contiguous_data;
+
+  //! let the rows use consecutive parts of the memory at \a data_ptr, optionally copying their current values
+  void set_row_memory(elemT* data_ptr, const bool copy_values);
+
   void
     construct_from_projdata_info(const shared_ptr < const ExamInfo > & exam_info_sptr_v,
                                  const ProjDataInfo& proj_data_info,
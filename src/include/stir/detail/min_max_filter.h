@@ -0,0 +1,163 @@
+/*!
+  \file
+  \ingroup buildblock_detail
+  \brief Implementation of the van Herk/Gil-Werman algorithm for erosion/dilation filters
+
+  Used by stir::MinimalArrayFilter3D and stir::MaximalArrayFilter3D.
+
+  \author agent
+
+*/
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+
+#ifndef __stir_detail_min_max_filter_H__
+#define __stir_detail_min_max_filter_H__
+
+#include "stir/Array.h"
+#include "stir/BasicCoordinate.h"
+#include "stir/error.h"
+#include <vector>
+#include <algorithm>
+
+#ifdef STIR_OPENMP
+#include <omp.h>
+#endif
+
+namespace stir {
+  namespace detail {
+
+    /*! \ingroup buildblock_detail
+      \brief computes the minimum (or maximum) over a sliding window of a 1D line
+
+      On return, <code>line[i]</code> is the "best" element of the input line in the window
+      <code>[i-radius, i+radius]</code>, restricted to the valid range <code>[0,n)</code>.
+      "best" is determined by \a is_better, e.g. \c std::less for the minimum.
+      \a neutral has to be a value that is never better than any other (e.g. the largest
+      value for the minimum).
+
+      This uses the van Herk/Gil-Werman algorithm, which needs 3 comparisons per element,
+      independent of the size of the window. The line is padded with \c radius neutral
+      elements on both sides. Windows are then full-size, and the padded line is divided
+      in blocks of window size. For every element, the result is the best of the "suffix"
+      of the block the window starts in and the "prefix" of the block the window ends in.
+
+      \a line is overwritten. \a padded, \a prefix and \a suffix are work buffers.
+    */
+    template <class elemT, class IsBetterT>
+    inline void
+    van_Herk_Gil_Werman_1D(elemT* line, const int n, const int radius,
+                           IsBetterT is_better, const elemT neutral,
+                           std::vector<elemT>& padded,
+                           std::vector<elemT>& prefix, std::vector<elemT>& suffix)
+    {
+      if (radius<=0 || n<=1)
+        return;
+      const int window = 2*radius+1;
+      const int padded_size = n + 2*radius;
+      padded.assign(padded_size, neutral);
+      std::copy(line, line+n, padded.begin()+radius);
+      prefix.resize(padded_size);
+      suffix.resize(padded_size);
+
+      for (int j=0; j<padded_size; ++j)
+        prefix[j] = (j%window==0 || is_better(padded[j], prefix[j-1])) ? padded[j] : prefix[j-1];
+      for (int j=padded_size-1; j>=0; --j)
+        suffix[j] = (j%window==window-1 || j==padded_size-1 || is_better(padded[j], suffix[j+1])) ? padded[j] : suffix[j+1];
+
+      for (int i=0; i<n; ++i)
+        {
+          // window in padded indices is [i, i+2*radius]
+          const elemT& a = suffix[i];
+          const elemT& b = prefix[i+window-1];
+          line[i] = is_better(b, a) ? b : a;
+        }
+    }
+
+    /*! \ingroup buildblock_detail
+      \brief applies an erosion (or dilation) filter with a box-shaped mask to a regular 3D array
+
+      As the box is separable, this is done using 1D filters in every direction. At the edges,
+      only voxels inside the array are used. \a mask_radius is in the order z,y,x.
+
+      Lines are processed in parallel when using OpenMP.
+    */
+    template <class elemT, class IsBetterT>
+    inline void
+    separable_min_max_filter_3D(Array<3,elemT>& array, const BasicCoordinate<3,int>& mask_radius,
+                                IsBetterT is_better, const elemT neutral)
+    {
+      BasicCoordinate<3,int> min_indices, max_indices;
+      if (!array.get_regular_range(min_indices, max_indices))
+        error("separable_min_max_filter_3D called with irregular array");
+
+      const int num_z = max_indices[1] - min_indices[1] + 1;
+      const int num_y = max_indices[2] - min_indices[2] + 1;
+      const int num_x = max_indices[3] - min_indices[3] + 1;
+
+      // x-direction: rows are contiguous
+      if (mask_radius[3]>0)
+        {
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+          for (int z=min_indices[1]; z<=max_indices[1]; ++z)
+            {
+              std::vector<elemT> padded, prefix, suffix;
+              for (int y=min_indices[2]; y<=max_indices[2]; ++y)
+                van_Herk_Gil_Werman_1D(&array[z][y][min_indices[3]], num_x, mask_radius[3],
+                                       is_better, neutral, padded, prefix, suffix);
+            }
+        }
+      // y-direction
+      if (mask_radius[2]>0)
+        {
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+          for (int z=min_indices[1]; z<=max_indices[1]; ++z)
+            {
+              std::vector<elemT> line(num_y), padded, prefix, suffix;
+              for (int x=min_indices[3]; x<=max_indices[3]; ++x)
+                {
+                  for (int y=0; y<num_y; ++y)
+                    line[y] = array[z][y+min_indices[2]][x];
+                  van_Herk_Gil_Werman_1D(&line[0], num_y, mask_radius[2],
+                                         is_better, neutral, padded, prefix, suffix);
+                  for (int y=0; y<num_y; ++y)
+                    array[z][y+min_indices[2]][x] = line[y];
+                }
+            }
+        }
+      // z-direction
+      if (mask_radius[1]>0)
+        {
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+          for (int y=min_indices[2]; y<=max_indices[2]; ++y)
+            {
+              std::vector<elemT> line(num_z), padded, prefix, suffix;
+              for (int x=min_indices[3]; x<=max_indices[3]; ++x)
+                {
+                  for (int z=0; z<num_z; ++z)
+                    line[z] = array[z+min_indices[1]][y][x];
+                  van_Herk_Gil_Werman_1D(&line[0], num_z, mask_radius[1],
+                                         is_better, neutral, padded, prefix, suffix);
+                  for (int z=0; z<num_z; ++z)
+                    array[z+min_indices[1]][y][x] = line[z];
+                }
+            }
+        }
+    }
+
+  } // end namespace detail
+} // end namespace stir
+
+#endif
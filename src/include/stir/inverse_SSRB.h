@@ -29,7 +29,7 @@ class Succeeded;
   \ingroup projdata
   \param[out] proj_data_4D Its projection_data_info is used to 
   determine output characteristics (e.g. number of segments). Data will be 'put' in here using 
-  ProjData::set_sinogram().
+  ProjData::set_segment().
   \param[in] proj_data_3D input data
 
   The STIR implementation of Inverse SSRB applies the 
@@ -42,6 +42,9 @@ class Succeeded;
   Note that any oblique segments in \a proj_data_3D are currently ignored.
 
   Input and output projectino data should have the same number of views and tangential positions.
+
+  Segment 0 of \a proj_data_3D is read only once. When compiled with OpenMP,
+  the sinograms of every output segment are computed in parallel.
   
 */  
 Succeeded 
@@ -66,6 +66,14 @@ public:
   /*! \todo this depends on the acquisition parameters */
   virtual bool has_delayeds() const { return false; }
 
+  //! Set the size (in bytes) of the blocks read from the file
+  /*! \see InputStreamWithRecordsFromHDF5::set_buffer_size() */
+  void set_read_buffer_size(const std::size_t buffer_size);
+
+  //! Enable or disable reading the next block of data in a background thread
+  /*! \see InputStreamWithRecordsFromHDF5::set_asynchronous_reading() */
+  void set_asynchronous_reading(const bool);
+
 private:
 
 //  shared_ptr<GEHDF5Wrapper> input_sptr;
@@ -53,9 +53,14 @@ namespace BSpline {
     {
                 
     public:
-      // only there for tests
-      Array<num_dimensions,out_elemT> get_coefficients() const
+      //! get the coefficients of the B-splines
+      /*! These are the values computed by set_coef(). */
+      const Array<num_dimensions,out_elemT>& get_coefficients() const
         { return this->_coeffs;  }
+
+      //! get the spline type used for every dimension
+      const BasicCoordinate<num_dimensions,BSplineType>& get_spline_types() const
+        { return this->_spline_types;  }
         
         
         
@@ -18,6 +18,8 @@
 
 */
 
+#include "stir/numerics/BSplinesRegularGrid.h"
+
 START_NAMESPACE_STIR
 
 /*!
@@ -49,6 +51,27 @@ void sample_function_on_regular_grid(Array<3,elemT>& out,
                                      const BasicCoordinate<3, positionT>&  offset,  
                                      const BasicCoordinate<3, positionT>& step);
 
+/*!
+ \brief Get the values of a 3D B-spline interpolator on a regular grid
+ \ingroup numerics
+
+ This gives the same result as the generic version above. However, as the B-splines are
+ separable and the sampling positions in every dimension are fixed, the interpolation weights
+ (and the indices of the coefficients they multiply) are computed only once for every dimension.
+ They are then applied in 3 passes (one per dimension), which are parallelised over planes
+ when using OpenMP. This needs temporary arrays with (at most) the size of the
+ coefficients and of \a out.
+
+ The array of coefficients of \a func and \a out need to have a regular range. If not,
+ the generic version is used.
+*/
+template <class elemT, class in_elemT, class constantsT, class positionT>
+inline
+void sample_function_on_regular_grid(Array<3,elemT>& out,
+                                     const BSpline::BSplinesRegularGrid<3,elemT,in_elemT,constantsT>& func,
+                                     const BasicCoordinate<3, positionT>&  offset,  
+                                     const BasicCoordinate<3, positionT>& step);
+
 END_NAMESPACE_STIR
 
 #include "stir/numerics/sampling_functions.inl"
@@ -15,6 +15,12 @@ This file is part of STIR.
   \brief implementation of stir::sample_function_on_regular_grid
 */
 
+#include "stir/IndexRange3D.h"
+#include "stir/warning.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
 START_NAMESPACE_STIR
 
 template <class FunctionType, class elemT, class positionT>
@@ -54,4 +60,172 @@ void sample_function_on_regular_grid(Array<3,elemT>& out,
     }                             
 }
 
+namespace detail_sampling_functions
+{
+  //! B-spline weights for sampling along one dimension
+  struct BSplinesSamplingWeights1D
+  {
+    //! number of coefficients for every sample
+    int kernel_length;
+    //! number of samples (starting from the minimum output index)
+    int num_samples;
+    //! for every sample, \c kernel_length indices of the coefficients
+    std::vector<int> indices;
+    //! for every sample, \c kernel_length weights
+    std::vector<BSpline::pos_type> weights;
+  };
+
+  // find the samples, indices and weights in the same way as sample_function_on_regular_grid
+  // and BSpline::detail::spline_convolution (including mirror boundary conditions)
+  template <class positionT>
+  inline void
+  set_BSplines_sampling_weights(BSplinesSamplingWeights1D& w,
+                                const BSpline::BSplineType spline_type,
+                                const positionT first_relative_position,
+                                const positionT step,
+                                const positionT max_relative_position,
+                                const int max_num_samples,
+                                const int min_coeff_index, const int max_coeff_index)
+  {
+    const BSpline::PieceWiseFunction<BSpline::pos_type>& bspline = BSpline::bspline_function(spline_type);
+    w.kernel_length = bspline.kernel_total_length();
+    w.num_samples = 0;
+    w.indices.clear();
+    w.weights.clear();
+    positionT relative_position = first_relative_position;
+    for (;
+         w.num_samples < max_num_samples && relative_position <= max_relative_position;
+         ++w.num_samples, relative_position += step)
+      {
+        const BSpline::pos_type pos = relative_position;
+        const int kmin = static_cast<int>(std::ceil(pos - bspline.kernel_length_right()));
+        BSpline::pos_type current_pos = pos - kmin;
+        int p = bspline.find_piece(current_pos);
+        for (int k=kmin; k<kmin+w.kernel_length; ++k, --current_pos, --p)
+          {
+            int index;
+            if (k<min_coeff_index) index=2*min_coeff_index-k;
+            else if (k>max_coeff_index) index=2*max_coeff_index-k;
+            else index = k;
+            w.indices.push_back(index);
+            w.weights.push_back(bspline.function_piece(current_pos, p));
+          }
+      }
+  }
+
+  // out[i] = sum_k in[index_k] * weight_k for every sample i, used for the last dimension
+  template <class elemT>
+  inline void
+  apply_BSplines_sampling_weights(elemT * const out, const Array<1,elemT>& in,
+                                  const BSplinesSamplingWeights1D& w)
+  {
+    const int * indices = &w.indices[0];
+    const BSpline::pos_type * weights = &w.weights[0];
+    for (int i=0; i<w.num_samples; ++i)
+      {
+        elemT value = 0;
+        for (int k=0; k<w.kernel_length; ++k, ++indices, ++weights)
+          value += static_cast<elemT>(in[*indices] * *weights);
+        out[i] = value;
+      }
+  }
+
+  // out[i] += in[i] * weight for num_elements elements
+  template <class elemT>
+  inline void
+  add_weighted_row(elemT * const out, const elemT * const in, const BSpline::pos_type weight,
+                   const int num_elements)
+  {
+    for (int i=0; i<num_elements; ++i)
+      out[i] += static_cast<elemT>(in[i] * weight);
+  }
+
+  //! function object that refers to another one, used to call the generic version
+  template <class FunctionType, class elemT>
+  struct FunctionReference
+  {
+    explicit FunctionReference(const FunctionType& func) : func(func) {}
+    template <class positionT>
+    elemT operator()(const BasicCoordinate<3, positionT>& relative_positions) const
+    { return func(relative_positions); }
+    const FunctionType& func;
+  };
+} // end of namespace detail_sampling_functions
+
+template <class elemT, class in_elemT, class constantsT, class positionT>
+void sample_function_on_regular_grid(Array<3,elemT>& out,
+                                     const BSpline::BSplinesRegularGrid<3,elemT,in_elemT,constantsT>& func,
+                                     const BasicCoordinate<3, positionT>&  offset,  
+                                     const BasicCoordinate<3, positionT>& step)
+{
+  using namespace detail_sampling_functions;
+  const Array<3,elemT>& coeffs = func.get_coefficients();
+  BasicCoordinate<3,int> min_out, max_out, min_in, max_in;
+  if (!out.get_regular_range(min_out,max_out) || !coeffs.get_regular_range(min_in,max_in))
+    {
+      sample_function_on_regular_grid(out,
+                                      FunctionReference<BSpline::BSplinesRegularGrid<3,elemT,in_elemT,constantsT>, elemT>(func),
+                                      offset, step);
+      return;
+    }
+
+  // find samples and weights for every dimension (same positions as the generic version)
+  const BasicCoordinate<3, positionT> max_relative_positions= 
+    (BasicCoordinate<3,positionT>(max_out)+static_cast<positionT>(.001)) * step + offset;
+  BasicCoordinate<3, positionT> first_relative_positions;
+  first_relative_positions[1] = min_out[1] * step[1] - offset[1];
+  first_relative_positions[2] = min_out[2] * step[2] + offset[2];
+  first_relative_positions[3] = min_out[3] * step[3] + offset[3];
+  BSplinesSamplingWeights1D w[3];
+  for (int d=1; d<=3; ++d)
+    {
+      set_BSplines_sampling_weights(w[d-1], func.get_spline_types()[d],
+                                    first_relative_positions[d], step[d], max_relative_positions[d],
+                                    max_out[d] - min_out[d] + 1, min_in[d], max_in[d]);
+      if (w[d-1].num_samples == 0)
+        return;
+    }
+  const int num_z = w[0].num_samples;
+  const int num_y = w[1].num_samples;
+  const int num_x = w[2].num_samples;
+
+  // interpolate along x
+  Array<3,elemT> tmp_x(IndexRange3D(min_in[1], max_in[1], min_in[2], max_in[2], 0, num_x-1));
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z=min_in[1]; z<=max_in[1]; ++z)
+    for (int y=min_in[2]; y<=max_in[2]; ++y)
+      apply_BSplines_sampling_weights(&tmp_x[z][y][0], coeffs[z][y], w[2]);
+
+  // interpolate along y
+  Array<3,elemT> tmp_xy(IndexRange3D(min_in[1], max_in[1], 0, num_y-1, 0, num_x-1));
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z=min_in[1]; z<=max_in[1]; ++z)
+    for (int y=0; y<num_y; ++y)
+      {
+        elemT * const out_row = &tmp_xy[z][y][0];
+        for (int k=0; k<w[1].kernel_length; ++k)
+          add_weighted_row(out_row, &tmp_x[z][w[1].indices[y*w[1].kernel_length + k]][0],
+                           w[1].weights[y*w[1].kernel_length + k], num_x);
+      }
+  tmp_x.recycle();
+
+  // interpolate along z
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z=0; z<num_z; ++z)
+    for (int y=0; y<num_y; ++y)
+      {
+        elemT * const out_row = &out[min_out[1]+z][min_out[2]+y][min_out[3]];
+        std::fill(out_row, out_row + num_x, static_cast<elemT>(0));
+        for (int k=0; k<w[0].kernel_length; ++k)
+          add_weighted_row(out_row, &tmp_xy[w[0].indices[z*w[0].kernel_length + k]][y][0],
+                           w[0].weights[z*w[0].kernel_length + k], num_x);
+      }
+}
+
 END_NAMESPACE_STIR
@@ -0,0 +1,86 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Declaration of class stir::BackProjectorByBinSPECTRotation
+
+  \author agent
+*/
+#ifndef __stir_recon_buildblock_BackProjectorByBinSPECTRotation_H__
+#define __stir_recon_buildblock_BackProjectorByBinSPECTRotation_H__
+
+#include "stir/RegisteredParsingObject.h"
+#include "stir/recon_buildblock/BackProjectorByBin.h"
+#include "stir/shared_ptr.h"
+
+START_NAMESPACE_STIR
+
+class SPECTRotationModel;
+class DataSymmetriesForViewSegmentNumbers;
+
+/*!
+  \ingroup projection
+  \brief Matrix-free SPECT back projector based on image rotation
+
+  This is the transpose of ForwardProjectorByBinSPECTRotation. See SPECTRotationModel for
+  details on the model and the parameters.
+
+  \par Example parameters
+  \verbatim
+  Back Projector Using SPECT Rotation Parameters:=
+    psf type := 3D
+    collimator sigma 0(cm) := 0.1403
+    collimator slope := 0.0163
+    attenuation map := attMapRec.hv
+  End Back Projector Using SPECT Rotation Parameters:=
+  \endverbatim
+*/
+class BackProjectorByBinSPECTRotation :
+  public RegisteredParsingObject<BackProjectorByBinSPECTRotation,
+                                 BackProjectorByBin>
+{
+public:
+  //! Name which will be used when parsing a BackProjectorByBin object
+  static const char * const registered_name;
+
+  BackProjectorByBinSPECTRotation();
+
+  //! Constructor that uses an existing model (e.g. shared with a forward projector)
+  explicit BackProjectorByBinSPECTRotation(const shared_ptr<SPECTRotationModel>& model_sptr);
+
+  //! Stores all necessary geometric info
+  virtual void set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                      const shared_ptr<const DiscretisedDensity<3,float> >& density_info_sptr);
+
+  //! Symmetries are not used, so returns TrivialDataSymmetriesForBins
+  const DataSymmetriesForViewSegmentNumbers * get_symmetries_used() const;
+
+  shared_ptr<SPECTRotationModel> get_model_sptr() const;
+
+private:
+  shared_ptr<SPECTRotationModel> model_sptr;
+  shared_ptr<DataSymmetriesForViewSegmentNumbers> symmetries_sptr;
+
+  void actual_back_project(DiscretisedDensity<3,float>&,
+                           const RelatedViewgrams<float>&,
+                           const int min_axial_pos_num, const int max_axial_pos_num,
+                           const int min_tangential_pos_num, const int max_tangential_pos_num);
+
+  virtual void set_defaults();
+  virtual void initialise_keymap();
+  virtual bool post_processing();
+};
+
+END_NAMESPACE_STIR
+
+#endif
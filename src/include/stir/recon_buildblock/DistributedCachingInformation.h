@@ -57,13 +57,32 @@ START_NAMESPACE_STIR
 \endverbatim
   within the parameter specification for the objective function, where 1 activates it and 0 deactivates
   caching. The default is set to 0.
+
+  If the workers on the same node share their cache (see distributed::create_node_shared_proj_data()),
+  the object has to be constructed with the node number of every processor. The cache is then
+  kept per node, i.e. a worker re-uses data received by any other worker on the same node.
+  This is enabled by setting
+\verbatim
+  share distributed cache between processes on the same node := 1
+\endverbatim
     
   */
 class DistributedCachingInformation
 {
 public:	
   //! constructor, calls initialise()
+  /*! Every processor has its own cache. */
   explicit DistributedCachingInformation(const int num_processors);
+
+  //! constructor for caches that are shared between processors, calls initialise()
+  /*! \param num_processors the number of processors
+      \param cache_nums for every processor, the number of the cache it uses (-1 for the master).
+      Cache numbers have to be between 0 and \a num_processors-1.
+  */
+  DistributedCachingInformation(const int num_processors, const std::vector<int>& cache_nums);
+
+  //! returns \c true if the object was constructed with cache numbers for every processor
+  bool caches_are_shared() const { return this->caches_shared; }
   
   //! destructor to clean up data structures
   virtual ~DistributedCachingInformation();
@@ -94,11 +113,17 @@ private:
   //! Number of processors available
   int num_workers;
 
+  //! stores the number of the cache for every processor
+  std::vector<int> cache_nums;
+
+  //! \c true if processors can share a cache
+  bool caches_shared;
+
   //! stores which data that have to be processed in this subiteration
   std::vector<ViewSegmentNumbers> vs_nums_to_process;	
 
-  //!stores the vs_nums in the cache of every processor
-  std::vector<std::vector<ViewSegmentNumbers> > proc_vs_nums;
+  //!stores the vs_nums in every cache
+  std::vector<std::vector<ViewSegmentNumbers> > cache_vs_nums;
 	
   //! marks the vs_num that still need to be processed
   /*! Has the same length as vs_nums_to_process */
@@ -110,35 +135,35 @@ private:
   //! \brief find the first vs_num which has not be processed at all
   int find_position_of_first_unprocessed() const;
 	
-  //! count how many data-sets that are cached remain to be processed by processor \a proc
-  int get_num_remaining_cached_data_to_process(int proc) const;
+  //! count how many data-sets that are in cache \a cache_num remain to be processed
+  int get_num_remaining_cached_data_to_process(int cache_num) const;
 
-  /*! \brief store the work-package in the cache-list of the processor
-   * \param proc the processor to whose list the View-Segment-Numbers is saved
-   * \param vs_num the vs_number to be saved to the processors list of cached numbers
+  /*! \brief store the work-package in the cache-list
+   * \param cache_num the cache to whose list the View-Segment-Numbers is saved
+   * \param vs_num the vs_number to be saved to the list of cached numbers
    * Calls set_processed() to make sure we do not process it again.
    */
-  void add_vs_num_to_proc(int proc, const ViewSegmentNumbers& vs_num);
+  void add_vs_num_to_cache(int cache_num, const ViewSegmentNumbers& vs_num);
 
-  /*! \brief gets the vs_num which is (most likely) the oldest in cache of the specific processor
+  /*! \brief gets the vs_num which is (most likely) the oldest in a specific cache
    * \param[out] vs_num will be set accordingly
-   * \param[in] proc the processor for which the View-Segment-Numbers are calculated
-   * \return \c true if there was an unprocessed data-set in the cache of processor \a proc
+   * \param[in] cache_num the cache in which to look
+   * \return \c true if there was an unprocessed data-set in cache \a cache_num
    * This is called by get_unprocessed_vs_num
    */
-  bool get_oldest_unprocessed_vs_num(ViewSegmentNumbers& vs_num, int proc) const;
+  bool get_oldest_unprocessed_vs_num(ViewSegmentNumbers& vs_num, int cache_num) const;
 
 	
-  /*! \brief gets a vs_num of the processor, which has the most work left
-   * \param proc processor that will not be checked (i.e. the one for which 
-   *      we are trying to find some work)
+  /*! \brief gets a vs_num of the cache which has the most work left
+   * \param cache_num cache that will not be checked (i.e. the one of the processor
+   *      for which we are trying to find some work)
    * 	 
    * this function is called if a processor requests work and already accomplished 
-   * everything in its cache. Allocating work from the slave with most work left
+   * everything in its cache. Allocating work from the cache with most work left
    * encourages load balancing without having a lot of extra communicatrions.
    * That way the probability of requesting already cached work is kept high.  
    */
-  ViewSegmentNumbers get_vs_num_of_proc_with_most_work_left(int proc) const;
+  ViewSegmentNumbers get_vs_num_of_cache_with_most_work_left(int cache_num) const;
 		
   /*! \brief set a ViewSegmentNumbers as already processed
    * \param vs_num the vs_num to be set processed
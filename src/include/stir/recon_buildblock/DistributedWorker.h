@@ -28,6 +28,7 @@
 #include "stir/ProjData.h"
 #include "stir/recon_buildblock/ProjectorByBinPair.h"
 #include "stir/recon_buildblock/distributable.h"
+#include "mpi.h"
 #include <string>
 #include <vector>
 
@@ -53,6 +54,10 @@ class ExamInfo;
   enabled.  If so, the worker does not have to receive the related viewgrams, but just gets it from 
   its saved viewgrams.
 
+  If the cache is shared between the workers on the same node, the saved viewgrams are stored in
+  shared memory (see distributed::create_node_shared_proj_data()). A worker can then re-use
+  viewgrams that were received by any worker on its node.
+
   \todo The log_likelihood_ptr argument to the RPC function is currently always NULL.
   \todo Currently the only computation that is supported corresponds to the gradient computation.
   It would be trivial to add others.
@@ -65,7 +70,7 @@ class DistributedWorker : public TimedObject //, public ParsingObject
   double* log_likelihood_ptr;
   bool zero_seg0_end_planes;
   shared_ptr<ProjectorByBinPair> proj_pair_sptr;
-  shared_ptr<ExamInfo> exam_info_sptr;
+  shared_ptr<const ExamInfo> exam_info_sptr;
   shared_ptr<const ProjDataInfo> proj_data_info_sptr;
   shared_ptr<TargetT> target_sptr;
                 
@@ -73,9 +78,14 @@ class DistributedWorker : public TimedObject //, public ParsingObject
 
   // cache variables
   bool cache_enabled;
+  bool cache_shared_on_node;
   shared_ptr<ProjData> proj_data_ptr;   
   shared_ptr<ProjData> binwise_correction;
   shared_ptr<ProjData> mult_proj_data_sptr;
+  // windows holding the memory of the above if the cache is shared on the node
+  MPI_Win proj_data_win;
+  MPI_Win binwise_correction_win;
+  MPI_Win mult_proj_data_win;
 
   int my_rank; //rank of the worker
 
@@ -117,6 +127,10 @@ class DistributedWorker : public TimedObject //, public ParsingObject
                   
   */
   void setup_distributable_computation();
+  /*!
+    \brief releases the cached data
+  */
+  void clear_cache();
   /*!
     \brief this does the actual computation corresponding to distributable_computation()
   */
@@ -40,6 +40,7 @@ class ProjDataInfo;
 class ProjData;
 class DataSymmetriesForViewSegmentNumbers;
 template <typename DataT> class DataProcessor;
+class ImageSupportBoundingBoxes;
 
 /*!
   \ingroup projection
@@ -125,6 +126,24 @@ virtual void set_up(
     /// Set data processor to use before forward projection. MUST BE CALLED BEFORE SET_INPUT.
     void set_pre_data_processor(shared_ptr<DataProcessor<DiscretisedDensity<3,float> > > pre_data_processor_sptr);
 
+    //! Skip LORs that do not intersect the non-zero voxels of the input. MUST BE CALLED BEFORE SET_INPUT.
+    /*! If set, set_input() finds the bounding boxes of the non-zero voxels in every plane
+        (see ImageSupportBoundingBoxes). Bins whose LOR does not intersect those boxes are set to
+        zero without projecting, and viewgrams without any such bins are skipped completely.
+        This is useful for images which are zero in large regions (e.g. when reconstructing
+        with a mask).
+
+        Only the derived classes that implement get_support_margin() clip the ranges of bins.
+        For the others, only projections of images that are zero everywhere are skipped.
+
+        The end-points of the LORs are then cached in the ProjDataInfo used by this projector
+        (see ProjDataInfo::set_LOR_endpoints_cache_enabled()). This uses 6 floats per bin.
+
+        Defaults to \c false.
+    */
+    void set_skip_zero_image_regions(const bool);
+    bool get_skip_zero_image_regions() const;
+
 protected:
   //! This virtual function has to be implemented by the derived class.
   virtual void actual_forward_project(RelatedViewgrams<float>&, 
@@ -142,11 +161,24 @@ protected:
       If overriding this function in a derived class, you need to call this one.
    */
   virtual void check(const ProjDataInfo& proj_data_info, const DiscretisedDensity<3,float>& density_info) const;
+
+  //! Distance (in mm) between an LOR and a voxel beyond which the voxel does not contribute to the bin
+  /*! The distance is measured to the edges of the voxel. This is used to find the bins that
+      are zero when set_skip_zero_image_regions() is used. It should therefore include the
+      width of the bins and any blurring done by the projector.
+
+      The default returns a negative number, which means that the projector cannot guarantee this.
+  */
+  virtual float get_support_margin() const;
+
   bool _already_set_up;
 
   //! The density ptr set with set_up()
   shared_ptr<DiscretisedDensity<3,float> > _density_sptr;
   shared_ptr<DataProcessor<DiscretisedDensity<3,float> > > _pre_data_processor_sptr;
+  bool _skip_zero_image_regions;
+  //! bounding boxes of the density set with set_input(), only computed if _skip_zero_image_regions is \c true
+  shared_ptr<const ImageSupportBoundingBoxes> _support_sptr;
 
   virtual void set_defaults();
   virtual void initialise_keymap();
@@ -71,6 +71,10 @@ public:
   
   const DataSymmetriesForViewSegmentNumbers * get_symmetries_used() const;
 
+protected:
+  //! Sum of the bin sizes and the voxel diagonal if the matrix is a ProjMatrixByBinUsingRayTracing
+  /*! Returns -1 for other matrices, as they could contain blurring. */
+  virtual float get_support_margin() const;
   
 private:
   shared_ptr<ProjMatrixByBin>  proj_matrix_ptr;
@@ -98,6 +98,9 @@ public:
   //! variable that determines if a cylindrical FOV or the whole image will be handled
   bool restrict_to_cylindrical_FOV;
 
+  //! Sum of the bin sizes and the voxel diagonal
+  virtual float get_support_margin() const;
+
 
 private:
   void actual_forward_project(RelatedViewgrams<float>&, 
@@ -27,6 +27,7 @@
 #include "stir/shared_ptr.h"
 #include "stir/recon_buildblock/GeneralisedPrior.h"
 #include <string>
+#include <vector>
 
 #include "stir/ExamData.h"
 #include "stir/ProjData.h"
@@ -243,6 +244,25 @@ public:
               const TargetT& input,
               const int subset_num) const;
 
+    //! Multiply the sub-Hessian (without penalty) with several inputs
+    /*! Adds the result for <code>*inputs[k]</code> to <code>*outputs[k]</code>. The result is the same
+        as calling accumulate_sub_Hessian_times_input_without_penalty() for every input, but derived
+        classes can share the computations that only depend on \a current_image_estimate
+        (e.g. reading the data and forward projecting \a current_image_estimate).
+
+        Calls actual_accumulate_sub_Hessian_times_inputs_without_penalty().
+    */
+    Succeeded
+      accumulate_sub_Hessian_times_inputs_without_penalty(const std::vector<shared_ptr<TargetT> >& outputs,
+              const TargetT& current_image_estimate,
+              const std::vector<shared_ptr<const TargetT> >& inputs,
+              const int subset_num) const;
+    //! Multiply the Hessian (without penalty) with several inputs
+    /*! \see accumulate_sub_Hessian_times_inputs_without_penalty() */
+    Succeeded
+      accumulate_Hessian_times_inputs_without_penalty(const std::vector<shared_ptr<TargetT> >& outputs,
+              const TargetT& current_image_estimate,
+              const std::vector<shared_ptr<const TargetT> >& inputs) const;
     //@}
 
 
@@ -404,6 +424,19 @@ protected:
                                                               const TargetT& current_image_estimate,
                                                               const TargetT& input,
                                                               const int subset_num) const;
+
+    //! Implementation of the function that multiplies the sub-Hessian with several inputs
+    /*!
+       \see accumulate_sub_Hessian_times_inputs_without_penalty()
+
+       The default implementation calls actual_accumulate_sub_Hessian_times_input_without_penalty()
+       for every input. Arguments have been checked already.
+    */
+    virtual Succeeded
+    actual_accumulate_sub_Hessian_times_inputs_without_penalty(const std::vector<shared_ptr<TargetT> >& outputs,
+                                                               const TargetT& current_image_estimate,
+                                                               const std::vector<shared_ptr<const TargetT> >& inputs,
+                                                               const int subset_num) const;
 };
 END_NAMESPACE_STIR
 
@@ -0,0 +1,93 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Declaration of class stir::ImageSupportBoundingBoxes
+
+  \author agent
+*/
+#ifndef __stir_recon_buildblock_ImageSupportBoundingBoxes_H__
+#define __stir_recon_buildblock_ImageSupportBoundingBoxes_H__
+
+#include "stir/VectorWithOffset.h"
+
+START_NAMESPACE_STIR
+
+template <int num_dimensions, typename elemT> class DiscretisedDensity;
+class ProjDataInfo;
+
+/*!
+  \ingroup projection
+  \brief Bounding boxes of the non-zero voxels of an image, one per plane
+
+  This class is used by projectors to skip LORs that do not intersect the support of
+  the image (see ForwardProjectorByBin::set_skip_zero_image_regions()).
+
+  For every plane, the smallest rectangle containing all voxels with a non-zero value is
+  stored (in mm, using the edges of the voxels). An LOR intersects the support if it
+  (or a cylinder with radius \a margin around it) intersects one of the boxes.
+
+  Coordinates are in the "gantry" coordinate system used by ProjDataInfo::get_LOR(),
+  i.e. with the origin in the centre of the scanner. The image is assumed to be centred
+  axially in the scanner, as for the other projectors.
+
+  If the image is not a stir::VoxelsOnCartesianGrid, no boxes are computed and all LORs are
+  considered to intersect the support (unless the image is zero everywhere).
+*/
+class ImageSupportBoundingBoxes
+{
+ public:
+  //! Finds the bounding boxes of all voxels with a non-zero value
+  explicit ImageSupportBoundingBoxes(const DiscretisedDensity<3,float>& density);
+
+  //! Returns \c true if all voxels are zero
+  bool is_empty() const { return this->empty; }
+
+  //! Checks if the line through 2 points intersects the support
+  /*! Voxels within a distance \a margin (in mm) of the line are taken into account as well. */
+  bool intersects(const float z1, const float y1, const float x1,
+                  const float z2, const float y2, const float x2,
+                  const float margin) const;
+
+  //! Finds the smallest range of positions in a viewgram whose LORs intersect the support
+  /*! The LORs are found via ProjDataInfo::get_LOR_endpoints().
+      \return \c false if no LOR intersects the support (the ranges are then not modified).
+  */
+  bool find_range_of_LORs_intersecting_support(int& min_axial_pos_num, int& max_axial_pos_num,
+                                               int& min_tangential_pos_num, int& max_tangential_pos_num,
+                                               const ProjDataInfo& proj_data_info,
+                                               const int view_num, const int segment_num,
+                                               const float margin) const;
+
+ private:
+  struct Box
+  {
+    float min_y, max_y, min_x, max_x;
+  };
+  bool empty;
+  //! \c true if no boxes could be computed
+  bool all_supported;
+  //! z-coordinate of the centre of the first plane and the plane spacing
+  float first_z, voxel_size_z;
+  //! box of the whole support (in z, the edges of the first and last non-empty plane)
+  float min_z, max_z;
+  Box total_box;
+  //! boxes per plane, indexed with the plane number
+  VectorWithOffset<Box> boxes;
+  //! \c true if the plane has no non-zero voxels
+  VectorWithOffset<bool> plane_is_empty;
+};
+
+END_NAMESPACE_STIR
+
+#endif
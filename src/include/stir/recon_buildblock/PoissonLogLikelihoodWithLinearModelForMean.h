@@ -102,6 +102,9 @@ START_NAMESPACE_STIR
   ; e.g. subsens_%d.hv
   ; boost::format is used with the pattern (which means you can use it like sprintf)
   subset sensitivity filenames:=
+  ; (existing) directory where computed sensitivities are stored and looked up
+  ; when no filenames are set (see set_sensitivity_cache_directory())
+  sensitivity cache directory:=
   \endverbatim
 
   \par Terminology
@@ -197,6 +200,14 @@ public  GeneralisedObjectiveFunction<TargetT>
   boost::format is used with the pattern (which means you can use it like sprintf)
  */
   std::string get_subsensitivity_filenames() const;
+  //! get directory used for caching sensitivities
+  /*! will be a zero string if not set */
+  std::string get_sensitivity_cache_directory() const;
+  //! get name of the files in the sensitivity cache used by the last call to set_up() (without extension)
+  /*! will be a zero string if the cache was not used */
+  std::string get_sensitivity_cache_filename_prefix() const;
+  //! check if the last call to set_up() read the sensitivities from the cache
+  bool get_sensitivity_read_from_cache() const;
 
   /*! \name Functions to set parameters
     This can be used as alternative to the parsing mechanism.
@@ -222,6 +233,24 @@ public  GeneralisedObjectiveFunction<TargetT>
   Calls error() if the pattern is invalid.
  */
   void set_subsensitivity_filenames(const std::string&);
+  //! set directory used for caching sensitivities
+  /*! If the (subset) sensitivities have to be computed by set_up() (i.e. when no filenames are set
+    or \c recompute_sensitivity is \c true), set_up() first looks for sensitivities that were computed
+    for the same configuration in this directory. Otherwise, it computes them and stores them there.
+    Remove the files from the directory to force recomputation.
+
+    The configuration is described by a text (see get_sensitivity_cache_description()), which is stored
+    in the directory as well. Files are named after a hash of this text, and the text is compared
+    when reading to validate the cached sensitivities. The images are stored in the default output
+    file format (normally Interfile).
+
+    The directory has to exist. Set to a zero-length string to switch caching off (the default).
+
+    \warning Input files (such as normalisation or attenuation files) are identified by their
+    name in the description. If such a file is overwritten with different data, or if objects are
+    set via pointers without a file name, the cache could contain wrong sensitivities.
+  */
+  void set_sensitivity_cache_directory(const std::string&);
   //@}
 
   /*! The implementation checks if the sensitivity of a voxel is zero. If so,
@@ -236,6 +265,9 @@ public  GeneralisedObjectiveFunction<TargetT>
   std::string subsensitivity_filenames;
   bool recompute_sensitivity;
   bool use_subset_sensitivities;
+  std::string sensitivity_cache_directory;
+  std::string sensitivity_cache_filename_prefix;
+  bool sensitivity_read_from_cache;
 
   VectorWithOffset<shared_ptr<TargetT> > subsensitivity_sptrs;
   shared_ptr<TargetT> sensitivity_sptr;
@@ -253,7 +285,26 @@ public  GeneralisedObjectiveFunction<TargetT>
   */
   void set_total_or_subset_sensitivities();
 
+  //! description of the configuration for the sensitivity cache, including info from the derived class
+  /*! returns an empty string if the derived class does not support caching. */
+  std::string get_full_sensitivity_cache_description(const TargetT& target);
+  //! name of the files in the sensitivity cache (without extension)
+  std::string construct_sensitivity_cache_filename_prefix(const std::string& description) const;
+  //! reads sensitivities from the cache, returns Succeeded::no if not found or invalid
+  Succeeded read_sensitivities_from_cache(const std::string& description, const TargetT& target);
+  //! writes sensitivities to the cache (only writes a warning on failure)
+  void write_sensitivities_to_cache(const std::string& description) const;
+
 protected:
+  //! Text describing everything the sensitivity depends on, for the sensitivity cache
+  /*! See set_sensitivity_cache_directory(). This is called after set_up_before_sensitivity().
+    The base class adds info on the subsets and the target characteristics.
+
+    The default implementation returns an empty string, which means that the derived class
+    does not support caching.
+  */
+  virtual std::string get_sensitivity_cache_description();
+
   //! set-up specifics for the derived class 
   virtual Succeeded 
     set_up_before_sensitivity(shared_ptr<const TargetT > const& target_sptr) = 0;
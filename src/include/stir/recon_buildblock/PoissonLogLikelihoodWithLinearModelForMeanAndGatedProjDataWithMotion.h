@@ -30,6 +30,7 @@
 #include "stir/GatedProjData.h"
 #include "stir/GatedDiscretisedDensity.h"
 #include "stir/spatial_transformation/GatedSpatialTransformation.h"
+#include <functional>
 
 START_NAMESPACE_STIR
 
@@ -48,6 +49,15 @@ START_NAMESPACE_STIR
  
  For more information: Tsoumpas et al (2013) Physics in Medicine and Biology
 
+  \par Processing gates in parallel
+  When STIR is compiled with OpenMP, the gates can be processed concurrently by setting
+  <tt>number of gates to process in parallel</tt> (default 1). The available threads are then split
+  over the gates, and every gate uses its share for its loop over viewgrams (nested parallelism).
+  As the projectors store the image that is being projected, every gate then needs its own
+  projector pair. These are constructed from the parameters of the projector pair given
+  (see ProjectorByBinPair::parameter_info()). Note that this increases memory usage when the
+  projectors cache data, such as ProjMatrixByBin.
+
 */
 
 template <typename TargetT>
@@ -122,6 +132,7 @@ public  RegisteredParsingObject<PoissonLogLikelihoodWithLinearModelForMeanAndGat
   const shared_ptr<GatedProjData>& get_normalisation_gated_proj_data_sptr() const;
   const ProjectorByBinPair& get_projector_pair() const;
   const shared_ptr<ProjectorByBinPair>& get_projector_pair_sptr() const;
+  int get_num_gates_to_process_in_parallel() const;
   //@}
 
   /*! \name Functions to set parameters
@@ -140,6 +151,8 @@ public  RegisteredParsingObject<PoissonLogLikelihoodWithLinearModelForMeanAndGat
 
   virtual void set_input_data(const shared_ptr<ExamData> &);
   virtual const GatedProjData& get_input_data() const;
+  //! set the number of gates that are processed concurrently (only used with OpenMP)
+  void set_num_gates_to_process_in_parallel(const int);
   //@}
  protected:
   //! Filename with input projection data
@@ -184,6 +197,8 @@ public  RegisteredParsingObject<PoissonLogLikelihoodWithLinearModelForMeanAndGat
 
   //! gated image template
   GatedDiscretisedDensity _gated_image_template;
+  //! number of gates that are processed concurrently
+  int _num_gates_to_process_in_parallel;
   bool actual_subsets_are_approximately_balanced(std::string& warning_message) const;
 
   //! Sets defaults before parsing 
@@ -191,6 +206,13 @@ public  RegisteredParsingObject<PoissonLogLikelihoodWithLinearModelForMeanAndGat
   virtual void initialise_keymap();
   virtual bool post_processing();
 
+ private:
+  //! gated images re-used between calls to compute the gradient or objective function
+  GatedDiscretisedDensity _gated_image_estimate_work;
+  GatedDiscretisedDensity _gated_gradient_work;
+
+  //! calls \a gate_function for all gates, in parallel if \c _num_gates_to_process_in_parallel > 1
+  void for_each_gate(const std::function<void (const unsigned int gate_num)>& gate_function) const;
 };
 
 END_NAMESPACE_STIR
@@ -39,6 +39,11 @@
 
 #include <algorithm>
 #include <string> 
+#include <sstream>
+#include <vector>
+#ifdef STIR_OPENMP
+#include <omp.h>
+#endif
 // For Motion
 #include "stir/spatial_transformation/GatedSpatialTransformation.h"
 #include "stir/recon_buildblock/PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotion.h"
@@ -75,6 +80,7 @@ set_defaults()
   // this->_time_gate_definitions_sptr=NULL;
   this->_additive_gated_proj_data_filename = "0";
   this->_additive_gated_proj_data_sptr.reset();
+  this->_num_gates_to_process_in_parallel = 1;
 
 #ifndef USE_PMRT // set default for _projector_pair_ptr
   shared_ptr<ForwardProjectorByBin> forward_projector_ptr
@@ -112,6 +118,7 @@ initialise_keymap()
 
   this->target_parameter_parser.add_to_keymap(this->parser);
   this->parser.add_parsing_key("Projector pair type", &this->_projector_pair_ptr);
+  this->parser.add_key("number of gates to process in parallel", &this->_num_gates_to_process_in_parallel);
 
   // Scatter correction
   this->parser.add_key("additive sinograms",&this->_additive_gated_proj_data_filename);
@@ -272,9 +279,21 @@ PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotion<TargetT>::
 get_projector_pair_sptr() const
 { return this->_projector_pair_ptr; }
 
+template <typename TargetT>
+int
+PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotion<TargetT>::
+get_num_gates_to_process_in_parallel() const
+{ return this->_num_gates_to_process_in_parallel; }
+
 /***************************************************************
   set_ functions
 ***************************************************************/
+template<typename TargetT>
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotion<TargetT>::
+set_num_gates_to_process_in_parallel(const int num_gates)
+{ this->_num_gates_to_process_in_parallel = num_gates; }
+
 template<typename TargetT>
 int
 PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotion<TargetT>::
@@ -367,6 +386,19 @@ set_up_before_sensitivity(shared_ptr<const TargetT > const& target_sptr)
 	      this->num_subsets);
       return Succeeded::no;
     }
+  if (this->_num_gates_to_process_in_parallel < 1)
+    {
+      warning("Number of gates to process in parallel (%d) should be at least 1.",
+	      this->_num_gates_to_process_in_parallel);
+      return Succeeded::no;
+    }
+#if !defined(STIR_OPENMP) || defined(STIR_MPI)
+  if (this->_num_gates_to_process_in_parallel > 1)
+    {
+      warning("Processing gates in parallel is only supported when using OpenMP (and not MPI). Gates will be processed sequentially.");
+      this->_num_gates_to_process_in_parallel = 1;
+    }
+#endif
   {
     const shared_ptr<DiscretisedDensity<3,float> > density_template_sptr(target_sptr->get_empty_copy()); // target_sptr appears not to be set up correctly
     const shared_ptr<Scanner> scanner_sptr(new Scanner(*proj_data_info_sptr->get_scanner_ptr()));
@@ -378,7 +410,18 @@ set_up_before_sensitivity(shared_ptr<const TargetT > const& target_sptr)
     for(unsigned int gate_num=1;gate_num<=this->get_time_gate_definitions().get_num_gates();++gate_num)
       {
         info(boost::format("Objective Function for Gate Number: %1%") % gate_num);
-	this->_single_gate_obj_funcs[gate_num].set_projector_pair_sptr(this->_projector_pair_ptr);
+	shared_ptr<ProjectorByBinPair> projector_pair_sptr = this->_projector_pair_ptr;
+	if (this->_num_gates_to_process_in_parallel > 1 && gate_num > 1)
+	  {
+	    // projectors store the image being projected, so gates processed in parallel need their own
+	    std::istringstream parameter_info_stream(this->_projector_pair_ptr->parameter_info());
+	    projector_pair_sptr.reset(RegisteredObject<ProjectorByBinPair>::
+				      read_registered_object(&parameter_info_stream,
+							     this->_projector_pair_ptr->get_registered_name()));
+	    if (is_null_ptr(projector_pair_sptr))
+	      error("Could not construct projector pair for gate %d", gate_num);
+	  }
+	this->_single_gate_obj_funcs[gate_num].set_projector_pair_sptr(projector_pair_sptr);
 	this->_single_gate_obj_funcs[gate_num].set_proj_data_sptr(this->_gated_proj_data_sptr->get_proj_data_sptr(gate_num));
 	this->_single_gate_obj_funcs[gate_num].set_max_segment_num_to_process(this->_max_segment_num_to_process);
 	this->_single_gate_obj_funcs[gate_num].set_zero_seg0_end_planes(this->_zero_seg0_end_planes!=0);
@@ -404,10 +447,47 @@ set_up_before_sensitivity(shared_ptr<const TargetT > const& target_sptr)
 	if(this->_single_gate_obj_funcs[gate_num].set_up(density_template_sptr) != Succeeded::yes)
 	  error("Single gate objective functions is not set correctly!");
       }
+    this->_gated_image_estimate_work = this->_gated_image_template;
+    this->_gated_gradient_work = this->_gated_image_template;
   }//_single_gate_obj_funcs[gate_num]
   return Succeeded::yes;
 }
 
+template<typename TargetT>
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotion<TargetT>::
+for_each_gate(const std::function<void (const unsigned int gate_num)>& gate_function) const
+{
+  const int num_gates = static_cast<int>(this->get_time_gate_definitions().get_num_gates());
+#ifdef STIR_OPENMP
+  const int num_gates_in_parallel = std::min(this->_num_gates_to_process_in_parallel, num_gates);
+  if (num_gates_in_parallel > 1)
+    {
+      // split the threads over the gates. Every gate uses its share for the loop over viewgrams.
+      const int old_num_threads = omp_get_max_threads();
+      const int num_threads_per_gate = std::max(1, old_num_threads / num_gates_in_parallel);
+      const int old_max_active_levels = omp_get_max_active_levels();
+      if (num_threads_per_gate > 1 && old_max_active_levels < 2)
+        omp_set_max_active_levels(2);
+#pragma omp parallel for schedule(dynamic) num_threads(num_gates_in_parallel)
+      for (int gate_num=1; gate_num<=num_gates; ++gate_num)
+        {
+          // Every gate runs in its own (inactive) team of 1 thread. The projectors of the gate
+          // therefore do not see the threads of the other gates.
+#pragma omp parallel num_threads(1)
+          {
+            omp_set_num_threads(num_threads_per_gate);
+            gate_function(static_cast<unsigned int>(gate_num));
+          }
+        }
+      omp_set_max_active_levels(old_max_active_levels);
+      return;
+    }
+#endif
+  for (int gate_num=1; gate_num<=num_gates; ++gate_num)
+    gate_function(static_cast<unsigned int>(gate_num));
+}
+
 /*************************************************************************
   functions that compute the value/gradient of the objective function etc
 *************************************************************************/
@@ -423,24 +503,21 @@ actual_compute_subset_gradient_without_penalty(TargetT& gradient,
   assert(subset_num>=0);
   assert(subset_num<this->num_subsets);
 
-  GatedDiscretisedDensity gated_gradient=this->_gated_image_template;
-  GatedDiscretisedDensity gated_image_estimate=this->_gated_image_template;
-  // The following initialization doesn't stabilize reconstruction.
-  for(unsigned int gate_num=1;gate_num<=this->get_time_gate_definitions().get_num_gates();++gate_num)
-    std::fill(gated_image_estimate[gate_num].begin_all(),
-	      gated_image_estimate[gate_num].end_all(),
-	      0.F);		  
+  GatedDiscretisedDensity& gated_gradient=this->_gated_gradient_work;
+  GatedDiscretisedDensity& gated_image_estimate=this->_gated_image_estimate_work;
+  // note: warp_image overwrites all gates
   this->_motion_vectors.warp_image(gated_image_estimate,current_estimate); 
-  for(unsigned int gate_num=1;gate_num<=this->get_time_gate_definitions().get_num_gates();++gate_num)	{
-    std::fill(gated_gradient[gate_num].begin_all(),
-              gated_gradient[gate_num].end_all(),
-              0.F);
-    this->_single_gate_obj_funcs[gate_num].
-            actual_compute_subset_gradient_without_penalty(gated_gradient[gate_num],
-                                                           gated_image_estimate[gate_num],
-                                                           subset_num,
-                                                           add_sensitivity);
-  }	
+  for_each_gate([&](const unsigned int gate_num)
+    {
+      std::fill(gated_gradient[gate_num].begin_all(),
+                gated_gradient[gate_num].end_all(),
+                0.F);
+      this->_single_gate_obj_funcs[gate_num].
+              actual_compute_subset_gradient_without_penalty(gated_gradient[gate_num],
+                                                             gated_image_estimate[gate_num],
+                                                             subset_num,
+                                                             add_sensitivity);
+    });
   //	if(this->_motion_correction_type==-1)
   this->_reverse_motion_vectors.warp_image(gradient,gated_gradient) ; 
   //	else
@@ -456,23 +533,21 @@ actual_compute_objective_function_without_penalty(const TargetT& current_estimat
   assert(subset_num>=0);
   assert(subset_num<this->num_subsets);
 
-  double result = 0.;
-  GatedDiscretisedDensity gated_image_estimate=this->_gated_image_template;
-  // The following initialization doesn't stabilize reconstruction.
-  for(unsigned int gate_num=1; gate_num<=this->get_time_gate_definitions().get_num_gates(); ++gate_num)
-    std::fill(gated_image_estimate[gate_num].begin_all(),
-	      gated_image_estimate[gate_num].end_all(),
-	      0.F);
+  GatedDiscretisedDensity& gated_image_estimate=this->_gated_image_estimate_work;
+  // note: warp_image overwrites all gates
   this->_motion_vectors.warp_image(gated_image_estimate,current_estimate) ;  
   // loop over single_gate
-  for(unsigned int gate_num=1 ;
-      gate_num<=this->get_time_gate_definitions().get_num_gates();
-      ++gate_num)
+  std::vector<double> gate_results(this->get_time_gate_definitions().get_num_gates(), 0.);
+  for_each_gate([&](const unsigned int gate_num)
     {
-      result +=	this->_single_gate_obj_funcs[gate_num].
+      gate_results[gate_num-1] = this->_single_gate_obj_funcs[gate_num].
         compute_objective_function_without_penalty(gated_image_estimate[gate_num], 
 						   subset_num);
-    }
+    });
+  // sum in a fixed order such that the result does not depend on the number of threads
+  double result = 0.;
+  for (std::size_t i=0; i<gate_results.size(); ++i)
+    result += gate_results[i];
   return result;
 }
 
@@ -520,9 +595,7 @@ actual_add_multiplication_with_approximate_sub_Hessian_without_penalty(TargetT&
   this->_motion_vectors.warp_image(gated_input,input) ;  
 
   VectorWithOffset<float> scale_factor(1,this->get_time_gate_definitions().get_num_gates());
-  for(unsigned int gate_num=1;
-      gate_num<=this->get_time_gate_definitions().get_num_gates();
-      ++gate_num)
+  for_each_gate([&](const unsigned int gate_num)
     {
       scale_factor[gate_num]=gated_input[gate_num].find_max();
       /*! /note This is used to avoid higher values than these set in the precompute_denominator_of_conditioner_without_penalty() function. 
@@ -533,7 +606,7 @@ actual_add_multiplication_with_approximate_sub_Hessian_without_penalty(TargetT&
 									gated_input[gate_num],
 									subset_num);      
       gated_output[gate_num]*=scale_factor[gate_num];
-    } // end of loop over gates
+    }); // end of loop over gates
   this->_reverse_motion_vectors.warp_image(output,gated_output);  
   output/=static_cast<float>(this->get_time_gate_definitions().get_num_gates()); //Normalizing to get the average value to test if OSSPS works.
   return Succeeded::yes;
@@ -574,16 +647,14 @@ actual_accumulate_sub_Hessian_times_input_without_penalty(TargetT& output,
   this->_motion_vectors.warp_image(gated_input,input);
   this->_motion_vectors.warp_image(gated_current_image_estimate, current_image_estimate);
 
-  for(unsigned int gate_num=1;
-      gate_num<=this->get_time_gate_definitions().get_num_gates();
-      ++gate_num)
+  for_each_gate([&](const unsigned int gate_num)
   {
     this->_single_gate_obj_funcs[gate_num].
     accumulate_sub_Hessian_times_input_without_penalty(gated_output[gate_num],
             gated_current_image_estimate[gate_num],
             gated_input[gate_num],
             subset_num);
-  } // end of loop over gates
+  }); // end of loop over gates
   this->_reverse_motion_vectors.warp_image(output, gated_output);
   output/=static_cast<float>(this->get_time_gate_definitions().get_num_gates()); //Normalizing to get the average value to test if OSSPS works.
   return Succeeded::yes;
@@ -100,6 +100,9 @@ protected:
 
   virtual Succeeded 
     set_up_before_sensitivity(shared_ptr <const TargetT > const& target_sptr); 
+
+  //! Describes projection data geometry, projection matrix and normalisation
+  virtual std::string get_sensitivity_cache_description();
  
   virtual void
     add_subset_sensitivity(TargetT& sensitivity, const int subset_num) const;
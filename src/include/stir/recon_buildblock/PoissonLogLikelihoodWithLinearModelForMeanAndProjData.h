@@ -148,6 +148,10 @@ public:
   //#ifdef STIR_MPI
   //!enable/disable key for distributed caching 
   bool distributed_cache_enabled;
+  //!if \c true, workers on the same node share their distributed cache
+  bool distributed_cache_shared_on_node;
+  //!if \c true, only the bounding box of the non-zero voxels of the output images is reduced
+  bool distributed_image_reduction_uses_bounding_box;
   bool distributed_tests_enabled;
   bool message_timings_enabled;
   double message_timings_threshold;
@@ -231,6 +235,9 @@ public:
   virtual Succeeded 
     set_up_before_sensitivity(shared_ptr <const TargetT > const& target_sptr);
 
+  //! Describes projection data geometry, projectors, normalisation and time frame
+  virtual std::string get_sensitivity_cache_description();
+
   virtual double
     actual_compute_objective_function_without_penalty(const TargetT& current_estimate,
                                                       const int subset_num);
@@ -289,6 +296,8 @@ public:
     The loglikelihood is a concave function, see
     add_multiplication_with_approximate_sub_Hessian_without_penalty() for
     more details regarding Hessian methods.
+
+    This calls actual_accumulate_sub_Hessian_times_inputs_without_penalty() with a single input.
   */
   virtual Succeeded
         actual_accumulate_sub_Hessian_times_input_without_penalty(TargetT& output,
@@ -296,6 +305,18 @@ public:
                 const TargetT& input,
                 const int subset_num) const;
 
+  /*!
+    The view/segments in the subset are processed in batches (of 4 per thread) to keep memory bounded.
+    For every batch, the data \f$y_i\f$ and \f$((P \lambda)_i + a_i)^2\f$ are computed once
+    and used for all inputs. Per input, only the forward projection of the input and the back
+    projection of the result are performed.
+  */
+  virtual Succeeded
+        actual_accumulate_sub_Hessian_times_inputs_without_penalty(const std::vector<shared_ptr<TargetT> >& outputs,
+                const TargetT& current_image_estimate,
+                const std::vector<shared_ptr<const TargetT> >& inputs,
+                const int subset_num) const;
+
 protected:
   //! Filename with input projection data
   std::string input_filename;
@@ -361,6 +382,13 @@ protected:
   bool actual_subsets_are_approximately_balanced(std::string& warning_message) const;
  private:
   shared_ptr<DataSymmetriesForViewSegmentNumbers> symmetries_sptr;
+
+  //! implementation of the Hessian times input functions, for any number of inputs
+  Succeeded
+    accumulate_sub_Hessian_times_inputs(const std::vector<TargetT*>& outputs,
+                                        const TargetT& current_image_estimate,
+                                        const std::vector<const TargetT*>& inputs,
+                                        const int subset_num) const;
 #if 0
   void
     add_view_seg_to_sensitivity(TargetT& sensitivity, const ViewSegmentNumbers& view_seg_nums) const;
@@ -369,7 +397,7 @@ protected:
 
 #ifdef STIR_MPI
 //made available to be called from DistributedWorker object
-RPC_process_related_viewgrams_type RPC_process_related_viewgrams_gradient;
+template <bool add_sensitivity> RPC_process_related_viewgrams_type RPC_process_related_viewgrams_gradient;
 RPC_process_related_viewgrams_type RPC_process_related_viewgrams_accumulate_loglikelihood;
 RPC_process_related_viewgrams_type RPC_process_related_viewgrams_sensitivity_computation;
 #endif
@@ -25,7 +25,9 @@
 #include "stir/CartesianCoordinate3D.h"
 #include "stir/IndexRange.h"
 #include "stir/shared_ptr.h"
+#include <boost/cstdint.hpp>
 #include <iostream>
+#include <vector>
 
 
 #include "stir/recon_buildblock/SPECTUB_Tools.h"
@@ -72,8 +74,15 @@ class Bin;
     ; if next variable is set to 0, only a single view is kept in memory
    keep all views in cache:=1
 
+    ; optional directory where the matrix elements of every view are stored after computation
+    ; (see set_matrix_cache_directory())
+    ; matrix cache directory :=
+
 End Projection Matrix By Bin SPECT UB Parameters:=
 \endverbatim
+
+  When all views are kept in the cache, different views are computed in parallel (when
+  using OpenMP).
 */
 
 class ProjMatrixByBinSPECTUB : 
@@ -107,6 +116,22 @@ class ProjMatrixByBinSPECTUB :
     You have to call set_up() after this (unless the value didn't change).
   */
   void set_keep_all_views_in_cache(bool value = true);
+  std::string get_matrix_cache_directory() const;
+  //! Set directory to store the computed matrix
+  /*!
+    If non-empty, the matrix elements of every view are written to a file in this directory after computing them.
+    The name of the file contains a hash of the geometry, the resolution model, the attenuation image and the mask,
+    such that a subsequent set_up() with the same settings reads the elements from file instead of computing them.
+    This is useful for repeated reconstructions of the same data. Note that these files can be large.
+
+    The directory has to exist. An empty string (the default) disables this feature.
+
+    You have to call set_up() after this.
+  */
+  void set_matrix_cache_directory(const std::string& value);
+  //! Name of the file in the matrix cache directory with the elements for a view
+  /*! Returns an empty string if no cache directory is set. Only valid after set_up(). */
+  std::string get_matrix_cache_filename_for_view(const int view_num) const;
   std::string get_attenuation_type() const;
   //! Set type of attenuation modelling
   /*! Has to be "no", "simple" or "full"
@@ -162,6 +187,7 @@ class ProjMatrixByBinSPECTUB :
   std::string mask_type;
   std::string mask_file;
   bool keep_all_views_in_cache; //!< if set to false, only a single view is kept in memory
+  std::string matrix_cache_directory;
 
   // explicitly list necessary members for image details (should use an Info object instead)
   CartesianCoordinate3D<float> voxel_size;
@@ -206,9 +232,19 @@ class ProjMatrixByBinSPECTUB :
   int maxszb;
 
 	
+  //! hash of all settings that influence the matrix, used for the files in matrix_cache_directory
+  boost::uint64_t matrix_cache_hash;
+  void compute_matrix_cache_hash();
+  std::string get_matrix_cache_filename(const int kOS) const;
+
   void compute_one_subset(const int kOS) const;
   void delete_UB_SPECT_arrays();
-  mutable std::vector<bool> subset_already_processed;
+  //! flags for every UB-subset (not std::vector<bool> as elements are modified by different threads)
+  mutable std::vector<char> subset_already_processed;
+#ifdef STIR_OPENMP
+  //! locks to make sure that every UB-subset is only computed once
+  mutable std::vector<omp_lock_t> subset_locks;
+#endif
 };
 
 END_NAMESPACE_STIR
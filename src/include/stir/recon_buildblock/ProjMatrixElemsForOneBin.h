@@ -194,6 +194,27 @@ public:
   void forward_project(RelatedBins&,
                        const DiscretisedDensity<3,float>&) const;
 
+  //! back project a single bin into an image stored in a contiguous block of memory
+  /*! \a data_ptr has to point to the voxel with indices \a min_indices, and the voxels have to
+      be stored with \c x running fastest, in an array with sizes \a lengths (in the order z,y,x).
+      This is used with VoxelsOnCartesianGrid::get_contiguous_data_ptr(), and avoids
+      the nested indexing of the other version.
+
+      As in back_project(DiscretisedDensity<3,float>&, const Bin&) const, elements with a
+      z-coordinate outside the image are ignored.
+  */
+  void back_project(float * const data_ptr,
+                    const BasicCoordinate<3,int>& min_indices,
+                    const BasicCoordinate<3,int>& lengths,
+                    const Bin&) const;
+
+  //! forward project into a single bin from an image stored in a contiguous block of memory
+  /*! \see back_project(float * const, const BasicCoordinate<3,int>&, const BasicCoordinate<3,int>&, const Bin&) const */
+  void forward_project(Bin&,
+                       const float * const data_ptr,
+                       const BasicCoordinate<3,int>& min_indices,
+                       const BasicCoordinate<3,int>& lengths) const;
+
   
 private:
   std::vector<value_type> elements;    
@@ -0,0 +1,80 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Declaration of class stir::ProjMatrixElemsForOneBinWithOffsets
+
+  \author agent
+*/
+#ifndef __stir_recon_buildblock_ProjMatrixElemsForOneBinWithOffsets_H__
+#define __stir_recon_buildblock_ProjMatrixElemsForOneBinWithOffsets_H__
+
+#include "stir/BasicCoordinate.h"
+#include <vector>
+#include <cstddef>
+
+START_NAMESPACE_STIR
+
+class ProjMatrixElemsForOneBin;
+class Bin;
+
+/*!
+  \ingroup projection
+  \brief A row of the projection matrix stored as offsets into a contiguous image
+
+  ProjMatrixElemsForOneBin stores the voxel coordinates of every element. This class
+  stores instead the linear offset of every voxel in an image that is stored in one contiguous
+  block of memory (see VoxelsOnCartesianGrid::get_contiguous_data_ptr()), and the
+  corresponding values, in 2 separate arrays. Forward and back projection are then simple
+  gather and scatter loops that the compiler can vectorise.
+
+  The offsets are computed once by set(). This is worth it when the row is used more than
+  once, e.g. for the forward and back projection of one event in a list-mode reconstruction.
+
+  Memory is reused between calls to set(), so it is best to keep one object per thread.
+*/
+class ProjMatrixElemsForOneBinWithOffsets
+{
+public:
+  //! Construct an empty row
+  ProjMatrixElemsForOneBinWithOffsets();
+
+  //! Compute offsets and values from \a row
+  /*! \a min_indices and \a lengths describe the image (in the order z,y,x), as in
+      ProjMatrixElemsForOneBin::forward_project(Bin&, const float * const, const BasicCoordinate<3,int>&, const BasicCoordinate<3,int>&) const.
+      Elements with a z-coordinate outside the image are dropped.
+  */
+  void set(const ProjMatrixElemsForOneBin& row,
+           const BasicCoordinate<3,int>& min_indices,
+           const BasicCoordinate<3,int>& lengths);
+
+  //! number of elements (inside the image)
+  std::size_t size() const { return offsets.size(); }
+
+  //! forward project into a single bin (the result is added to the value of \a bin)
+  /*! \a data_ptr has to point to the first voxel of an image with the characteristics
+      used in set(). */
+  void forward_project(Bin& bin, const float * const data_ptr) const;
+
+  //! back project a single bin
+  /*! \see forward_project() */
+  void back_project(float * const data_ptr, const Bin& bin) const;
+
+private:
+  std::vector<int> offsets;
+  std::vector<float> values;
+};
+
+END_NAMESPACE_STIR
+
+#endif
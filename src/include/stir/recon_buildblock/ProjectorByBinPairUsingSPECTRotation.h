@@ -0,0 +1,82 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Declares class stir::ProjectorByBinPairUsingSPECTRotation
+
+  \author agent
+*/
+#ifndef __stir_recon_buildblock_ProjectorByBinPairUsingSPECTRotation_h_
+#define __stir_recon_buildblock_ProjectorByBinPairUsingSPECTRotation_h_
+
+#include "stir/RegisteredParsingObject.h"
+#include "stir/recon_buildblock/ProjectorByBinPair.h"
+
+START_NAMESPACE_STIR
+
+class SPECTRotationModel;
+/*!
+  \ingroup projection
+  \brief A matrix-free projector pair for SPECT based on image rotation
+
+  The forward and back projectors share the same SPECTRotationModel, such that the
+  back projector is the exact transpose of the forward projector.
+
+  \par Example parameters
+  \verbatim
+  Projector pair type := SPECT Rotation
+    Projector Pair Using SPECT Rotation Parameters:=
+      psf type := 3D
+      collimator sigma 0(cm) := 0.1403
+      collimator slope := 0.0163
+      attenuation map := attMapRec.hv
+    End Projector Pair Using SPECT Rotation Parameters:=
+  \endverbatim
+*/
+class ProjectorByBinPairUsingSPECTRotation :
+  public RegisteredParsingObject<ProjectorByBinPairUsingSPECTRotation,
+                                 ProjectorByBinPair,
+                                 ProjectorByBinPair>
+{
+ private:
+  typedef
+    RegisteredParsingObject<ProjectorByBinPairUsingSPECTRotation,
+                            ProjectorByBinPair,
+                            ProjectorByBinPair>
+    base_type;
+public:
+  //! Name which will be used when parsing a ProjectorByBinPair object
+  static const char * const registered_name;
+
+  //! Default constructor
+  ProjectorByBinPairUsingSPECTRotation();
+
+  //! Constructor that sets the model
+  explicit ProjectorByBinPairUsingSPECTRotation(const shared_ptr<SPECTRotationModel>& model_sptr);
+
+  shared_ptr<SPECTRotationModel> get_model_sptr() const;
+
+  void set_model_sptr(const shared_ptr<SPECTRotationModel>& sptr);
+
+private:
+
+  shared_ptr<SPECTRotationModel> model_sptr;
+  void set_defaults();
+  void initialise_keymap();
+  bool post_processing();
+};
+
+END_NAMESPACE_STIR
+
+
+#endif // __stir_recon_buildblock_ProjectorByBinPairUsingSPECTRotation_h_
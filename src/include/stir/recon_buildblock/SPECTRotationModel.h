@@ -0,0 +1,188 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Declaration of class stir::SPECTRotationModel
+
+  \author agent
+*/
+#ifndef __stir_recon_buildblock_SPECTRotationModel_H__
+#define __stir_recon_buildblock_SPECTRotationModel_H__
+
+#include "stir/DiscretisedDensity.h"
+#include "stir/VectorWithOffset.h"
+#include "stir/shared_ptr.h"
+#include <string>
+#include <vector>
+
+START_NAMESPACE_STIR
+
+class KeyParser;
+class ProjDataInfo;
+class ProjDataInfoCylindricalArcCorr;
+template <typename elemT> class Viewgram;
+template <int num_dimensions, typename elemT> class Array;
+
+/*!
+  \ingroup projection
+  \brief Matrix-free model for parallel-hole SPECT, based on rotating the image for every view
+
+  This class implements forward and back projection of a single viewgram. It is used by
+  stir::ForwardProjectorByBinSPECTRotation and stir::BackProjectorByBinSPECTRotation.
+
+  For every view, the image is resampled (with bilinear interpolation) on a grid aligned with
+  the detector, i.e. with one axis along the tangential direction (sampled at the bin centres)
+  and one along the direction orthogonal to the detector (sampled with the voxel size in x).
+  The resampled image is then multiplied with the attenuation factors (computed from the
+  resampled attenuation map via a cumulative sum towards the detector), convolved with
+  the depth-dependent collimator response and summed along the depth direction.
+  The back projection is the exact transpose of these operations.
+
+  Conventions (e.g. for the geometry and the units of the parameters) are the same as for
+  stir::ProjMatrixByBinSPECTUB, such that the results of the 2 are close. Differences are due
+  to the interpolation of the image (SPECTUB uses the exact footprint of the voxels) and the
+  discretisation of the collimator response. As opposed to SPECTUB, no matrix is stored. This
+  saves a lot of memory when using depth-dependent resolution modelling and/or attenuation,
+  at the expense of recomputing everything for every projection.
+
+  Only data for the stir::ProjDataInfoCylindricalArcCorr geometry with a single segment are
+  supported (as for SPECT), and the image has to have the same number of planes and plane spacing
+  as the projection data.
+
+  The collimator response is modelled as a Gaussian with standard deviation
+  \f[ \sigma(d) = \sigma_0 + s d \f]
+  with \f$d\f$ the distance to the detector (computed from the radius of rotation of every view),
+  \f$\sigma_0\f$ the "collimator sigma 0" and \f$s\f$ the "collimator slope".
+  It is truncated at "maximum number of sigmas".
+
+  \par Example parameters
+  \verbatim
+  ; optional keywords (defaults are as below)
+  psf type := Geometrical ; or 2D or 3D
+  collimator sigma 0(cm) := 0
+  collimator slope := 0
+  maximum number of sigmas := 2
+  ; values in cm^-1
+  attenuation map :=
+  \endverbatim
+
+  \warning All member functions called after set_up() are thread-safe, but the
+  class is not parallelised itself. Parallelisation happens over views in
+  stir::ForwardProjectorByBin::forward_project() and stir::BackProjectorByBin::back_project().
+*/
+class SPECTRotationModel
+{
+ public:
+  //! Default constructor (calls set_defaults())
+  SPECTRotationModel();
+
+  void set_defaults();
+  //! Add the parameters to a parser
+  void add_to_keymap(KeyParser& parser);
+  //! Checks values and reads the attenuation map if set by the parser
+  /*! Return value follows the ParsingObject::post_processing() convention (i.e. \c true on error). */
+  bool post_processing();
+
+  //! Set the collimator response
+  /*! As for ProjMatrixByBinSPECTUB::set_resolution_model(), but the slope is dimensionless and
+    therefore not rescaled. If both arguments are zero, no blurring is used.
+    If \a full_3D is \c false, the blurring is only applied in the tangential direction.
+  */
+  void set_resolution_model(const float collimator_sigma_0_in_mm, const float collimator_slope, const bool full_3D = true);
+
+  //! Set the attenuation image (in cm^-1)
+  /*! Needs to have the same characteristics as the emission image. Can be set to a null pointer
+    to switch off attenuation correction.
+  */
+  void set_attenuation_image_sptr(const shared_ptr<const DiscretisedDensity<3,float> > value);
+  shared_ptr<const DiscretisedDensity<3,float> > get_attenuation_image_sptr() const;
+
+  //! Number of standard deviations at which the Gaussian response is truncated
+  void set_maximum_number_of_sigmas(const float value);
+  float get_maximum_number_of_sigmas() const;
+
+  //! Stores all necessary geometric info
+  /*! Calls error() if the geometry is not supported. */
+  void set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+              const shared_ptr<const DiscretisedDensity<3,float> >& density_info_sptr);
+
+  //! Forward project a single viewgram
+  /*! Only the bins within the specified ranges are overwritten. */
+  void forward_project(Viewgram<float>& viewgram,
+                       const DiscretisedDensity<3,float>& density,
+                       const int min_axial_pos_num, const int max_axial_pos_num,
+                       const int min_tangential_pos_num, const int max_tangential_pos_num) const;
+
+  //! Back project a single viewgram, adding to \a density
+  /*! Only the bins within the specified ranges are used. */
+  void back_project(DiscretisedDensity<3,float>& density,
+                    const Viewgram<float>& viewgram,
+                    const int min_axial_pos_num, const int max_axial_pos_num,
+                    const int min_tangential_pos_num, const int max_tangential_pos_num) const;
+
+ private:
+  //! bilinear interpolation weights for one point in the rotated grid
+  /*! Neighbours outside the image get zero weight (and a valid index). */
+  struct Sample
+  {
+    int x0, x1, y0, y1;
+    float w00, w01, w10, w11; // weights for (y0,x0), (y0,x1), (y1,x0), (y1,x1)
+    bool valid;
+  };
+
+  // parameters
+  std::string psf_type;
+  float collimator_sigma_0; // in cm
+  float collimator_slope;
+  float maximum_number_of_sigmas;
+  std::string attenuation_map;
+  shared_ptr<const DiscretisedDensity<3,float> > attenuation_image_sptr;
+
+  // set by set_up()
+  bool already_set_up;
+  bool do_psf, do_psf_3d;
+  shared_ptr<const ProjDataInfoCylindricalArcCorr> proj_data_info_sptr;
+  shared_ptr<const DiscretisedDensity<3,float> > density_info_sptr;
+  int min_x, max_x, min_y, max_y, min_z, max_z;
+  float voxel_size_x, voxel_size_y, voxel_size_z;
+  float centre_x, centre_y;
+  int min_tangential_pos_num, max_tangential_pos_num, min_axial_pos_num;
+  float bin_size, centre_tangential_pos_num;
+  //! sampling along the direction orthogonal to the detector
+  int num_depth_samples;
+  float depth_sampling, first_depth_sample;
+  //! (intrinsic tilt + view*azimuthal angle sampling), in radians
+  VectorWithOffset<float> angles;
+  //! radius of rotation (mm)
+  VectorWithOffset<float> radii;
+
+  void check_set_up(const DiscretisedDensity<3,float>& density) const;
+  void compute_samples(std::vector<Sample>& samples, const int view_num) const;
+  //! resamples \a density on the rotated grid, indexed as [z][depth_index][tangential_pos_num]
+  void rotate(Array<3,float>& rotated, const DiscretisedDensity<3,float>& density,
+              const std::vector<Sample>& samples) const;
+  //! transpose of rotate(), adding to \a density
+  void rotate_transpose(DiscretisedDensity<3,float>& density, const Array<3,float>& rotated,
+                        const std::vector<Sample>& samples) const;
+  //! computes attenuation factors on the rotated grid, if there is an attenuation image
+  bool compute_attenuation_factors(Array<3,float>& factors, const std::vector<Sample>& samples) const;
+  //! Gaussian kernels in tangential and axial direction for every depth sample
+  /*! An empty kernel means that the depth sample is beyond the detector and should be ignored. */
+  void compute_kernels(std::vector<std::vector<float> >& tangential_kernels,
+                       std::vector<std::vector<float> >& axial_kernels,
+                       const int view_num) const;
+};
+
+END_NAMESPACE_STIR
+
+#endif
@@ -24,8 +24,9 @@
   <i>Integration of advanced 3D SPECT modeling into the open-source STIR framework</i>,
   Med. Phys. 40, 092502 (2013); http://dx.doi.org/10.1118/1.4816676
 
-  \todo Variables wm, wmh and Rrad are currently global variables. This means that this code would be very dangerous
-  in a parallel setting.
+  \todo Variables wm, wmh and Rrad are currently global variables. They are only modified while setting up
+  the matrix. Afterwards, wm_calculation() and wm_size_estimation() only read them, such that
+  different views (i.e. UB-subsets) can be computed in parallel.
 */
 
 namespace SPECTUB {
@@ -40,6 +41,14 @@ namespace SPECTUB {
   extern float * Rrad;  //! radii per view
 
 
+//! computes the weights for all bins in UB-subset \a kOS
+/*! The weights are stored in \a wm, which needs to have allocated \c val, \c col and \c ne
+    arrays (using sizes given by \a NITEMS), as well as \c na, \c nb and \c ns.
+    The image indices \c wm.nx, \c wm.ny and \c wm.nz are not filled in.
+
+    This function does not modify any global variables, and allocates its own work arrays.
+    It can therefore be called from multiple threads for different subsets (with a different \a wm).
+*/
 void wm_calculation( const int kOS,
 					const angle_type *const ang, 
 					voxel_type vox, 
@@ -51,7 +60,8 @@ void wm_calculation( const int kOS,
 					const bool *msk_2d,
 					const int maxszb,
 					const discrf_type *const gaussdens,
-					const int *const  NITEMS
+					const int *const  NITEMS,
+					wm_da_type& wm
 					);
 
 void wm_size_estimation (int kOS,
@@ -53,6 +53,7 @@ const int task_setup_distributable_computation=200;
 const int task_do_distributable_gradient_computation=42;
 const int task_do_distributable_loglikelihood_computation=43;
 const int task_do_distributable_sensitivity_computation=44;
+const int task_do_distributable_gradient_computation_add_sensitivity=45;
 //!@}
 
 //! set-up parameters before calling distributable_computation()
@@ -61,6 +62,10 @@ const int task_do_distributable_sensitivity_computation=44;
     Empty unless STIR_MPI is defined, in which case it sends parameters to the 
     slaves (see stir::DistributedWorker).
 
+    If \a distributed_cache_shared_on_node is \c true (and \a distributed_cache_enabled as well),
+    the workers on the same node store their cache in shared memory. The master then needs
+    to use a DistributedCachingInformation object that knows on which node every worker runs.
+
     \todo currently uses some global variables for configuration in the distributed
     namespace. This needs to be converted to a class, e.g. \c DistributedMaster
 */
@@ -70,7 +75,8 @@ void setup_distributable_computation(
                                      const shared_ptr<const ProjDataInfo> proj_data_info_sptr,
                                      const shared_ptr<const DiscretisedDensity<3,float> >& target_sptr,
                                      const bool zero_seg0_end_planes,
-                                     const bool distributed_cache_enabled);
+                                     const bool distributed_cache_enabled,
+                                     const bool distributed_cache_shared_on_node = false);
 
 //! clean-up after a sequence of computations
 /*! \ingroup distributable
@@ -77,9 +77,11 @@
 #include "stir/Viewgram.h"
 #include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/ProjDataInfo.h"
+#include <vector>
 
 namespace stir {
   class ExamInfo;
+  class ProjDataInMemory;
 }
 
 namespace distributed
@@ -104,6 +106,56 @@ namespace distributed
   extern double total_rpc_time_2;       //!adding up the time used for PRC_process_related_viewgrams_gradient() computation at a single slave
   extern double total_rpc_time_slaves;  //!value to reduce the total_rpc_time values
   extern double min_threshold;          //!threshold for displaying send/receive times, initially set to 0.1 seconds
+
+  //! if \c true, images are only reduced over the bounding box of their non-zero voxels
+  /*! The box is the union over all workers. This reduces the amount of communication when 
+      the images are zero in a large part of the volume, but needs an extra (small) reduction
+      to find the box.
+  */
+  extern bool image_reduction_uses_bounding_box;
+
+  //! communicator between the workers that run on the same node (\c MPI_COMM_NULL for the master)
+  extern MPI_Comm node_comm;
+  //! for every process, the number of the node it runs on (-1 for the master)
+  /*! Nodes are numbered from 0, in the order of the rank of their first worker. */
+  extern std::vector<int> node_nums;
+  //@}
+
+  //----------------------Set-up of communicators----------------------------
+
+  /*! \brief finds out which workers share memory with each other
+   *
+   * Sets \c node_comm and \c node_nums. This is a collective call that has to be made
+   * by all processes after \c MPI_Init().
+   */
+  void set_up_node_communicators();
+
+  /*! \brief allocates projection data that are shared between all workers on the same node
+   * \param[out] win the MPI window that holds the memory
+   * \param exam_info_sptr the ExamInfo of the projection data
+   * \param proj_data_info_sptr the ProjDataInfo of the projection data
+   * \returns a ProjDataInMemory object that uses the shared memory
+   *
+   * This is a collective call over \c node_comm. The memory is allocated only once per
+   * node, such that the workers on the node can re-use each other's cached data.
+   * The window is locked for passive-target access by all workers. After writing to the
+   * memory, a worker has to call \c MPI_Win_sync() before notifying the master. Other workers
+   * have to call \c MPI_Win_sync() before reading.
+   *
+   * The window has to be released with \c free_node_shared_window() after the returned
+   * object is no longer used.
+   */
+  stir::shared_ptr<stir::ProjDataInMemory>
+    create_node_shared_proj_data(MPI_Win& win,
+                                 const stir::shared_ptr<const stir::ExamInfo>& exam_info_sptr,
+                                 const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_sptr);
+
+  /*! \brief releases a window allocated by \c create_node_shared_proj_data()
+   *
+   * This is a collective call over \c node_comm. \a win is set to \c MPI_WIN_NULL.
+   * Nothing is done if \a win is already \c MPI_WIN_NULL.
+   */
+  void free_node_shared_window(MPI_Win& win);
         
         
   //----------------------Send operations----------------------------------
@@ -346,8 +398,8 @@ namespace distributed
    * to construct a ProjDataInfo within a InterfilePDFSHeader using the received 
    * char-array as stream-input to the parse() function of InterfilePDFSHeader. 
    */
-  void receive_and_construct_exam_and_proj_data_info_ptr(stir::shared_ptr<stir::ExamInfo>& exam_info_sptr,
-							 stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_sptr, 
+  void receive_and_construct_exam_and_proj_data_info_ptr(stir::shared_ptr<const stir::ExamInfo>& exam_info_sptr,
+							 stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_sptr, 
 							 int source);
         
         
@@ -373,7 +425,7 @@ namespace distributed
    * a RelatedViewgrams object.  
    */
   void receive_and_construct_related_viewgrams(stir::RelatedViewgrams<float>*& viewgrams, 
-                                               const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr, 
+                                               const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr, 
                                                const stir::shared_ptr<stir::DataSymmetriesForViewSegmentNumbers> symmetries_sptr,
                                                int source);
         
@@ -391,7 +443,7 @@ namespace distributed
    * The viewgram is filled by iterating througn it and copying the values of the received values.
    */
   void receive_and_construct_viewgram(stir::Viewgram<float>*& viewgram, 
-                                      const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr, 
+                                      const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr, 
                                       int source); 
         
   //-----------------------reduce operations-------------------------------------
@@ -399,20 +451,37 @@ namespace distributed
   /*! \brief the function called by the master to reduce the output image
    * \param output_image_ptr the image pointer where the reduced image is saved 
    * \param destination the process id where the output_image is reduced 
+   *
+   * The image is reduced in chunks of planes with non-blocking reductions (\c MPI_Ireduce).
+   * Every chunk is copied into the image as soon as it has arrived, while the other
+   * chunks are still being reduced. The master does not contribute to the sum.
+   *
+   * \see image_reduction_uses_bounding_box
    */
   void reduce_received_output_image(stir::DiscretisedDensity<3,float>* output_image_ptr, int destination);
         
   /*! \brief the function called by the slaves to reduce the output image
    * \param output_image_ptr the image pointer where the reduced image is saved
-   * \param image_buffer_size the buffer size needed for the image 
-   * \param my_rank rank of the slave, only used for screen output
+   * \param image_buffer_size not used
+   * \param my_rank not used
    * \param destination the process id where the output_image is reduced 
    * 
-   * The buffer size was calculated in \c receive_image_values_and_fill_image_ptr().
-   * Alternatively it can be calculated by the image parameters.
+   * This function only starts the reduction (in chunks, see \c reduce_received_output_image())
+   * and returns, such that the slave can continue with the next task while the reduction proceeds.
+   * The values are copied to a buffer first, so \a output_image_ptr can be modified afterwards.
+   * The buffer is re-used by the next call, which therefore waits until the previous
+   * reduction has finished.
+   *
+   * \see wait_for_output_image_reduction()
    */
   void reduce_output_image(stir::shared_ptr<stir::DiscretisedDensity<3,float> > &output_image_ptr, int image_buffer_size, int my_rank, int destination);
 
+  /*! \brief waits until the reduction started by \c reduce_output_image() has finished
+   *
+   * This has to be called by the slaves before \c MPI_Finalize().
+   */
+  void wait_for_output_image_reduction();
+
   /*! \name Tag-names currently used by functions in the distributed namespace
    */
   //!@{
@@ -58,19 +58,19 @@ namespace distributed
   //-----------------------test functions------------------------------------------
 	
 	
-  void test_viewgram_slave(const  stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr);
+  void test_viewgram_slave(const  stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr);
 	
-  void test_viewgram_master(stir::Viewgram<float> viewgram, const  stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr);
+  void test_viewgram_master(stir::Viewgram<float> viewgram, const  stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr);
 	
   void test_image_estimate_master(const stir::DiscretisedDensity<3,float>* input_image_ptr, int slave);
 	
   void test_image_estimate_slave();
 	
-  void test_related_viewgrams_master(const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr, 
+  void test_related_viewgrams_master(const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr, 
 				     const stir::shared_ptr<stir::DataSymmetriesForViewSegmentNumbers> symmetries_sptr,
 				     stir::RelatedViewgrams<float>* y, int slave);
 	
-  void test_related_viewgrams_slave(const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr, 
+  void test_related_viewgrams_slave(const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr, 
 				    const stir::shared_ptr<stir::DataSymmetriesForViewSegmentNumbers> symmetries_sptr
 				    );
 	
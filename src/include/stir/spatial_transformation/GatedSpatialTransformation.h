@@ -22,13 +22,17 @@
 #include "stir/DiscretisedDensity.h"
 #include "stir/spatial_transformation/SpatialTransformation.h"
 #include "stir/numerics/BSplinesRegularGrid.h"
+#include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/RegisteredParsingObject.h"
 #include "stir/Succeeded.h"
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 START_NAMESPACE_STIR
 
+class ImageWarpingWeights;
+
 //! Class for spatial transformations for gated images
 /*!
  \ingroup spatial_transformation
@@ -58,6 +62,13 @@ class GatedSpatialTransformation: public RegisteredParsingObject<GatedSpatialTra
                           const GatedDiscretisedDensity & motion_y, 
                           const GatedDiscretisedDensity & motion_x);
   void set_gate_defs(const TimeGateDefinitions & gate_defs); 
+  //! Set if interpolation weights are precomputed for every gate
+  /*! This makes warping faster when the warp functions are called several times (e.g. during
+      reconstruction), at the expense of memory (6 numbers per voxel per gate for linear interpolation).
+      The weights are computed the first time they are needed. Default is \c false.
+      \see ImageWarpingWeights
+  */
+  void set_precompute_warping_weights(const bool);
   //!@}
 
   //! Warping functions from to gated images. @{
@@ -89,6 +100,14 @@ class GatedSpatialTransformation: public RegisteredParsingObject<GatedSpatialTra
   BSpline::BSplineType _spline_type;
   std::string _time_gate_definition_filename;
   TimeGateDefinitions _gate_defs;
+  bool _precompute_warping_weights;
+  //! precomputed weights for every gate (if \c _precompute_warping_weights is \c true)
+  mutable std::vector<shared_ptr<ImageWarpingWeights> > _warping_weights;
+
+  //! warp an image with the motion field of one gate
+  void warp_gate(VoxelsOnCartesianGrid<float>& out_density,
+                 const BSpline::BSplinesRegularGrid<3,float>& density_interpolation,
+                 const unsigned int gate_num) const;
 };
 
 END_NAMESPACE_STIR
@@ -21,8 +21,21 @@
 #include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/numerics/BSplinesRegularGrid.h"
 
+#include <vector>
+
 START_NAMESPACE_STIR
 
+//! Warp an image with a motion field
+/*!
+ \ingroup spatial_transformation
+ The value of the output at voxel \c c is the B-spline interpolation of the input
+ at \c c plus the motion vector (in mm) at \c c. Voxels that would use data outside the
+ input image are set to 0.
+
+ This computes the B-spline coefficients of the input. If the same image needs to be warped
+ with several motion fields, it is more efficient to compute the coefficients once and
+ use the other overloads.
+*/
 VoxelsOnCartesianGrid<float> 
 warp_image(const shared_ptr<DiscretisedDensity<3,float> > & density_sptr, 
            const shared_ptr<DiscretisedDensity<3,float> > & motion_x_sptr, 
@@ -30,6 +43,68 @@ warp_image(const shared_ptr<DiscretisedDensity<3,float> > & density_sptr,
            const shared_ptr<DiscretisedDensity<3,float> > & motion_z_sptr, 
            const BSpline::BSplineType spline_type, const bool extend_borders);
 
+//! Warp an image with a motion field, given the B-spline interpolator of the input
+/*!
+ \ingroup spatial_transformation
+ \a out_density, the motion fields and the image used to construct \a density_interpolation
+ need to have the same (regular) index range. The grid spacing is taken from \a out_density.
+
+ Planes are computed in parallel when using OpenMP.
+*/
+void
+warp_image(VoxelsOnCartesianGrid<float>& out_density,
+           const BSpline::BSplinesRegularGrid<3,float>& density_interpolation,
+           const DiscretisedDensity<3,float>& motion_x,
+           const DiscretisedDensity<3,float>& motion_y,
+           const DiscretisedDensity<3,float>& motion_z);
+
+//! Precomputed interpolation weights for warping images with a fixed motion field
+/*!
+ \ingroup spatial_transformation
+ For every voxel, the indices of the B-spline coefficients and their weights are
+ computed once in the constructor, such that warping images with the same motion field
+ only needs to compute the weighted sums. This uses <tt>2*3*n</tt> numbers per voxel,
+ with \c n the length of the B-spline kernel (e.g. 2 for linear interpolation).
+
+ Results are the same as for warp_image() up to numerical rounding.
+*/
+class ImageWarpingWeights
+{
+public:
+  //! Compute the weights
+  /*! The motion fields need to be VoxelsOnCartesianGrid (or at least DiscretisedDensityOnCartesianGrid)
+      with the same regular index range. Their grid spacing is used to convert the motion vectors (in mm)
+      to voxel units.
+  */
+  ImageWarpingWeights(const DiscretisedDensity<3,float>& motion_x,
+                      const DiscretisedDensity<3,float>& motion_y,
+                      const DiscretisedDensity<3,float>& motion_z,
+                      const BSpline::BSplineType spline_type);
+
+  //! Warp an image, given its B-spline interpolator
+  /*! \a density_interpolation has to use the spline type passed to the constructor.
+      \a out_density and the image used for \a density_interpolation need to have the same
+      index range as the motion fields.
+
+      Planes are computed in parallel when using OpenMP.
+  */
+  void warp(VoxelsOnCartesianGrid<float>& out_density,
+            const BSpline::BSplinesRegularGrid<3,float>& density_interpolation) const;
+
+private:
+  BasicCoordinate<3,int> min_indices;
+  BasicCoordinate<3,int> max_indices;
+  //! number of coefficients per dimension
+  int kernel_length;
+  //! for every voxel, 1 if it needs to be computed, 0 if the output is zero
+  /*! (not a \c std::vector<bool> such that elements can be set by different threads) */
+  std::vector<unsigned char> inside;
+  //! for every voxel and dimension, the \c kernel_length indices of the coefficients
+  std::vector<int> indices;
+  //! for every voxel and dimension, the \c kernel_length weights of the coefficients
+  std::vector<float> weights;
+};
+
 END_NAMESPACE_STIR
 
 #endif
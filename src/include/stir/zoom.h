@@ -25,7 +25,9 @@
 
   These functions can be used for zooming of projection data or image data.
   Zooming requires interpolation. Currently, this is done using 
-  stir::overlap_interpolate.
+  stir::overlap_interpolate. For images, the interpolation weights are computed
+  once for every dimension and then applied to all rows and planes (in parallel
+  if OpenMP is enabled).
   
   The first set of functions allows zooming and translation in transaxial
   planes only. These parameters are the same for projection data or image data.
@@ -45,12 +45,17 @@
 #include "stir/stream.h"
 #include "stir/info.h"
 #include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/FNV1aHash.h"
 
 //#include "stir/modelling/ParametricDiscretisedDensity.h"
 //#include "stir/modelling/KineticParameters.h"
 
 #include <memory>
 #include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <random>
 
 #ifdef STIR_OPENMP
 #include <omp.h>
@@ -94,6 +99,8 @@ inline unsigned int ravel_index(int x, int y, int z,
       }
 
 
+const char * const kernel_matrix_cache_magic = "STIR KOSMAPOSL anatomical kernel matrix v1\n";
+
 inline double gaussian_kernel_already_sq(double distance_sq) {
   // std::cout << "gaussian_kernel(" << distance_sq << ", " << sigma << ")" << std::endl;
   return exp(-distance_sq );
@@ -160,6 +167,7 @@ set_defaults()
   this->kernelised_output_filename_prefix="";
   this->hybrid=0;
   this->freeze_iterative_kernel_at_subiter_num=-1;
+  this->kernel_matrix_cache_directory="";
 }
 
 template <typename TargetT>
@@ -183,6 +191,7 @@ initialise_keymap()
   this->parser.add_key("anatomical image filenames", &anatomical_image_filenames);
   this->parser.add_key("kernelised output filename prefix",&this->kernelised_output_filename_prefix);
   this->parser.add_key("freeze iterative kernel at subiteration number",&this->freeze_iterative_kernel_at_subiter_num);
+  this->parser.add_key("kernel matrix cache directory",&this->kernel_matrix_cache_directory);
 }
 
 
@@ -307,25 +316,12 @@ set_up(shared_ptr <TargetT > const& target_image_sptr)
      precalculate_patch_euclidean_distances(distance,num_neighbours, only_2D, grid_spacing);
    
        if(num_non_zero_feat>1){
-            this->kmnorm_sptrs.resize(anatomical_sd.size());
-            for(unsigned int i = 0; i < this->anatomical_prior_sptrs.size(); i++){
-              this->kmnorm_sptrs[i].reset(target_image_sptr->get_empty_copy ());
-              this->kmnorm_sptrs[i]->resize(IndexRange3D(0,0,0,this->num_voxels-1,0,this->num_elem_neighbourhood-1));
-              }
-            
             this->kpnorm_sptr= shared_ptr<TargetT>(target_image_sptr->get_empty_copy ());
             this->kpnorm_sptr->resize(IndexRange3D(0,0,0,this->num_voxels-1,0,this->num_elem_neighbourhood-1));
-            
-            int dimf_col = this->num_non_zero_feat-1;
-            int dimf_row=this->num_voxels;
-            
-            if (this->anatomical_prior_sptrs.size()!=0){
-                calculate_norm_const_matrix(this->kmnorm_sptrs,
-                                            dimf_row,
-                                            dimf_col);
-            }
        }
 
+  set_up_kernel_matrix(*target_image_sptr);
+
   this->_already_set_up = true;
    
   return Succeeded::yes;
@@ -407,6 +403,18 @@ KOSMAPOSLReconstruction<TargetT>::
 get_freeze_iterative_kernel_at_subiter_num() const
 { return this->freeze_iterative_kernel_at_subiter_num; }
 
+template <typename TargetT>
+const std::string
+KOSMAPOSLReconstruction<TargetT>::
+get_kernel_matrix_cache_directory() const
+{ return this->kernel_matrix_cache_directory; }
+
+template <typename TargetT>
+const std::string
+KOSMAPOSLReconstruction<TargetT>::
+get_kernel_matrix_cache_filename() const
+{ return this->kernel_matrix_cache_filename; }
+
 
 /***************************************************************
   set_ functions
@@ -550,6 +558,23 @@ set_freeze_iterative_kernel_at_subiter_num(const int arg)
   this->freeze_iterative_kernel_at_subiter_num = arg;
 }
 
+template <typename TargetT>
+void
+KOSMAPOSLReconstruction<TargetT>::
+set_kernel_matrix_cache_directory(const std::string& arg)
+{
+  this->_already_set_up = false;
+  this->kernel_matrix_cache_directory = arg;
+}
+
+template <typename TargetT>
+void
+KOSMAPOSLReconstruction<TargetT>::
+set_kernelised_output_filename_prefix(const std::string& arg)
+{
+  this->kernelised_output_filename_prefix = arg;
+}
+
 /***************************************************************/
 // Here start the definition of few functions that calculate the SD of the anatomical image, a norm matrix and
 // finally the Kernelised image
@@ -568,6 +593,8 @@ calculate_norm_matrix(TargetT &normp,
 //  int l=0,m=0;
 
   fp = Array<2,float>(IndexRange2D(0,dimf_row,0,dimf_col));
+  // the norms are accumulated below, so start from zero
+  normp.fill(0.F);
 
   const int min_z = min_ind[1];
   const int max_z = max_ind[1];
@@ -758,129 +785,338 @@ void KOSMAPOSLReconstruction<TargetT>::estimate_stand_dev_for_anatomical_image(s
 }
 
 template<typename TargetT>
-void KOSMAPOSLReconstruction<TargetT>::compute_kernelised_image(
-                         TargetT& kernelised_image_out,
-                         const TargetT& image_to_kernelise,
-                         const TargetT& current_alpha_estimate)
+boost::uint64_t KOSMAPOSLReconstruction<TargetT>::
+compute_anatomical_kernel_hash(const TargetT& target_image) const
 {
-
-    for(unsigned int i=0; i < this->anatomical_prior_sptrs.size();i++){
-    if(!current_alpha_estimate.has_same_characteristics(*this->anatomical_prior_sptrs[i]))
-        error("anatomical and emission image have different sizes! Make sure they are the same");
+  FNV1aHash hash;
+  hash.add_bytes(kernel_matrix_cache_magic, std::strlen(kernel_matrix_cache_magic));
+  hash.add(this->min_ind);
+  hash.add(this->max_ind);
+  hash.add(this->num_neighbours);
+  hash.add(this->num_non_zero_feat);
+  const int only_2D_int = this->only_2D ? 1 : 0;
+  hash.add(only_2D_int);
+  hash.add(this->sigma_dm);
+  const DiscretisedDensityOnCartesianGrid<3,float>* target_cast =
+    dynamic_cast< const DiscretisedDensityOnCartesianGrid<3,float> *>(&target_image);
+  if (target_cast != 0)
+    {
+      const CartesianCoordinate3D<float> grid_spacing = target_cast->get_grid_spacing();
+      hash.add(grid_spacing.z());
+      hash.add(grid_spacing.y());
+      hash.add(grid_spacing.x());
     }
+  for (unsigned int i=0; i < this->anatomical_prior_sptrs.size(); ++i)
+    {
+      hash.add(this->sigma_m[i]);
+      for (typename TargetT::const_full_iterator iter = this->anatomical_prior_sptrs[i]->begin_all_const();
+           iter != this->anatomical_prior_sptrs[i]->end_all_const();
+           ++iter)
+        {
+          const float value = *iter;
+          hash.add(value);
+        }
+    }
+  return hash.get_value();
+}
 
-    bool use_compact_implementation = this->num_non_zero_feat == 1;
-
-    // Something very weird happens here if I do not get_empty_copy()
-    // KImage elements will be all nan
+template<typename TargetT>
+void KOSMAPOSLReconstruction<TargetT>::
+set_up_kernel_matrix(const TargetT& target_image)
+{
+  const int min_z = min_ind[1];
+  const int max_z = max_ind[1];
+  const int min_y = min_ind[2];
+  const int max_y = max_ind[2];
+  const int min_x = min_ind[3];
+  const int max_x = max_ind[3];
 
-    unique_ptr<TargetT> kImage_uptr(current_alpha_estimate.get_empty_copy());
+  // offsets of the patch elements
+  const int patch_size_y = distance[0].get_length();
+  const int patch_size_x = distance[0][0].get_length();
+  if (distance.size_all() > 65536)
+    error("KOSMAPOSL: number of neighbours is too large");
+  this->patch_ravelled_offsets.resize(distance.size_all());
+  for (int dz=distance.get_min_index(); dz<=distance.get_max_index(); ++dz)
+    for (int dy=distance[0].get_min_index(); dy<=distance[0].get_max_index(); ++dy)
+      for (int dx=distance[0][0].get_min_index(); dx<=distance[0][0].get_max_index(); ++dx)
+        {
+          const int p = ((dz-distance.get_min_index())*patch_size_y + (dy-distance[0].get_min_index()))*patch_size_x
+            + (dx-distance[0][0].get_min_index());
+          this->patch_ravelled_offsets[p] = (dz*this->dimy + dy)*this->dimx + dx;
+        }
 
-    if (!use_compact_implementation && this->get_hybrid()) {
-      // Going to need the full emission regional normalised differences
-      int dimf_row = this->num_voxels;
-      int dimf_col = this->num_non_zero_feat-1;
-      
-      if(still_updating_iterative_kernel()) 
-      calculate_norm_matrix(*this->kpnorm_sptr, dimf_row, dimf_col,
-                          current_alpha_estimate);
+  // sparsity pattern: all neighbours in the patch that are inside the image
+  this->kernel_row_starts.resize(this->num_voxels+1);
+  this->kernel_row_starts[0] = 0;
+  for (int z=min_z; z<=max_z; z++)
+    for (int y=min_y; y<= max_y; y++)
+      for (int x=min_x; x<= max_x; x++)
+        {
+          const int min_dz = max(distance.get_min_index(), min_z-z);
+          const int max_dz = min(distance.get_max_index(), max_z-z);
+          const int min_dy = max(distance[0].get_min_index(), min_y-y);
+          const int max_dy = min(distance[0].get_max_index(), max_y-y);
+          const int min_dx = max(distance[0][0].get_min_index(), min_x-x);
+          const int max_dx = min(distance[0][0].get_max_index(), max_x-x);
+          const int row = ravel_index(x, y, z, min_x, min_y, min_z, max_x, max_y, max_z);
+          this->kernel_row_starts[row+1] = this->kernel_row_starts[row] +
+            (max_dz-min_dz+1)*(max_dy-min_dy+1)*(max_dx-min_dx+1);
+        }
+  const std::size_t num_non_zeros = this->kernel_row_starts[this->num_voxels];
+  this->kernel_patch_indices.resize(num_non_zeros);
+  this->anatomical_kernel_values.resize(num_non_zeros);
+  this->kernel_values.clear();
+  this->kernel_row_sums.clear();
+  this->kernel_values_image_sptr.reset();
+
+  // try to read the anatomical part from the cache
+  this->kernel_matrix_cache_filename = "";
+  bool read_from_cache = false;
+  boost::uint64_t hash = 0;
+  if (!this->kernel_matrix_cache_directory.empty() && this->anatomical_prior_sptrs.size()!=0)
+    {
+      hash = compute_anatomical_kernel_hash(target_image);
+      this->kernel_matrix_cache_filename =
+        (boost::format("%1%/KOSMAPOSL_kernel_%2$016x.bin") % this->kernel_matrix_cache_directory % hash).str();
+      std::ifstream cache(this->kernel_matrix_cache_filename.c_str(), std::ios::binary);
+      if (cache)
+        {
+          std::string magic(std::strlen(kernel_matrix_cache_magic), ' ');
+          boost::uint64_t hash_in = 0, num_non_zeros_in = 0;
+          cache.read(&magic[0], magic.size());
+          cache.read(reinterpret_cast<char *>(&hash_in), sizeof(hash_in));
+          cache.read(reinterpret_cast<char *>(&num_non_zeros_in), sizeof(num_non_zeros_in));
+          if (cache && magic == kernel_matrix_cache_magic && hash_in == hash && num_non_zeros_in == num_non_zeros)
+            {
+              cache.read(reinterpret_cast<char *>(&this->anatomical_kernel_values[0]), num_non_zeros*sizeof(float));
+              read_from_cache = !!cache;
+            }
+          if (read_from_cache)
+            info(boost::format("KOSMAPOSL: anatomical kernel matrix read from '%1%'") % this->kernel_matrix_cache_filename);
+          else
+            warning(boost::format("KOSMAPOSL: kernel matrix cache '%1%' is invalid. Recomputing") % this->kernel_matrix_cache_filename);
+        }
     }
 
+  if(!read_from_cache && num_non_zero_feat>1 && this->anatomical_prior_sptrs.size()!=0)
+    {
+      this->kmnorm_sptrs.resize(anatomical_sd.size());
+      for(unsigned int i = 0; i < this->anatomical_prior_sptrs.size(); i++){
+        this->kmnorm_sptrs[i].reset(target_image.get_empty_copy ());
+        this->kmnorm_sptrs[i]->resize(IndexRange3D(0,0,0,this->num_voxels-1,0,this->num_elem_neighbourhood-1));
+      }
+      const int dimf_col = this->num_non_zero_feat-1;
+      const int dimf_row=this->num_voxels;
+      calculate_norm_const_matrix(this->kmnorm_sptrs,
+                                  dimf_row,
+                                  dimf_col);
+    }
 
-      //     calculate kernelised image
-    int min_z, max_z, min_y, max_y, min_x, max_x;
+  const bool use_compact_implementation = this->num_non_zero_feat == 1;
 
-    min_z = current_alpha_estimate.get_min_index();
-    max_z = current_alpha_estimate.get_max_index();
-    min_y = current_alpha_estimate[min_z].get_min_index();
-    max_y = current_alpha_estimate[min_z].get_max_index();
-    min_x = current_alpha_estimate[min_z][min_y].get_min_index();
-    max_x = current_alpha_estimate[min_z][min_y].get_max_index();
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z=min_z; z<=max_z; z++)
+    for (int y=min_y; y<= max_y; y++)
+      for (int x=min_x; x<= max_x; x++)
+        {
+          const int min_dz = max(distance.get_min_index(), min_z-z);
+          const int max_dz = min(distance.get_max_index(), max_z-z);
+          const int min_dy = max(distance[0].get_min_index(), min_y-y);
+          const int max_dy = min(distance[0].get_max_index(), max_y-y);
+          const int min_dx = max(distance[0][0].get_min_index(), min_x-x);
+          const int max_dx = min(distance[0][0].get_max_index(), max_x-x);
+          const int current_ravelled_idx
+            = ravel_index(x, y, z, min_x, min_y, min_z, max_x, max_y, max_z);
+          std::size_t k = this->kernel_row_starts[current_ravelled_idx];
+
+          for (int dz=min_dz; dz<=max_dz; ++dz)
+            for (int dy=min_dy; dy<=max_dy; ++dy)
+              for (int dx=min_dx; dx<=max_dx; ++dx, ++k)
+                {
+                  this->kernel_patch_indices[k] = static_cast<std::uint16_t>(
+                    ((dz-distance.get_min_index())*patch_size_y + (dy-distance[0].get_min_index()))*patch_size_x
+                    + (dx-distance[0][0].get_min_index()));
+                  if (read_from_cache)
+                    continue;
 
-        // Iterate over the image
+                  const int delta_ravelled_idx
+                    = ravel_index(dx, dy, dz, min_dx, min_dy, min_dz, max_dx, max_dy, max_dz);
+                  double anatomical_kernel=1;
+                  for(unsigned int i=0; i < this->anatomical_prior_sptrs.size();i++){
+                    anatomical_kernel = anatomical_kernel * calc_anatomical_kernel((*anatomical_prior_sptrs[i])[z][y][x],
+                                                                                   (*anatomical_prior_sptrs[i])[z+dz][y+dy][x+dx],
+                                                                                   distance[dz][dy][dx],
+                                                                                   use_compact_implementation,
+                                                                                   current_ravelled_idx,
+                                                                                   delta_ravelled_idx,
+                                                                                   i);
+                  }
+                  this->anatomical_kernel_values[k] = static_cast<float>(anatomical_kernel);
+                }
+        }
 
+  // the norm matrices are no longer needed
+  this->kmnorm_sptrs.clear();
 
-#ifdef STIR_OPENMP
-#  if _OPENMP <201107
-                      #pragma omp parallel for
-#  else
-                      #pragma omp parallel for collapse(3) schedule(dynamic)
-#  endif
-#endif
-    for (int z=min_z; z<=max_z; z++) {
-        for (int y=min_y; y<= max_y; y++) {
-            for (int x=min_x; x<= max_x; x++) {
-                const int min_dz = max(distance.get_min_index(), min_z-z);
-                const int max_dz = min(distance.get_max_index(), max_z-z);
-                const int min_dy = max(distance[0].get_min_index(), min_y-y);
-                const int max_dy = min(distance[0].get_max_index(), max_y-y);
-                const int min_dx = max(distance[0][0].get_min_index(), min_x-x);
-                const int max_dx = min(distance[0][0].get_max_index(), max_x-x);
-
-              // Iterate over the kernel patch, centered at the current voxel
-
-              double kernel_sum = 0;
-
-              for (int dz=min_dz; dz<=max_dz; ++dz) {
-                for (int dy=min_dy; dy<=max_dy; ++dy) {
-                  for (int dx=min_dx; dx<=max_dx; ++dx) {
-
-                      const int current_ravelled_idx
-                        = ravel_index(x, y, z, min_x, min_y, min_z, max_x, max_y, max_z);
-                      const int delta_ravelled_idx
-                        = ravel_index(dx, dy, dz, min_dx, min_dy, min_dz, max_dx, max_dy, max_dz);
-
-//                     std::cout << "d " <<z<<" "<<y<<" "<<x<< std::endl;
-                    // Calculate the emission kernel
-                    double emission_kernel;
-                    if (get_hybrid()) {
-                      if(current_alpha_estimate[z][y][x]==0){
-                        continue;
-                      }
+  if (!read_from_cache && !this->kernel_matrix_cache_filename.empty())
+    {
+      // write to a temporary file first and rename it afterwards, such that
+      // other processes never see an incomplete file
+      std::random_device random_device;
+      const std::string tmp_filename =
+        (boost::format("%1%.tmp%2$08x") % this->kernel_matrix_cache_filename % random_device()).str();
+      bool written;
+      {
+        std::ofstream cache(tmp_filename.c_str(), std::ios::binary);
+        const boost::uint64_t num_non_zeros_out = num_non_zeros;
+        cache.write(kernel_matrix_cache_magic, std::strlen(kernel_matrix_cache_magic));
+        cache.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+        cache.write(reinterpret_cast<const char *>(&num_non_zeros_out), sizeof(num_non_zeros_out));
+        cache.write(reinterpret_cast<const char *>(&this->anatomical_kernel_values[0]), num_non_zeros*sizeof(float));
+        cache.close();
+        written = !!cache;
+      }
+      if (written && std::rename(tmp_filename.c_str(), this->kernel_matrix_cache_filename.c_str()) != 0)
+        {
+          // rename() does not overwrite an existing (invalid) file on all systems
+          std::remove(this->kernel_matrix_cache_filename.c_str());
+          written = std::rename(tmp_filename.c_str(), this->kernel_matrix_cache_filename.c_str()) == 0;
+        }
+      if (written)
+        info(boost::format("KOSMAPOSL: anatomical kernel matrix written to '%1%'") % this->kernel_matrix_cache_filename);
+      else
+        {
+          std::remove(tmp_filename.c_str());
+          warning(boost::format("KOSMAPOSL: could not write kernel matrix cache '%1%'") % this->kernel_matrix_cache_filename);
+        }
+    }
+}
 
-                      emission_kernel = calc_emission_kernel(current_alpha_estimate[z][y][x],
-                                                   current_alpha_estimate[z+dz][y+dy][x+dx],
-                                                   distance[dz][dy][dx],
-                                                   use_compact_implementation,
-                                                   current_ravelled_idx,
-                                                   delta_ravelled_idx);
-                                    }
-                                    else {
-                                      emission_kernel = 1;
-                                    }
-                    // Calculate the anatomical kernel
-                     double anatomical_kernel=1;
-                     
-                    for(unsigned int i=0; i < this->anatomical_prior_sptrs.size();i++){
-                         anatomical_kernel = anatomical_kernel * calc_anatomical_kernel((*anatomical_prior_sptrs[i])[z][y][x],
-                                                                     (*anatomical_prior_sptrs[i])[z+dz][y+dy][x+dx],
-                                                                      distance[dz][dy][dx],
-                                                                      use_compact_implementation,
-                                                                      current_ravelled_idx,
-                                                                      delta_ravelled_idx,
-                                                                      i);
-                    }
+template<typename TargetT>
+void KOSMAPOSLReconstruction<TargetT>::
+update_kernel_values(const shared_ptr<const TargetT>& iterative_kernel_image_sptr)
+{
+  // without hybrid kernel, the kernel matrix does not depend on the image
+  if (!this->kernel_values.empty() &&
+      (!this->get_hybrid() || this->kernel_values_image_sptr == iterative_kernel_image_sptr))
+    return;
 
-                       const double kernel = anatomical_kernel * emission_kernel;
+  const TargetT& current_alpha_estimate = *iterative_kernel_image_sptr;
+  for(unsigned int i=0; i < this->anatomical_prior_sptrs.size();i++){
+    if(!current_alpha_estimate.has_same_characteristics(*this->anatomical_prior_sptrs[i]))
+      error("anatomical and emission image have different sizes! Make sure they are the same");
+  }
 
-                       kernelised_image_out[z][y][x]
-                       += kernel * image_to_kernelise[z+dz][y+dy][x+dx];
-                       kernel_sum += kernel;
-                                    }
-                                 }
-                              }
+  const bool use_compact_implementation = this->num_non_zero_feat == 1;
 
-              if (current_alpha_estimate[z][y][x] == 0) {
-                continue;
+  if (!use_compact_implementation && this->get_hybrid()) {
+    // Going to need the full emission regional normalised differences
+    const int dimf_row = this->num_voxels;
+    const int dimf_col = this->num_non_zero_feat-1;
+    calculate_norm_matrix(*this->kpnorm_sptr, dimf_row, dimf_col,
+                          current_alpha_estimate);
+  }
 
-              }
+  const int min_z = min_ind[1];
+  const int max_z = max_ind[1];
+  const int min_y = min_ind[2];
+  const int max_y = max_ind[2];
+  const int min_x = min_ind[3];
+  const int max_x = max_ind[3];
 
+  this->kernel_values.resize(this->anatomical_kernel_values.size());
+  this->kernel_row_sums.resize(this->num_voxels);
 
-                      kernelised_image_out[z][y][x] /= kernel_sum;
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z=min_z; z<=max_z; z++)
+    for (int y=min_y; y<= max_y; y++)
+      for (int x=min_x; x<= max_x; x++)
+        {
+          const int min_dz = max(distance.get_min_index(), min_z-z);
+          const int max_dz = min(distance.get_max_index(), max_z-z);
+          const int min_dy = max(distance[0].get_min_index(), min_y-y);
+          const int max_dy = min(distance[0].get_max_index(), max_y-y);
+          const int min_dx = max(distance[0][0].get_min_index(), min_x-x);
+          const int max_dx = min(distance[0][0].get_max_index(), max_x-x);
+          const int current_ravelled_idx
+            = ravel_index(x, y, z, min_x, min_y, min_z, max_x, max_y, max_z);
+          std::size_t k = this->kernel_row_starts[current_ravelled_idx];
+          double kernel_sum = 0;
+
+          for (int dz=min_dz; dz<=max_dz; ++dz)
+            for (int dy=min_dy; dy<=max_dy; ++dy)
+              for (int dx=min_dx; dx<=max_dx; ++dx, ++k)
+                {
+                  double emission_kernel = 1;
+                  if (get_hybrid()) {
+                    if (current_alpha_estimate[z][y][x]==0) {
+                      // no contribution for this voxel
+                      this->kernel_values[k] = 0;
+                      continue;
                     }
+                    const int delta_ravelled_idx
+                      = ravel_index(dx, dy, dz, min_dx, min_dy, min_dz, max_dx, max_dy, max_dz);
+                    emission_kernel = calc_emission_kernel(current_alpha_estimate[z][y][x],
+                                                           current_alpha_estimate[z+dz][y+dy][x+dx],
+                                                           distance[dz][dy][dx],
+                                                           use_compact_implementation,
+                                                           current_ravelled_idx,
+                                                           delta_ravelled_idx);
                   }
-    }
-    }
+                  const double kernel = this->anatomical_kernel_values[k] * emission_kernel;
+                  this->kernel_values[k] = static_cast<float>(kernel);
+                  kernel_sum += kernel;
+                }
+          this->kernel_row_sums[current_ravelled_idx] = kernel_sum;
+        }
+  this->kernel_values_image_sptr = iterative_kernel_image_sptr;
+}
+
+template<typename TargetT>
+void KOSMAPOSLReconstruction<TargetT>::compute_kernelised_image(
+                         TargetT& kernelised_image_out,
+                         const TargetT& image_to_kernelise,
+                         const TargetT& current_alpha_estimate) const
+{
+  assert(!this->kernel_values.empty());
+
+  const int min_z = min_ind[1];
+  const int max_z = max_ind[1];
+  const int min_y = min_ind[2];
+  const int max_y = max_ind[2];
+  const int min_x = min_ind[3];
+  const int max_x = max_ind[3];
+
+  // copy to a contiguous array for fast access by ravelled index
+  std::vector<float> image_to_kernelise_ravelled(this->num_voxels);
+  std::copy(image_to_kernelise.begin_all_const(), image_to_kernelise.end_all_const(),
+            image_to_kernelise_ravelled.begin());
+
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int z=min_z; z<=max_z; z++)
+    for (int y=min_y; y<= max_y; y++)
+      {
+        int row = ravel_index(min_x, y, z, min_x, min_y, min_z, max_x, max_y, max_z);
+        for (int x=min_x; x<= max_x; x++, row++)
+          {
+            double sum = 0;
+            for (std::size_t k = this->kernel_row_starts[row]; k < this->kernel_row_starts[row+1]; ++k)
+              sum += this->kernel_values[k] *
+                image_to_kernelise_ravelled[row + this->patch_ravelled_offsets[this->kernel_patch_indices[k]]];
+            // normalise rows of the kernel (but not for voxels where the iterative kernel image is zero)
+            if (current_alpha_estimate[z][y][x] != 0)
+              sum /= this->kernel_row_sums[row];
+            kernelised_image_out[z][y][x] = static_cast<float>(sum);
+          }
+      }
+}
 
 template <typename TargetT>
 double
@@ -1010,6 +1246,9 @@ update_estimate(TargetT &current_alpha_coefficent_image)
   else
       iterative_kernel_image_sptr=this->iterative_kernel_image_frozen_sptr;
   
+  // compute the kernel matrix once for this subiteration (if it changed)
+  update_kernel_values(iterative_kernel_image_sptr);
+
   unique_ptr< TargetT > current_update_image_ptr(current_alpha_coefficent_image.get_empty_copy());
   compute_kernelised_image(*current_update_image_ptr, current_alpha_coefficent_image, *iterative_kernel_image_sptr);
 
@@ -34,7 +34,6 @@
 #include "stir/ThresholdMinToSmallPositiveValueDataProcessor.h"
 #include "stir/ChainedDataProcessor.h"
 #include "stir/Succeeded.h"
-#include "stir/numerics/divide.h"
 #include "stir/thresholding.h"
 #include "stir/is_null_ptr.h"
 #include "stir/NumericInfo.h"
@@ -58,6 +57,12 @@
 
 #include "stir/unique_ptr.h"
 #include <algorithm>
+#include <vector>
+#include <limits>
+#include <cmath>
+#ifdef STIR_OPENMP
+#include <omp.h>
+#endif
 using std::min;
 using std::max;
 #ifndef STIR_NO_NAMESPACES
@@ -68,6 +73,185 @@ using std::endl;
 
 START_NAMESPACE_STIR
 
+namespace { // private namespace for the (fused) voxel-wise passes of update_estimate
+
+//! how the denominator of the multiplicative update is formed
+enum DenominatorType { sensitivity_only, additive_MAP, multiplicative_MAP };
+
+/* Voxel-wise kernels working on a range of full iterators.
+
+   They implement exactly the same floating point operations as the (separate)
+   loops that were previously used (i.e. combination with the prior gradient,
+   stir::divide, min/max finding and stir::threshold_upper_lower) such that
+   results are identical.
+*/
+template <class IterT, class ConstIterT>
+inline void
+divide_by_denominator_in_range(IterT update_iter, const IterT update_end,
+                               ConstIterT prior_gradient_iter,
+                               ConstIterT sensitivity_iter,
+                               const DenominatorType denominator_type,
+                               const float num_subsets,
+                               const float small_value,
+                               const bool do_threshold,
+                               const float new_min, const float new_max,
+                               float& current_min, float& current_max)
+{
+  current_min = std::numeric_limits<float>::max();
+  current_max = -std::numeric_limits<float>::max();
+  for (; update_iter != update_end; ++update_iter, ++prior_gradient_iter, ++sensitivity_iter)
+    {
+      const float sensitivity = *sensitivity_iter;
+      float denominator;
+      switch (denominator_type)
+        {
+        case additive_MAP:
+          denominator = *prior_gradient_iter/num_subsets + sensitivity;
+          denominator = std::max(std::min(denominator, sensitivity*10), sensitivity/10);
+          break;
+        case multiplicative_MAP:
+          denominator = *prior_gradient_iter + 1;
+          denominator = std::max(std::min(denominator, 10.F), 1/10.F);
+          denominator *= sensitivity;
+          break;
+        default:
+          denominator = sensitivity;
+          break;
+        }
+
+      float update = *update_iter;
+      if (std::fabs(denominator)<=small_value && std::fabs(update)<=small_value)
+        update = 0;
+      else
+        update /= denominator;
+
+      if (update < current_min)
+        current_min = update;
+      if (update > current_max)
+        current_max = update;
+
+      if (do_threshold)
+        {
+          if (update > new_max)
+            update = new_max;
+          else if (new_min > update)
+            update = new_min;
+        }
+      *update_iter = update;
+    }
+}
+
+template <class IterT, class ConstIterT>
+inline void
+multiply_in_range(IterT image_iter, const IterT image_end, ConstIterT update_iter)
+{
+  for (; image_iter != image_end; ++image_iter, ++update_iter)
+    *image_iter *= *update_iter;
+}
+
+/* Drivers for the above kernels. The generic versions run over the whole image.
+   The overloads for DiscretisedDensity<3,float> distribute the planes over threads
+   (when using OpenMP). Per-plane reductions are combined serially afterwards
+   such that results do not depend on the number of threads.
+*/
+template <class TargetT>
+float
+find_max(const TargetT& image)
+{
+  return *std::max_element(image.begin_all_const(), image.end_all_const());
+}
+
+float
+find_max(const DiscretisedDensity<3,float>& image)
+{
+  const int min_z = image.get_min_index();
+  const int max_z = image.get_max_index();
+  std::vector<float> plane_maxs(max_z - min_z + 1);
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int z=min_z; z<=max_z; ++z)
+    plane_maxs[z-min_z] = *std::max_element(image[z].begin_all_const(), image[z].end_all_const());
+  return *std::max_element(plane_maxs.begin(), plane_maxs.end());
+}
+
+template <class TargetT>
+void
+divide_by_denominator(TargetT& update, const TargetT& prior_gradient, const TargetT& sensitivity,
+                      const DenominatorType denominator_type, const float num_subsets,
+                      const float small_value,
+                      const bool do_threshold, const float new_min, const float new_max,
+                      float& current_min, float& current_max)
+{
+  divide_by_denominator_in_range(update.begin_all(), update.end_all(),
+                                 prior_gradient.begin_all_const(), sensitivity.begin_all_const(),
+                                 denominator_type, num_subsets, small_value,
+                                 do_threshold, new_min, new_max,
+                                 current_min, current_max);
+}
+
+void
+divide_by_denominator(DiscretisedDensity<3,float>& update,
+                      const DiscretisedDensity<3,float>& prior_gradient,
+                      const DiscretisedDensity<3,float>& sensitivity,
+                      const DenominatorType denominator_type, const float num_subsets,
+                      const float small_value,
+                      const bool do_threshold, const float new_min, const float new_max,
+                      float& current_min, float& current_max)
+{
+  const int min_z = update.get_min_index();
+  const int max_z = update.get_max_index();
+  std::vector<float> plane_mins(max_z - min_z + 1);
+  std::vector<float> plane_maxs(max_z - min_z + 1);
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int z=min_z; z<=max_z; ++z)
+    divide_by_denominator_in_range(update[z].begin_all(), update[z].end_all(),
+                                   prior_gradient[z].begin_all_const(), sensitivity[z].begin_all_const(),
+                                   denominator_type, num_subsets, small_value,
+                                   do_threshold, new_min, new_max,
+                                   plane_mins[z-min_z], plane_maxs[z-min_z]);
+  current_min = *std::min_element(plane_mins.begin(), plane_mins.end());
+  current_max = *std::max_element(plane_maxs.begin(), plane_maxs.end());
+}
+
+template <class TargetT>
+void
+threshold_update(TargetT& update, const float new_min, const float new_max)
+{
+  threshold_upper_lower(update.begin_all(), update.end_all(), new_min, new_max);
+}
+
+void
+threshold_update(DiscretisedDensity<3,float>& update, const float new_min, const float new_max)
+{
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int z=update.get_min_index(); z<=update.get_max_index(); ++z)
+    threshold_upper_lower(update[z].begin_all(), update[z].end_all(), new_min, new_max);
+}
+
+template <class TargetT>
+void
+multiply_image(TargetT& image, const TargetT& update)
+{
+  multiply_in_range(image.begin_all(), image.end_all(), update.begin_all_const());
+}
+
+void
+multiply_image(DiscretisedDensity<3,float>& image, const DiscretisedDensity<3,float>& update)
+{
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int z=image.get_min_index(); z<=image.get_max_index(); ++z)
+    multiply_in_range(image[z].begin_all(), image[z].end_all(), update[z].begin_all_const());
+}
+
+} // end of private namespace
+
 template <typename TargetT>
 const char * const
 OSMAPOSLReconstruction <TargetT> ::registered_name =
@@ -388,6 +572,8 @@ set_up(shared_ptr <TargetT > const& target_image_ptr)
 
   // initialise mutliplicative update to zeros
   multiplicative_update_image_ptr = unique_ptr<TargetT>(target_image_ptr->get_empty_copy());
+  // work image for the prior gradient will be allocated when first needed
+  prior_gradient_image_ptr.reset();
 
   return Succeeded::yes;
 }
@@ -418,18 +604,7 @@ OSMAPOSLReconstruction<TargetT>::apply_multiplicative_update(
   TargetT& current_image_estimate, const TargetT& multiplicative_update_image)
 {
   this->check(current_image_estimate);
-  typename TargetT::const_full_iterator multiplicative_update_image_iter =
-    multiplicative_update_image.begin_all_const();
-  const typename TargetT::const_full_iterator end_multiplicative_update_image_iter =
-    multiplicative_update_image.end_all_const();
-  typename TargetT::full_iterator current_image_estimate_iter =
-    current_image_estimate.begin_all();
-  while (multiplicative_update_image_iter != end_multiplicative_update_image_iter)
-  {
-    *current_image_estimate_iter *= (*multiplicative_update_image_iter);
-    ++current_image_estimate_iter;
-    ++multiplicative_update_image_iter;
-  }
+  multiply_image(current_image_estimate, multiplicative_update_image);
 }
 
 
@@ -457,81 +632,66 @@ update_estimate(TargetT &current_image_estimate)
   this->compute_sub_gradient_without_penalty_plus_sensitivity(
       *multiplicative_update_image_ptr, current_image_estimate, subset_num);
 
+  const bool write_update = this->write_update_image && !this->_disable_output;
+  const bool do_threshold = this->subiteration_num != 1;
+  const float new_min = 
+    static_cast<float>(this->minimum_relative_change);
+  const float new_max = 
+    static_cast<float>(this->maximum_relative_change);
+  float current_min, current_max;
+
   // divide by subset sensitivity
+  // This is done in a single pass over the image, which combines the prior gradient,
+  // divides, finds min/max of the update and (if the update image does not need to be
+  // written first) thresholds it.
   {
     const TargetT& sensitivity = this->get_subset_sensitivity(subset_num);
 
     int count = 0;
     
-    //std::cerr <<this->MAP_model << std::endl;
-    
   if (this->objective_function_sptr->prior_is_zero())
     {
-      divide(multiplicative_update_image_ptr->begin_all(),
-             multiplicative_update_image_ptr->end_all(), 
-             sensitivity.begin_all(),
-             0.F); // no need to find a threshold for division by sensitivity
+      // no need to find a threshold for division by sensitivity
+      divide_by_denominator(*multiplicative_update_image_ptr, sensitivity, sensitivity,
+                            sensitivity_only, static_cast<float>(this->get_num_subsets()),
+                            0.F,
+                            do_threshold && !write_update, new_min, new_max,
+                            current_min, current_max);
     }
     else
     {
-      unique_ptr< TargetT > denominator_ptr
-        (current_image_estimate.get_empty_copy());
-      
+      // re-use work image between subiterations
+      if (is_null_ptr(prior_gradient_image_ptr))
+        prior_gradient_image_ptr.reset(current_image_estimate.get_empty_copy());
+      else
+        std::fill(prior_gradient_image_ptr->begin_all(), prior_gradient_image_ptr->end_all(), 0.F);
       
       this->objective_function_sptr->
-        get_prior_ptr()->compute_gradient(*denominator_ptr, current_image_estimate); 
-      
-      typename TargetT::full_iterator denominator_iter = denominator_ptr->begin_all();
-      const typename TargetT::full_iterator denominator_end = denominator_ptr->end_all();
-      typename TargetT::const_full_iterator sensitivity_iter = sensitivity.begin_all();
-
-      if(this->MAP_model =="additive" )
-      {
-        // lambda_new = lambda / (p_v + beta*prior_gradient/ num_subsets) *
-        //                   sum_subset backproj(measured/forwproj(lambda))
-        // with p_v = sum_{b in subset} p_bv
-        // actually, we restrict 1 + beta*prior_gradient/num_subsets/p_v between .1 and 10
-        while (denominator_iter != denominator_end)
-          {
-            *denominator_iter = *denominator_iter/this->get_num_subsets() + (*sensitivity_iter);
-            // bound denominator between (*sensitivity_iter)/10 and (*sensitivity_iter)*10
-            *denominator_iter =
-                std::max(std::min(*denominator_iter, (*sensitivity_iter)*10),(*sensitivity_iter)/10);
-            ++denominator_iter;
-            ++sensitivity_iter;
-          }
-      }
-      else
-      {
-        if(this->MAP_model =="multiplicative" )
-        {
-          // multiplicative form
-          // lambda_new = lambda / (p_v*(1 + beta*prior_gradient)) *
-          //                   sum_subset backproj(measured/forwproj(lambda))
-          // with p_v = sum_{b in subset} p_bv
-          // actually, we restrict 1 + beta*prior_gradient between .1 and 10
-        while (denominator_iter != denominator_end)
-          {
-            *denominator_iter += 1;
-            // bound denominator between 1/10 and 1*10
-            // TODO code will fail if *denominator_iter is not a float
-            *denominator_iter =
-                std::max(std::min(*denominator_iter, 10.F),1/10.F);
-            *denominator_iter *= (*sensitivity_iter);
-            ++denominator_iter;
-            ++sensitivity_iter;
-          }
-        }
-      }
-
-      // do the division
+        get_prior_ptr()->compute_gradient(*prior_gradient_image_ptr, current_image_estimate); 
+
+      // lambda_new = lambda / (p_v + beta*prior_gradient/ num_subsets) *
+      //                   sum_subset backproj(measured/forwproj(lambda))
+      // with p_v = sum_{b in subset} p_bv
+      // actually, we restrict 1 + beta*prior_gradient/num_subsets/p_v between .1 and 10
+      // or for the multiplicative form
+      // lambda_new = lambda / (p_v*(1 + beta*prior_gradient)) *
+      //                   sum_subset backproj(measured/forwproj(lambda))
+      // actually, we restrict 1 + beta*prior_gradient between .1 and 10
+      const DenominatorType denominator_type =
+        this->MAP_model == "additive" ? additive_MAP : multiplicative_MAP;
+
+      // find threshold as in stir::divide
       // TODO: The thresholding implied in "divide" potentially fails with parametric images
       // as the different parametric images can have very different scales.
       // See https://github.com/UCL/STIR/issues/906
-      divide(multiplicative_update_image_ptr->begin_all(),
-             multiplicative_update_image_ptr->end_all(), 
-             denominator_ptr->begin_all(),
-             small_num);
+      float small_value = find_max(*multiplicative_update_image_ptr) * small_num;
+      small_value = (small_value>0)?small_value:0;
+
+      divide_by_denominator(*multiplicative_update_image_ptr, *prior_gradient_image_ptr, sensitivity,
+                            denominator_type, static_cast<float>(this->get_num_subsets()),
+                            small_value,
+                            do_threshold && !write_update, new_min, new_max,
+                            current_min, current_max);
     }
     
     info(boost::format("Number of (cancelled) singularities in Sensitivity division: %1%") % count);
@@ -548,7 +708,7 @@ update_estimate(TargetT &current_image_estimate)
   
   // KT 17/08/2000 limit update
   // TODO move below thresholding?
-  if (this->write_update_image && !this->_disable_output)
+  if (write_update)
   {
     // allocate space for the filename assuming that
     // we never have more than 10^49 subiterations ...
@@ -561,23 +721,13 @@ update_estimate(TargetT &current_image_estimate)
     delete[] fname;
   }
   
-  if (this->subiteration_num != 1)
+  if (do_threshold)
     {
-      const float current_min =
-        *std::min_element(multiplicative_update_image_ptr->begin_all(),
-                          multiplicative_update_image_ptr->end_all()); 
-      const float current_max = 
-        *std::max_element(multiplicative_update_image_ptr->begin_all(),
-                          multiplicative_update_image_ptr->end_all()); 
-      const float new_min = 
-        static_cast<float>(this->minimum_relative_change);
-      const float new_max = 
-        static_cast<float>(this->maximum_relative_change);
       info(boost::format("Update image old min,max: %1%, %2%, new min,max %3%, %4%") % current_min % current_max % (min(current_min, new_min)) % (max(current_max, new_max)));
 
-      threshold_upper_lower(multiplicative_update_image_ptr->begin_all(),
-                            multiplicative_update_image_ptr->end_all(), 
-                            new_min, new_max);
+      // thresholding was already done above unless we had to write the update image first
+      if (write_update)
+        threshold_update(*multiplicative_update_image_ptr, new_min, new_max);
     }
 
   //current_image_estimate *= *multiplicative_update_image_ptr;
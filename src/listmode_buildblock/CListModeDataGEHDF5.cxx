@@ -121,6 +121,20 @@ reset()
   return current_lm_data_ptr->reset();
 }
 
+void
+CListModeDataGEHDF5::
+set_read_buffer_size(const std::size_t buffer_size)
+{
+  current_lm_data_ptr->set_buffer_size(buffer_size);
+}
+
+void
+CListModeDataGEHDF5::
+set_asynchronous_reading(const bool arg)
+{
+  current_lm_data_ptr->set_asynchronous_reading(arg);
+}
+
 
 CListModeData::SavedPosition
 CListModeDataGEHDF5::
@@ -0,0 +1,141 @@
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+
+*/
+/*!
+  \file
+  \ingroup listmode_utilities
+
+  \brief Program to measure how fast records can be read from listmode data
+
+  All records are read (and decoded) once, and the number of records and events
+  per second (wall-clock time) is written to stdout.
+
+  For GE HDF5 listmode data, the size of the blocks read from the file and asynchronous
+  reading can be set, see stir::GE::RDF_HDF5::InputStreamWithRecordsFromHDF5.
+
+  \author agent
+*/
+
+
+#include "stir/listmode/ListRecord.h"
+#include "stir/listmode/ListEvent.h"
+#include "stir/listmode/ListModeData.h"
+#include "stir/Succeeded.h"
+#include "stir/HighResWallClockTimer.h"
+#include "stir/IO/read_from_file.h"
+#ifdef HAVE_HDF5
+#include "stir/listmode/CListModeDataGEHDF5.h"
+#endif
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+using std::cerr;
+using std::cout;
+
+USING_NAMESPACE_STIR
+
+int main(int argc, char *argv[])
+{
+  const char * const program_name = argv[0];
+  // skip program name
+  --argc;
+  ++argv;
+
+  unsigned long num_records_to_read = 0;
+  long buffer_size = -1;
+  int asynchronous = -1;
+  while (argc>1 && argv[0][0]=='-')
+    {
+      if (strcmp(argv[0], "--num-records-to-read")==0)
+        {
+          num_records_to_read = atol(argv[1]);
+        }
+      else if (strcmp(argv[0], "--buffer-size")==0)
+        {
+          buffer_size = atol(argv[1]);
+        }
+      else if (strcmp(argv[0], "--asynchronous")==0)
+        {
+          asynchronous = atoi(argv[1])!=0;
+        }
+      else
+        {
+          cerr << "Unrecognised option\n";
+          return EXIT_FAILURE;
+        }
+      argc-=2; argv+=2;
+    }
+
+  if (argc!=1)
+    {
+      cerr << "Usage: " << program_name << " [options] lm_filename\n"
+           << "Options:\n"
+           << "--num-records-to-read <num> : stop after this number of records (default: 0, i.e. all)\n"
+           << "--buffer-size <num> : size of the blocks read from file in bytes (GE HDF5 only, default: 0, i.e. automatic)\n"
+           << "--asynchronous 0|1 : read the next block in a background thread or not (GE HDF5 only, default: 1 if the HDF5 library is thread-safe)\n";
+      return EXIT_FAILURE;
+    }
+
+  shared_ptr<ListModeData> lm_data_ptr(read_from_file<ListModeData>(argv[0]));
+
+  if (buffer_size >= 0 || asynchronous >= 0)
+    {
+#ifdef HAVE_HDF5
+      GE::RDF_HDF5::CListModeDataGEHDF5* GE_lm_data_ptr =
+        dynamic_cast<GE::RDF_HDF5::CListModeDataGEHDF5*>(lm_data_ptr.get());
+      if (GE_lm_data_ptr != 0)
+        {
+          if (buffer_size >= 0)
+            GE_lm_data_ptr->set_read_buffer_size(static_cast<std::size_t>(buffer_size));
+          if (asynchronous >= 0)
+            GE_lm_data_ptr->set_asynchronous_reading(asynchronous != 0);
+        }
+      else
+#endif
+        cerr << "WARNING: --buffer-size and --asynchronous are only supported for GE HDF5 listmode data. Ignored.\n";
+    }
+
+  shared_ptr <ListRecord> record_sptr = lm_data_ptr->get_empty_record_sptr();
+  ListRecord& record = *record_sptr;
+
+  unsigned long num_records = 0;
+  unsigned long num_events = 0;
+  unsigned long num_prompts = 0;
+  HighResWallClockTimer timer;
+  timer.start();
+  while (num_records_to_read==0 || num_records!=num_records_to_read)
+    {
+      if (lm_data_ptr->get_next_record(record) == Succeeded::no)
+        {
+          // no more events in file for some reason
+          break; //get out of while loop
+        }
+      ++num_records;
+      if (record.is_event())
+        {
+          ++num_events;
+          // make sure the event is decoded
+          if (record.event().is_prompt())
+            ++num_prompts;
+        }
+    }
+  timer.stop();
+
+  const double time = timer.value();
+  cout << "Number of records: " << num_records << '\n'
+       << "Number of events:  " << num_events << " (prompts: " << num_prompts << ")\n"
+       << "Wall-clock time:   " << time << " s\n";
+  if (time > 0)
+    cout << "Records per second: " << num_records/time << '\n'
+         << "Events per second:  " << num_events/time << '\n';
+
+  return EXIT_SUCCESS;
+}
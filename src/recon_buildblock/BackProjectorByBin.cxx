@@ -28,6 +28,7 @@
 #include "stir/RelatedViewgrams.h"
 #include "stir/ProjData.h"
 #include "stir/DiscretisedDensity.h"
+#include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/info.h"
 #include "stir/is_null_ptr.h"
 #include "stir/DataProcessor.h"
@@ -75,6 +76,11 @@ set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
   _already_set_up = true;
   _proj_data_info_sptr = proj_data_info_sptr->create_shared_clone();
   _density_sptr.reset(density_info_sptr->clone());
+  // store voxels contiguously, such that back projectors can avoid the nested indexing
+  // (images for the threads are created with get_empty_copy() and will be contiguous as well)
+  if (VoxelsOnCartesianGrid<float>* vox_image_ptr =
+        dynamic_cast<VoxelsOnCartesianGrid<float>*>(_density_sptr.get()))
+    vox_image_ptr->make_contiguous();
 
 #ifdef STIR_OPENMP
 #pragma omp parallel
@@ -87,7 +93,7 @@ set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
         if (!_local_output_image_sptrs[i]->has_same_characteristics(*density_info_sptr))
           {
             // previous run was with different sizes, so reallocate
-            _local_output_image_sptrs[i].reset(density_info_sptr->get_empty_copy());
+            _local_output_image_sptrs[i].reset(_density_sptr->get_empty_copy());
           }
 
 #endif
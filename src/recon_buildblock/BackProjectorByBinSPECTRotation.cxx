@@ -0,0 +1,113 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Implementation of class stir::BackProjectorByBinSPECTRotation
+
+  \author agent
+*/
+
+#include "stir/recon_buildblock/BackProjectorByBinSPECTRotation.h"
+#include "stir/recon_buildblock/SPECTRotationModel.h"
+#include "stir/recon_buildblock/TrivialDataSymmetriesForBins.h"
+#include "stir/RelatedViewgrams.h"
+#include "stir/is_null_ptr.h"
+#include "stir/error.h"
+
+START_NAMESPACE_STIR
+
+const char * const
+BackProjectorByBinSPECTRotation::registered_name =
+  "SPECT Rotation";
+
+BackProjectorByBinSPECTRotation::
+BackProjectorByBinSPECTRotation()
+{
+  set_defaults();
+}
+
+BackProjectorByBinSPECTRotation::
+BackProjectorByBinSPECTRotation(const shared_ptr<SPECTRotationModel>& model_sptr_v)
+  : model_sptr(model_sptr_v)
+{
+  if (is_null_ptr(model_sptr))
+    error("BackProjectorByBinSPECTRotation: model not set");
+}
+
+void
+BackProjectorByBinSPECTRotation::
+set_defaults()
+{
+  BackProjectorByBin::set_defaults();
+  model_sptr.reset(new SPECTRotationModel);
+}
+
+void
+BackProjectorByBinSPECTRotation::
+initialise_keymap()
+{
+  parser.add_start_key("Back Projector Using SPECT Rotation Parameters");
+  parser.add_stop_key("End Back Projector Using SPECT Rotation Parameters");
+  BackProjectorByBin::initialise_keymap();
+  model_sptr->add_to_keymap(parser);
+}
+
+bool
+BackProjectorByBinSPECTRotation::
+post_processing()
+{
+  if (BackProjectorByBin::post_processing())
+    return true;
+  return model_sptr->post_processing();
+}
+
+void
+BackProjectorByBinSPECTRotation::
+set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+       const shared_ptr<const DiscretisedDensity<3,float> >& density_info_sptr)
+{
+  BackProjectorByBin::set_up(proj_data_info_sptr, density_info_sptr);
+  model_sptr->set_up(proj_data_info_sptr, density_info_sptr);
+  symmetries_sptr.reset(new TrivialDataSymmetriesForBins(proj_data_info_sptr));
+}
+
+const DataSymmetriesForViewSegmentNumbers *
+BackProjectorByBinSPECTRotation::
+get_symmetries_used() const
+{
+  if (!this->_already_set_up)
+    error("BackProjectorByBin method called without calling set_up first.");
+  return symmetries_sptr.get();
+}
+
+shared_ptr<SPECTRotationModel>
+BackProjectorByBinSPECTRotation::
+get_model_sptr() const
+{
+  return model_sptr;
+}
+
+void
+BackProjectorByBinSPECTRotation::
+actual_back_project(DiscretisedDensity<3,float>& density,
+                    const RelatedViewgrams<float>& viewgrams,
+                    const int min_axial_pos_num, const int max_axial_pos_num,
+                    const int min_tangential_pos_num, const int max_tangential_pos_num)
+{
+  for (RelatedViewgrams<float>::const_iterator iter = viewgrams.begin(); iter != viewgrams.end(); ++iter)
+    model_sptr->back_project(density, *iter,
+                             min_axial_pos_num, max_axial_pos_num,
+                             min_tangential_pos_num, max_tangential_pos_num);
+}
+
+END_NAMESPACE_STIR
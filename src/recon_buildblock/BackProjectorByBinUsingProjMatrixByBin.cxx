@@ -34,6 +34,7 @@
 #include "stir/recon_buildblock/BackProjectorByBinUsingProjMatrixByBin.h"
 #include "stir/Viewgram.h"
 #include "stir/RelatedViewgrams.h"
+#include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/is_null_ptr.h"
 
 using std::vector;
@@ -119,6 +120,16 @@ actual_back_project(DiscretisedDensity<3,float>& image,
 		    const int min_axial_pos_num, const int max_axial_pos_num,
 		    const int min_tangential_pos_num, const int max_tangential_pos_num)
 {
+  // use the faster version of ProjMatrixElemsForOneBin::back_project() if the image is contiguous
+  VoxelsOnCartesianGrid<float>* vox_image_ptr =
+    dynamic_cast<VoxelsOnCartesianGrid<float>*>(&image);
+  float* const image_data_ptr =
+    vox_image_ptr == 0 ? 0 : vox_image_ptr->get_contiguous_data_ptr();
+  const BasicCoordinate<3,int> min_indices =
+    image_data_ptr == 0 ? make_coordinate(0,0,0) : vox_image_ptr->get_min_indices();
+  const BasicCoordinate<3,int> lengths =
+    image_data_ptr == 0 ? make_coordinate(0,0,0) : vox_image_ptr->get_lengths();
+
   if (proj_matrix_ptr->is_cache_enabled()/* &&
 					    !proj_matrix_ptr->does_cache_store_only_basic_bins()*/)
     {
@@ -144,7 +155,10 @@ actual_back_project(DiscretisedDensity<3,float>& image,
 		  continue;
 		Bin bin(segment_num, view_num, ax_pos, tang_pos, viewgram[ax_pos][tang_pos]);
 		proj_matrix_ptr->get_proj_matrix_elems_for_one_bin(proj_matrix_row, bin);
-		proj_matrix_row.back_project(image, bin);
+		if (image_data_ptr != 0)
+		  proj_matrix_row.back_project(image_data_ptr, min_indices, lengths, bin);
+		else
+		  proj_matrix_row.back_project(image, bin);
 	      }
 	  ++r_viewgrams_iter;   
 	}
@@ -223,7 +237,10 @@ actual_back_project(DiscretisedDensity<3,float>& image,
 		    assert(bin.tangential_pos_num() == basic_bin.tangential_pos_num());
 	      
 		    symm_op_ptr->transform_proj_matrix_elems_for_one_bin(proj_matrix_row_copy);
-		    proj_matrix_row_copy.back_project(image, bin);
+		    if (image_data_ptr != 0)
+		      proj_matrix_row_copy.back_project(image_data_ptr, min_indices, lengths, bin);
+		    else
+		      proj_matrix_row_copy.back_project(image, bin);
 		  }
 	      }  
 	  }      
@@ -26,8 +26,23 @@
 START_NAMESPACE_STIR
 
 DistributedCachingInformation::DistributedCachingInformation(const int num_workers_v)
-  : num_workers(num_workers_v)
+  : num_workers(num_workers_v), caches_shared(false)
 {
+  this->cache_nums.resize(this->num_workers);
+  for (int i=0; i<this->num_workers; i++) 
+    this->cache_nums[i]=i;
+  initialise();
+}
+
+DistributedCachingInformation::DistributedCachingInformation(const int num_workers_v,
+                                                             const std::vector<int>& cache_nums_v)
+  : num_workers(num_workers_v), cache_nums(cache_nums_v), caches_shared(true)
+{
+  if (static_cast<int>(this->cache_nums.size()) != this->num_workers)
+    error("DistributedCachingInformation: need a cache number for every processor");
+  for (int i=0; i<this->num_workers; i++) 
+    if (this->cache_nums[i] >= this->num_workers)
+      error("DistributedCachingInformation: cache numbers have to be smaller than the number of processors");
   initialise();
 }
 
@@ -39,9 +54,9 @@ DistributedCachingInformation::~DistributedCachingInformation()
 void DistributedCachingInformation::initialise()
 {        
   //initialize vector sizes
-  this->proc_vs_nums.resize(this->num_workers);
+  this->cache_vs_nums.resize(this->num_workers);
   for (int i=0; i<this->num_workers; i++) 
-    this->proc_vs_nums[i].resize(0);
+    this->cache_vs_nums[i].resize(0);
          
   this->vs_nums_to_process.resize(0);
   this->initialise_new_subiteration(this->vs_nums_to_process);
@@ -92,17 +107,17 @@ bool DistributedCachingInformation::is_still_to_be_processed(const ViewSegmentNu
     return this->still_to_process[iter - this->vs_nums_to_process.begin()];
 }
 
-void DistributedCachingInformation::add_vs_num_to_proc(int proc, const ViewSegmentNumbers& vs_num)
+void DistributedCachingInformation::add_vs_num_to_cache(int cache_num, const ViewSegmentNumbers& vs_num)
 {       
-  this->proc_vs_nums[proc].push_back(vs_num);
+  this->cache_vs_nums[cache_num].push_back(vs_num);
   this->set_processed(vs_num);
 }
 
-int DistributedCachingInformation::get_num_remaining_cached_data_to_process(int proc) const
+int DistributedCachingInformation::get_num_remaining_cached_data_to_process(int cache_num) const
 {
   int cnt = 0;
-  for (std::vector<ViewSegmentNumbers>::const_iterator iter=this->proc_vs_nums[proc].begin();
-       iter!=this->proc_vs_nums[proc].end(); ++ iter)
+  for (std::vector<ViewSegmentNumbers>::const_iterator iter=this->cache_vs_nums[cache_num].begin();
+       iter!=this->cache_vs_nums[cache_num].end(); ++ iter)
     {
       if (this->is_still_to_be_processed(*iter)) 
         cnt++;
@@ -110,11 +125,11 @@ int DistributedCachingInformation::get_num_remaining_cached_data_to_process(int
   return cnt;
 }
 
-bool DistributedCachingInformation::get_oldest_unprocessed_vs_num(ViewSegmentNumbers& vs, int proc) const
+bool DistributedCachingInformation::get_oldest_unprocessed_vs_num(ViewSegmentNumbers& vs, int cache_num) const
 {
   //find unprocessed vs_num
-  for (std::vector<ViewSegmentNumbers>::const_iterator iter=this->proc_vs_nums[proc].begin();
-       iter!=this->proc_vs_nums[proc].end(); ++ iter)
+  for (std::vector<ViewSegmentNumbers>::const_iterator iter=this->cache_vs_nums[cache_num].begin();
+       iter!=this->cache_vs_nums[cache_num].end(); ++ iter)
     {   
       if (this->is_still_to_be_processed(*iter)) 
         {
@@ -128,40 +143,41 @@ bool DistributedCachingInformation::get_oldest_unprocessed_vs_num(ViewSegmentNum
 
 bool DistributedCachingInformation::get_unprocessed_vs_num(ViewSegmentNumbers& vs, int proc)
 {
-  const bool in_cache = this->get_oldest_unprocessed_vs_num(vs, proc);
+  const int cache_num = this->cache_nums[proc];
+  const bool in_cache = this->get_oldest_unprocessed_vs_num(vs, cache_num);
   if (!in_cache)
     {
       // no cached unprocessed data found
-      // get work from worker with most work left
-      vs = this->get_vs_num_of_proc_with_most_work_left(proc);
+      // get work from cache with most work left
+      vs = this->get_vs_num_of_cache_with_most_work_left(cache_num);
     }
         
-  this->add_vs_num_to_proc(proc, vs);
+  this->add_vs_num_to_cache(cache_num, vs);
   return !in_cache;     
 }
 
-ViewSegmentNumbers DistributedCachingInformation::get_vs_num_of_proc_with_most_work_left(int proc) const
+ViewSegmentNumbers DistributedCachingInformation::get_vs_num_of_cache_with_most_work_left(int cache_num) const
 {                
-  int proc_with_max_work=0;
+  int cache_with_max_work=0;
   int max_work=0;
 
-  //find processor with most work left
+  //find cache with most work left
   for (int i=0; i<this->num_workers;i++)
     {
-      if (i==proc) continue;
+      if (i==cache_num) continue;
       const int cnt = this->get_num_remaining_cached_data_to_process(i);
       if (cnt>max_work)
         {
           max_work=cnt;
-          proc_with_max_work = i;
+          cache_with_max_work = i;
         } 
     }
 
   ViewSegmentNumbers vs;
-  //get vs_number of the processor with most work left
+  //get vs_number of the cache with most work left
   if (max_work>0) 
     {
-      this->get_oldest_unprocessed_vs_num(vs, proc_with_max_work);
+      this->get_oldest_unprocessed_vs_num(vs, cache_with_max_work);
     }
   else
     {
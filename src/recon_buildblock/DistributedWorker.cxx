@@ -65,6 +65,9 @@ int main(int argc, char **argv)
       
       stir::info(boost::format("Process %d of %d on %s") 
 	   % my_rank % distributed::num_processors % processor_name);
+
+      //find out which workers are on the same node
+      distributed::set_up_node_communicators();
          
       //master
       if (my_rank==0)
@@ -114,6 +117,12 @@ int main(int argc, char **argv)
   
 namespace stir 
 {
+  //! make data written by other workers on the node visible (and our own data to them)
+  static void sync_node_shared_window(MPI_Win win)
+  {
+    if (win != MPI_WIN_NULL)
+      MPI_Win_sync(win);
+  }
         
   template <typename TargetT>
   DistributedWorker<TargetT>::DistributedWorker() 
@@ -133,6 +142,22 @@ namespace stir
     log_likelihood_ptr=NULL;
     zero_seg0_end_planes=false;
     cache_enabled=false;
+    cache_shared_on_node=false;
+    proj_data_win=MPI_WIN_NULL;
+    binwise_correction_win=MPI_WIN_NULL;
+    mult_proj_data_win=MPI_WIN_NULL;
+  }
+
+  template <typename TargetT>
+  void DistributedWorker<TargetT>::clear_cache()
+  {
+    this->proj_data_ptr.reset();
+    this->binwise_correction.reset(); 
+    this->mult_proj_data_sptr.reset(); 
+    // note: this is collective over the workers on the node
+    distributed::free_node_shared_window(this->proj_data_win);
+    distributed::free_node_shared_window(this->binwise_correction_win);
+    distributed::free_node_shared_window(this->mult_proj_data_win);
   }   
    
   template <typename TargetT>
@@ -149,6 +174,8 @@ namespace stir
           {
           case task_stop_processing: // done with processing
             {
+              distributed::wait_for_output_image_reduction();
+              this->clear_cache();
               return;
             }
 
@@ -160,7 +187,12 @@ namespace stir
 
           case task_do_distributable_gradient_computation:
             {
-              this->distributable_computation(RPC_process_related_viewgrams_gradient);
+              this->distributable_computation(RPC_process_related_viewgrams_gradient<false>);
+              break;
+            }
+          case task_do_distributable_gradient_computation_add_sensitivity:
+            {
+              this->distributable_computation(RPC_process_related_viewgrams_gradient<true>);
               break;
             }
 	  case task_do_distributable_loglikelihood_computation:
@@ -206,8 +238,8 @@ namespace stir
     proj_pair_sptr->set_up(this->proj_data_info_sptr, this->target_sptr);
                 
     //some values to configure tests
-    int configurations[4];
-    status=distributed::receive_int_values(configurations, 4, distributed::STIR_MPI_CONF_TAG);
+    int configurations[6];
+    status=distributed::receive_int_values(configurations, 6, distributed::STIR_MPI_CONF_TAG);
         
     status=distributed::receive_double_values(&distributed::min_threshold, 1, distributed::STIR_MPI_CONF_TAG);
                                         
@@ -215,6 +247,8 @@ namespace stir
     (configurations[1]==1)?distributed::test_send_receive_times=true:distributed::test_send_receive_times=false;
     (configurations[2]==1)?distributed::rpc_time=true:distributed::rpc_time=false;
     (configurations[3]==1)?cache_enabled=true:cache_enabled=false;
+    (configurations[4]==1)?cache_shared_on_node=true:cache_shared_on_node=false;
+    (configurations[5]==1)?distributed::image_reduction_uses_bounding_box=true:distributed::image_reduction_uses_bounding_box=false;
                         
 #ifndef NDEBUG
     if (distributed::test && my_rank==1) distributed::test_parameter_info_slave(proj_pair_sptr->stir::ParsingObject::parameter_info());
@@ -231,9 +265,7 @@ namespace stir
 #endif
                         
     // reset cache-stores, they will be initialised if we need them
-    this->proj_data_ptr.reset();
-    this->binwise_correction.reset(); 
-    this->mult_proj_data_sptr.reset(); 
+    this->clear_cache();
   } // set_up
 
   template <typename TargetT>
@@ -257,6 +289,10 @@ namespace stir
       }
 #endif    
                  
+    // the master never uses the distributed cache for the sensitivity (see add_subset_sensitivity)
+    const bool use_cache = this->cache_enabled &&
+      RPC_process_related_viewgrams != &RPC_process_related_viewgrams_sensitivity_computation;
+
     HighResWallClockTimer t;
                 
       {
@@ -281,6 +317,23 @@ namespace stir
 	    //output_image_ptr->fill(0.F);
 	  }
 
+        if (use_cache && this->cache_shared_on_node)
+          {
+            // receive which data will be cached, and allocate the shared memory for it
+            // (this is collective over the workers on the node, so cannot be done when the data arrive)
+            const bool use_binwise_correction = distributed::receive_bool_value(-1,-1);
+            const bool use_mult_viewgrams = distributed::receive_bool_value(-1,-1);
+            if (is_null_ptr(this->proj_data_ptr))
+              this->proj_data_ptr =
+                distributed::create_node_shared_proj_data(this->proj_data_win, this->exam_info_sptr, this->proj_data_info_sptr);
+            if (use_binwise_correction && is_null_ptr(this->binwise_correction))
+              this->binwise_correction =
+                distributed::create_node_shared_proj_data(this->binwise_correction_win, this->exam_info_sptr, this->proj_data_info_sptr);
+            if (use_mult_viewgrams && is_null_ptr(this->mult_proj_data_sptr))
+              this->mult_proj_data_sptr =
+                distributed::create_node_shared_proj_data(this->mult_proj_data_win, this->exam_info_sptr, this->proj_data_info_sptr);
+          }
+
         proj_pair_sptr->get_forward_projector_sptr()->set_input(*this->target_sptr);
         if (!is_null_ptr(output_image_ptr))
           proj_pair_sptr->get_back_projector_sptr()->start_accumulating_in_new_target();
@@ -305,6 +358,13 @@ namespace stir
              */         
             if (status.MPI_TAG==REUSE_VIEWGRAM_TAG) //use a viewgram already available
               {                        
+                if (this->cache_shared_on_node)
+                  {
+                    // the data might have been written by another worker on the node
+                    sync_node_shared_window(this->proj_data_win);
+                    sync_node_shared_window(this->binwise_correction_win);
+                    sync_node_shared_window(this->mult_proj_data_win);
+                  }
                 viewgrams = new RelatedViewgrams<float>(proj_data_ptr->get_related_viewgrams(vs, symmetries_sptr));
                 if (!is_null_ptr(binwise_correction))
                   additive_binwise_correction_viewgrams = 
@@ -337,7 +397,7 @@ namespace stir
                 distributed::receive_and_construct_related_viewgrams(viewgrams, proj_data_info_sptr, symmetries_sptr, 0); 
                         
                 //save Viewgrams to ProjDataInMemory object
-                if(cache_enabled)
+                if (use_cache)
                   {
                     if (is_null_ptr(this->proj_data_ptr))
                       this->proj_data_ptr.reset(new ProjDataInMemory(this->exam_info_sptr,this->proj_data_info_sptr, /*init_with_0*/ false));
@@ -362,6 +422,15 @@ namespace stir
                         if (mult_proj_data_sptr->set_related_viewgrams(*mult_viewgrams_ptr)==Succeeded::no)
                           error("Slave %i: Storing mult_viewgrams_ptr failed!\n", my_rank);
                       }
+
+                    if (this->cache_shared_on_node)
+                      {
+                        // make sure the other workers on the node will see the data
+                        // (the master only asks them to re-use it after our next message)
+                        sync_node_shared_window(this->proj_data_win);
+                        sync_node_shared_window(this->binwise_correction_win);
+                        sync_node_shared_window(this->mult_proj_data_win);
+                      }
                   }
               }
             else if (status.MPI_TAG==END_ITERATION_TAG)  //the iteration is completed --> send results
@@ -36,8 +36,10 @@
 #include "stir/error.h"
 #include "stir/DataProcessor.h"
 #include "stir/is_null_ptr.h"
+#include "stir/recon_buildblock/ImageSupportBoundingBoxes.h"
 #include <boost/format.hpp>
 #include <iostream>
+#include <algorithm>
 
 START_NAMESPACE_STIR
 
@@ -57,6 +59,7 @@ ForwardProjectorByBin::
 set_defaults()
 {
   _pre_data_processor_sptr.reset();
+  _skip_zero_image_regions = false;
 }
 
 void
@@ -66,6 +69,7 @@ initialise_keymap()
   parser.add_start_key("Forward Projector Parameters");
   parser.add_stop_key("End Forward Projector Parameters");
   parser.add_parsing_key("pre data processor", &_pre_data_processor_sptr);
+  parser.add_key("skip zero image regions", &_skip_zero_image_regions);
 }
 
 void
@@ -91,6 +95,13 @@ check(const ProjDataInfo& proj_data_info, const DiscretisedDensity<3,float>& den
     error("ForwardProjectorByBin set-up with different geometry for density or volume data.");
 }
 
+float
+ForwardProjectorByBin::
+get_support_margin() const
+{
+  return -1.F;
+}
+
 void
 ForwardProjectorByBin::forward_project(ProjData& proj_data,
                        const DiscretisedDensity<3,float>& image,
@@ -275,6 +286,80 @@ forward_project(RelatedViewgrams<float>& viewgrams,
       error("ForwardProjectByBin: forward_project called with incorrect related_viewgrams. Problem with symmetries!\n");
     }
   }
+
+  if (!is_null_ptr(_support_sptr))
+    {
+      // find the bins whose LORs intersect the support of the image
+      bool found = false;
+      int support_min_axial_pos_num = 0, support_max_axial_pos_num = 0;
+      int support_min_tangential_pos_num = 0, support_max_tangential_pos_num = 0;
+      const float margin = this->get_support_margin();
+      if (margin < 0)
+        {
+          // projector cannot clip, so can only skip empty images
+          found = !_support_sptr->is_empty();
+          support_min_axial_pos_num = min_axial_pos_num;
+          support_max_axial_pos_num = max_axial_pos_num;
+          support_min_tangential_pos_num = min_tangential_pos_num;
+          support_max_tangential_pos_num = max_tangential_pos_num;
+        }
+      else
+        {
+          for (RelatedViewgrams<float>::const_iterator iter = viewgrams.begin();
+               iter != viewgrams.end();
+               ++iter)
+            {
+              int current_min_axial_pos_num, current_max_axial_pos_num;
+              int current_min_tangential_pos_num, current_max_tangential_pos_num;
+              if (!_support_sptr->find_range_of_LORs_intersecting_support(current_min_axial_pos_num, current_max_axial_pos_num,
+                                                                          current_min_tangential_pos_num, current_max_tangential_pos_num,
+                                                                          *this->_proj_data_info_sptr,
+                                                                          iter->get_view_num(), iter->get_segment_num(),
+                                                                          margin))
+                continue;
+              if (!found)
+                {
+                  found = true;
+                  support_min_axial_pos_num = current_min_axial_pos_num;
+                  support_max_axial_pos_num = current_max_axial_pos_num;
+                  support_min_tangential_pos_num = current_min_tangential_pos_num;
+                  support_max_tangential_pos_num = current_max_tangential_pos_num;
+                }
+              else
+                {
+                  support_min_axial_pos_num = std::min(support_min_axial_pos_num, current_min_axial_pos_num);
+                  support_max_axial_pos_num = std::max(support_max_axial_pos_num, current_max_axial_pos_num);
+                  support_min_tangential_pos_num = std::min(support_min_tangential_pos_num, current_min_tangential_pos_num);
+                  support_max_tangential_pos_num = std::max(support_max_tangential_pos_num, current_max_tangential_pos_num);
+                }
+            }
+          support_min_axial_pos_num = std::max(support_min_axial_pos_num, min_axial_pos_num);
+          support_max_axial_pos_num = std::min(support_max_axial_pos_num, max_axial_pos_num);
+          support_min_tangential_pos_num = std::max(support_min_tangential_pos_num, min_tangential_pos_num);
+          support_max_tangential_pos_num = std::min(support_max_tangential_pos_num, max_tangential_pos_num);
+          found = found &&
+            support_min_axial_pos_num <= support_max_axial_pos_num &&
+            support_min_tangential_pos_num <= support_max_tangential_pos_num;
+        }
+
+      // set all bins in the range to zero, as the projector will only fill in those in the support
+      for (RelatedViewgrams<float>::iterator iter = viewgrams.begin();
+           iter != viewgrams.end();
+           ++iter)
+        for (int axial_pos_num = min_axial_pos_num; axial_pos_num <= max_axial_pos_num; ++axial_pos_num)
+          for (int tangential_pos_num = min_tangential_pos_num; tangential_pos_num <= max_tangential_pos_num; ++tangential_pos_num)
+            (*iter)[axial_pos_num][tangential_pos_num] = 0;
+
+      if (found)
+        actual_forward_project(viewgrams,
+                               support_min_axial_pos_num,
+                               support_max_axial_pos_num,
+                               support_min_tangential_pos_num,
+                               support_max_tangential_pos_num);
+      stop_timers();
+      return;
+    }
+
   actual_forward_project(viewgrams,
              min_axial_pos_num,
          max_axial_pos_num,
@@ -317,6 +402,39 @@ set_input(const DiscretisedDensity<3,float> & density)
         if (success != Succeeded::yes)
             throw std::runtime_error("ForwardProjectorByBin::set_input(). Pre-forward-projection data processor failed.");
     }
+
+    // store voxels contiguously, such that projectors can avoid the nested indexing
+    if (VoxelsOnCartesianGrid<float>* vox_image_ptr =
+          dynamic_cast<VoxelsOnCartesianGrid<float>*>(_density_sptr.get()))
+      vox_image_ptr->make_contiguous();
+
+    if (_skip_zero_image_regions)
+      {
+        _support_sptr.reset(new ImageSupportBoundingBoxes(*_density_sptr));
+        // forward_project() needs the LOR end-points of every viewgram, so keep them in memory
+        if (!is_null_ptr(_proj_data_info_sptr) && !_proj_data_info_sptr->get_LOR_endpoints_cache_enabled())
+          {
+            shared_ptr<ProjDataInfo> proj_data_info_sptr = _proj_data_info_sptr->create_shared_clone();
+            proj_data_info_sptr->set_LOR_endpoints_cache_enabled(true);
+            _proj_data_info_sptr = proj_data_info_sptr;
+          }
+      }
+    else
+      _support_sptr.reset();
+}
+
+void
+ForwardProjectorByBin::
+set_skip_zero_image_regions(const bool arg)
+{
+  _skip_zero_image_regions = arg;
+}
+
+bool
+ForwardProjectorByBin::
+get_skip_zero_image_regions() const
+{
+  return _skip_zero_image_regions;
 }
 
 void
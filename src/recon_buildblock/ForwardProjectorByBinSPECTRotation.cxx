@@ -0,0 +1,113 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Implementation of class stir::ForwardProjectorByBinSPECTRotation
+
+  \author agent
+*/
+
+#include "stir/recon_buildblock/ForwardProjectorByBinSPECTRotation.h"
+#include "stir/recon_buildblock/SPECTRotationModel.h"
+#include "stir/recon_buildblock/TrivialDataSymmetriesForBins.h"
+#include "stir/RelatedViewgrams.h"
+#include "stir/is_null_ptr.h"
+#include "stir/error.h"
+
+START_NAMESPACE_STIR
+
+const char * const
+ForwardProjectorByBinSPECTRotation::registered_name =
+  "SPECT Rotation";
+
+ForwardProjectorByBinSPECTRotation::
+ForwardProjectorByBinSPECTRotation()
+{
+  set_defaults();
+}
+
+ForwardProjectorByBinSPECTRotation::
+ForwardProjectorByBinSPECTRotation(const shared_ptr<SPECTRotationModel>& model_sptr_v)
+  : model_sptr(model_sptr_v)
+{
+  if (is_null_ptr(model_sptr))
+    error("ForwardProjectorByBinSPECTRotation: model not set");
+}
+
+void
+ForwardProjectorByBinSPECTRotation::
+set_defaults()
+{
+  ForwardProjectorByBin::set_defaults();
+  model_sptr.reset(new SPECTRotationModel);
+}
+
+void
+ForwardProjectorByBinSPECTRotation::
+initialise_keymap()
+{
+  parser.add_start_key("Forward Projector Using SPECT Rotation Parameters");
+  parser.add_stop_key("End Forward Projector Using SPECT Rotation Parameters");
+  ForwardProjectorByBin::initialise_keymap();
+  model_sptr->add_to_keymap(parser);
+}
+
+bool
+ForwardProjectorByBinSPECTRotation::
+post_processing()
+{
+  if (ForwardProjectorByBin::post_processing())
+    return true;
+  return model_sptr->post_processing();
+}
+
+void
+ForwardProjectorByBinSPECTRotation::
+set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+       const shared_ptr<const DiscretisedDensity<3,float> >& density_info_sptr)
+{
+  ForwardProjectorByBin::set_up(proj_data_info_sptr, density_info_sptr);
+  model_sptr->set_up(proj_data_info_sptr, density_info_sptr);
+  symmetries_sptr.reset(new TrivialDataSymmetriesForBins(proj_data_info_sptr));
+}
+
+const DataSymmetriesForViewSegmentNumbers *
+ForwardProjectorByBinSPECTRotation::
+get_symmetries_used() const
+{
+  if (!this->_already_set_up)
+    error("ForwardProjectorByBin method called without calling set_up first.");
+  return symmetries_sptr.get();
+}
+
+shared_ptr<SPECTRotationModel>
+ForwardProjectorByBinSPECTRotation::
+get_model_sptr() const
+{
+  return model_sptr;
+}
+
+void
+ForwardProjectorByBinSPECTRotation::
+actual_forward_project(RelatedViewgrams<float>& viewgrams,
+                       const DiscretisedDensity<3,float>& density,
+                       const int min_axial_pos_num, const int max_axial_pos_num,
+                       const int min_tangential_pos_num, const int max_tangential_pos_num)
+{
+  for (RelatedViewgrams<float>::iterator iter = viewgrams.begin(); iter != viewgrams.end(); ++iter)
+    model_sptr->forward_project(*iter, density,
+                                min_axial_pos_num, max_axial_pos_num,
+                                min_tangential_pos_num, max_tangential_pos_num);
+}
+
+END_NAMESPACE_STIR
@@ -27,6 +27,8 @@
 #include "stir/RelatedViewgrams.h"
 #include "stir/IndexRange2D.h"
 #include "stir/is_null_ptr.h"
+#include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h"
+#include "stir/VoxelsOnCartesianGrid.h"
 #include <algorithm>
 #include <vector>
 #include <list>
@@ -109,6 +111,21 @@ ForwardProjectorByBinUsingProjMatrixByBin::get_symmetries_used() const
   return proj_matrix_ptr->get_symmetries_ptr();
 }
 
+float
+ForwardProjectorByBinUsingProjMatrixByBin::
+get_support_margin() const
+{
+  if (dynamic_cast<const ProjMatrixByBinUsingRayTracing*>(proj_matrix_ptr.get()) == 0)
+    return -1.F;
+  // rays are traced within the bin
+  const VoxelsOnCartesianGrid<float>& image =
+    dynamic_cast<const VoxelsOnCartesianGrid<float>&>(*this->_density_sptr);
+  const Bin bin(this->_proj_data_info_sptr->get_max_segment_num(),0,0,0);
+  return this->_proj_data_info_sptr->get_sampling_in_s(bin) +
+    this->_proj_data_info_sptr->get_sampling_in_m(bin) +
+    norm(image.get_voxel_size());
+}
+
 void 
 ForwardProjectorByBinUsingProjMatrixByBin::
  actual_forward_project(RelatedViewgrams<float>& viewgrams, 
@@ -116,6 +133,16 @@ ForwardProjectorByBinUsingProjMatrixByBin::
 		  const int min_axial_pos_num, const int max_axial_pos_num,
 		  const int min_tangential_pos_num, const int max_tangential_pos_num)
 {
+  // use the faster version of ProjMatrixElemsForOneBin::forward_project() if the image is contiguous
+  const VoxelsOnCartesianGrid<float>* vox_image_ptr =
+    dynamic_cast<const VoxelsOnCartesianGrid<float>*>(&image);
+  const float* const image_data_ptr =
+    vox_image_ptr == 0 ? 0 : vox_image_ptr->get_contiguous_data_ptr();
+  const BasicCoordinate<3,int> min_indices =
+    image_data_ptr == 0 ? make_coordinate(0,0,0) : vox_image_ptr->get_min_indices();
+  const BasicCoordinate<3,int> lengths =
+    image_data_ptr == 0 ? make_coordinate(0,0,0) : vox_image_ptr->get_lengths();
+
   if (proj_matrix_ptr->is_cache_enabled()/* &&
 					    !proj_matrix_ptr->does_cache_store_only_basic_bins()*/)
   {
@@ -138,7 +165,10 @@ ForwardProjectorByBinUsingProjMatrixByBin::
         { 
           Bin bin(segment_num, view_num, ax_pos, tang_pos, 0);
           proj_matrix_ptr->get_proj_matrix_elems_for_one_bin(proj_matrix_row, bin);
-          proj_matrix_row.forward_project(bin,image);
+          if (image_data_ptr != 0)
+            proj_matrix_row.forward_project(bin, image_data_ptr, min_indices, lengths);
+          else
+            proj_matrix_row.forward_project(bin,image);
           viewgram[ax_pos][tang_pos] = bin.get_bin_value();
         }
         ++r_viewgrams_iter; 
@@ -209,7 +239,10 @@ ForwardProjectorByBinUsingProjMatrixByBin::
             assert(bin == basic_bin);
             
             symm_op_ptr->transform_proj_matrix_elems_for_one_bin(proj_matrix_row_copy);
-            proj_matrix_row_copy.forward_project(bin,image);
+            if (image_data_ptr != 0)
+              proj_matrix_row_copy.forward_project(bin, image_data_ptr, min_indices, lengths);
+            else
+              proj_matrix_row_copy.forward_project(bin,image);
             
             viewgram[axial_pos_tmp][tang_pos_tmp] = bin.get_bin_value();
           }
@@ -77,6 +77,7 @@ void
 ForwardProjectorByBinUsingRayTracing::
 set_defaults()
 {
+  ForwardProjectorByBin::set_defaults();
   restrict_to_cylindrical_FOV = true;
 }
 
@@ -84,6 +85,7 @@ void
 ForwardProjectorByBinUsingRayTracing::
 initialise_keymap()
 {
+  ForwardProjectorByBin::initialise_keymap();
   parser.add_start_key("Forward Projector Using Ray Tracing Parameters");
   parser.add_key("restrict to cylindrical FOV", &restrict_to_cylindrical_FOV);
   parser.add_stop_key("End Forward Projector Using Ray Tracing Parameters");
@@ -169,6 +171,19 @@ set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
 }
 
 
+float
+ForwardProjectorByBinUsingRayTracing::
+get_support_margin() const
+{
+  // rays are traced within the bin, with interpolation between neighbouring voxels
+  const VoxelsOnCartesianGrid<float>& image =
+    dynamic_cast<const VoxelsOnCartesianGrid<float>&>(*this->_density_sptr);
+  const Bin bin(this->_proj_data_info_sptr->get_max_segment_num(),0,0,0);
+  return this->_proj_data_info_sptr->get_sampling_in_s(bin) +
+    this->_proj_data_info_sptr->get_sampling_in_m(bin) +
+    norm(image.get_voxel_size());
+}
+
 const DataSymmetriesForViewSegmentNumbers * 
 ForwardProjectorByBinUsingRayTracing::get_symmetries_used() const
 {
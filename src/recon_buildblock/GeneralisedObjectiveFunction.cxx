@@ -436,6 +436,86 @@ accumulate_sub_Hessian_times_input_without_penalty(TargetT& output,
           subset_num);
 }
 
+template <typename TargetT>
+Succeeded
+GeneralisedObjectiveFunction<TargetT>::
+accumulate_Hessian_times_inputs_without_penalty(const std::vector<shared_ptr<TargetT> >& outputs,
+                                                const TargetT& current_image_estimate,
+                                                const std::vector<shared_ptr<const TargetT> >& inputs) const
+{
+  for (int subset_num=0; subset_num<this->get_num_subsets(); ++subset_num)
+  {
+    if (this->accumulate_sub_Hessian_times_inputs_without_penalty(outputs,
+            current_image_estimate, inputs, subset_num) ==  Succeeded::no)
+      return Succeeded::no;
+  }
+  return Succeeded::yes;
+}
+
+template <typename TargetT>
+Succeeded
+GeneralisedObjectiveFunction<TargetT>::
+accumulate_sub_Hessian_times_inputs_without_penalty(const std::vector<shared_ptr<TargetT> >& outputs,
+                                                    const TargetT& current_image_estimate,
+                                                    const std::vector<shared_ptr<const TargetT> >& inputs,
+                                                    const int subset_num) const
+{
+  if (subset_num<0 || subset_num>=this->get_num_subsets())
+    error("accumulate_sub_Hessian_times_inputs_without_penalty subset_num out-of-range error");
+
+  if (outputs.size() != inputs.size())
+    error("accumulate_sub_Hessian_times_inputs_without_penalty: number of outputs (%d) and inputs (%d) differ",
+          static_cast<int>(outputs.size()), static_cast<int>(inputs.size()));
+
+  for (std::size_t k=0; k<inputs.size(); ++k)
+  {
+    if (is_null_ptr(outputs[k]) || is_null_ptr(inputs[k]))
+      error("accumulate_sub_Hessian_times_inputs_without_penalty: null pointer for input or output");
+
+    string explanation;
+    if (!outputs[k]->has_same_characteristics(*inputs[k], explanation)) {
+      warning("GeneralisedObjectiveFunction:\n"
+              "input and output for accumulate_sub_Hessian_times_inputs_without_penalty\n"
+              "should have the same characteristics.\n%s",
+              explanation.c_str());
+      return Succeeded::no;
+    }
+
+    if (!outputs[k]->has_same_characteristics(current_image_estimate, explanation)) {
+      warning("GeneralisedObjectiveFunction:\n"
+              "current_image_estimate and output for accumulate_sub_Hessian_times_inputs_without_penalty\n"
+              "should have the same characteristics.\n%s",
+              explanation.c_str());
+      return Succeeded::no;
+    }
+  }
+
+  if (inputs.empty())
+    return Succeeded::yes;
+
+  return this->actual_accumulate_sub_Hessian_times_inputs_without_penalty(outputs,
+          current_image_estimate,
+          inputs,
+          subset_num);
+}
+
+template <typename TargetT>
+Succeeded
+GeneralisedObjectiveFunction<TargetT>::
+actual_accumulate_sub_Hessian_times_inputs_without_penalty(const std::vector<shared_ptr<TargetT> >& outputs,
+                                                           const TargetT& current_image_estimate,
+                                                           const std::vector<shared_ptr<const TargetT> >& inputs,
+                                                           const int subset_num) const
+{
+  for (std::size_t k=0; k<inputs.size(); ++k)
+  {
+    if (this->actual_accumulate_sub_Hessian_times_input_without_penalty(*outputs[k],
+            current_image_estimate, *inputs[k], subset_num) == Succeeded::no)
+      return Succeeded::no;
+  }
+  return Succeeded::yes;
+}
+
 template <typename TargetT>
 Succeeded
 GeneralisedObjectiveFunction<TargetT>::
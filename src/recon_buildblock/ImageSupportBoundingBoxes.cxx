@@ -0,0 +1,240 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Implementation of class stir::ImageSupportBoundingBoxes
+
+  \author agent
+*/
+
+#include "stir/recon_buildblock/ImageSupportBoundingBoxes.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/LOREndPoints.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+START_NAMESPACE_STIR
+
+namespace {
+
+//! restricts [t_min,t_max] to the values of t for which start + t*dir is in [low,high]
+/*! returns \c false if the resulting interval is empty */
+inline bool
+clip_to_slab(double& t_min, double& t_max,
+             const double start, const double dir, const double low, const double high)
+{
+  if (dir == 0)
+    return low <= start && start <= high;
+  double t_low = (low - start)/dir;
+  double t_high = (high - start)/dir;
+  if (t_low > t_high)
+    std::swap(t_low, t_high);
+  t_min = std::max(t_min, t_low);
+  t_max = std::min(t_max, t_high);
+  return t_min <= t_max;
+}
+
+} // end of anonymous namespace
+
+ImageSupportBoundingBoxes::
+ImageSupportBoundingBoxes(const DiscretisedDensity<3,float>& density)
+  : empty(true), all_supported(false),
+    first_z(0.F), voxel_size_z(1.F), min_z(0.F), max_z(0.F)
+{
+  const VoxelsOnCartesianGrid<float>* image_ptr =
+    dynamic_cast<const VoxelsOnCartesianGrid<float>*>(&density);
+  if (image_ptr == 0)
+    {
+      this->all_supported = true;
+      for (DiscretisedDensity<3,float>::const_full_iterator iter = density.begin_all_const();
+           iter != density.end_all_const(); ++iter)
+        if (*iter != 0)
+          {
+            this->empty = false;
+            break;
+          }
+      return;
+    }
+
+  const VoxelsOnCartesianGrid<float>& image = *image_ptr;
+  const CartesianCoordinate3D<float> voxel_size = image.get_voxel_size();
+  const CartesianCoordinate3D<float> origin = image.get_origin();
+  const int min_plane = image.get_min_index();
+  const int max_plane = image.get_max_index();
+  this->voxel_size_z = voxel_size.z();
+  // z=0 is in the middle of the image (see ParallelprojHelper)
+  this->first_z = origin.z() + min_plane*voxel_size.z() - (min_plane + max_plane)/2.F*voxel_size.z();
+
+  this->boxes.grow(min_plane, max_plane);
+  this->plane_is_empty.grow(min_plane, max_plane);
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z = min_plane; z <= max_plane; ++z)
+    {
+      int min_y = std::numeric_limits<int>::max();
+      int max_y = std::numeric_limits<int>::min();
+      int min_x = std::numeric_limits<int>::max();
+      int max_x = std::numeric_limits<int>::min();
+      for (int y = image[z].get_min_index(); y <= image[z].get_max_index(); ++y)
+        {
+          const Array<1,float>& row = image[z][y];
+          int x = row.get_min_index();
+          while (x <= row.get_max_index() && row[x] == 0)
+            ++x;
+          if (x > row.get_max_index())
+            continue;
+          int last_x = row.get_max_index();
+          while (row[last_x] == 0)
+            --last_x;
+          min_y = std::min(min_y, y);
+          max_y = y;
+          min_x = std::min(min_x, x);
+          max_x = std::max(max_x, last_x);
+        }
+      this->plane_is_empty[z] = min_y > max_y;
+      if (!this->plane_is_empty[z])
+        {
+          Box& box = this->boxes[z];
+          box.min_y = origin.y() + (min_y - .5F)*voxel_size.y();
+          box.max_y = origin.y() + (max_y + .5F)*voxel_size.y();
+          box.min_x = origin.x() + (min_x - .5F)*voxel_size.x();
+          box.max_x = origin.x() + (max_x + .5F)*voxel_size.x();
+        }
+    }
+
+  for (int z = min_plane; z <= max_plane; ++z)
+    {
+      if (this->plane_is_empty[z])
+        continue;
+      const Box& box = this->boxes[z];
+      const float centre_z = this->first_z + (z - min_plane)*voxel_size.z();
+      if (this->empty)
+        {
+          this->empty = false;
+          this->total_box = box;
+          this->min_z = centre_z - voxel_size.z()/2;
+        }
+      else
+        {
+          this->total_box.min_y = std::min(this->total_box.min_y, box.min_y);
+          this->total_box.max_y = std::max(this->total_box.max_y, box.max_y);
+          this->total_box.min_x = std::min(this->total_box.min_x, box.min_x);
+          this->total_box.max_x = std::max(this->total_box.max_x, box.max_x);
+        }
+      this->max_z = centre_z + voxel_size.z()/2;
+    }
+}
+
+bool
+ImageSupportBoundingBoxes::
+intersects(const float z1, const float y1, const float x1,
+           const float z2, const float y2, const float x2,
+           const float margin) const
+{
+  if (this->empty)
+    return false;
+  if (this->all_supported)
+    return true;
+
+  const double dz = z2 - z1;
+  const double dy = y2 - y1;
+  const double dx = x2 - x1;
+  // first clip the (infinite) line with the box of the whole support
+  double t_min = -std::numeric_limits<double>::max();
+  double t_max = std::numeric_limits<double>::max();
+  if (!clip_to_slab(t_min, t_max, z1, dz, this->min_z - margin, this->max_z + margin) ||
+      !clip_to_slab(t_min, t_max, y1, dy, this->total_box.min_y - margin, this->total_box.max_y + margin) ||
+      !clip_to_slab(t_min, t_max, x1, dx, this->total_box.min_x - margin, this->total_box.max_x + margin))
+    return false;
+
+  // now check the boxes of the planes that the remaining part of the line crosses
+  const double z_start = z1 + t_min*dz;
+  const double z_end = z1 + t_max*dz;
+  const int min_plane = this->boxes.get_min_index();
+  const int first_plane =
+    std::max(min_plane,
+             min_plane + static_cast<int>(std::ceil((std::min(z_start, z_end) - margin - this->first_z)/this->voxel_size_z - .5)));
+  const int last_plane =
+    std::min(this->boxes.get_max_index(),
+             min_plane + static_cast<int>(std::floor((std::max(z_start, z_end) + margin - this->first_z)/this->voxel_size_z + .5)));
+  for (int z = first_plane; z <= last_plane; ++z)
+    {
+      if (this->plane_is_empty[z])
+        continue;
+      const Box& box = this->boxes[z];
+      const double centre_z = this->first_z + (z - min_plane)*this->voxel_size_z;
+      double t_min_plane = t_min;
+      double t_max_plane = t_max;
+      if (clip_to_slab(t_min_plane, t_max_plane, z1, dz,
+                       centre_z - this->voxel_size_z/2 - margin, centre_z + this->voxel_size_z/2 + margin) &&
+          clip_to_slab(t_min_plane, t_max_plane, y1, dy, box.min_y - margin, box.max_y + margin) &&
+          clip_to_slab(t_min_plane, t_max_plane, x1, dx, box.min_x - margin, box.max_x + margin))
+        return true;
+    }
+  return false;
+}
+
+bool
+ImageSupportBoundingBoxes::
+find_range_of_LORs_intersecting_support(int& min_axial_pos_num, int& max_axial_pos_num,
+                                        int& min_tangential_pos_num, int& max_tangential_pos_num,
+                                        const ProjDataInfo& proj_data_info,
+                                        const int view_num, const int segment_num,
+                                        const float margin) const
+{
+  if (this->empty)
+    return false;
+  if (this->all_supported)
+    {
+      min_axial_pos_num = proj_data_info.get_min_axial_pos_num(segment_num);
+      max_axial_pos_num = proj_data_info.get_max_axial_pos_num(segment_num);
+      min_tangential_pos_num = proj_data_info.get_min_tangential_pos_num();
+      max_tangential_pos_num = proj_data_info.get_max_tangential_pos_num();
+      return true;
+    }
+
+  const shared_ptr<const LOREndPoints> lors_sptr = proj_data_info.get_LOR_endpoints(view_num, segment_num);
+  const LOREndPoints& lors = *lors_sptr;
+  bool found = false;
+  std::size_t lor_index = 0;
+  for (int axial_pos_num = proj_data_info.get_min_axial_pos_num(segment_num);
+       axial_pos_num <= proj_data_info.get_max_axial_pos_num(segment_num);
+       ++axial_pos_num)
+    for (int tangential_pos_num = proj_data_info.get_min_tangential_pos_num();
+         tangential_pos_num <= proj_data_info.get_max_tangential_pos_num();
+         ++tangential_pos_num, ++lor_index)
+      {
+        if (!this->intersects(lors.z1[lor_index], lors.y1[lor_index], lors.x1[lor_index],
+                              lors.z2[lor_index], lors.y2[lor_index], lors.x2[lor_index],
+                              margin))
+          continue;
+        if (!found)
+          {
+            found = true;
+            min_axial_pos_num = max_axial_pos_num = axial_pos_num;
+            min_tangential_pos_num = max_tangential_pos_num = tangential_pos_num;
+          }
+        else
+          {
+            max_axial_pos_num = axial_pos_num;
+            min_tangential_pos_num = std::min(min_tangential_pos_num, tangential_pos_num);
+            max_tangential_pos_num = std::max(max_tangential_pos_num, tangential_pos_num);
+          }
+      }
+  return found;
+}
+
+END_NAMESPACE_STIR
@@ -21,8 +21,7 @@
 #include "stir/recon_buildblock/Parallelproj_projector/ParallelprojHelper.h"
 #include "stir/ProjData.h"
 #include "stir/VoxelsOnCartesianGrid.h"
-#include "stir/LORCoordinates.h"
-#include "stir/Bin.h"
+#include "stir/LOREndPoints.h"
 
 // for debugging, remove later
 #include "stir/info.h"
@@ -70,42 +69,45 @@ detail::ParallelprojHelper::ParallelprojHelper(const ProjDataInfo& p_info, const
   copy_to_array(coord_first_voxel*rescale, origin);
 
   // loop over all LORs in the projdata
-  Bin bin;
-  LORInAxialAndNoArcCorrSinogramCoordinates<float> lor;
-  LORAs2Points<float> lor_points;
-  const float radius = p_info.get_scanner_sptr()->get_inner_ring_radius();
-
   // warning: next loop needs to be the same as how ProjDataInMemory stores its data. There is no guarantee that this will remain the case in the future.
   const auto segment_sequence = ProjData::standard_segment_sequence(p_info);
-  std::size_t index(0);
+  // use a copy with the LOR end-points cache enabled, such that the end-points of a segment are computed
+  // (in parallel) by the first get_LOR_endpoints() call, and the other views then only access the cache
+  shared_ptr<ProjDataInfo> cached_p_info_sptr(p_info.clone());
+  const int num_views = p_info.get_num_views();
+  const int num_tangential_poss = p_info.get_num_tangential_poss();
+  std::size_t segment_offset(0);
   for (int seg : segment_sequence)
     {
-      bin.segment_num() = seg;
-      for (bin.axial_pos_num() = p_info.get_min_axial_pos_num(bin.segment_num()); bin.axial_pos_num() <= p_info.get_max_axial_pos_num(bin.segment_num()); ++bin.axial_pos_num())
+      const int num_axial_poss = p_info.get_num_axial_poss(seg);
+      // (re)enabling the cache removes the previous segment from memory
+      cached_p_info_sptr->set_LOR_endpoints_cache_enabled(true);
+      cached_p_info_sptr->get_LOR_endpoints(p_info.get_min_view_num(), seg);
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (int view_num = p_info.get_min_view_num(); view_num <= p_info.get_max_view_num(); ++view_num)
         {
-          for (bin.view_num() = p_info.get_min_view_num(); bin.view_num() <= p_info.get_max_view_num(); ++bin.view_num())
+          const shared_ptr<const LOREndPoints> end_points_sptr = cached_p_info_sptr->get_LOR_endpoints(view_num, seg);
+          const LOREndPoints& end_points = *end_points_sptr;
+          std::size_t lor_index(0);
+          for (int a = 0; a < num_axial_poss; ++a)
             {
-              for (bin.tangential_pos_num() = p_info.get_min_tangential_pos_num(); bin.tangential_pos_num() <= p_info.get_max_tangential_pos_num(); ++bin.tangential_pos_num())
+              // data are stored as [axial_pos][view][tangential_pos], with 3 coordinates per LOR
+              std::size_t index =
+                3*(segment_offset + (static_cast<std::size_t>(a)*num_views + view_num - p_info.get_min_view_num())*num_tangential_poss);
+              for (int t = 0; t < num_tangential_poss; ++t, ++lor_index)
                 {
-                  p_info.get_LOR(lor, bin);
-                  lor.get_intersections_with_cylinder(lor_points, radius);
-                  const CartesianCoordinate3D<float> p1 = lor_points.p1()*rescale;
-                  const CartesianCoordinate3D<float> p2 = lor_points.p2()*rescale;
-#if 0
-                  if (index+2 > xstart.size())
-                    error("That went wrong: index " + std::to_string(index) + ", xstart size " + std::to_string(xstart.size()));
-                  if (index+2 > xend.size())
-                    error("That went wrong: index " + std::to_string(index) + ", xend size " + std::to_string(xstart.size()));
-#endif
-                  xstart[index] = p1[1];
-                  xend[index++] = p2[1];
-                  xstart[index] = p1[2];
-                  xend[index++] = p2[2];
-                  xstart[index] = p1[3];
-                  xend[index++] = p2[3];
+                  xstart[index] = end_points.z1[lor_index]*rescale;
+                  xend[index++] = end_points.z2[lor_index]*rescale;
+                  xstart[index] = end_points.y1[lor_index]*rescale;
+                  xend[index++] = end_points.y2[lor_index]*rescale;
+                  xstart[index] = end_points.x1[lor_index]*rescale;
+                  xend[index++] = end_points.x2[lor_index]*rescale;
                 }
             }
         }
+      segment_offset += static_cast<std::size_t>(num_axial_poss)*num_views*num_tangential_poss;
     }
 
   info("done", 2);
@@ -27,13 +27,47 @@
 #include "stir/modelling/ParametricDiscretisedDensity.h"
 #include "stir/modelling/KineticParameters.h"
 #include "stir/info.h"
+#include "stir/warning.h"
+#include "stir/stream.h"
+#include "stir/DiscretisedDensityOnCartesianGrid.h"
+#include "stir/FNV1aHash.h"
 #include "boost/format.hpp"
 #include "boost/lexical_cast.hpp"
+#include <fstream>
+#include <sstream>
+#include <iterator>
 
 using std::string;
 
 START_NAMESPACE_STIR
 
+namespace {
+
+std::string
+sensitivity_cache_target_description(const DiscretisedDensity<3,float>& target)
+{
+  std::ostringstream s;
+  BasicCoordinate<3,int> min_indices, max_indices;
+  if (target.get_regular_range(min_indices, max_indices))
+    s << "index range: " << min_indices << " to " << max_indices << '\n';
+  else
+    s << "irregular index range\n";
+  s << "origin: " << target.get_origin() << '\n';
+  const DiscretisedDensityOnCartesianGrid<3,float>* cartesian_ptr =
+    dynamic_cast<const DiscretisedDensityOnCartesianGrid<3,float>*>(&target);
+  if (cartesian_ptr != 0)
+    s << "grid spacing: " << cartesian_ptr->get_grid_spacing() << '\n';
+  return s.str();
+}
+
+std::string
+sensitivity_cache_target_description(const ParametricVoxelsOnCartesianGrid& target)
+{
+  return "parametric image\n" + sensitivity_cache_target_description(target.construct_single_density(1));
+}
+
+} // end of anonymous namespace
+
 template<typename TargetT>
 void
 PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
@@ -45,6 +79,9 @@ set_defaults()
   this->subsensitivity_filenames = "";  
   this->recompute_sensitivity = false;
   this->use_subset_sensitivities = true;
+  this->sensitivity_cache_directory = "";
+  this->sensitivity_cache_filename_prefix = "";
+  this->sensitivity_read_from_cache = false;
   this->subsensitivity_sptrs.resize(0);
 }
 
@@ -59,6 +96,7 @@ initialise_keymap()
   this->parser.add_key("subset sensitivity filenames", &this->subsensitivity_filenames);
   this->parser.add_key("recompute sensitivity", &this->recompute_sensitivity);
   this->parser.add_key("use_subset_sensitivities", &this->use_subset_sensitivities);
+  this->parser.add_key("sensitivity cache directory", &this->sensitivity_cache_directory);
 
 }
 
@@ -116,6 +154,38 @@ set_subsensitivity_filenames(const std::string& filenames)
 }
 
 
+template<typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
+get_sensitivity_cache_directory() const
+{
+  return this->sensitivity_cache_directory;
+}
+
+template<typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
+get_sensitivity_cache_filename_prefix() const
+{
+  return this->sensitivity_cache_filename_prefix;
+}
+
+template<typename TargetT>
+bool
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
+get_sensitivity_read_from_cache() const
+{
+  return this->sensitivity_read_from_cache;
+}
+
+template<typename TargetT>
+void
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
+set_sensitivity_cache_directory(const std::string& directory)
+{
+  this->sensitivity_cache_directory = directory;
+}
+
 template<typename TargetT>
 shared_ptr<TargetT> 
 PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
@@ -190,6 +260,8 @@ set_up(shared_ptr<TargetT> const& target_sptr)
     return Succeeded::no;
 
   this->subsensitivity_sptrs.resize(this->num_subsets);
+  this->sensitivity_cache_filename_prefix = "";
+  this->sensitivity_read_from_cache = false;
 
   if(!this->recompute_sensitivity)
     {      
@@ -300,17 +372,36 @@ set_up(shared_ptr<TargetT> const& target_sptr)
       return Succeeded::no;
     }
 
+  std::string cache_description;
+  if (this->recompute_sensitivity && !this->sensitivity_cache_directory.empty())
+    {
+      cache_description = this->get_full_sensitivity_cache_description(*target_sptr);
+      if (cache_description.empty())
+        warning("PoissonLogLikelihoodWithLinearModelForMean: 'sensitivity cache directory' is set, but this "
+                "objective function does not support caching the sensitivity. The cache will not be used.");
+      else
+        {
+          this->sensitivity_cache_filename_prefix =
+            this->construct_sensitivity_cache_filename_prefix(cache_description);
+          this->sensitivity_read_from_cache =
+            this->read_sensitivities_from_cache(cache_description, *target_sptr) == Succeeded::yes;
+        }
+    }
+
   if(this->recompute_sensitivity)
     {
-      info("Computing sensitivity");
-      CPUTimer sens_timer;
-      sens_timer.start();
-      // preallocate one such that compute_sensitivities knows the size
-      this->subsensitivity_sptrs[0].reset(target_sptr->get_empty_copy());
-      this->compute_sensitivities();
-      sens_timer.stop();
-      info("Done computing sensitivity");
-      info("This took " + boost::lexical_cast<std::string>(sens_timer.value()) + " seconds CPU time.");
+      if (!this->sensitivity_read_from_cache)
+        {
+          info("Computing sensitivity");
+          CPUTimer sens_timer;
+          sens_timer.start();
+          // preallocate one such that compute_sensitivities knows the size
+          this->subsensitivity_sptrs[0].reset(target_sptr->get_empty_copy());
+          this->compute_sensitivities();
+          sens_timer.stop();
+          info("Done computing sensitivity");
+          info("This took " + boost::lexical_cast<std::string>(sens_timer.value()) + " seconds CPU time.");
+        }
 
       // write to file
       try
@@ -346,11 +437,149 @@ set_up(shared_ptr<TargetT> const& target_sptr)
           error("Error writing sensitivity to file:\n%s", e.what());
           return Succeeded::no;
         }
+
+      if (!cache_description.empty() && !this->sensitivity_read_from_cache)
+        this->write_sensitivities_to_cache(cache_description);
     }
       
   return Succeeded::yes;
 }
 
+template<typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
+get_sensitivity_cache_description()
+{
+  return "";
+}
+
+template<typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
+get_full_sensitivity_cache_description(const TargetT& target)
+{
+  const std::string description = this->get_sensitivity_cache_description();
+  if (description.empty())
+    return description;
+
+  std::ostringstream s;
+  s << description
+    << "\nnumber of subsets: " << this->get_num_subsets()
+    << "\nuse subset sensitivities: " << this->get_use_subset_sensitivities()
+    << "\n" << sensitivity_cache_target_description(target);
+  return s.str();
+}
+
+template<typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
+construct_sensitivity_cache_filename_prefix(const std::string& description) const
+{
+  FNV1aHash hash;
+  hash.add(description);
+  return (boost::format("%1%/sensitivity_%2$016x")
+          % this->sensitivity_cache_directory % hash.get_value()).str();
+}
+
+template<typename TargetT>
+Succeeded
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
+read_sensitivities_from_cache(const std::string& description, const TargetT& target)
+{
+  const std::string prefix = this->construct_sensitivity_cache_filename_prefix(description);
+  {
+    std::ifstream description_file((prefix + ".txt").c_str());
+    if (!description_file)
+      {
+        info(boost::format("No sensitivity found in cache '%1%'") % prefix, 2);
+        return Succeeded::no;
+      }
+    const std::string cached_description((std::istreambuf_iterator<char>(description_file)),
+                                         std::istreambuf_iterator<char>());
+    if (cached_description != description)
+      {
+        warning(boost::format("Sensitivity cache '%1%' was created for a different configuration. It will be overwritten.")
+                % prefix);
+        return Succeeded::no;
+      }
+  }
+
+  try
+    {
+      string explanation;
+      if (this->get_use_subset_sensitivities())
+        {
+          for (int subset=0; subset<this->get_num_subsets(); ++subset)
+            {
+              const std::string filename = (boost::format("%1%_subset%2%.hv") % prefix % subset).str();
+              info(boost::format("Reading sensitivity from cache '%1%'") % filename);
+              this->subsensitivity_sptrs[subset] = read_from_file<TargetT>(filename);
+              if (!target.has_same_characteristics(*this->subsensitivity_sptrs[subset], explanation))
+                {
+                  warning("Sensitivity in cache and target should have the same characteristics.\n%s",
+                          explanation.c_str());
+                  return Succeeded::no;
+                }
+            }
+        }
+      else
+        {
+          const std::string filename = prefix + ".hv";
+          info(boost::format("Reading sensitivity from cache '%1%'") % filename);
+          this->sensitivity_sptr = read_from_file<TargetT>(filename);
+          if (!target.has_same_characteristics(*this->sensitivity_sptr, explanation))
+            {
+              warning("Sensitivity in cache and target should have the same characteristics.\n%s",
+                      explanation.c_str());
+              return Succeeded::no;
+            }
+        }
+    }
+  catch (std::exception& e)
+    {
+      warning("Error reading sensitivity from cache:\n%s", e.what());
+      return Succeeded::no;
+    }
+  // compute total from subsensitivity or vice versa
+  this->set_total_or_subset_sensitivities();
+  return Succeeded::yes;
+}
+
+template<typename TargetT>
+void
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
+write_sensitivities_to_cache(const std::string& description) const
+{
+  const std::string prefix = this->construct_sensitivity_cache_filename_prefix(description);
+  try
+    {
+      if (this->get_use_subset_sensitivities())
+        {
+          for (int subset=0; subset<this->get_num_subsets(); ++subset)
+            {
+              const std::string filename = (boost::format("%1%_subset%2%.hv") % prefix % subset).str();
+              info(boost::format("Writing sensitivity to cache '%1%'") % filename);
+              write_to_file(filename, this->get_subset_sensitivity(subset));
+            }
+        }
+      else
+        {
+          const std::string filename = prefix + ".hv";
+          info(boost::format("Writing sensitivity to cache '%1%'") % filename);
+          write_to_file(filename, this->get_sensitivity());
+        }
+      // write description last, such that an incomplete cache is never used
+      std::ofstream description_file((prefix + ".txt").c_str());
+      description_file << description;
+      if (!description_file)
+        warning(boost::format("Error writing sensitivity cache description '%1%.txt'") % prefix);
+    }
+  catch (std::exception& e)
+    {
+      warning("Error writing sensitivity to cache:\n%s", e.what());
+    }
+}
+
 template<typename TargetT>
 void
 PoissonLogLikelihoodWithLinearModelForMean<TargetT>::
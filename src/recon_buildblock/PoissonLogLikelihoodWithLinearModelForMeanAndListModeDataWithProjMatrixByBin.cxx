@@ -21,6 +21,8 @@
 #include "stir/recon_buildblock/PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin.h" 
 #include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h" 
 #include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinWithOffsets.h"
+#include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/recon_buildblock/ProjectorByBinPairUsingProjMatrixByBin.h"
 #include "stir/ProjDataInfoCylindricalNoArcCorr.h"
 #include "stir/ProjData.h"
@@ -240,6 +242,22 @@ set_up_before_sensitivity(shared_ptr <const TargetT > const& target_sptr)
 } 
  
  
+template <typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::
+get_sensitivity_cache_description()
+{
+    std::ostringstream s;
+    s << "objective function type: " << registered_name
+      << "\nmaximum ring difference to process: " << this->max_ring_difference_num_to_process
+      << "\n" << this->proj_data_info_sptr->parameter_info()
+      << "\n" << this->PM_sptr->parameter_info()
+      << "\n" << this->normalisation_sptr->parameter_info()
+      << "\ntime frame: " << this->frame_defs.get_start_time(this->current_frame_num)
+      << " - " << this->frame_defs.get_end_time(this->current_frame_num);
+    return s.str();
+}
+
 template <typename TargetT>  
 bool  
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::post_processing() 
@@ -762,6 +780,33 @@ actual_compute_subset_gradient_without_penalty(TargetT& gradient,
 
         ProjMatrixElemsForOneBin proj_matrix_row;
         gradient.fill(0);
+
+        // If possible, use images with contiguous storage such that the offsets of the voxels in a row
+        // are computed once per event and used for forward and back projection.
+        // The back projection is then accumulated in a separate image and added to the gradient at the end.
+        ProjMatrixElemsForOneBinWithOffsets proj_matrix_row_with_offsets;
+        shared_ptr<VoxelsOnCartesianGrid<float> > contiguous_estimate_sptr;
+        shared_ptr<VoxelsOnCartesianGrid<float> > contiguous_gradient_sptr;
+        {
+          const VoxelsOnCartesianGrid<float>* estimate_voxels_ptr =
+            dynamic_cast<const VoxelsOnCartesianGrid<float>*>(&current_estimate);
+          if (estimate_voxels_ptr != 0 && estimate_voxels_ptr->has_same_characteristics(gradient))
+            {
+              contiguous_estimate_sptr.reset(estimate_voxels_ptr->clone());
+              contiguous_estimate_sptr->make_contiguous();
+              contiguous_gradient_sptr.reset(contiguous_estimate_sptr->get_empty_copy());
+            }
+        }
+        const float* const estimate_data_ptr =
+          is_null_ptr(contiguous_estimate_sptr) ? 0 : contiguous_estimate_sptr->get_contiguous_data_ptr();
+        float* const gradient_data_ptr =
+          is_null_ptr(contiguous_gradient_sptr) ? 0 : contiguous_gradient_sptr->get_contiguous_data_ptr();
+        const bool use_offsets = estimate_data_ptr != 0 && gradient_data_ptr != 0;
+        const BasicCoordinate<3,int> min_indices =
+          use_offsets ? contiguous_estimate_sptr->get_min_indices() : make_coordinate(0,0,0);
+        const BasicCoordinate<3,int> lengths =
+          use_offsets ? contiguous_estimate_sptr->get_lengths() : make_coordinate(0,0,0);
+
         shared_ptr<ListRecord> record_sptr = this->list_mode_data_sptr->get_empty_record_sptr();
         ListRecord& record = *record_sptr;
 
@@ -820,7 +865,13 @@ actual_compute_subset_gradient_without_penalty(TargetT& gradient,
                //in_the_range++;
                Bin fwd_bin;
                fwd_bin.set_bin_value(0.0f);
-               proj_matrix_row.forward_project(fwd_bin,current_estimate);
+               if (use_offsets)
+               {
+                   proj_matrix_row_with_offsets.set(proj_matrix_row, min_indices, lengths);
+                   proj_matrix_row_with_offsets.forward_project(fwd_bin, estimate_data_ptr);
+               }
+               else
+                   proj_matrix_row.forward_project(fwd_bin,current_estimate);
                // additive sinogram
                if (!is_null_ptr(this->additive_proj_data_sptr))
                {
@@ -844,10 +895,15 @@ actual_compute_subset_gradient_without_penalty(TargetT& gradient,
                    continue;
 
                measured_bin.set_bin_value(measured_div_fwd);
-               proj_matrix_row.back_project(gradient, measured_bin);
+               if (use_offsets)
+                   proj_matrix_row_with_offsets.back_project(gradient_data_ptr, measured_bin);
+               else
+                   proj_matrix_row.back_project(gradient, measured_bin);
 
            }
        }
+       if (use_offsets)
+           gradient += *contiguous_gradient_sptr;
        info(boost::format("Number of used events: %1%") % num_used_events);
 
     }
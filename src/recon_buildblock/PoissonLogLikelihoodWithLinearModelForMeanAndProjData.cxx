@@ -127,6 +127,8 @@ set_defaults()
 #ifdef STIR_MPI
   //distributed stuff
   this->distributed_cache_enabled = false;
+  this->distributed_cache_shared_on_node = false;
+  this->distributed_image_reduction_uses_bounding_box = false;
   this->distributed_tests_enabled = false;
   this->message_timings_enabled = false;
   this->message_timings_threshold = 0.1;
@@ -161,6 +163,8 @@ initialise_keymap()
 #ifdef STIR_MPI
   //distributed stuff 
   this->parser.add_key("enable distributed caching", &distributed_cache_enabled);
+  this->parser.add_key("share distributed cache between processes on the same node", &distributed_cache_shared_on_node);
+  this->parser.add_key("use bounding box for distributed image reduction", &distributed_image_reduction_uses_bounding_box);
   this->parser.add_key("enable distributed tests", &distributed_tests_enabled);
   this->parser.add_key("enable message timings", &message_timings_enabled);
   this->parser.add_key("message timings threshold", &message_timings_threshold);
@@ -231,6 +235,13 @@ post_processing()
    if (this->distributed_cache_enabled==true) 
      info("Will use distributed caching!");
    else info("Distributed caching is disabled. Will use standard distributed version without forced caching!");
+   if (this->distributed_cache_shared_on_node==true)
+     {
+       if (this->distributed_cache_enabled==true)
+         info("Distributed cache will be shared between processes on the same node.");
+       else
+         warning("Sharing the distributed cache between processes on the same node has no effect when distributed caching is disabled.");
+     }
    
 #ifndef NDEBUG 
    //check tests enabled value
@@ -518,6 +529,23 @@ actual_subsets_are_approximately_balanced(std::string& warning_message) const
   return true;
 }
 
+template<typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMeanAndProjData<TargetT>::
+get_sensitivity_cache_description()
+{
+  std::ostringstream s;
+  s << "objective function type: " << registered_name
+    << "\nmaximum absolute segment number to process: " << this->max_segment_num_to_process
+    << "\n" << this->proj_data_sptr->get_proj_data_info_sptr()->parameter_info()
+    << "\n" << this->projector_pair_ptr->parameter_info()
+    << "\n" << this->normalisation_sptr->parameter_info()
+    << "\nzero end planes of segment 0: " << this->zero_seg0_end_planes
+    << "\ntime frame: " << this->frame_defs.get_start_time(this->frame_num)
+    << " - " << this->frame_defs.get_end_time(this->frame_num);
+  return s.str();
+}
+
 /***************************************************************
   set_up()
 ***************************************************************/
@@ -552,18 +580,26 @@ set_up_before_sensitivity(shared_ptr<const TargetT > const& target_sptr)
 
   // set projectors to be used for the calculations
 
+#ifdef STIR_MPI
+  // needs to be set before setup_distributable_computation, which sends it to the slaves
+  distributed::image_reduction_uses_bounding_box = this->distributed_image_reduction_uses_bounding_box;
+#endif
   setup_distributable_computation(this->projector_pair_ptr,
                                   this->proj_data_sptr->get_exam_info_sptr(),
                                   this->proj_data_sptr->get_proj_data_info_sptr(),
                                   target_sptr,
                                   zero_seg0_end_planes,
-                                  distributed_cache_enabled);
+                                  distributed_cache_enabled,
+                                  distributed_cache_shared_on_node);
         
 #ifdef STIR_MPI
   //set up distributed caching object
   if (distributed_cache_enabled) 
     {
-      this->caching_info_ptr = new DistributedCachingInformation(distributed::num_processors);
+      if (distributed_cache_shared_on_node)
+        this->caching_info_ptr = new DistributedCachingInformation(distributed::num_processors, distributed::node_nums);
+      else
+        this->caching_info_ptr = new DistributedCachingInformation(distributed::num_processors);
     }
   else caching_info_ptr = NULL;
 #else 
@@ -737,7 +773,9 @@ add_subset_sensitivity(TargetT& sensitivity, const int subset_num) const
                                  this->normalisation_sptr, 
                                  this->get_time_frame_definitions().get_start_time(this->get_time_frame_num()),
                                  this->get_time_frame_definitions().get_end_time(this->get_time_frame_num()),
-                                 this->caching_info_ptr
+                                 // don't use the distributed cache, as the workers would otherwise
+                                 // re-use sens_proj_data_sptr instead of the measured data
+                                 /* caching_info_ptr */ NULL
                                  );
   std::transform(sensitivity.begin_all(), sensitivity.end_all(), 
                  sensitivity_this_subset_sptr->begin_all(), sensitivity.begin_all(), 
@@ -955,107 +993,140 @@ actual_accumulate_sub_Hessian_times_input_without_penalty(TargetT& output,
     }
   }
 
+  return
+    this->accumulate_sub_Hessian_times_inputs(std::vector<TargetT*>(1, &output),
+                                              current_image_estimate,
+                                              std::vector<const TargetT*>(1, &input),
+                                              subset_num);
+}
+
+template<typename TargetT>
+Succeeded
+PoissonLogLikelihoodWithLinearModelForMeanAndProjData<TargetT>::
+actual_accumulate_sub_Hessian_times_inputs_without_penalty(const std::vector<shared_ptr<TargetT> >& outputs,
+                                                           const TargetT& current_image_estimate,
+                                                           const std::vector<shared_ptr<const TargetT> >& inputs,
+                                                           const int subset_num) const
+{
+  { // check characteristics (other checks are done in accumulate_sub_Hessian_times_inputs_without_penalty)
+    std::string explanation;
+    if (!current_image_estimate.has_same_characteristics(this->get_sensitivity(),explanation))
+    {
+      error("PoissonLogLikelihoodWithLinearModelForMeanAndProjData:\n"
+            "sensitivity and current_image_estimate for accumulate_sub_Hessian_times_inputs_without_penalty\n"
+            "should have the same characteristics.\n%s",
+            explanation.c_str());
+      return Succeeded::no;
+    }
+  }
+
+  std::vector<TargetT*> output_ptrs(outputs.size());
+  std::vector<const TargetT*> input_ptrs(inputs.size());
+  for (std::size_t k=0; k<inputs.size(); ++k)
+  {
+    output_ptrs[k] = outputs[k].get();
+    input_ptrs[k] = inputs[k].get();
+  }
+  return
+    this->accumulate_sub_Hessian_times_inputs(output_ptrs, current_image_estimate, input_ptrs, subset_num);
+}
+
+template<typename TargetT>
+Succeeded
+PoissonLogLikelihoodWithLinearModelForMeanAndProjData<TargetT>::
+accumulate_sub_Hessian_times_inputs(const std::vector<TargetT*>& outputs,
+                                    const TargetT& current_image_estimate,
+                                    const std::vector<const TargetT*>& inputs,
+                                    const int subset_num) const
+{
   shared_ptr<DataSymmetriesForViewSegmentNumbers> symmetries_sptr(
           this->get_projector_pair().get_symmetries_used()->clone());
 
-  this->get_projector_pair().get_forward_projector_sptr()->set_input(input);
-  this->get_projector_pair().get_back_projector_sptr()->start_accumulating_in_new_target();
-
   const std::vector<ViewSegmentNumbers> vs_nums_to_process =
           detail::find_basic_vs_nums_in_subset(* this->get_proj_data().get_proj_data_info_sptr(),
                                                *symmetries_sptr,
                                                -this->get_max_segment_num_to_process(),
                                                this->get_max_segment_num_to_process(),
                                                subset_num, this->get_num_subsets());
+  const int num_vs = static_cast<int>(vs_nums_to_process.size());
 
-
-
-  // Create and populate the input_viewgrams_vec with empty values.
-  // This is needed to make the order of the vector correct w.r.t vs_nums_to_process.
-  //OMP may mess this up
-  // Try:  std::vector<RelatedViewgrams<float>> input_viewgrams_vec(vs_nums_to_process.size());
-  std::vector<RelatedViewgrams<float>> input_viewgrams_vec;
-  for (int i=0; i<static_cast<int>(vs_nums_to_process.size()); ++i)
-  {
-    const ViewSegmentNumbers view_segment_num = vs_nums_to_process[i];
-    input_viewgrams_vec.push_back(this->get_proj_data().get_empty_related_viewgrams(view_segment_num, symmetries_sptr));
-  }
-
-
-  // Forward project input image
-  info("Forward projecting input image.",2);
+  // Data and ybar_sq = [ F(current_image_est) + additive ]^2 only depend on the current estimate,
+  // so we compute them once for every view/segment and use them for all inputs.
+  // To keep memory bounded, this is done for batches of view/segments at a time.
 #ifdef STIR_OPENMP
-#pragma omp parallel for schedule(dynamic)
-#endif
-  for (int i=0; i<static_cast<int>(vs_nums_to_process.size()); ++i)
-  {  // Loop over eah of the viewgrams in input_viewgrams_vec, forward projecting input into them
-#ifdef STIR_OPENMP
-    const int thread_num = omp_get_thread_num();
-    info(boost::format("Thread %d/%d calculating segment_num: %d, view_num: %d")
-         % thread_num % omp_get_num_threads()
-         % vs_nums_to_process[i].segment_num() % vs_nums_to_process[i].view_num(), 2);
+  const int max_num_vs_in_batch = 4*omp_get_max_threads();
 #else
-    info(boost::format("calculating segment_num: %d, view_num: %d")
-         % vs_nums_to_process[i].segment_num() % vs_nums_to_process[i].view_num(), 2);
+  const int max_num_vs_in_batch = 4;
 #endif
-    input_viewgrams_vec[i] = this->get_proj_data().get_empty_related_viewgrams(vs_nums_to_process[i], symmetries_sptr);
-    this->get_projector_pair().get_forward_projector_sptr()->forward_project(input_viewgrams_vec[i]);
-  }
-
+  std::vector<RelatedViewgrams<float> > data_viewgrams_vec(std::min(num_vs, max_num_vs_in_batch));
+  std::vector<RelatedViewgrams<float> > ybar_sq_viewgrams_vec(data_viewgrams_vec.size());
 
+  shared_ptr<TargetT> tmp(outputs[0]->get_empty_copy());
+  for (int batch_start = 0; batch_start < num_vs; batch_start += max_num_vs_in_batch)
+  {
+    const int num_vs_in_batch = std::min(num_vs - batch_start, max_num_vs_in_batch);
 
-  info("Forward projecting current image estimate and back projecting to output.", 2);
-  this->get_projector_pair().get_forward_projector_sptr()->set_input(current_image_estimate);
+    info("Forward projecting current image estimate.", 2);
+    this->get_projector_pair().get_forward_projector_sptr()->set_input(current_image_estimate);
 #ifdef STIR_OPENMP
 #pragma omp parallel for schedule(dynamic)
 #endif
-  for (int i = 0; i < static_cast<int>(vs_nums_to_process.size()); ++i)
-  {
+    for (int i = 0; i < num_vs_in_batch; ++i)
+    {
+      const ViewSegmentNumbers& vs_num = vs_nums_to_process[batch_start + i];
 #ifdef STIR_OPENMP
-    const int thread_num = omp_get_thread_num();
-    info(boost::format("Thread %d/%d calculating segment_num: %d, view_num: %d")
-         % thread_num % omp_get_num_threads()
-         % vs_nums_to_process[i].segment_num() % vs_nums_to_process[i].view_num(), 2);
+      const int thread_num = omp_get_thread_num();
+      info(boost::format("Thread %d/%d calculating segment_num: %d, view_num: %d")
+           % thread_num % omp_get_num_threads()
+           % vs_num.segment_num() % vs_num.view_num(), 2);
 #else
-    info(boost::format("calculating segment_num: %d, view_num: %d")
-         % vs_nums_to_process[i].segment_num() % vs_nums_to_process[i].view_num(), 2);
+      info(boost::format("calculating segment_num: %d, view_num: %d")
+           % vs_num.segment_num() % vs_num.view_num(), 2);
 #endif
-    // Compute ybar_sq_viewgram = [ F(current_image_est) + additive ]^2
-    RelatedViewgrams<float> ybar_sq_viewgram;
-    {
-      ybar_sq_viewgram = this->get_proj_data().get_empty_related_viewgrams(vs_nums_to_process[i], symmetries_sptr);
+      RelatedViewgrams<float>& ybar_sq_viewgram = ybar_sq_viewgrams_vec[i];
+      ybar_sq_viewgram = this->get_proj_data().get_empty_related_viewgrams(vs_num, symmetries_sptr);
       this->get_projector_pair().get_forward_projector_sptr()->forward_project(ybar_sq_viewgram);
 
       //add additive sinogram to forward projection
       if (!(is_null_ptr(this->get_additive_proj_data_sptr())))
-        ybar_sq_viewgram += this->get_additive_proj_data().get_related_viewgrams(vs_nums_to_process[i], symmetries_sptr);
+        ybar_sq_viewgram += this->get_additive_proj_data().get_related_viewgrams(vs_num, symmetries_sptr);
       // square ybar
       ybar_sq_viewgram *= ybar_sq_viewgram;
-    }
 
-    // Compute: final_viewgram * F(input) / ybar_sq_viewgram
-    // final_viewgram starts as measured data
-    RelatedViewgrams<float> final_viewgram = this->get_proj_data().get_related_viewgrams(vs_nums_to_process[i], symmetries_sptr);
-    {
-      // Mult input_viewgram
-      final_viewgram *= input_viewgrams_vec[i];
-      int tmp1 = 0, tmp2 = 0;// ignore counters returned by divide_and_truncate
-      // Divide final_viewgeam by ybar_sq_viewgram
-      divide_and_truncate(final_viewgram, ybar_sq_viewgram, 0, tmp1, tmp2);
+      data_viewgrams_vec[i] = this->get_proj_data().get_related_viewgrams(vs_num, symmetries_sptr);
     }
 
-    // back-project final_viewgram
-    this->get_projector_pair().get_back_projector_sptr()->
-            back_project(final_viewgram);
-
-  } // end of loop over view/segments
+    for (std::size_t k = 0; k < inputs.size(); ++k)
+    {
+      info(boost::format("Forward projecting input image %d and back projecting to output.") % k, 2);
+      this->get_projector_pair().get_forward_projector_sptr()->set_input(*inputs[k]);
+      this->get_projector_pair().get_back_projector_sptr()->start_accumulating_in_new_target();
 
-  shared_ptr<TargetT> tmp(output.get_empty_copy());
-  this->get_projector_pair().get_back_projector_sptr()->get_output(*tmp);
-  // output -= tmp;
-  std::transform(output.begin_all(), output.end_all(),
-                 tmp->begin_all(), output.begin_all(),
-                 std::minus<typename TargetT::full_value_type>());
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (int i = 0; i < num_vs_in_batch; ++i)
+      {
+        // Compute: final_viewgram = data * F(input) / ybar_sq_viewgram
+        RelatedViewgrams<float> final_viewgram =
+          this->get_proj_data().get_empty_related_viewgrams(vs_nums_to_process[batch_start + i], symmetries_sptr);
+        this->get_projector_pair().get_forward_projector_sptr()->forward_project(final_viewgram);
+        final_viewgram *= data_viewgrams_vec[i];
+        int tmp1 = 0, tmp2 = 0;// ignore counters returned by divide_and_truncate
+        divide_and_truncate(final_viewgram, ybar_sq_viewgrams_vec[i], 0, tmp1, tmp2);
+
+        // back-project final_viewgram
+        this->get_projector_pair().get_back_projector_sptr()->
+                back_project(final_viewgram);
+      } // end of loop over view/segments
+
+      this->get_projector_pair().get_back_projector_sptr()->get_output(*tmp);
+      // output -= tmp;
+      std::transform(outputs[k]->begin_all(), outputs[k]->end_all(),
+                     tmp->begin_all(), outputs[k]->begin_all(),
+                     std::minus<typename TargetT::full_value_type>());
+    } // end of loop over inputs
+  } // end of loop over batches
 
   return Succeeded::yes;
 }
@@ -1067,7 +1138,7 @@ actual_accumulate_sub_Hessian_times_input_without_penalty(TargetT& output,
 // make call-backs public for the moment
 
 //! Call-back function for compute_gradient
-RPC_process_related_viewgrams_type RPC_process_related_viewgrams_gradient;
+template<bool add_sensitivity> RPC_process_related_viewgrams_type RPC_process_related_viewgrams_gradient;
 
 //! Call-back function for accumulate_loglikelihood
 RPC_process_related_viewgrams_type RPC_process_related_viewgrams_accumulate_loglikelihood;
@@ -1340,4 +1411,10 @@ void RPC_process_related_viewgrams_sensitivity_computation(
 
 template class PoissonLogLikelihoodWithLinearModelForMeanAndProjData<DiscretisedDensity<3,float> >;
 
+#ifdef STIR_MPI
+// call-backs used by DistributedWorker
+template RPC_process_related_viewgrams_type RPC_process_related_viewgrams_gradient<true>;
+template RPC_process_related_viewgrams_type RPC_process_related_viewgrams_gradient<false>;
+#endif
+
 END_NAMESPACE_STIR
@@ -33,6 +33,10 @@
 #include "stir/Coordinate3D.h"
 #include "stir/info.h"
 #include "stir/CPUTimer.h"
+#include "stir/warning.h"
+#include "stir/error.h"
+#include "stir/spatial_transformation/InvertAxis.h"
+#include "stir/FNV1aHash.h"
 #ifdef STIR_OPENMP
 #include "stir/num_threads.h"
 #endif
@@ -53,6 +57,9 @@
 #include <stdlib.h>
 #include <math.h>
 #include <ctype.h>
+#include <cstring>
+#include <cstdio>
+#include <random>
 //#include <time.h>
 
 //... user defined libraries .............................................................
@@ -68,6 +75,91 @@ namespace SPECTUB {
 
 START_NAMESPACE_STIR
 
+namespace {
+
+const char * const matrix_cache_magic = "STIR SPECTUB matrix view v1\n";
+
+//! write the elements of all bins in a view to file
+/*! The elements are first written to a temporary file, which is then renamed, such
+    that other processes (using the same cache directory) never read an incomplete file.
+*/
+Succeeded
+write_lors_to_matrix_cache(const std::string& filename, const boost::uint64_t hash,
+                           const std::vector<ProjMatrixElemsForOneBin>& lors)
+{
+  std::random_device random_device;
+  const std::string tmp_filename = (boost::format("%1%.tmp%2$08x") % filename % random_device()).str();
+  std::ofstream cache(tmp_filename.c_str(), std::ios::binary);
+  const boost::uint64_t num_lors = lors.size();
+  cache.write(matrix_cache_magic, std::strlen(matrix_cache_magic));
+  cache.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+  cache.write(reinterpret_cast<const char *>(&num_lors), sizeof(num_lors));
+  for (std::vector<ProjMatrixElemsForOneBin>::const_iterator lor_iter = lors.begin(); lor_iter != lors.end(); ++lor_iter)
+    {
+      const Bin bin = lor_iter->get_bin();
+      const boost::int32_t header[4] =
+        { bin.view_num(), bin.axial_pos_num(), bin.tangential_pos_num(), static_cast<boost::int32_t>(lor_iter->size()) };
+      cache.write(reinterpret_cast<const char *>(header), sizeof(header));
+      for (ProjMatrixElemsForOneBin::const_iterator elem_iter = lor_iter->begin(); elem_iter != lor_iter->end(); ++elem_iter)
+        {
+          const Coordinate3D<int> c = elem_iter->get_coords();
+          const boost::int16_t coords[3] = { static_cast<boost::int16_t>(c[1]), static_cast<boost::int16_t>(c[2]), static_cast<boost::int16_t>(c[3]) };
+          const float value = elem_iter->get_value();
+          cache.write(reinterpret_cast<const char *>(coords), sizeof(coords));
+          cache.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+    }
+  cache.close();
+  bool written = !!cache;
+  if (written && std::rename(tmp_filename.c_str(), filename.c_str()) != 0)
+    {
+      // rename() does not overwrite an existing (invalid) file on all systems
+      std::remove(filename.c_str());
+      written = std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
+    }
+  if (!written)
+    std::remove(tmp_filename.c_str());
+  return written ? Succeeded::yes : Succeeded::no;
+}
+
+//! read the elements written by write_lors_to_matrix_cache()
+Succeeded
+read_lors_from_matrix_cache(std::vector<ProjMatrixElemsForOneBin>& lors,
+                            const std::string& filename, const boost::uint64_t hash)
+{
+  std::ifstream cache(filename.c_str(), std::ios::binary);
+  if (!cache)
+    return Succeeded::no;
+  std::string magic(std::strlen(matrix_cache_magic), ' ');
+  boost::uint64_t hash_in = 0, num_lors = 0;
+  cache.read(&magic[0], magic.size());
+  cache.read(reinterpret_cast<char *>(&hash_in), sizeof(hash_in));
+  cache.read(reinterpret_cast<char *>(&num_lors), sizeof(num_lors));
+  if (!cache || magic != matrix_cache_magic || hash_in != hash)
+    return Succeeded::no;
+  lors.resize(static_cast<std::size_t>(num_lors));
+  for (std::vector<ProjMatrixElemsForOneBin>::iterator lor_iter = lors.begin(); lor_iter != lors.end(); ++lor_iter)
+    {
+      boost::int32_t header[4];
+      cache.read(reinterpret_cast<char *>(header), sizeof(header));
+      if (!cache)
+        return Succeeded::no;
+      Bin bin(0, header[0], header[1], header[2], 0.F);
+      lor_iter->set_bin(bin);
+      lor_iter->reserve(header[3]);
+      for (int i=0; i<header[3]; ++i)
+        {
+          boost::int16_t coords[3];
+          float value;
+          cache.read(reinterpret_cast<char *>(coords), sizeof(coords));
+          cache.read(reinterpret_cast<char *>(&value), sizeof(value));
+          lor_iter->push_back(ProjMatrixElemsForOneBin::value_type(Coordinate3D<int>(coords[0], coords[1], coords[2]), value));
+        }
+    }
+  return cache ? Succeeded::yes : Succeeded::no;
+}
+
+} // end of anonymous namespace
 
 const char * const 
 ProjMatrixByBinSPECTUB::registered_name =
@@ -99,6 +191,7 @@ initialise_keymap()
   parser.add_key("mask type", &mask_type);
   parser.add_key("mask file", &mask_file);
   parser.add_key("keep_all_views_in_cache", &keep_all_views_in_cache);
+  parser.add_key("matrix cache directory", &matrix_cache_directory);
 
   parser.add_stop_key("End Projection Matrix By Bin SPECT UB Parameters");
 }
@@ -112,6 +205,7 @@ ProjMatrixByBinSPECTUB::set_defaults()
   this->already_setup= false;
 
   this->keep_all_views_in_cache=false;
+  this->matrix_cache_directory="";
   minimum_weight=0.0;
   maximum_number_of_sigmas= 2.;
   spatial_resolution_PSF= 0.00001;
@@ -160,6 +254,23 @@ set_keep_all_views_in_cache(bool value)
     }
 }
 
+std::string
+ProjMatrixByBinSPECTUB::
+get_matrix_cache_directory() const
+{
+  return this->matrix_cache_directory;
+}
+
+void
+ProjMatrixByBinSPECTUB::
+set_matrix_cache_directory(const std::string& value)
+{
+  if (this->matrix_cache_directory == value)
+    return;
+  this->matrix_cache_directory = value;
+  this->already_setup = false;
+}
+
 std::string
 ProjMatrixByBinSPECTUB::
 get_attenuation_type() const
@@ -240,6 +351,9 @@ set_up(
 
   ProjMatrixByBin::set_up(proj_data_info_ptr_v, density_info_ptr);
 
+  if (this->cache_disabled)
+    error("ProjMatrixByBinSPECTUB computes all elements for a view at once, and therefore needs caching to be enabled");
+
 #ifdef STIR_OPENMP
   if (!this->keep_all_views_in_cache)
     {
@@ -596,38 +710,24 @@ set_up(
 	  NITEMS[kOS] = new int [ wm.NbOS ];
 	}
 
-	//... double array wm.val and wm.col .....................................................
-
-	if ( ( wm.val = new (std::nothrow) float * [ wm.NbOS ] ) == NULL ) 
-          {
-            //error_wm_SPECT( 200, "wm.val[]" );
-            error("Error allocating space to store values for SPECTUB matrix");
-          }
-	if ( ( wm.col = new (std::nothrow) int   * [ wm.NbOS ] ) == NULL ) 
-          {
-            //error_wm_SPECT( 200, "wm.col[]" );
-            error("Error allocating space to store column indices for SPECTUB matrix");
-          }
-
-	//... array wm.ne .........................................................................
-
-	if ( ( wm.ne = new (std::nothrow) int [ wm.NbOS + 1 ]) == 0 ) 
-          {
-            // error_wm_SPECT(200,"wm.ne[]");
-            error("Error allocating space to store number of elements for SPECTUB matrix");
-          }
-
-
 	//... STIR indices .......................................................................
+	// Note: the weights themselves (wm.val etc) are allocated per subset in compute_one_subset()
 
 	if ( wm.do_save_STIR ){
-		wm.ns = new int [ prj.NbOS ];
-		wm.nb = new int [ prj.NbOS ];
-		wm.na = new int [ prj.NbOS ];
-
 		wm.nx = new short int [ vol.Nvox ];
 		wm.ny = new short int [ vol.Nvox ];
 		wm.nz = new short int [ vol.Nvox ];
+
+		//... image indices are the same for all subsets, so fill them here ...........
+		InvertAxis invert;
+		for ( int islc = 0 ; islc < vol.Nsli ; islc++ )
+		  for ( int irow = 0 ; irow < vol.Nrow ; irow++ )
+		    for ( int icol = 0 ; icol < vol.Ncol ; icol++ ){
+		      const int iv = islc * vol.Npix + irow * vol.Ncol + icol;
+		      wm.nx[ iv ] = (short int)invert.invert_axis_index(( icol - (int) floor( vol.Ncold2 ) ),vol.Ncold2*2, "x");  // centered index for STIR format
+		      wm.ny[ iv ] = (short int)( irow - (int) floor( vol.Nrowd2 ) );  // centered index for STIR format
+		      wm.nz[ iv ] = (short int)  islc ;                               // non-centered index for STIR format
+		    }
 	}
 
 	//... memory allocation for wmh .........................................................
@@ -639,16 +739,20 @@ set_up(
 	//... CALCULATION OF MATRICES ..............................................................
 	//..........................................................................................
 
-	//... LOOP: Subsets .................................................................
-	subset_already_processed.assign(prj.NOS, false);
-	for ( int kOS = 0 ; kOS < prj.NOS ; kOS++ ){
-		wmh.subset_ind = kOS;
+	//... fill wmh fields related to the (last) subset (only used for information) ....
 
-		for ( int i = 0 ; i < prj.NangOS ; i ++ ){
+	for ( int i = 0 ; i < prj.NangOS ; i ++ ){
+		wmh.index[ i ] = prj.order[ i + (prj.NOS - 1) * prj.NangOS ];
+		wmh.Rrad [ i ] = Rrad[ wmh.index[ i ] ];
+	}
+	wmh.subset_ind = prj.NOS - 1;
 
-			wmh.index[ i ] = prj.order[ i + kOS * prj.NangOS ];
-			wmh.Rrad [ i ] = Rrad[ wmh.index[ i ] ];
-		}
+	//... LOOP: Subsets (these are independent, so can be done in parallel) ...............
+	subset_already_processed.assign(prj.NOS, false);
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for ( int kOS = 0 ; kOS < prj.NOS ; kOS++ ){
 
 		//... NITEMS initialization  ......................
 
@@ -664,6 +768,17 @@ set_up(
 	// compute_one_subset(kOS);
 	}   // end of LOOP: Subsets
 
+#ifdef STIR_OPENMP
+	for ( std::size_t i = 0 ; i < this->subset_locks.size() ; i++ )
+	  omp_destroy_lock(&this->subset_locks[i]);
+	this->subset_locks.resize(prj.NOS);
+	for ( int kOS = 0 ; kOS < prj.NOS ; kOS++ )
+	  omp_init_lock(&this->subset_locks[kOS]);
+#endif
+
+	if (!this->matrix_cache_directory.empty())
+	  this->compute_matrix_cache_hash();
+
 	//delete_UB_SPECT_arrays();
 	info(boost::format("Done estimating size of matrix. Execution (CPU) time %1% s ") % timer.value(), 
              2);
@@ -695,9 +810,11 @@ delete_UB_SPECT_arrays()
     }
   }
 
-  delete [] wm.val;
-  delete [] wm.col;
-  delete [] wm.ne;
+#ifdef STIR_OPENMP
+  for (std::size_t kOS=0; kOS<this->subset_locks.size(); ++kOS)
+    omp_destroy_lock(&this->subset_locks[kOS]);
+  this->subset_locks.clear();
+#endif
 
   //... freeing memory .............................................
 
@@ -721,9 +838,6 @@ delete_UB_SPECT_arrays()
   }
 
   if ( wm.do_save_STIR ){
-    delete [] wm.ns;
-    delete [] wm.nb;
-    delete [] wm.na;
     delete [] wm.nx;
     delete [] wm.ny;
     delete [] wm.nz;
@@ -733,108 +847,189 @@ delete_UB_SPECT_arrays()
 }
 void
 ProjMatrixByBinSPECTUB::
-compute_one_subset(const int kOS) const
+compute_matrix_cache_hash()
 {
   using namespace SPECTUB;
 
-  CPUTimer timer;
-  timer.start();
-  // cout << "\n\n--- Processing subset: " << kOS+1 << "/" << prj.NOS << " ----------------------------------------\n" << endl;
-
-  //... to fill wmh fields related to the subset ..................................
-
-  wmh.subset_ind = kOS;
-
-  for ( int i = 0 ; i < prj.NangOS ; i ++ ){
+  FNV1aHash hash;
+  hash.add_bytes(matrix_cache_magic, std::strlen(matrix_cache_magic));
+  // image and projection data geometry
+  hash.add(vol.Ncol);
+  hash.add(vol.Nrow);
+  hash.add(vol.Nsli);
+  hash.add(vol.szcm);
+  hash.add(vol.thcm);
+  hash.add(prj.Nbin);
+  hash.add(prj.szcm);
+  hash.add(prj.Nang);
+  hash.add(prj.Nsli);
+  hash.add(prj.thcm);
+  hash.add(prj.ang0);
+  hash.add(prj.incr);
+  hash.add(this->origin.z());
+  hash.add(this->origin.y());
+  hash.add(this->origin.x());
+  hash.add_bytes(Rrad, prj.Nang*sizeof(float));
+  hash.add_bytes(prj.order, prj.Nang*sizeof(int));
+  // resolution model
+  hash.add(wmh.min_w);
+  hash.add(wmh.maxsigm);
+  hash.add(wmh.psfres);
+  hash.add(wmh.do_psf);
+  if (wmh.do_psf)
+    {
+      hash.add(wmh.do_psf_3d);
+      hash.add(wmh.COL.A);
+      hash.add(wmh.COL.B);
+    }
+  // attenuation and mask
+  hash.add(wmh.do_att);
+  if (wmh.do_att)
+    hash.add(wmh.do_full_att);
+  if (attmap != NULL)
+    hash.add_bytes(attmap, vol.Nvox*sizeof(float));
+  hash.add(wmh.do_msk);
+  if (wmh.do_msk)
+    hash.add_bytes(msk_3d, vol.Nvox*sizeof(bool));
+
+  this->matrix_cache_hash = hash.get_value();
+}
 
-    wmh.index[ i ] = prj.order[ i + kOS * prj.NangOS ];
-    wmh.Rrad [ i ] = Rrad[ wmh.index[ i ] ];
-  }
+std::string
+ProjMatrixByBinSPECTUB::
+get_matrix_cache_filename_for_view(const int view_num) const
+{
+  using namespace SPECTUB;
+  for (int kOS=0; kOS<prj.NOS; ++kOS)
+    {
+      if (prj.order[kOS * prj.NangOS] == view_num)
+        return this->get_matrix_cache_filename(kOS);
+    }
+  return "";
+}
 
-  //... NITEMS initialization  ......................
+std::string
+ProjMatrixByBinSPECTUB::
+get_matrix_cache_filename(const int kOS) const
+{
+  if (this->matrix_cache_directory.empty())
+    return "";
+  return (boost::format("%1%/SPECTUB_matrix_%2$016x_view%3%.bin")
+          % this->matrix_cache_directory % this->matrix_cache_hash % prj.order[kOS * prj.NangOS]).str();
+}
 
-  // for ( int i = 0 ; i < prj.NbOS ; i++ ) NITEMS[ i ] = 1;
+void
+ProjMatrixByBinSPECTUB::
+compute_one_subset(const int kOS) const
+{
+  using namespace SPECTUB;
 
+  CPUTimer timer;
+  timer.start();
+  // cout << "\n\n--- Processing subset: " << kOS+1 << "/" << prj.NOS << " ----------------------------------------\n" << endl;
 
-  //... size esmitations ........................................................
+  std::vector<ProjMatrixElemsForOneBin> lors;
 
-  //wm_size_estimation ( kOS,  ang, vox, bin, vol, prj, msk_3d, msk_2d, maxszb, &gaussdens, NITEMS );
+  //... try to read from file ......................................................
 
-  //cout << "\nwm_SPECT. Size estimation done. time (s): " << double( clock()-ini )/CLOCKS_PER_SEC <<endl;
+  const std::string cache_filename = this->get_matrix_cache_filename(kOS);
+  if (!cache_filename.empty())
+    {
+      if (read_lors_from_matrix_cache(lors, cache_filename, this->matrix_cache_hash) == Succeeded::yes)
+        {
+          info(boost::format("Read matrix elements for subset %1% from '%2%'") % kOS % cache_filename,
+               2);
+        }
+      else
+        lors.clear();
+    }
 
-  int ne = 0;
+  if (lors.empty())
+    {
+      int ne = 0;
 
-  for ( int i = 0 ; i < wmh.prj.NbOS ; i++ ) ne += NITEMS[kOS][ i ];
+      for ( int i = 0 ; i < prj.NbOS ; i++ ) ne += NITEMS[kOS][ i ];
 
-  //... size information ....................................................................
+      //... size information ....................................................................
 
-  info(boost::format("total number of non-zero weights in this view: %1%, estimated size: %2% MB") 
-       % ne
-       % ( wm.do_save_STIR ?  (ne + 10* prj.NbOS)/104857.6 : ne/131072),
-       2);
+      info(boost::format("total number of non-zero weights in this view: %1%, estimated size: %2% MB") 
+           % ne
+           % ( wm.do_save_STIR ?  (ne + 10* prj.NbOS)/104857.6 : ne/131072),
+           2);
 
-  //... memory allocation for wm float arrays ...................................
+      //... memory allocation for the weights of this subset ...................................
+      // These are not stored in the global wm, such that different subsets can be computed in parallel.
+      // The image indices (nx, ny, nz) are shared.
 
-  for( int i = 0 ; i < wmh.prj.NbOS ; i++ ){
+      std::vector<std::vector<float> > val_storage(prj.NbOS);
+      std::vector<std::vector<int> > col_storage(prj.NbOS);
+      std::vector<float *> val(prj.NbOS);
+      std::vector<int *> col(prj.NbOS);
+      std::vector<int> ne_per_row(prj.NbOS + 1, 0);
+      std::vector<int> na(prj.NbOS), nb(prj.NbOS), ns(prj.NbOS);
 
-    if ( ( wm.val[ i ] = new (std::nothrow) float [ NITEMS[kOS][ i ] ]) == NULL) 
-      {
-        //error_wm_SPECT( 200, "wm.val[][]" );
-        error("Error allocating space to store values for SPECTUB matrix");
+      for( int i = 0 ; i < prj.NbOS ; i++ ){
+        val_storage[ i ].resize( NITEMS[kOS][ i ], 0.F );
+        col_storage[ i ].resize( NITEMS[kOS][ i ], 0 );
+        val[ i ] = &val_storage[ i ][ 0 ];
+        col[ i ] = &col_storage[ i ][ 0 ];
       }
 
-    if ( ( wm.col[ i ] = new (std::nothrow) int   [ NITEMS[kOS][ i ] ]) == NULL) 
-      {
-        //error_wm_SPECT( 200, "wm.col[]" );
-        error("Error allocating space to store column indices for SPECTUB matrix");
+      wm_da_type wm_subset;
+      wm_subset.NbOS = prj.NbOS;
+      wm_subset.Nvox = vol.Nvox;
+      wm_subset.do_save_STIR = true;
+      wm_subset.val = &val[ 0 ];
+      wm_subset.col = &col[ 0 ];
+      wm_subset.ne = &ne_per_row[ 0 ];
+      wm_subset.na = &na[ 0 ];
+      wm_subset.nb = &nb[ 0 ];
+      wm_subset.ns = &ns[ 0 ];
+
+      //... wm calculation for this subset ...........................
+
+      wm_calculation ( kOS, ang, vox, bin, vol, prj, attmap, msk_3d, msk_2d, maxszb, &gaussdens, NITEMS[kOS], wm_subset );
+      info(boost::format("Weight matrix calculation done. time %1% (s)") % timer.value(),
+           2);
+
+      //... fill lors .........................
+
+      lors.resize(prj.NbOS);
+      for( int j = 0 ; j < prj.NbOS ; j++ ){
+        ProjMatrixElemsForOneBin& lor = lors[ j ];
+        Bin bin;
+        bin.segment_num()=0;	
+        bin.view_num()=na [ j ];	
+        bin.axial_pos_num()=ns [ j ];	
+        bin.tangential_pos_num()=nb [ j ];	
+        bin.set_bin_value(0);
+        lor.set_bin(bin);
+
+        lor.reserve(ne_per_row[ j ]);
+        for ( int i = 0 ; i < ne_per_row[ j ] ; i++ ){
+
+          const int iv = col[ j ][ i ];
+          const ProjMatrixElemsForOneBin::value_type 
+            elem(Coordinate3D<int>(wm.nz[ iv ],wm.ny[ iv ],wm.nx[ iv ]), val[ j ][ i ]);      
+          lor.push_back( elem);	
+        }
+        // free memory as we go
+        std::vector<float>().swap(val_storage[ j ]);
+        std::vector<int>().swap(col_storage[ j ]);
       }
-  }
-
-  //... to initialize wm to zero ......................
-
-  for ( int i = 0 ; i < wm.NbOS ; i++ ){
-
-    wm.ne[ i ] = 0;
-
-    for( int j = 0 ; j < NITEMS[kOS][ i ] ; j++ ){
 
-      wm.val[ i ][ j ] = (float)0.;
-      wm.col[ i ][ j ] = 0;
+      if (!cache_filename.empty())
+        {
+          if (write_lors_to_matrix_cache(cache_filename, this->matrix_cache_hash, lors) == Succeeded::yes)
+            info(boost::format("Matrix elements for subset %1% written to '%2%'") % kOS % cache_filename,
+                 2);
+          else
+            warning(boost::format("ProjMatrixByBinSPECTUB: could not write matrix elements to '%1%'") % cache_filename);
+        }
     }
-  }
-  wm.ne[ wm.NbOS ] = 0;
-
-  //... wm calculation for this subset ...........................
-
-  wm_calculation ( kOS, ang, vox, bin, vol, prj, attmap, msk_3d, msk_2d, maxszb, &gaussdens, NITEMS[kOS] );
-  info(boost::format("Weight matrix calculation done. time %1% (s)") % timer.value(),
-       2);
 
-  //... fill lor .........................
-
-  for( int j = 0 ; j < wm.NbOS ; j++ ){
-    ProjMatrixElemsForOneBin lor;
-    Bin bin;
-    bin.segment_num()=0;	
-    bin.view_num()=wm.na [ j ];	
-    bin.axial_pos_num()=wm.ns [ j ];	
-    bin.tangential_pos_num()=wm.nb [ j ];	
-    bin.set_bin_value(0);
-    lor.set_bin(bin);
-
-    lor.reserve(wm.ne[ j ]);
-    for ( int i = 0 ; i < wm.ne[ j ] ; i++ ){
-
-      const ProjMatrixElemsForOneBin::value_type 
-        elem(Coordinate3D<int>(wm.nz[ wm.col[ j ][ i ] ],wm.ny[ wm.col[ j ][ i ] ],wm.nx[ wm.col[ j ][ i ] ]), wm.val[ j ][ i ]);      
-      lor.push_back( elem);	
-    }
-
-    delete [] wm.val[ j ];
-    delete [] wm.col[ j ];
-
-    this->cache_proj_matrix_elems_for_one_bin(lor);
-  }
+  for( std::size_t j = 0 ; j < lors.size() ; j++ )
+    this->cache_proj_matrix_elems_for_one_bin(lors[ j ]);
 
   info(boost::format("Total time after transfering to ProjMatrixElemsForOneBin. time %1% (s)") % timer.value(),
        2);
@@ -845,8 +1040,6 @@ ProjMatrixByBinSPECTUB::
 calculate_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor
 					) const
 {
-  //error("ProjMatrixByBinSPECTUB element not found in cache (and hence file)");
-
   const int view_num=lor.get_bin().view_num();
   // find which "UB-subset" this view is in
   int kOS=0;
@@ -856,22 +1049,40 @@ calculate_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor
       if (prj.order[kOS] == view_num)
 	break;
     }
+  if (!this->keep_all_views_in_cache)
+    {
+      // only a single subset is kept in memory. set_up() made sure that we are single-threaded
+      if (!subset_already_processed[kOS])
+        {
+          this->clear_cache();
+          subset_already_processed.assign(prj.NOS,false);
+          info(boost::format("Computing matrix elements for view %1%") % view_num,
+               2);
+          compute_one_subset(kOS);
+          subset_already_processed[kOS]=true;
+        }
+    }
+  else
+    {
+      // different subsets can be computed in parallel, but every subset has to be computed only once
 #ifdef STIR_OPENMP
-#pragma omp critical(PROJMATRIXBYBINUBONEVIEW)
+      omp_set_lock(&this->subset_locks[kOS]);
+#endif
+      if (!subset_already_processed[kOS])
+        {
+          info(boost::format("Computing matrix elements for view %1%") % view_num,
+               2);
+          compute_one_subset(kOS);
+          subset_already_processed[kOS]=true;
+        }
+#ifdef STIR_OPENMP
+      omp_unset_lock(&this->subset_locks[kOS]);
 #endif
-  if (!subset_already_processed[kOS])
-    {
-      if (!this->keep_all_views_in_cache)
-	{
-	  this->clear_cache();
-	  subset_already_processed.assign(prj.NOS,false);
-	}
-      info(boost::format("Computing matrix elements for view %1%") % view_num,
-        2);
-      compute_one_subset(kOS);
-      subset_already_processed[kOS]=true;
     }
+  // all elements of this subset are now in the cache
   lor.erase();
+  if (this->get_cached_proj_matrix_elems_for_one_bin(lor) == Succeeded::no)
+    error(boost::format("ProjMatrixByBinSPECTUB: internal error: matrix elements for view %1% not found in cache") % view_num);
 }
 
 END_NAMESPACE_STIR
@@ -383,6 +383,53 @@ forward_project(Bin& single,
 }
 
 
+void
+ProjMatrixElemsForOneBin::
+back_project(float * const data_ptr,
+             const BasicCoordinate<3,int>& min_indices,
+             const BasicCoordinate<3,int>& lengths,
+             const Bin& single) const
+{
+  const float data = single.get_bin_value();
+  if (data == 0)
+    return;
+
+  const int min_z = min_indices[1];
+  const int max_z = min_indices[1] + lengths[1] - 1;
+  // offset of the voxel with indices (0,0,0)
+  const int offset_0 = -((min_indices[1]*lengths[2] + min_indices[2])*lengths[3] + min_indices[3]);
+  for (const_iterator element_ptr = begin(); element_ptr != end(); ++element_ptr)
+    {
+      const int z = element_ptr->coord1();
+      if (z >= min_z && z <= max_z)
+        data_ptr[offset_0 + (z*lengths[2] + element_ptr->coord2())*lengths[3] + element_ptr->coord3()] +=
+          element_ptr->get_value() * data;
+    }
+}
+
+void
+ProjMatrixElemsForOneBin::
+forward_project(Bin& single,
+                const float * const data_ptr,
+                const BasicCoordinate<3,int>& min_indices,
+                const BasicCoordinate<3,int>& lengths) const
+{
+  const int min_z = min_indices[1];
+  const int max_z = min_indices[1] + lengths[1] - 1;
+  // offset of the voxel with indices (0,0,0)
+  const int offset_0 = -((min_indices[1]*lengths[2] + min_indices[2])*lengths[3] + min_indices[3]);
+  float value = single.get_bin_value();
+  for (const_iterator element_ptr = begin(); element_ptr != end(); ++element_ptr)
+    {
+      const int z = element_ptr->coord1();
+      if (z >= min_z && z <= max_z)
+        value +=
+          data_ptr[offset_0 + (z*lengths[2] + element_ptr->coord2())*lengths[3] + element_ptr->coord3()] *
+          element_ptr->get_value();
+    }
+  single.set_bin_value(value);
+}
+
 void 
 ProjMatrixElemsForOneBin::
 back_project(DiscretisedDensity<3,float>& density,
@@ -0,0 +1,96 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Implementation of class stir::ProjMatrixElemsForOneBinWithOffsets
+
+  \author agent
+*/
+
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinWithOffsets.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/Bin.h"
+
+START_NAMESPACE_STIR
+
+ProjMatrixElemsForOneBinWithOffsets::
+ProjMatrixElemsForOneBinWithOffsets()
+{}
+
+void
+ProjMatrixElemsForOneBinWithOffsets::
+set(const ProjMatrixElemsForOneBin& row,
+    const BasicCoordinate<3,int>& min_indices,
+    const BasicCoordinate<3,int>& lengths)
+{
+  this->offsets.resize(row.size());
+  this->values.resize(row.size());
+
+  const int min_z = min_indices[1];
+  const int max_z = min_indices[1] + lengths[1] - 1;
+  // offset of the voxel with indices (0,0,0)
+  const int offset_0 = -((min_indices[1]*lengths[2] + min_indices[2])*lengths[3] + min_indices[3]);
+  std::size_t num_elements = 0;
+  for (ProjMatrixElemsForOneBin::const_iterator element_ptr = row.begin();
+       element_ptr != row.end(); ++element_ptr)
+    {
+      const int z = element_ptr->coord1();
+      if (z < min_z || z > max_z)
+        continue;
+      this->offsets[num_elements] =
+        offset_0 + (z*lengths[2] + element_ptr->coord2())*lengths[3] + element_ptr->coord3();
+      this->values[num_elements] = element_ptr->get_value();
+      ++num_elements;
+    }
+  this->offsets.resize(num_elements);
+  this->values.resize(num_elements);
+}
+
+void
+ProjMatrixElemsForOneBinWithOffsets::
+forward_project(Bin& bin, const float * const data_ptr) const
+{
+  const std::size_t num_elements = this->offsets.size();
+  if (num_elements == 0)
+    return;
+  const int * const offsets_ptr = &this->offsets[0];
+  const float * const values_ptr = &this->values[0];
+  float sum = 0.F;
+#if defined(STIR_OPENMP) && (_OPENMP >= 201307)
+#pragma omp simd reduction(+:sum)
+#endif
+  for (std::size_t i = 0; i < num_elements; ++i)
+    sum += data_ptr[offsets_ptr[i]] * values_ptr[i];
+  bin += sum;
+}
+
+void
+ProjMatrixElemsForOneBinWithOffsets::
+back_project(float * const data_ptr, const Bin& bin) const
+{
+  const float data = bin.get_bin_value();
+  const std::size_t num_elements = this->offsets.size();
+  if (data == 0 || num_elements == 0)
+    return;
+  const int * const offsets_ptr = &this->offsets[0];
+  const float * const values_ptr = &this->values[0];
+  // every voxel occurs only once in a row (see ProjMatrixElemsForOneBin::check_state()),
+  // so there are no conflicts between iterations
+#if defined(STIR_OPENMP) && (_OPENMP >= 201307)
+#pragma omp simd
+#endif
+  for (std::size_t i = 0; i < num_elements; ++i)
+    data_ptr[offsets_ptr[i]] += values_ptr[i] * data;
+}
+
+END_NAMESPACE_STIR
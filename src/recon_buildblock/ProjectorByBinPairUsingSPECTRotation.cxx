@@ -0,0 +1,88 @@
+//
+//
+/*!
+  \file
+  \ingroup projection
+
+  \brief non-inline implementations for stir::ProjectorByBinPairUsingSPECTRotation
+
+  \author agent
+
+*/
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+
+
+#include "stir/recon_buildblock/ProjectorByBinPairUsingSPECTRotation.h"
+#include "stir/recon_buildblock/ForwardProjectorByBinSPECTRotation.h"
+#include "stir/recon_buildblock/BackProjectorByBinSPECTRotation.h"
+#include "stir/recon_buildblock/SPECTRotationModel.h"
+
+START_NAMESPACE_STIR
+
+
+const char * const
+ProjectorByBinPairUsingSPECTRotation::registered_name =
+  "SPECT Rotation";
+
+
+void
+ProjectorByBinPairUsingSPECTRotation::initialise_keymap()
+{
+  base_type::initialise_keymap();
+  parser.add_start_key("Projector Pair Using SPECT Rotation Parameters");
+  parser.add_stop_key("End Projector Pair Using SPECT Rotation Parameters");
+  model_sptr->add_to_keymap(parser);
+}
+
+
+void
+ProjectorByBinPairUsingSPECTRotation::set_defaults()
+{
+  base_type::set_defaults();
+  this->set_model_sptr(shared_ptr<SPECTRotationModel>(new SPECTRotationModel));
+}
+
+bool
+ProjectorByBinPairUsingSPECTRotation::post_processing()
+{
+  if (base_type::post_processing())
+    return true;
+  return model_sptr->post_processing();
+}
+
+ProjectorByBinPairUsingSPECTRotation::
+ProjectorByBinPairUsingSPECTRotation()
+{
+  set_defaults();
+}
+
+ProjectorByBinPairUsingSPECTRotation::
+ProjectorByBinPairUsingSPECTRotation(const shared_ptr<SPECTRotationModel>& model_sptr_v)
+{
+  this->set_model_sptr(model_sptr_v);
+}
+
+shared_ptr<SPECTRotationModel>
+ProjectorByBinPairUsingSPECTRotation::
+get_model_sptr() const
+{
+  return model_sptr;
+}
+
+void
+ProjectorByBinPairUsingSPECTRotation::
+set_model_sptr(const shared_ptr<SPECTRotationModel>& sptr)
+{
+  this->model_sptr = sptr;
+  this->forward_projector_sptr.reset(new ForwardProjectorByBinSPECTRotation(this->model_sptr));
+  this->back_projector_sptr.reset(new BackProjectorByBinSPECTRotation(this->model_sptr));
+}
+
+END_NAMESPACE_STIR
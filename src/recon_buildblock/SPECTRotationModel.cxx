@@ -0,0 +1,525 @@
+//
+//
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Implementation of class stir::SPECTRotationModel
+
+  \author agent
+*/
+
+#include "stir/recon_buildblock/SPECTRotationModel.h"
+#include "stir/ProjDataInfoCylindricalArcCorr.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/Viewgram.h"
+#include "stir/IndexRange2D.h"
+#include "stir/IndexRange3D.h"
+#include "stir/KeyParser.h"
+#include "stir/IO/read_from_file.h"
+#include "stir/is_null_ptr.h"
+#include "stir/warning.h"
+#include "stir/error.h"
+#include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <cmath>
+
+START_NAMESPACE_STIR
+
+namespace {
+  //! Gaussian integrated over every sample, normalised to 1, \a sigma in units of the sampling distance
+  void make_Gaussian_kernel(std::vector<float>& kernel, const float sigma, const float max_num_sigmas)
+  {
+    if (sigma <= 0.F)
+      {
+        kernel.assign(1, 1.F);
+        return;
+      }
+    const int half_length = static_cast<int>(std::floor(max_num_sigmas*sigma + .5F));
+    kernel.resize(2*half_length+1);
+    const double scale = 1/(std::sqrt(2.)*sigma);
+    double sum = 0;
+    for (int k=-half_length; k<=half_length; ++k)
+      {
+        const double value = (std::erf((k+.5)*scale) - std::erf((k-.5)*scale))/2;
+        kernel[k+half_length] = static_cast<float>(value);
+        sum += value;
+      }
+    for (std::vector<float>::iterator iter = kernel.begin(); iter != kernel.end(); ++iter)
+      *iter = static_cast<float>(*iter/sum);
+  }
+}
+
+SPECTRotationModel::
+SPECTRotationModel()
+{
+  set_defaults();
+}
+
+void
+SPECTRotationModel::
+set_defaults()
+{
+  psf_type = "Geometrical";
+  collimator_sigma_0 = 0.F;
+  collimator_slope = 0.F;
+  maximum_number_of_sigmas = 2.F;
+  attenuation_map = "";
+  attenuation_image_sptr.reset();
+  already_set_up = false;
+}
+
+void
+SPECTRotationModel::
+add_to_keymap(KeyParser& parser)
+{
+  parser.add_key("psf type", &psf_type);
+  parser.add_key("collimator sigma 0(cm)", &collimator_sigma_0);
+  parser.add_key("collimator slope", &collimator_slope);
+  parser.add_key("maximum number of sigmas", &maximum_number_of_sigmas);
+  parser.add_key("attenuation map", &attenuation_map);
+}
+
+bool
+SPECTRotationModel::
+post_processing()
+{
+  boost::algorithm::to_lower(psf_type);
+  if (psf_type != "geometrical" && psf_type != "2d" && psf_type != "3d")
+    {
+      warning("SPECTRotationModel: psf type has to be Geometrical, 2D or 3D");
+      return true;
+    }
+  if (maximum_number_of_sigmas <= 0.F)
+    {
+      warning("SPECTRotationModel: maximum number of sigmas has to be positive");
+      return true;
+    }
+  if (!attenuation_map.empty())
+    attenuation_image_sptr = read_from_file<DiscretisedDensity<3,float> >(attenuation_map);
+  else
+    attenuation_image_sptr.reset();
+  already_set_up = false;
+  return false;
+}
+
+void
+SPECTRotationModel::
+set_resolution_model(const float collimator_sigma_0_in_mm, const float collimator_slope_v, const bool full_3D)
+{
+  this->collimator_sigma_0 = collimator_sigma_0_in_mm / 10;
+  this->collimator_slope = collimator_slope_v;
+  if (collimator_slope == 0.F && collimator_sigma_0 == 0.F)
+    this->psf_type = "geometrical";
+  else
+    this->psf_type = full_3D ? "3d" : "2d";
+  already_set_up = false;
+}
+
+void
+SPECTRotationModel::
+set_attenuation_image_sptr(const shared_ptr<const DiscretisedDensity<3,float> > value)
+{
+  this->attenuation_image_sptr = value;
+  already_set_up = false;
+}
+
+shared_ptr<const DiscretisedDensity<3,float> >
+SPECTRotationModel::
+get_attenuation_image_sptr() const
+{
+  return this->attenuation_image_sptr;
+}
+
+void
+SPECTRotationModel::
+set_maximum_number_of_sigmas(const float value)
+{
+  this->maximum_number_of_sigmas = value;
+}
+
+float
+SPECTRotationModel::
+get_maximum_number_of_sigmas() const
+{
+  return this->maximum_number_of_sigmas;
+}
+
+void
+SPECTRotationModel::
+set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr_v,
+       const shared_ptr<const DiscretisedDensity<3,float> >& density_info_sptr_v)
+{
+  this->proj_data_info_sptr =
+    std::dynamic_pointer_cast<const ProjDataInfoCylindricalArcCorr>(proj_data_info_sptr_v);
+  if (is_null_ptr(this->proj_data_info_sptr))
+    error("SPECTRotationModel: can only handle arc-corrected data (ProjDataInfoCylindricalArcCorr)");
+  const ProjDataInfoCylindricalArcCorr& proj_data_info = *this->proj_data_info_sptr;
+  if (proj_data_info.get_min_segment_num() != 0 || proj_data_info.get_max_segment_num() != 0)
+    error("SPECTRotationModel: can only handle data with a single segment");
+
+  this->density_info_sptr = density_info_sptr_v;
+  const VoxelsOnCartesianGrid<float>* image_ptr =
+    dynamic_cast<const VoxelsOnCartesianGrid<float> *>(density_info_sptr_v.get());
+  if (image_ptr == 0)
+    error("SPECTRotationModel: can only handle images of type VoxelsOnCartesianGrid");
+  BasicCoordinate<3,int> min_indices, max_indices;
+  if (!image_ptr->get_regular_range(min_indices, max_indices))
+    error("SPECTRotationModel: can only handle images with a regular range");
+  min_z = min_indices[1]; max_z = max_indices[1];
+  min_y = min_indices[2]; max_y = max_indices[2];
+  min_x = min_indices[3]; max_x = max_indices[3];
+  voxel_size_x = image_ptr->get_voxel_size().x();
+  voxel_size_y = image_ptr->get_voxel_size().y();
+  voxel_size_z = image_ptr->get_voxel_size().z();
+  centre_x = (min_x + max_x)/2.F;
+  centre_y = (min_y + max_y)/2.F;
+
+  if (max_z - min_z + 1 != proj_data_info.get_num_axial_poss(0))
+    error(boost::format("SPECTRotationModel: number of planes in the image (%1%) has to be equal to the number of axial positions (%2%)")
+          % (max_z - min_z + 1) % proj_data_info.get_num_axial_poss(0));
+  if (std::abs(voxel_size_z - proj_data_info.get_axial_sampling(0)) > .01F)
+    error(boost::format("SPECTRotationModel: plane spacing in the image (%1%) has to be equal to the axial sampling (%2%)")
+          % voxel_size_z % proj_data_info.get_axial_sampling(0));
+
+  min_tangential_pos_num = proj_data_info.get_min_tangential_pos_num();
+  max_tangential_pos_num = proj_data_info.get_max_tangential_pos_num();
+  min_axial_pos_num = proj_data_info.get_min_axial_pos_num(0);
+  bin_size = proj_data_info.get_tangential_sampling();
+  centre_tangential_pos_num = (min_tangential_pos_num + max_tangential_pos_num)/2.F;
+
+  // sample the whole image along the direction orthogonal to the detector
+  depth_sampling = voxel_size_x;
+  const float half_diagonal =
+    std::sqrt(square((max_x - min_x + 1)*voxel_size_x) + square((max_y - min_y + 1)*voxel_size_y))/2;
+  const int half_num_depth_samples = static_cast<int>(std::ceil(half_diagonal/depth_sampling));
+  num_depth_samples = 2*half_num_depth_samples + 1;
+  first_depth_sample = -half_num_depth_samples*depth_sampling;
+
+  // same conventions as SPECTUB
+  const int min_view_num = proj_data_info.get_min_view_num();
+  const int max_view_num = proj_data_info.get_max_view_num();
+  angles.grow(min_view_num, max_view_num);
+  for (int view_num = min_view_num; view_num <= max_view_num; ++view_num)
+    angles[view_num] =
+      proj_data_info.get_scanner_ptr()->get_intrinsic_azimuthal_tilt() +
+      (view_num - min_view_num)*proj_data_info.get_azimuthal_angle_sampling();
+  radii = proj_data_info.get_ring_radii_for_all_views();
+
+  boost::algorithm::to_lower(psf_type);
+  do_psf = psf_type != "geometrical";
+  do_psf_3d = psf_type == "3d";
+
+  if (!is_null_ptr(attenuation_image_sptr))
+    {
+      std::string explanation;
+      if (!attenuation_image_sptr->has_same_characteristics(*density_info_sptr, explanation))
+        error("SPECTRotationModel: attenuation image and emission image need to have the same characteristics: " + explanation);
+    }
+  already_set_up = true;
+}
+
+void
+SPECTRotationModel::
+check_set_up(const DiscretisedDensity<3,float>& density) const
+{
+  if (!already_set_up)
+    error("SPECTRotationModel used without calling set_up first");
+  std::string explanation;
+  if (!density.has_same_characteristics(*density_info_sptr, explanation))
+    error("SPECTRotationModel: image does not correspond to the one used for set_up: " + explanation);
+}
+
+void
+SPECTRotationModel::
+compute_samples(std::vector<Sample>& samples, const int view_num) const
+{
+  const float cos_angle = std::cos(angles[view_num]);
+  const float sin_angle = std::sin(angles[view_num]);
+  const int num_tangential_poss = max_tangential_pos_num - min_tangential_pos_num + 1;
+  samples.resize(num_depth_samples*num_tangential_poss);
+  std::vector<Sample>::iterator sample_iter = samples.begin();
+  for (int j=0; j<num_depth_samples; ++j)
+    {
+      const float w = first_depth_sample + j*depth_sampling;
+      for (int t=min_tangential_pos_num; t<=max_tangential_pos_num; ++t, ++sample_iter)
+        {
+          Sample& sample = *sample_iter;
+          const float u = (t - centre_tangential_pos_num)*bin_size;
+          // inverse of u = -x cos + y sin, w = x sin + y cos
+          const float x = centre_x + (-u*cos_angle + w*sin_angle)/voxel_size_x;
+          const float y = centre_y + (u*sin_angle + w*cos_angle)/voxel_size_y;
+          const int x0 = static_cast<int>(std::floor(x));
+          const int y0 = static_cast<int>(std::floor(y));
+          const float fx = x - x0;
+          const float fy = y - y0;
+          const bool x0_ok = x0 >= min_x && x0 <= max_x;
+          const bool x1_ok = x0+1 >= min_x && x0+1 <= max_x;
+          const bool y0_ok = y0 >= min_y && y0 <= max_y;
+          const bool y1_ok = y0+1 >= min_y && y0+1 <= max_y;
+          sample.valid = (x0_ok || x1_ok) && (y0_ok || y1_ok);
+          if (!sample.valid)
+            continue;
+          sample.x0 = x0_ok ? x0 : x0+1;
+          sample.x1 = x1_ok ? x0+1 : x0;
+          sample.y0 = y0_ok ? y0 : y0+1;
+          sample.y1 = y1_ok ? y0+1 : y0;
+          const float wx0 = x0_ok ? 1-fx : 0.F;
+          const float wx1 = x1_ok ? fx : 0.F;
+          const float wy0 = y0_ok ? 1-fy : 0.F;
+          const float wy1 = y1_ok ? fy : 0.F;
+          sample.w00 = wy0*wx0;
+          sample.w01 = wy0*wx1;
+          sample.w10 = wy1*wx0;
+          sample.w11 = wy1*wx1;
+        }
+    }
+}
+
+void
+SPECTRotationModel::
+rotate(Array<3,float>& rotated, const DiscretisedDensity<3,float>& density,
+       const std::vector<Sample>& samples) const
+{
+  for (int z=min_z; z<=max_z; ++z)
+    {
+      const Array<2,float>& plane = density[z];
+      std::vector<Sample>::const_iterator sample_iter = samples.begin();
+      for (int j=0; j<num_depth_samples; ++j)
+        for (int t=min_tangential_pos_num; t<=max_tangential_pos_num; ++t, ++sample_iter)
+          {
+            const Sample& s = *sample_iter;
+            rotated[z][j][t] = s.valid
+              ? s.w00*plane[s.y0][s.x0] + s.w01*plane[s.y0][s.x1] + s.w10*plane[s.y1][s.x0] + s.w11*plane[s.y1][s.x1]
+              : 0.F;
+          }
+    }
+}
+
+void
+SPECTRotationModel::
+rotate_transpose(DiscretisedDensity<3,float>& density, const Array<3,float>& rotated,
+                 const std::vector<Sample>& samples) const
+{
+  for (int z=min_z; z<=max_z; ++z)
+    {
+      Array<2,float>& plane = density[z];
+      std::vector<Sample>::const_iterator sample_iter = samples.begin();
+      for (int j=0; j<num_depth_samples; ++j)
+        for (int t=min_tangential_pos_num; t<=max_tangential_pos_num; ++t, ++sample_iter)
+          {
+            const Sample& s = *sample_iter;
+            const float value = rotated[z][j][t];
+            if (!s.valid || value == 0.F)
+              continue;
+            plane[s.y0][s.x0] += s.w00*value;
+            plane[s.y0][s.x1] += s.w01*value;
+            plane[s.y1][s.x0] += s.w10*value;
+            plane[s.y1][s.x1] += s.w11*value;
+          }
+    }
+}
+
+bool
+SPECTRotationModel::
+compute_attenuation_factors(Array<3,float>& factors, const std::vector<Sample>& samples) const
+{
+  if (is_null_ptr(attenuation_image_sptr))
+    return false;
+  rotate(factors, *attenuation_image_sptr, samples);
+  // attenuation map is in cm^-1
+  const float step_in_cm = depth_sampling/10;
+  for (int z=min_z; z<=max_z; ++z)
+    for (int t=min_tangential_pos_num; t<=max_tangential_pos_num; ++t)
+      {
+        // cumulative sum towards the detector (i.e. larger depth indices), using half of the current sample
+        float line_integral = 0.F;
+        for (int j=num_depth_samples-1; j>=0; --j)
+          {
+            const float mu = factors[z][j][t];
+            factors[z][j][t] = std::exp(-(line_integral + mu*step_in_cm/2));
+            line_integral += mu*step_in_cm;
+          }
+      }
+  return true;
+}
+
+void
+SPECTRotationModel::
+compute_kernels(std::vector<std::vector<float> >& tangential_kernels,
+                std::vector<std::vector<float> >& axial_kernels,
+                const int view_num) const
+{
+  tangential_kernels.resize(num_depth_samples);
+  axial_kernels.resize(num_depth_samples);
+  for (int j=0; j<num_depth_samples; ++j)
+    {
+      const float distance_to_detector = radii[view_num] - (first_depth_sample + j*depth_sampling);
+      if (distance_to_detector <= 0.F)
+        {
+          // beyond the detector (corners of the image), as in SPECTUB
+          tangential_kernels[j].clear();
+          axial_kernels[j].clear();
+          continue;
+        }
+      const float sigma =
+        do_psf ? collimator_sigma_0*10 + collimator_slope*distance_to_detector : 0.F;
+      make_Gaussian_kernel(tangential_kernels[j], sigma/bin_size, maximum_number_of_sigmas);
+      make_Gaussian_kernel(axial_kernels[j], do_psf_3d ? sigma/voxel_size_z : 0.F, maximum_number_of_sigmas);
+    }
+}
+
+void
+SPECTRotationModel::
+forward_project(Viewgram<float>& viewgram,
+                const DiscretisedDensity<3,float>& density,
+                const int min_axial_pos_num_v, const int max_axial_pos_num_v,
+                const int min_tangential_pos_num_v, const int max_tangential_pos_num_v) const
+{
+  check_set_up(density);
+  const int view_num = viewgram.get_view_num();
+
+  std::vector<Sample> samples;
+  compute_samples(samples, view_num);
+  std::vector<std::vector<float> > tangential_kernels, axial_kernels;
+  compute_kernels(tangential_kernels, axial_kernels, view_num);
+
+  const IndexRange3D rotated_range(min_z, max_z, 0, num_depth_samples-1,
+                                   min_tangential_pos_num, max_tangential_pos_num);
+  Array<3,float> rotated(rotated_range);
+  rotate(rotated, density, samples);
+  {
+    Array<3,float> attenuation_factors(rotated_range);
+    if (compute_attenuation_factors(attenuation_factors, samples))
+      rotated *= attenuation_factors;
+  }
+
+  // blur every depth sample and sum
+  const IndexRange2D proj_range(min_z, max_z, min_tangential_pos_num, max_tangential_pos_num);
+  Array<2,float> proj(proj_range);
+  Array<2,float> tmp(proj_range);
+  for (int j=0; j<num_depth_samples; ++j)
+    {
+      const std::vector<float>& tangential_kernel = tangential_kernels[j];
+      if (tangential_kernel.empty())
+        continue;
+      const int half_length = static_cast<int>(tangential_kernel.size()/2);
+      Array<2,float>& blurred = do_psf_3d ? tmp : proj;
+      if (do_psf_3d)
+        tmp.fill(0.F);
+      for (int z=min_z; z<=max_z; ++z)
+        for (int t=min_tangential_pos_num; t<=max_tangential_pos_num; ++t)
+          {
+            const float value = rotated[z][j][t];
+            if (value == 0.F)
+              continue;
+            const int k_min = std::max(-half_length, min_tangential_pos_num - t);
+            const int k_max = std::min(half_length, max_tangential_pos_num - t);
+            for (int k=k_min; k<=k_max; ++k)
+              blurred[z][t+k] += tangential_kernel[k+half_length]*value;
+          }
+      if (do_psf_3d)
+        {
+          const std::vector<float>& axial_kernel = axial_kernels[j];
+          const int axial_half_length = static_cast<int>(axial_kernel.size()/2);
+          for (int z=min_z; z<=max_z; ++z)
+            {
+              const int k_min = std::max(-axial_half_length, min_z - z);
+              const int k_max = std::min(axial_half_length, max_z - z);
+              for (int k=k_min; k<=k_max; ++k)
+                {
+                  const float weight = axial_kernel[k+axial_half_length];
+                  for (int t=min_tangential_pos_num; t<=max_tangential_pos_num; ++t)
+                    proj[z+k][t] += weight*tmp[z][t];
+                }
+            }
+        }
+    }
+  // normalise such that every voxel contributes (about) 1 in total in the absence of attenuation
+  proj *= depth_sampling*bin_size/(voxel_size_x*voxel_size_y);
+
+  for (int ax_pos=min_axial_pos_num_v; ax_pos<=max_axial_pos_num_v; ++ax_pos)
+    for (int t=min_tangential_pos_num_v; t<=max_tangential_pos_num_v; ++t)
+      viewgram[ax_pos][t] = proj[ax_pos - min_axial_pos_num + min_z][t];
+}
+
+void
+SPECTRotationModel::
+back_project(DiscretisedDensity<3,float>& density,
+             const Viewgram<float>& viewgram,
+             const int min_axial_pos_num_v, const int max_axial_pos_num_v,
+             const int min_tangential_pos_num_v, const int max_tangential_pos_num_v) const
+{
+  check_set_up(density);
+  const int view_num = viewgram.get_view_num();
+
+  std::vector<Sample> samples;
+  compute_samples(samples, view_num);
+  std::vector<std::vector<float> > tangential_kernels, axial_kernels;
+  compute_kernels(tangential_kernels, axial_kernels, view_num);
+
+  const IndexRange2D proj_range(min_z, max_z, min_tangential_pos_num, max_tangential_pos_num);
+  Array<2,float> proj(proj_range);
+  const float scale = depth_sampling*bin_size/(voxel_size_x*voxel_size_y);
+  for (int ax_pos=min_axial_pos_num_v; ax_pos<=max_axial_pos_num_v; ++ax_pos)
+    for (int t=min_tangential_pos_num_v; t<=max_tangential_pos_num_v; ++t)
+      proj[ax_pos - min_axial_pos_num + min_z][t] = viewgram[ax_pos][t]*scale;
+
+  // transpose of the blurring
+  const IndexRange3D rotated_range(min_z, max_z, 0, num_depth_samples-1,
+                                   min_tangential_pos_num, max_tangential_pos_num);
+  Array<3,float> rotated(rotated_range);
+  Array<2,float> tmp(proj_range);
+  for (int j=0; j<num_depth_samples; ++j)
+    {
+      const std::vector<float>& tangential_kernel = tangential_kernels[j];
+      if (tangential_kernel.empty())
+        continue;
+      const int half_length = static_cast<int>(tangential_kernel.size()/2);
+      if (do_psf_3d)
+        {
+          const std::vector<float>& axial_kernel = axial_kernels[j];
+          const int axial_half_length = static_cast<int>(axial_kernel.size()/2);
+          tmp.fill(0.F);
+          for (int z=min_z; z<=max_z; ++z)
+            {
+              const int k_min = std::max(-axial_half_length, min_z - z);
+              const int k_max = std::min(axial_half_length, max_z - z);
+              for (int k=k_min; k<=k_max; ++k)
+                {
+                  const float weight = axial_kernel[k+axial_half_length];
+                  for (int t=min_tangential_pos_num; t<=max_tangential_pos_num; ++t)
+                    tmp[z][t] += weight*proj[z+k][t];
+                }
+            }
+        }
+      const Array<2,float>& blurred = do_psf_3d ? tmp : proj;
+      for (int z=min_z; z<=max_z; ++z)
+        for (int t=min_tangential_pos_num; t<=max_tangential_pos_num; ++t)
+          {
+            const int k_min = std::max(-half_length, min_tangential_pos_num - t);
+            const int k_max = std::min(half_length, max_tangential_pos_num - t);
+            float sum = 0.F;
+            for (int k=k_min; k<=k_max; ++k)
+              sum += tangential_kernel[k+half_length]*blurred[z][t+k];
+            rotated[z][j][t] = sum;
+          }
+    }
+  {
+    Array<3,float> attenuation_factors(rotated_range);
+    if (compute_attenuation_factors(attenuation_factors, samples))
+      rotated *= attenuation_factors;
+  }
+  rotate_transpose(density, rotated, samples);
+}
+
+END_NAMESPACE_STIR
@@ -19,7 +19,6 @@
 #include "stir/error.h"
 #include <boost/format.hpp>
 #include <boost/math/constants/constants.hpp>
-#include "stir/spatial_transformation/InvertAxis.h"
 
 //system libraries
 #include <stdio.h>
@@ -56,7 +55,8 @@ void wm_calculation( const int kOS,
 					const bool *msk_2d,
 					const int maxszb,
 					const discrf_type *const gaussdens,
-		     const int *const  NITEMS)
+		     const int *const  NITEMS,
+		     wm_da_type& wm)
 {
 	
 	float weight;
@@ -119,7 +119,7 @@ void wm_calculation( const int kOS,
 		
 		for ( int j = 0 ; j < prj.NangOS ; j++ ){
 			
-			j1 = wmh.index[ j ];			
+			j1 = prj.order[ j + kOS * prj.NangOS ];
 			
 			for ( int k = 0 ; k < prj.Nsli ; k++ ){
 				
@@ -160,7 +160,7 @@ void wm_calculation( const int kOS,
 			
 			for( int k = 0 ; k < prj.NangOS ; k++ ){
 				
-				int ka = wmh.index[ k ];			// angle index of the current projection (considering the whole set of projections)
+				int ka = prj.order[ k + kOS * prj.NangOS ];	// angle index of the current projection (considering the whole set of projections)
 						
 				//... perpendicular distance form voxel to detection plane ...........................
 				
@@ -252,15 +252,6 @@ void wm_calculation( const int kOS,
 						
 						weight = psf.val[ ie ] * eff * coeff_att ;
                         
-                        //... fill image STIR indices ...........................
-                        
-                        if ( wm.do_save_STIR ){
-                            stir::InvertAxis invert;
-                            wm.nx[ vox.iv ] = (short int)invert.invert_axis_index(( vox.icol - (int) floor( vol.Ncold2 ) ),vol.Ncold2*2, "x");  // centered index for STIR format
-							wm.ny[ vox.iv ] = (short int)( vox.irow - (int) floor( vol.Nrowd2 ) );  // centered index for STIR format
-							wm.nz[ vox.iv ] = (short int)  vox.islc ;                               // non-centered index for STIR format
-						}
-                        
                         //... fill wm values .....................
                         
 						wm.col[ jp ][ wm.ne[ jp ] ] = vox.iv;
@@ -366,7 +357,7 @@ void wm_size_estimation (int kOS,
 			
 			for( int k = 0 ; k < prj.NangOS ; k++ ){
 				
-				int ka = wmh.index[ k ];			// angle index of the current projection (considering the whole set of projections)
+				int ka = prj.order[ k + kOS * prj.NangOS ];	// angle index of the current projection (considering the whole set of projections)
 				
 				//... perpendicular distance form voxel to detection plane ...........................
 				
@@ -55,6 +55,8 @@
 
 #include "stir/recon_buildblock/ProjMatrixByBin.h"
 #include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinWithOffsets.h"
+#include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/Bin.h"
 
 #ifdef STIR_MPI
@@ -81,7 +83,8 @@ void setup_distributable_computation(
                                      const shared_ptr<const ProjDataInfo> proj_data_info_sptr,
                                      const shared_ptr<const DiscretisedDensity<3,float> >& target_sptr,
                                      const bool zero_seg0_end_planes,
-                                     const bool distributed_cache_enabled)
+                                     const bool distributed_cache_enabled,
+                                     const bool distributed_cache_shared_on_node)
 {
   set_num_threads();
 #ifdef STIR_OPENMP
@@ -109,12 +112,14 @@ void setup_distributable_computation(
   distributed::send_projectors(proj_pair_sptr, -1);
 
   //send configuration values for distributed computation
-  int configurations[4];
+  int configurations[6];
   configurations[0]=distributed::test?1:0;
   configurations[1]=distributed::test_send_receive_times?1:0;
   configurations[2]=distributed::rpc_time?1:0;
   configurations[3]=distributed_cache_enabled?1:0;
-  distributed::send_int_values(configurations, 4, distributed::STIR_MPI_CONF_TAG, -1);
+  configurations[4]=(distributed_cache_enabled && distributed_cache_shared_on_node)?1:0;
+  configurations[5]=distributed::image_reduction_uses_bounding_box?1:0;
+  distributed::send_int_values(configurations, 6, distributed::STIR_MPI_CONF_TAG, -1);
         
   distributed::send_double_values(&distributed::min_threshold, 1, distributed::STIR_MPI_CONF_TAG, -1);
                 
@@ -307,8 +312,10 @@ void distributable_computation(
   int task_id;
   if (RPC_process_related_viewgrams == &RPC_process_related_viewgrams_accumulate_loglikelihood)
     task_id=task_do_distributable_loglikelihood_computation;
-  else if (RPC_process_related_viewgrams == &RPC_process_related_viewgrams_gradient)
+  else if (RPC_process_related_viewgrams == &RPC_process_related_viewgrams_gradient<false>)
     task_id=task_do_distributable_gradient_computation;
+  else if (RPC_process_related_viewgrams == &RPC_process_related_viewgrams_gradient<true>)
+    task_id=task_do_distributable_gradient_computation_add_sensitivity;
   else if (RPC_process_related_viewgrams == &RPC_process_related_viewgrams_sensitivity_computation)
     task_id=task_do_distributable_sensitivity_computation;
       /* else if (RPC_process_related_viewgrams == &
@@ -540,6 +547,14 @@ void distributable_computation(
   int int_values[2];  int_values[0]=3; int_values[1]=4; // values are ignored
   distributed::send_int_values(int_values, 2, END_ITERATION_TAG, -1);
         
+  // time the reduction separately, to see how much time is spent on communication
+  // (the timer has to be stopped to read its value)
+  wall_clock_timer.stop();
+  const double computation_time = wall_clock_timer.value();
+  wall_clock_timer.start();
+  HighResWallClockTimer reduction_timer;
+  reduction_timer.start();
+
   //reduce output image
   if (!is_null_ptr(output_image_ptr))
     distributed::reduce_received_output_image(output_image_ptr, 0);
@@ -549,6 +564,9 @@ void distributable_computation(
       double buffer = 0.0;
       MPI_Reduce(&buffer, log_likelihood_ptr, /*size*/1, MPI_DOUBLE, MPI_SUM, /*destination*/ 0, MPI_COMM_WORLD);
     }
+  reduction_timer.stop();
+  info(boost::format("Distributed computation: %1% s until all slaves finished, %2% s for the reduction of the results")
+       % computation_time % reduction_timer.value());
 
   //reduce timed rpc-value
   if(distributed::rpc_time)
@@ -598,14 +616,44 @@ void LM_distributable_computation(
     if (output_image_ptr != NULL)
       output_image_ptr->fill(0.F);
 
+    // If possible, use images with contiguous storage such that the offsets of the voxels in a row
+    // can be computed once per event and used for forward and back projection.
+    // The back projections are then accumulated in contiguous copies of the input image.
+    const VoxelsOnCartesianGrid<float>* contiguous_input_ptr = 0;
+    shared_ptr<VoxelsOnCartesianGrid<float> > contiguous_input_sptr;
+    {
+      const VoxelsOnCartesianGrid<float>* input_voxels_ptr =
+        dynamic_cast<const VoxelsOnCartesianGrid<float>*>(input_image_ptr);
+      if (input_voxels_ptr != 0 &&
+          (output_image_ptr == NULL || input_voxels_ptr->has_same_characteristics(*output_image_ptr)))
+        {
+          if (input_voxels_ptr->get_contiguous_data_ptr() != 0)
+            contiguous_input_ptr = input_voxels_ptr;
+          else
+            {
+              contiguous_input_sptr.reset(input_voxels_ptr->clone());
+              contiguous_input_sptr->make_contiguous();
+              contiguous_input_ptr = contiguous_input_sptr.get();
+            }
+        }
+    }
+    const float* const input_data_ptr =
+      contiguous_input_ptr == 0 ? 0 : contiguous_input_ptr->get_contiguous_data_ptr();
+    const BasicCoordinate<3,int> min_indices =
+      contiguous_input_ptr == 0 ? make_coordinate(0,0,0) : contiguous_input_ptr->get_min_indices();
+    const BasicCoordinate<3,int> lengths =
+      contiguous_input_ptr == 0 ? make_coordinate(0,0,0) : contiguous_input_ptr->get_lengths();
+
 std::vector< shared_ptr<DiscretisedDensity<3,float> > > local_output_image_sptrs;
+std::vector<float*> local_output_data_ptrs;
+std::vector<ProjMatrixElemsForOneBinWithOffsets> local_row_with_offsets;
 std::vector<double> local_log_likelihoods;
 std::vector<int> local_counts, local_count2s;
 std::vector<Bin> local_measured_bin, local_basic_bin, local_fwd_bin;
 std::vector<ProjMatrixElemsForOneBin> local_row;
 std::vector<float>measured_div_fwd;
 #ifdef STIR_OPENMP
-#pragma omp parallel shared(local_output_image_sptrs,local_row, local_log_likelihoods, local_counts, local_count2s, local_measured_bin, local_fwd_bin)
+#pragma omp parallel shared(local_output_image_sptrs,local_output_data_ptrs,local_row,local_row_with_offsets, local_log_likelihoods, local_counts, local_count2s, local_measured_bin, local_fwd_bin)
 #endif
     // start of threaded section if openmp
     {
@@ -614,6 +662,7 @@ std::vector<float>measured_div_fwd;
         {
             std::cerr << "Starting loop with " << omp_get_num_threads() << " threads\n";
             local_output_image_sptrs.resize(omp_get_max_threads(), shared_ptr<DiscretisedDensity<3,float> >());
+            local_output_data_ptrs.resize(omp_get_max_threads(), 0);
             //            local_log_likelihoods.resize(omp_get_max_threads(), 0.);
             local_counts.resize(omp_get_max_threads(), 0);
             local_count2s.resize(omp_get_max_threads(), 0);
@@ -622,6 +671,7 @@ std::vector<float>measured_div_fwd;
             local_basic_bin.resize(omp_get_max_threads(), Bin());
             local_fwd_bin.resize(omp_get_max_threads(), Bin());
             local_row.resize(omp_get_max_threads(), ProjMatrixElemsForOneBin());
+            local_row_with_offsets.resize(omp_get_max_threads(), ProjMatrixElemsForOneBinWithOffsets());
         }
 
 #pragma omp for schedule(dynamic)
@@ -629,6 +679,7 @@ std::vector<float>measured_div_fwd;
         {
            info("Starting loop with 1 thread", 2);
             local_output_image_sptrs.resize(1, shared_ptr<DiscretisedDensity<3,float> >());
+            local_output_data_ptrs.resize(1, 0);
             //            local_log_likelihoods.resize(omp_get_max_threads(), 0.);
             local_counts.resize(1, 0);
             local_count2s.resize(1, 0);
@@ -637,6 +688,7 @@ std::vector<float>measured_div_fwd;
             local_basic_bin.resize(1, Bin());
             local_fwd_bin.resize(1, Bin());
             local_row.resize(1, ProjMatrixElemsForOneBin());
+            local_row_with_offsets.resize(1, ProjMatrixElemsForOneBinWithOffsets());
         }
 #endif
         // Putting the Bins here I avoid rellocation.
@@ -669,7 +721,13 @@ std::vector<float>measured_div_fwd;
                                                               local_measured_bin[thread_num]);
 
             local_fwd_bin[thread_num].set_bin_value(0.0f);
-            local_row[thread_num].forward_project(local_fwd_bin[thread_num], *input_image_ptr);
+            if (input_data_ptr != 0)
+              {
+                local_row_with_offsets[thread_num].set(local_row[thread_num], min_indices, lengths);
+                local_row_with_offsets[thread_num].forward_project(local_fwd_bin[thread_num], input_data_ptr);
+              }
+            else
+              local_row[thread_num].forward_project(local_fwd_bin[thread_num], *input_image_ptr);
 
             if (has_add)
             {
@@ -682,7 +740,17 @@ std::vector<float>measured_div_fwd;
             if (output_image_ptr != NULL)
             {
                 if(is_null_ptr(local_output_image_sptrs[thread_num]))
-                    local_output_image_sptrs[thread_num].reset(output_image_ptr->get_empty_copy());
+                  {
+                    if (input_data_ptr != 0)
+                      {
+                        // get_empty_copy() of a contiguous image is contiguous as well
+                        VoxelsOnCartesianGrid<float>* local_image_ptr = contiguous_input_ptr->get_empty_copy();
+                        local_output_data_ptrs[thread_num] = local_image_ptr->get_contiguous_data_ptr();
+                        local_output_image_sptrs[thread_num].reset(local_image_ptr);
+                      }
+                    else
+                      local_output_image_sptrs[thread_num].reset(output_image_ptr->get_empty_copy());
+                  }
             }
 
             if ( local_measured_bin[thread_num].get_bin_value() <= max_quotient *local_fwd_bin[thread_num].get_bin_value())
@@ -691,11 +759,13 @@ std::vector<float>measured_div_fwd;
                 continue;
 
             local_measured_bin[thread_num].set_bin_value(measured_div_fwd[thread_num]);
-            local_row[thread_num].back_project(*local_output_image_sptrs[thread_num], local_measured_bin[thread_num]);
+            if (local_output_data_ptrs[thread_num] != 0)
+              local_row_with_offsets[thread_num].back_project(local_output_data_ptrs[thread_num], local_measured_bin[thread_num]);
+            else
+              local_row[thread_num].back_project(*local_output_image_sptrs[thread_num], local_measured_bin[thread_num]);
         }
     }
-#ifdef STIR_OPENMP
-    // flatten data constructed by threads
+    // flatten data constructed by threads (or the single local image when not using OpenMP)
     {
         if (output_image_ptr != NULL)
         {
@@ -705,7 +775,6 @@ std::vector<float>measured_div_fwd;
         }
 
     }
-#endif
     CPU_timer.stop();
     wall_clock_timer.stop();
     info(boost::format("Computation times for distributable_computation, CPU %1%s, wall-clock %2%s")
@@ -39,6 +39,7 @@
 #include "stir/DiscretisedDensity.h"
 #include "stir/ViewSegmentNumbers.h"
 #include "stir/CPUTimer.h"
+#include "stir/HighResWallClockTimer.h"
 #include "stir/recon_buildblock/ForwardProjectorByBin.h"
 #include "stir/recon_buildblock/BackProjectorByBin.h"
 #include "stir/recon_buildblock/BinNormalisation.h"
@@ -229,6 +230,14 @@ void distributable_computation_cache_enabled(
   distributed::send_image_estimate(input_image_ptr, -1);
   //send if output_image_ptr is valid and so needs to be accumulated
   distributed::send_bool_value(!is_null_ptr(output_image_ptr),USE_OUTPUT_IMAGE_ARG_TAG,-1);
+  if (caching_info_ptr->caches_are_shared())
+    {
+      //tell the workers which data will be cached, such that they can allocate shared memory
+      //note: this has to be consistent with get_viewgrams()
+      distributed::send_bool_value(!is_null_ptr(binwise_correction), -1, -1);
+      distributed::send_bool_value((!is_null_ptr(normalise_sptr) && !normalise_sptr->is_trivial()) || zero_seg0_end_planes,
+                                   -1, -1);
+    }
   
   assert(min_segment_num <= max_segment_num);
   assert(subset_num >=0);
@@ -260,6 +269,8 @@ void distributable_computation_cache_enabled(
         
   CPUTimer iteration_timer;
   iteration_timer.start();
+  HighResWallClockTimer wall_clock_timer;
+  wall_clock_timer.start();
    
   //initialize the caching values for the new iteration
   caching_info_ptr->initialise_new_subiteration(vs_nums_to_process);
@@ -347,6 +358,12 @@ void distributable_computation_cache_enabled(
   //send end_iteration notification
   distributed::send_int_values(int_values, 2, END_ITERATION_TAG, -1);
         
+  // time the reduction separately, to see how much time is spent on communication
+  wall_clock_timer.stop();
+  const double computation_time = wall_clock_timer.value();
+  HighResWallClockTimer reduction_timer;
+  reduction_timer.start();
+
   //reduce output image
   if (!is_null_ptr(output_image_ptr))
     distributed::reduce_received_output_image(output_image_ptr, 0);
@@ -356,6 +373,9 @@ void distributable_computation_cache_enabled(
       double buffer = 0.0;
       MPI_Reduce(&buffer, log_likelihood_ptr, /*size*/1, MPI_DOUBLE, MPI_SUM, /*destination*/ 0, MPI_COMM_WORLD);
     }
+  reduction_timer.stop();
+  info(boost::format("Distributed computation: %1% s until all slaves finished, %2% s for the reduction of the results")
+       % computation_time % reduction_timer.value());
         
   //reduce timed rpc-value
   if(distributed::rpc_time)
@@ -24,12 +24,15 @@
 #include "stir/IO/InterfileHeader.h"
 #include "stir/IO/InterfilePDFSHeaderSPECT.h"
 #include "stir/ProjDataInterfile.h"
+#include "stir/ProjDataInMemory.h"
 #include "stir/ExamInfo.h"
 #include "stir/shared_ptr.h"
 #include <fstream>
+#include <algorithm>
 #include "stir/Succeeded.h"
 #include "stir/error.h"
 #include <boost/shared_array.hpp>
+#include <boost/format.hpp>
 
 using std::ios;
 
@@ -59,6 +62,80 @@ namespace distributed
   int sizes[6]; //array for receiving image dimensions          
         
   stir::HighResWallClockTimer t;
+
+  MPI_Comm node_comm = MPI_COMM_NULL;
+  std::vector<int> node_nums;
+
+  //--------------------------------------Set-up of communicators-----------------------------
+
+  void set_up_node_communicators()
+  {
+    int my_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+
+    // put all workers in one communicator, and split that by shared memory
+    MPI_Comm worker_comm;
+    MPI_Comm_split(MPI_COMM_WORLD, my_rank==0 ? MPI_UNDEFINED : 1, my_rank, &worker_comm);
+    int first_rank_on_node = -1;
+    if (my_rank != 0)
+      {
+        MPI_Comm_split_type(worker_comm, MPI_COMM_TYPE_SHARED, my_rank, MPI_INFO_NULL, &node_comm);
+        MPI_Comm_free(&worker_comm);
+        first_rank_on_node = my_rank;
+        MPI_Bcast(&first_rank_on_node, 1, MPI_INT, 0, node_comm);
+      }
+
+    std::vector<int> first_ranks(num_processors);
+    MPI_Allgather(&first_rank_on_node, 1, MPI_INT, &first_ranks[0], 1, MPI_INT, MPI_COMM_WORLD);
+    // convert to node numbers (first_ranks is sorted for all workers, as ranks are keys in the split)
+    node_nums.resize(num_processors);
+    int num_nodes = 0;
+    for (int proc=0; proc<num_processors; ++proc)
+      {
+        if (first_ranks[proc] < 0)
+          node_nums[proc] = -1;
+        else if (first_ranks[proc] == proc)
+          node_nums[proc] = num_nodes++;
+        else
+          node_nums[proc] = node_nums[first_ranks[proc]];
+      }
+  }
+
+  stir::shared_ptr<stir::ProjDataInMemory>
+  create_node_shared_proj_data(MPI_Win& win,
+                               const stir::shared_ptr<const stir::ExamInfo>& exam_info_sptr,
+                               const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_sptr)
+  {
+    if (node_comm == MPI_COMM_NULL)
+      stir::error("create_node_shared_proj_data: set_up_node_communicators() has not been called (or called by the master)");
+
+    const std::size_t num_elements = proj_data_info_sptr->size_all();
+    int node_rank;
+    MPI_Comm_rank(node_comm, &node_rank);
+    // only the first worker on the node allocates memory
+    const MPI_Aint local_size =
+      node_rank==0 ? static_cast<MPI_Aint>(num_elements*sizeof(float)) : 0;
+    float * local_ptr;
+    if (MPI_Win_allocate_shared(local_size, sizeof(float), MPI_INFO_NULL, node_comm, &local_ptr, &win) != MPI_SUCCESS)
+      stir::error(boost::format("create_node_shared_proj_data: allocating %1% MB of shared memory failed")
+                  % (num_elements*sizeof(float)/1000000));
+
+    MPI_Aint size;
+    int disp_unit;
+    float * node_data_ptr;
+    MPI_Win_shared_query(win, 0, &size, &disp_unit, &node_data_ptr);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+    return stir::shared_ptr<stir::ProjDataInMemory>
+      (new stir::ProjDataInMemory(exam_info_sptr, proj_data_info_sptr, node_data_ptr));
+  }
+
+  void free_node_shared_window(MPI_Win& win)
+  {
+    if (win == MPI_WIN_NULL)
+      return;
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+  }
                 
         
   //--------------------------------------Send Operations-------------------------------------
@@ -612,8 +689,8 @@ namespace distributed
     return status;                      
   }
         
-  void receive_and_construct_exam_and_proj_data_info_ptr(stir::shared_ptr<stir::ExamInfo>& exam_info_sptr, 
-							 stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_sptr, 
+  void receive_and_construct_exam_and_proj_data_info_ptr(stir::shared_ptr<const stir::ExamInfo>& exam_info_sptr, 
+							 stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_sptr, 
 							 int source)
   {
     int len;
@@ -658,12 +735,12 @@ namespace distributed
 	  stir::error("Error receiving projection data info. Text does not seem to be in Interfile format");
         
 	proj_data_info_sptr = 
-	  stir::shared_ptr<stir::ProjDataInfo> (hdr.data_info_ptr->clone());
+	  stir::shared_ptr<stir::ProjDataInfo> (hdr.data_info_sptr->clone());
       }
   }
    
   void receive_and_construct_related_viewgrams(stir::RelatedViewgrams<float>*& viewgrams, 
-                                               const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr, 
+                                               const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr, 
                                                const stir::shared_ptr<stir::DataSymmetriesForViewSegmentNumbers> symmetries_sptr,
                                                int source)
   {
@@ -692,7 +769,7 @@ namespace distributed
   }
    
   void receive_and_construct_viewgram(stir::Viewgram<float>*& viewgram_ptr, 
-                                      const  stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr, 
+                                      const  stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr, 
                                       int source)
   {
 #ifdef STIR_MPI_TIMINGS
@@ -728,28 +805,134 @@ namespace distributed
   }     
     
   //--------------------------------------Reduce Operations-------------------------------------
-        
+
+  bool image_reduction_uses_bounding_box=false;
+
+  // buffer and requests of the reduction started by reduce_output_image()
+  // (they have to be kept until the reduction has finished)
+  static std::vector<float> reduction_buffer;
+  static std::vector<MPI_Request> reduction_requests;
+
+  // images are reduced in chunks of planes with (at least) this number of elements
+  static const int min_reduction_chunk_size = 1<<18;
+
+  /* find the index range of the voxels that are reduced 
+
+     This is the whole image, or the smallest box containing the non-zero voxels of all processes
+     when image_reduction_uses_bounding_box is true. In the latter case, this is a collective call.
+     The master passes \a image_has_values=false, as it does not contribute to the reduction.
+
+     The box is empty (max < min) when all voxels are zero.
+  */
+  static void find_reduction_box(stir::BasicCoordinate<3,int>& min_indices, stir::BasicCoordinate<3,int>& max_indices,
+                                 const stir::DiscretisedDensity<3,float>& image, const bool image_has_values)
+  {
+    if (!image.get_regular_range(min_indices, max_indices))
+      stir::error("Reduction of images in the distributed computation needs images with a regular index range");
+    if (!image_reduction_uses_bounding_box)
+      return;
+
+    // box of our own non-zero values, start with an empty box
+    // minima are stored negated, such that the union can be found with a single MPI_MAX reduction
+    int local_box[6];
+    for (int d=1; d<=3; ++d)
+      {
+        local_box[d-1] = -(max_indices[d]+1);
+        local_box[d+2] = min_indices[d]-1;
+      }
+    if (image_has_values)
+      for (int z=min_indices[1]; z<=max_indices[1]; ++z)
+        for (int y=min_indices[2]; y<=max_indices[2]; ++y)
+          for (int x=min_indices[3]; x<=max_indices[3]; ++x)
+            if (image[z][y][x] != 0.F)
+              {
+                local_box[0] = std::max(local_box[0], -z);
+                local_box[1] = std::max(local_box[1], -y);
+                local_box[2] = std::max(local_box[2], -x);
+                local_box[3] = std::max(local_box[3], z);
+                local_box[4] = std::max(local_box[4], y);
+                local_box[5] = std::max(local_box[5], x);
+              }
+    int box[6];
+    MPI_Allreduce(local_box, box, 6, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    for (int d=1; d<=3; ++d)
+      {
+        min_indices[d] = -box[d-1];
+        max_indices[d] = box[d+2];
+      }
+  }
+
+  static int get_num_planes_per_reduction_chunk(const stir::BasicCoordinate<3,int>& min_indices, const stir::BasicCoordinate<3,int>& max_indices)
+  {
+    const int plane_size = (max_indices[2]-min_indices[2]+1)*(max_indices[3]-min_indices[3]+1);
+    return std::max(1, min_reduction_chunk_size/plane_size);
+  }
+
+  // copy the box-part of planes min_z...max_z of the image to the buffer
+  static void copy_box_to_buffer(float * buffer, const stir::DiscretisedDensity<3,float>& image,
+                                 const stir::BasicCoordinate<3,int>& min_indices, const stir::BasicCoordinate<3,int>& max_indices,
+                                 const int min_z, const int max_z)
+  {
+    for (int z=min_z; z<=max_z; ++z)
+      for (int y=min_indices[2]; y<=max_indices[2]; ++y)
+        buffer = std::copy(&image[z][y][min_indices[3]], &image[z][y][max_indices[3]]+1, buffer);
+  }
+
+  // copy the values from the buffer to the box-part of planes min_z...max_z of the image
+  static void copy_buffer_to_box(stir::DiscretisedDensity<3,float>& image, const float * buffer,
+                                 const stir::BasicCoordinate<3,int>& min_indices, const stir::BasicCoordinate<3,int>& max_indices,
+                                 const int min_z, const int max_z)
+  {
+    const int row_size = max_indices[3]-min_indices[3]+1;
+    for (int z=min_z; z<=max_z; ++z)
+      for (int y=min_indices[2]; y<=max_indices[2]; ++y, buffer+=row_size)
+        std::copy(buffer, buffer+row_size, &image[z][y][min_indices[3]]);
+  }
+
   void reduce_received_output_image(stir::DiscretisedDensity<3,float>* output_image_ptr, int destination)
   {             
- #ifdef STIR_MPI_TIMINGS
+#ifdef STIR_MPI_TIMINGS
     stir::HighResWallClockTimer fulltimer;
     fulltimer.reset(); fulltimer.start();
 #endif
-    float *output_buf = new float[image_buffer_size];
-    float *image_buf = new float[image_buffer_size];
-                
+    stir::BasicCoordinate<3,int> min_indices, max_indices;
+    find_reduction_box(min_indices, max_indices, *output_image_ptr, /* image_has_values = */ false);
+    // voxels outside the box are zero for all slaves
+    output_image_ptr->fill(0.F);
+    if (max_indices[1] < min_indices[1])
+      return;
+
+    const int plane_size = (max_indices[2]-min_indices[2]+1)*(max_indices[3]-min_indices[3]+1);
+    const int num_planes_per_chunk = get_num_planes_per_reduction_chunk(min_indices, max_indices);
     //initialize output_buffer to zero.
     //contributions from all slaves will be added into it
-    //KTXXXfor (int i=0; i<image_buffer_size;i++) output_buf[i]=0.0;
-    for (int i=0; i<image_buffer_size;i++) image_buf[i]=0.0;
+    std::vector<float> output_buf((max_indices[1]-min_indices[1]+1)*plane_size, 0.F);
                         
     //receive output image values
 #ifdef STIR_MPI_TIMINGS
     if (test_send_receive_times) {t.reset(); t.start();} 
 #endif
 
-    MPI_Reduce(image_buf, output_buf, image_buffer_size, MPI_FLOAT, MPI_SUM, destination, MPI_COMM_WORLD);
-    delete[] image_buf;
+    std::vector<MPI_Request> requests;
+    std::vector<int> chunk_min_zs;
+    for (int z=min_indices[1]; z<=max_indices[1]; z+=num_planes_per_chunk)
+      {
+        const int chunk_max_z = std::min(z+num_planes_per_chunk-1, max_indices[1]);
+        MPI_Request request;
+        MPI_Ireduce(MPI_IN_PLACE, &output_buf[(z-min_indices[1])*plane_size], (chunk_max_z-z+1)*plane_size,
+                    MPI_FLOAT, MPI_SUM, destination, MPI_COMM_WORLD, &request);
+        requests.push_back(request);
+        chunk_min_zs.push_back(z);
+      }
+    //get output_image from 1-dimensional array, while the other chunks are still being reduced
+    for (std::size_t i=0; i<requests.size(); ++i)
+      {
+        int chunk_num;
+        MPI_Waitany(static_cast<int>(requests.size()), &requests[0], &chunk_num, MPI_STATUS_IGNORE);
+        const int z = chunk_min_zs[chunk_num];
+        copy_buffer_to_box(*output_image_ptr, &output_buf[(z-min_indices[1])*plane_size], min_indices, max_indices,
+                           z, std::min(z+num_planes_per_chunk-1, max_indices[1]));
+      }
 
 #ifdef STIR_MPI_TIMINGS
     if (test_send_receive_times) t.stop();
@@ -758,39 +941,54 @@ namespace distributed
 
     std::cout <<"Master: output_image reduced.\n";
                 
-    //get input_image from 1-demnsional array
-    std::copy(output_buf, output_buf+image_buffer_size, output_image_ptr->begin_all());
-    delete[] output_buf;
 #ifdef STIR_MPI_TIMINGS
     fulltimer.stop();
     if (test_send_receive_times /*&& fulltimer.value()>min_threshold*/) std::cout << "Master: reduced output_image total after " << fulltimer.value() << " seconds" << std::endl;
 #endif
   }
         
-  void reduce_output_image(stir::shared_ptr<stir::DiscretisedDensity<3, float> > &output_image_ptr, int image_buffer_size, int my_rank_ignored, int destination)
+  void reduce_output_image(stir::shared_ptr<stir::DiscretisedDensity<3, float> > &output_image_ptr, int image_buffer_size_ignored, int my_rank_ignored, int destination)
   {
-    float *output_buf = new float[image_buffer_size];
-    float *image_buf = new float[image_buffer_size];
-                
-    //serialize input_image into 1-demnsional array
-    //KTXXXstd::copy(output_image_ptr->begin_all(), output_image_ptr->end_all(), output_buf);
-    std::copy(output_image_ptr->begin_all(), output_image_ptr->end_all(), image_buf);
+    // the buffer might still be used by the previous reduction
+    wait_for_output_image_reduction();
+
+    stir::BasicCoordinate<3,int> min_indices, max_indices;
+    find_reduction_box(min_indices, max_indices, *output_image_ptr, /* image_has_values = */ true);
+    if (max_indices[1] < min_indices[1])
+      return;
+
+    const int plane_size = (max_indices[2]-min_indices[2]+1)*(max_indices[3]-min_indices[3]+1);
+    const int num_planes_per_chunk = get_num_planes_per_reduction_chunk(min_indices, max_indices);
+    reduction_buffer.resize((max_indices[1]-min_indices[1]+1)*plane_size);
                 
-    //reduction of output_image at master
+    //serialize output_image into 1-dimensional array, one chunk at a time,
+    //such that the first chunks are already being reduced
 #ifdef STIR_MPI_TIMINGS
     if (test_send_receive_times) {t.reset(); t.start();} 
 #endif
-
-    MPI_Reduce(image_buf, output_buf, image_buffer_size, MPI_FLOAT, MPI_SUM, destination, MPI_COMM_WORLD);
-    delete[] image_buf;
+    for (int z=min_indices[1]; z<=max_indices[1]; z+=num_planes_per_chunk)
+      {
+        const int chunk_max_z = std::min(z+num_planes_per_chunk-1, max_indices[1]);
+        float * const chunk = &reduction_buffer[(z-min_indices[1])*plane_size];
+        copy_box_to_buffer(chunk, *output_image_ptr, min_indices, max_indices, z, chunk_max_z);
+        MPI_Request request;
+        MPI_Ireduce(chunk, NULL, (chunk_max_z-z+1)*plane_size, MPI_FLOAT, MPI_SUM, destination, MPI_COMM_WORLD, &request);
+        reduction_requests.push_back(request);
+      }
 
 #ifdef STIR_MPI_TIMINGS
     if (test_send_receive_times) t.stop();
     int my_rank=0;
     MPI_Comm_rank(MPI_COMM_WORLD, &my_rank) ; /*Gets the rank of the Processor*/         
-    if (test_send_receive_times && t.value()>min_threshold) std::cout << "Slave " << my_rank << ": reduced output_image after " << t.value() << " seconds" << std::endl;
+    if (test_send_receive_times && t.value()>min_threshold) std::cout << "Slave " << my_rank << ": started reduction of output_image after " << t.value() << " seconds" << std::endl;
 #endif          
-    delete[] output_buf;
   }
-        
+
+  void wait_for_output_image_reduction()
+  {
+    if (!reduction_requests.empty())
+      MPI_Waitall(static_cast<int>(reduction_requests.size()), &reduction_requests[0], MPI_STATUSES_IGNORE);
+    reduction_requests.clear();
+  }
+
 }
@@ -25,7 +25,7 @@
 
 namespace distributed
 {
-  void test_viewgram_slave(const  stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr)
+  void test_viewgram_slave(const  stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr)
   {	
     printf("\n-----Slave startet Test for sending viewgram----------\n");
 	
@@ -37,7 +37,7 @@ namespace distributed
     delete vg;
   }
 	
-  void test_viewgram_master(stir::Viewgram<float> viewgram, const  stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr)
+  void test_viewgram_master(stir::Viewgram<float> viewgram, const  stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr)
   {
     printf("\n-----Running Test for sending viewgram----------\n");
 		
@@ -112,7 +112,7 @@ namespace distributed
     send_image_estimate(received_image_estimate.get(), 0);
   }
 	
-  void test_related_viewgrams_master(const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr, 
+  void test_related_viewgrams_master(const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr, 
 				     const stir::shared_ptr<stir::DataSymmetriesForViewSegmentNumbers> symmetries_sptr,
 				     stir::RelatedViewgrams<float>* y, int slave)
   {
@@ -152,7 +152,7 @@ namespace distributed
     printf("\n-----Test sending related viewgrams done-----\n");
   }
 	
-  void test_related_viewgrams_slave(const stir::shared_ptr<stir::ProjDataInfo>& proj_data_info_ptr, 
+  void test_related_viewgrams_slave(const stir::shared_ptr<const stir::ProjDataInfo>& proj_data_info_ptr, 
 				    const stir::shared_ptr<stir::DataSymmetriesForViewSegmentNumbers> symmetries_sptr
 				    )
   {
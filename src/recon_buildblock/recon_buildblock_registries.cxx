@@ -45,9 +45,12 @@
 #include "stir/recon_buildblock/BackProjectorByBinUsingInterpolation.h"
 #include "stir/recon_buildblock/PresmoothingForwardProjectorByBin.h"
 #include "stir/recon_buildblock/PostsmoothingBackProjectorByBin.h"
+#include "stir/recon_buildblock/ForwardProjectorByBinSPECTRotation.h"
+#include "stir/recon_buildblock/BackProjectorByBinSPECTRotation.h"
 
 #include "stir/recon_buildblock/ProjectorByBinPairUsingProjMatrixByBin.h"
 #include "stir/recon_buildblock/ProjectorByBinPairUsingSeparateProjectors.h"
+#include "stir/recon_buildblock/ProjectorByBinPairUsingSPECTRotation.h"
 
 #include "stir/recon_buildblock/TrivialBinNormalisation.h"
 #include "stir/recon_buildblock/ChainedBinNormalisation.h"
@@ -112,13 +115,16 @@ static ProjMatrixByBinSPECTUB::RegisterIt dumy14;
 static ForwardProjectorByBinUsingProjMatrixByBin::RegisterIt dummy31;
 static ForwardProjectorByBinUsingRayTracing::RegisterIt dummy32;
 static PostsmoothingBackProjectorByBin::RegisterIt dummy33;
+static ForwardProjectorByBinSPECTRotation::RegisterIt dummy34;
 
 static BackProjectorByBinUsingProjMatrixByBin::RegisterIt dummy51;
 static BackProjectorByBinUsingInterpolation::RegisterIt dummy52;
 static PresmoothingForwardProjectorByBin::RegisterIt dummy53;
+static BackProjectorByBinSPECTRotation::RegisterIt dummy54;
 
 static ProjectorByBinPairUsingProjMatrixByBin::RegisterIt dummy71;
 static ProjectorByBinPairUsingSeparateProjectors::RegisterIt dummy72;
+static ProjectorByBinPairUsingSPECTRotation::RegisterIt dummy73;
 
 static TrivialBinNormalisation::RegisterIt dummy91;
 static ChainedBinNormalisation::RegisterIt dummy92;
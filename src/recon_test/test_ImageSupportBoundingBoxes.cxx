@@ -0,0 +1,158 @@
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recontest
+
+  \brief Test program for stir::ImageSupportBoundingBoxes and
+  stir::ForwardProjectorByBin::set_skip_zero_image_regions()
+
+  Checks the intersection of a few LORs with the support of an image, and checks that
+  forward projections with and without skipping zero image regions are identical.
+
+  \author agent
+*/
+
+#include "stir/recon_buildblock/ImageSupportBoundingBoxes.h"
+#include "stir/recon_buildblock/ForwardProjectorByBinUsingRayTracing.h"
+#include "stir/recon_buildblock/ForwardProjectorByBinUsingProjMatrixByBin.h"
+#include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/SegmentByView.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/Shape/EllipsoidalCylinder.h"
+#include "stir/RunTests.h"
+#include <iostream>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup recontest
+  \brief Test class for ImageSupportBoundingBoxes
+*/
+class ImageSupportBoundingBoxesTests : public RunTests
+{
+public:
+  void run_tests();
+
+private:
+  shared_ptr<ProjDataInfo> proj_data_info_sptr;
+  shared_ptr<ExamInfo> exam_info_sptr;
+  shared_ptr<VoxelsOnCartesianGrid<float> > image_sptr;
+
+  void run_tests_intersections();
+  void run_tests_for_projector(ForwardProjectorByBin& forward_projector, const std::string& str);
+};
+
+void
+ImageSupportBoundingBoxesTests::run_tests_intersections()
+{
+  std::cerr << "\tTests on intersections\n";
+  const VoxelsOnCartesianGrid<float>& image = *image_sptr;
+  const CartesianCoordinate3D<float> voxel_size = image.get_voxel_size();
+  {
+    shared_ptr<VoxelsOnCartesianGrid<float> > zero_image_sptr(image.get_empty_copy());
+    const ImageSupportBoundingBoxes support(*zero_image_sptr);
+    check(support.is_empty(), "zero image should have empty support");
+    check(!support.intersects(0.F, -300.F, 0.F, 0.F, 300.F, 0.F, 10.F), "LOR should not intersect empty support");
+  }
+
+  const ImageSupportBoundingBoxes support(image);
+  check(!support.is_empty(), "image should have non-empty support");
+  // the cylinder is centred at x=60, y=0, z=0 (in gantry coordinates) with radius 30
+  check(support.intersects(0.F, -300.F, 60.F, 0.F, 300.F, 60.F, 0.F), "LOR through the centre of the cylinder");
+  check(support.intersects(0.F, 300.F, -240.F, 0.F, -300.F, 360.F, 0.F), "oblique LOR through the centre of the cylinder");
+  check(!support.intersects(0.F, -300.F, 0.F, 0.F, 300.F, 0.F, 0.F), "LOR through the centre of the image");
+  check(!support.intersects(0.F, -300.F, 30.F - 2*voxel_size.x(), 0.F, 300.F, 30.F - 2*voxel_size.x(), 0.F),
+        "LOR next to the cylinder");
+  check(support.intersects(0.F, -300.F, 30.F - 2*voxel_size.x(), 0.F, 300.F, 30.F - 2*voxel_size.x(), 3*voxel_size.x()),
+        "LOR next to the cylinder with margin");
+  check(!support.intersects(-300.F, 0.F, 60.F, -300.F, 1.F, 60.F, 0.F), "LOR outside the axial extent of the cylinder");
+  check(support.intersects(-300.F, 0.F, 60.F, 300.F, 0.F, 60.F, 0.F), "axial LOR through the cylinder");
+}
+
+void
+ImageSupportBoundingBoxesTests::run_tests_for_projector(ForwardProjectorByBin& forward_projector, const std::string& str)
+{
+  std::cerr << "\tTests with " << str << "\n";
+  forward_projector.set_up(proj_data_info_sptr, image_sptr);
+
+  ProjDataInMemory org_proj_data(exam_info_sptr, proj_data_info_sptr);
+  forward_projector.set_skip_zero_image_regions(false);
+  forward_projector.forward_project(org_proj_data, *image_sptr);
+
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+  proj_data.fill(1.F); // check that skipped bins are set to zero
+  forward_projector.set_skip_zero_image_regions(true);
+  forward_projector.forward_project(proj_data, *image_sptr);
+
+  for (int segment_num = proj_data.get_min_segment_num(); segment_num <= proj_data.get_max_segment_num(); ++segment_num)
+    {
+      const SegmentByView<float> org_segment = org_proj_data.get_segment_by_view(segment_num);
+      const SegmentByView<float> segment = proj_data.get_segment_by_view(segment_num);
+      check(org_segment.find_max() > 0, str + ": forward projection should be non-zero");
+      check_if_equal(org_segment, segment, str + ": forward projection when skipping zero image regions");
+    }
+
+  shared_ptr<VoxelsOnCartesianGrid<float> > zero_image_sptr(image_sptr->get_empty_copy());
+  proj_data.fill(1.F);
+  forward_projector.forward_project(proj_data, *zero_image_sptr);
+  for (int segment_num = proj_data.get_min_segment_num(); segment_num <= proj_data.get_max_segment_num(); ++segment_num)
+    check_if_zero(proj_data.get_segment_by_view(segment_num), str + ": forward projection of zero image");
+}
+
+void
+ImageSupportBoundingBoxesTests::run_tests()
+{
+  std::cerr << "Tests for ImageSupportBoundingBoxes\n";
+
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E962));
+  // the ray tracing projector needs a zero view offset, so avoid view mashing
+  scanner_sptr->set_num_detectors_per_ring(96);
+  proj_data_info_sptr.reset(ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                                          /*span=*/1,
+                                                          /*max_delta=*/3,
+                                                          /*num_views=*/48,
+                                                          /*num_tang_poss=*/64));
+  exam_info_sptr.reset(new ExamInfo(ImagingModality::PT));
+  image_sptr.reset(new VoxelsOnCartesianGrid<float>(exam_info_sptr, *proj_data_info_sptr));
+  {
+    const float z_centre =
+      (image_sptr->get_min_index() + image_sptr->get_max_index())/2.F * image_sptr->get_voxel_size().z();
+    const EllipsoidalCylinder cylinder(/*length*/ 4*image_sptr->get_voxel_size().z(),
+                                       /*radius_y*/ 30.F, /*radius_x*/ 30.F,
+                                       CartesianCoordinate3D<float>(z_centre, 0.F, 60.F));
+    cylinder.construct_volume(*image_sptr, make_coordinate(2, 2, 2));
+  }
+
+  run_tests_intersections();
+  {
+    ForwardProjectorByBinUsingRayTracing forward_projector;
+    run_tests_for_projector(forward_projector, "ray tracing projector");
+  }
+  {
+    shared_ptr<ProjMatrixByBin> proj_matrix_sptr(new ProjMatrixByBinUsingRayTracing());
+    ForwardProjectorByBinUsingProjMatrixByBin forward_projector(proj_matrix_sptr);
+    run_tests_for_projector(forward_projector, "ray tracing matrix");
+  }
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int main()
+{
+  ImageSupportBoundingBoxesTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -0,0 +1,203 @@
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+    SPDX-License-Identifier: Apache-2.0
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recon_test
+  \ingroup KOSMAPOSL
+  \brief Test program for KOSMAPOSL
+  \author agent
+*/
+
+#include "stir/recon_buildblock/test/PoissonLLReconstructionTests.h"
+#include "stir/KOSMAPOSL/KOSMAPOSLReconstruction.h"
+#include "stir/OSMAPOSL/OSMAPOSLReconstruction.h"
+#include "stir/FilePath.h"
+#include <boost/format.hpp>
+#include <cstdio>
+#include <ctime>
+
+START_NAMESPACE_STIR
+
+typedef DiscretisedDensity<3,float> target_type;
+/*!
+  \ingroup recon_test
+  \ingroup KOSMAPOSL
+  \brief Test class for KOSMAPOSL
+
+  Checks that
+  - with a neighbourhood of a single voxel, KOSMAPOSL gives the same result as OSMAPOSL
+    (i.e. the sparse kernel matrix reduces to the identity),
+  - the anatomical kernel matrix that is read from the cache gives the same result as
+    the one that is computed.
+*/
+class TestKOSMAPOSL : public PoissonLLReconstructionTests<target_type>
+{
+private:
+  typedef PoissonLLReconstructionTests<target_type> base_type;
+public:
+  //! Constructor that can take some input data to run the test with
+  TestKOSMAPOSL(const std::string &projector_pair_filename = "",
+                const std::string &proj_data_filename = "",
+                const std::string & density_filename = "")
+    : base_type(projector_pair_filename, proj_data_filename, density_filename)
+  {}
+  virtual ~TestKOSMAPOSL() {}
+
+  virtual void construct_reconstructor();
+  KOSMAPOSLReconstruction<target_type>&
+  recon()
+  { return dynamic_cast<KOSMAPOSLReconstruction<target_type>& >(*this->_recon_sptr); }
+
+  void run_tests();
+private:
+  //! run a few subiterations, starting from a uniform image
+  shared_ptr<target_type> run_reconstruction();
+  void test_single_voxel_neighbourhood();
+  void test_kernel_matrix_cache();
+};
+
+void
+TestKOSMAPOSL::
+construct_reconstructor()
+{
+  this->_recon_sptr.reset(new KOSMAPOSLReconstruction<target_type>);
+  this->construct_log_likelihood();
+  this->recon().set_objective_function_sptr(this->_objective_function_sptr);
+  this->recon().set_num_subiterations(3);
+  this->recon().set_anatomical_prior_sptr(shared_ptr<target_type>(this->_input_density_sptr->clone()));
+  this->recon().set_sigma_m(1.);
+  this->recon().set_sigma_dm(5.);
+  this->recon().set_kernelised_output_filename_prefix("test_KOSMAPOSL_kernelised");
+}
+
+shared_ptr<target_type>
+TestKOSMAPOSL::
+run_reconstruction()
+{
+  shared_ptr<target_type> output_sptr(this->_input_density_sptr->get_empty_copy());
+  output_sptr->fill(1.F);
+  this->reconstruct(output_sptr);
+  return output_sptr;
+}
+
+void
+TestKOSMAPOSL::
+test_single_voxel_neighbourhood()
+{
+  std::cerr << "\nComparing KOSMAPOSL with a single voxel neighbourhood with OSMAPOSL\n";
+
+  this->construct_reconstructor();
+  this->recon().set_num_neighbours(1);
+  shared_ptr<const target_type> kosmaposl_sptr = this->run_reconstruction();
+
+  this->_recon_sptr.reset(new OSMAPOSLReconstruction<target_type>);
+  this->construct_log_likelihood();
+  OSMAPOSLReconstruction<target_type>& osmaposl =
+    dynamic_cast<OSMAPOSLReconstruction<target_type>& >(*this->_recon_sptr);
+  osmaposl.set_objective_function_sptr(this->_objective_function_sptr);
+  osmaposl.set_num_subiterations(3);
+  shared_ptr<const target_type> osmaposl_sptr = this->run_reconstruction();
+
+  set_tolerance(kosmaposl_sptr->find_max()*1E-4);
+  check_if_equal(*osmaposl_sptr, *kosmaposl_sptr, "KOSMAPOSL with single voxel neighbourhood vs OSMAPOSL");
+}
+
+void
+TestKOSMAPOSL::
+test_kernel_matrix_cache()
+{
+  std::cerr << "\nComparing KOSMAPOSL with and without kernel matrix cache\n";
+
+  this->construct_reconstructor();
+  shared_ptr<const target_type> no_cache_sptr = this->run_reconstruction();
+
+  // use a new directory such that we start with an empty cache
+  const std::string cache_directory_name =
+    (boost::format("test_KOSMAPOSL_cache_%1%") % std::time(0)).str();
+  const std::string cache_directory =
+    FilePath(FilePath::get_current_working_directory(), false).append(cache_directory_name).get_as_string();
+
+  // first run: computes the kernel matrix and writes it to the cache
+  this->construct_reconstructor();
+  this->recon().set_kernel_matrix_cache_directory(cache_directory);
+  shared_ptr<const target_type> write_cache_sptr = this->run_reconstruction();
+  const std::string cache_filename = this->recon().get_kernel_matrix_cache_filename();
+  check(!cache_filename.empty(), "cache filename should be set");
+  check(FilePath::exists(cache_filename), "cache file should have been written");
+
+  // second run: reads the kernel matrix from the cache
+  this->construct_reconstructor();
+  this->recon().set_kernel_matrix_cache_directory(cache_directory);
+  shared_ptr<const target_type> read_cache_sptr = this->run_reconstruction();
+  check(this->recon().get_kernel_matrix_cache_filename() == cache_filename,
+        "cache filename should be the same for identical input");
+
+  set_tolerance(0.);
+  check_if_equal(*no_cache_sptr, *write_cache_sptr, "KOSMAPOSL without cache vs writing to cache");
+  check_if_equal(*no_cache_sptr, *read_cache_sptr, "KOSMAPOSL without cache vs reading from cache");
+
+  // a change in the kernel parameters should give another file
+  this->construct_reconstructor();
+  this->recon().set_kernel_matrix_cache_directory(cache_directory);
+  this->recon().set_sigma_m(2.);
+  if (this->_recon_sptr->set_up(shared_ptr<target_type>(this->_input_density_sptr->get_empty_copy())) == Succeeded::no)
+    error("KOSMAPOSL set_up failed");
+  const std::string other_cache_filename = this->recon().get_kernel_matrix_cache_filename();
+  check(other_cache_filename != cache_filename, "cache filename should depend on sigma_m");
+
+  // clean-up. Removing the directory fails if there are any files left (e.g. temporary files).
+  check(std::remove(cache_filename.c_str()) == 0, "removing cache file");
+  check(std::remove(other_cache_filename.c_str()) == 0, "removing second cache file");
+  check(std::remove(cache_directory.c_str()) == 0, "removing cache directory (should be empty)");
+}
+
+void
+TestKOSMAPOSL::
+run_tests()
+{
+  std::cerr << "Tests for KOSMAPOSL\n";
+
+  try {
+    this->construct_input_data();
+    this->test_single_voxel_neighbourhood();
+    this->test_kernel_matrix_cache();
+  }
+  catch(const std::exception &error)
+    {
+      std::cerr << "\nHere's the error:\n\t" << error.what() << "\n\n";
+      everything_ok = false;
+    }
+  catch(...)
+    {
+      everything_ok = false;
+    }
+}
+
+END_NAMESPACE_STIR
+
+
+USING_NAMESPACE_STIR
+
+
+int main(int argc, char **argv)
+{
+    if (argc < 1 || argc > 3) {
+        std::cerr << "\nUsage: " << argv[0] << " [projector_pair_filename [template_proj_data [image]]]\n"
+                  << "projector_pair_filename (optional) can be used to specify the projectors\n"
+                  <<"  if set to an empty string, the default ray-tracing matrix will be used.\n"
+                  << "template_proj_data (optional) will serve as a template, but is otherwise not used.\n"
+                  << "image (optional) has to be compatible with projection data and currently at zoom=1\n";
+        return EXIT_FAILURE;
+    }
+
+    TestKOSMAPOSL test(argc>1 ? argv[1] : "", argc > 2 ? argv[2] : "", argc > 3 ? argv[3] : "");
+
+    if (test.is_everything_ok())
+        test.run_tests();
+
+    return test.main_return_value();
+}
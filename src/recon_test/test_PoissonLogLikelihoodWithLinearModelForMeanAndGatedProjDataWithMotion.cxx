@@ -0,0 +1,227 @@
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recon_test
+
+  \brief Test program for processing gates in parallel in stir::PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotion
+
+  Constructs a small 2-gate data set with a translation between the gates, and checks that the
+  gradient, the objective function value and the Hessian times an input are the same when gates
+  are processed in parallel as when they are processed sequentially.
+  Without OpenMP, gates are always processed sequentially, so the test is then trivial.
+
+  \author agent
+*/
+
+#include "stir/recon_buildblock/PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotion.h"
+#include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h"
+#include "stir/recon_buildblock/ProjectorByBinPairUsingProjMatrixByBin.h"
+#include "stir/spatial_transformation/GatedSpatialTransformation.h"
+#include "stir/GatedDiscretisedDensity.h"
+#include "stir/TimeGateDefinitions.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/SegmentByView.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/RunTests.h"
+#include "stir/Succeeded.h"
+#include <boost/format.hpp>
+#include <cmath>
+#include <vector>
+#include <utility>
+
+START_NAMESPACE_STIR
+
+typedef DiscretisedDensity<3,float> target_type;
+
+namespace {
+
+//! Objective function that gets its motion vectors and projectors from memory instead of from files
+class GatedObjectiveFunctionForTests
+  : public PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotion<target_type>
+{
+public:
+  void set_projector_pair_sptr(const shared_ptr<ProjectorByBinPair>& projector_pair_sptr)
+  { this->_projector_pair_ptr = projector_pair_sptr; }
+  void set_motion_vectors(const GatedSpatialTransformation& motion_vectors,
+                          const GatedSpatialTransformation& reverse_motion_vectors)
+  {
+    this->_motion_vectors = motion_vectors;
+    this->_reverse_motion_vectors = reverse_motion_vectors;
+  }
+};
+
+} // end of anonymous namespace
+
+/*!
+  \ingroup recon_test
+  \brief Test class for processing gates in parallel in PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotion
+*/
+class PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotionTests : public RunTests
+{
+public:
+  void run_tests();
+
+private:
+  TimeGateDefinitions gate_defs;
+  shared_ptr<GatedProjData> gated_proj_data_sptr;
+  shared_ptr<target_type> image_sptr;
+  GatedSpatialTransformation motion_vectors;
+  GatedSpatialTransformation reverse_motion_vectors;
+
+  void construct_input_data();
+  //! construct a gated image with the given translation (in mm) in gate 2, and none in gate 1
+  GatedDiscretisedDensity construct_gated_translation(const float translation) const;
+  shared_ptr<GatedObjectiveFunctionForTests> construct_objective_function(const int num_gates_in_parallel) const;
+};
+
+GatedDiscretisedDensity
+PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotionTests::
+construct_gated_translation(const float translation) const
+{
+  const shared_ptr<target_type> no_motion_sptr(image_sptr->get_empty_copy());
+  const shared_ptr<target_type> motion_sptr(image_sptr->get_empty_copy());
+  motion_sptr->fill(translation);
+  GatedDiscretisedDensity gated_translation(no_motion_sptr, 2);
+  gated_translation.set_density_sptr(motion_sptr, 2);
+  gated_translation.set_time_gate_definitions(gate_defs);
+  return gated_translation;
+}
+
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotionTests::
+construct_input_data()
+{
+  std::vector<std::pair<unsigned int, double> > gate_sequence;
+  gate_sequence.push_back(std::make_pair(1U, 1.));
+  gate_sequence.push_back(std::make_pair(2U, 1.));
+  gate_defs = TimeGateDefinitions(gate_sequence);
+
+  // construct a small scanner and sinograms
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E953));
+  scanner_sptr->set_num_rings(5);
+  shared_ptr<ProjDataInfo> proj_data_info_sptr(
+    ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                  /*span=*/3,
+                                  /*max_delta=*/4,
+                                  /*num_views=*/16,
+                                  /*num_tang_poss=*/16));
+  shared_ptr<ExamInfo> exam_info_sptr(new ExamInfo);
+  gated_proj_data_sptr.reset(new GatedProjData);
+  gated_proj_data_sptr->resize(2);
+  for (unsigned int gate_num=1; gate_num<=2; ++gate_num)
+    {
+      shared_ptr<ProjData> proj_data_sptr(new ProjDataInMemory(exam_info_sptr, proj_data_info_sptr));
+      for (int seg_num=proj_data_sptr->get_min_segment_num();
+           seg_num<=proj_data_sptr->get_max_segment_num();
+           ++seg_num)
+        {
+          SegmentByView<float> segment = proj_data_sptr->get_empty_segment_by_view(seg_num);
+          // fill in some crazy values, different for every gate
+          float value=0;
+          for (SegmentByView<float>::full_iterator iter = segment.begin_all();
+               iter != segment.end_all();
+               ++iter)
+            {
+              value = float(std::fabs((seg_num+.1*gate_num)*value - 5)); // needs to be positive for Poisson
+              *iter = value;
+            }
+          proj_data_sptr->set_segment(segment);
+        }
+      gated_proj_data_sptr->set_proj_data_sptr(proj_data_sptr, gate_num);
+    }
+  gated_proj_data_sptr->set_exam_info(*exam_info_sptr);
+
+  // construct a small image with a blob in the centre
+  image_sptr.reset(new VoxelsOnCartesianGrid<float>(*proj_data_info_sptr, 1.F, CartesianCoordinate3D<float>(0.F,0.F,0.F)));
+  BasicCoordinate<3,int> min_ind, max_ind;
+  image_sptr->get_regular_range(min_ind, max_ind);
+  for (int z=min_ind[1]; z<=max_ind[1]; ++z)
+    for (int y=min_ind[2]; y<=max_ind[2]; ++y)
+      for (int x=min_ind[3]; x<=max_ind[3]; ++x)
+        (*image_sptr)[z][y][x] = 1.F + 10.F*std::exp(-(x*x + y*y)/20.F);
+
+  // translate gate 2 over 1.5 voxels in x
+  const float translation =
+    1.5F*dynamic_cast<const VoxelsOnCartesianGrid<float>&>(*image_sptr).get_voxel_size().x();
+  const GatedDiscretisedDensity no_motion = construct_gated_translation(0.F);
+  motion_vectors.set_gate_defs(gate_defs);
+  motion_vectors.set_spatial_transformations(no_motion, no_motion, construct_gated_translation(translation));
+  reverse_motion_vectors.set_gate_defs(gate_defs);
+  reverse_motion_vectors.set_spatial_transformations(no_motion, no_motion, construct_gated_translation(-translation));
+}
+
+shared_ptr<GatedObjectiveFunctionForTests>
+PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotionTests::
+construct_objective_function(const int num_gates_in_parallel) const
+{
+  shared_ptr<GatedObjectiveFunctionForTests> objective_function_sptr(new GatedObjectiveFunctionForTests);
+  shared_ptr<ProjMatrixByBin> proj_matrix_sptr(new ProjMatrixByBinUsingRayTracing);
+  objective_function_sptr->set_projector_pair_sptr(shared_ptr<ProjectorByBinPair>(new ProjectorByBinPairUsingProjMatrixByBin(proj_matrix_sptr)));
+  objective_function_sptr->set_input_data(gated_proj_data_sptr);
+  objective_function_sptr->set_time_gate_definitions(gate_defs);
+  objective_function_sptr->set_motion_vectors(motion_vectors, reverse_motion_vectors);
+  objective_function_sptr->set_num_subsets(2);
+  objective_function_sptr->set_num_gates_to_process_in_parallel(num_gates_in_parallel);
+  if (objective_function_sptr->set_up(image_sptr) != Succeeded::yes)
+    error("set_up of the gated objective function failed");
+  return objective_function_sptr;
+}
+
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotionTests::
+run_tests()
+{
+  std::cerr << "Tests for processing gates in parallel in PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotion\n";
+  construct_input_data();
+
+  const shared_ptr<GatedObjectiveFunctionForTests> sequential_sptr = construct_objective_function(1);
+  const shared_ptr<GatedObjectiveFunctionForTests> parallel_sptr = construct_objective_function(2);
+#ifdef STIR_OPENMP
+  check_if_equal(parallel_sptr->get_num_gates_to_process_in_parallel(), 2, "number of gates to process in parallel");
+#endif
+
+  const shared_ptr<target_type> input_sptr(image_sptr->get_empty_copy());
+  input_sptr->fill(1.F);
+  // the order of accumulation over viewgrams depends on the number of threads, so values are not identical
+  set_tolerance(1E-4);
+  for (int subset_num=0; subset_num<2; ++subset_num)
+    {
+      const std::string str = boost::str(boost::format(" (subset %1%)") % subset_num);
+      const double value = sequential_sptr->compute_objective_function_without_penalty(*image_sptr, subset_num);
+      check_if_equal(value, parallel_sptr->compute_objective_function_without_penalty(*image_sptr, subset_num),
+                     "objective function value" + str);
+
+      shared_ptr<target_type> gradient_sptr(image_sptr->get_empty_copy());
+      shared_ptr<target_type> parallel_gradient_sptr(image_sptr->get_empty_copy());
+      sequential_sptr->compute_sub_gradient_without_penalty(*gradient_sptr, *image_sptr, subset_num);
+      parallel_sptr->compute_sub_gradient_without_penalty(*parallel_gradient_sptr, *image_sptr, subset_num);
+      check(gradient_sptr->find_max() != 0.F || gradient_sptr->find_min() != 0.F, "gradient should be non-zero" + str);
+      check_if_equal(*gradient_sptr, *parallel_gradient_sptr, "gradient" + str);
+
+      shared_ptr<target_type> Hessian_sptr(image_sptr->get_empty_copy());
+      shared_ptr<target_type> parallel_Hessian_sptr(image_sptr->get_empty_copy());
+      sequential_sptr->accumulate_sub_Hessian_times_input_without_penalty(*Hessian_sptr, *image_sptr, *input_sptr, subset_num);
+      parallel_sptr->accumulate_sub_Hessian_times_input_without_penalty(*parallel_Hessian_sptr, *image_sptr, *input_sptr, subset_num);
+      check_if_equal(*Hessian_sptr, *parallel_Hessian_sptr, "Hessian times input" + str);
+    }
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int main()
+{
+  PoissonLogLikelihoodWithLinearModelForMeanAndGatedProjDataWithMotionTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
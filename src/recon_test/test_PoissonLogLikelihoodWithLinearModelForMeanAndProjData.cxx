@@ -45,8 +45,12 @@
 #include "stir/info.h"
 #include "stir/Succeeded.h"
 #include "stir/num_threads.h"
+#include "stir/FilePath.h"
 #include <iostream>
 #include <memory>
+#include <cstdio>
+#include <ctime>
+#include <boost/format.hpp>
 #include <boost/random/uniform_01.hpp>
 #include <boost/random/normal_distribution.hpp>
 #include <boost/random/mersenne_twister.hpp>
@@ -120,6 +124,24 @@ protected:
   void test_objective_function_approximate_Hessian_concavity(GeneralisedObjectiveFunction<target_type>& objective_function,
                                                              target_type& target);
 
+  //! Test if multiplying the Hessian with several inputs at once gives the same result as doing it one by one
+  void test_objective_function_Hessian_times_inputs(GeneralisedObjectiveFunction<target_type>& objective_function,
+                                                    target_type& target);
+
+  //! Test if sensitivities read from the cache are equal to the computed ones
+  /*! Writes files in the current directory. */
+  void test_sensitivity_cache(PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& objective_function,
+                              const shared_ptr<target_type>& target_sptr);
+
+#ifdef STIR_MPI
+  //! Test if the gradient is the same with and without distributed caching
+  /*! Tests caching per worker and caching shared between the workers on a node. */
+  void test_distributed_caching(PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& objective_function,
+                                const shared_ptr<target_type>& target_sptr);
+  //! Test if the gradient is the same when only the bounding box of the images is reduced
+  void test_distributed_image_reduction(PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& objective_function,
+                                        const shared_ptr<target_type>& target_sptr);
+#endif
 };
 
 PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests::
@@ -139,6 +161,9 @@ run_tests_for_objective_function(GeneralisedObjectiveFunction<PoissonLogLikeliho
 
   std::cerr << "----- testing approximate-Hessian-vector product (accumulate_Hessian_times_input)\n";
   test_objective_function_approximate_Hessian_concavity(objective_function, target);
+
+  std::cerr << "----- testing Hessian times multiple inputs (accumulate_sub_Hessian_times_inputs_without_penalty)\n";
+  test_objective_function_Hessian_times_inputs(objective_function, target);
 }
 
 void
@@ -182,9 +207,9 @@ test_objective_function_gradient(GeneralisedObjectiveFunction<target_type> &obje
          "proj_data.hs, mult_proj_data.hs and add_proj_data.hs");
 
       write_to_file("subsens.hv", 
-                    reinterpret_cast<const PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type> &>(objective_function).get_subset_sensitivity(subset_num));
+                    dynamic_cast<const PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type> &>(objective_function).get_subset_sensitivity(subset_num));
     gradient_sptr->fill(0.F);
-    reinterpret_cast<PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type> &>(objective_function).
+    dynamic_cast<PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type> &>(objective_function).
       compute_sub_gradient_without_penalty_plus_sensitivity(*gradient_sptr, target, subset_num);
     write_to_file("gradient-without-sens.hv", *gradient_sptr);
     proj_data_sptr->write_to_file("proj_data.hs");
@@ -246,6 +271,148 @@ test_objective_function_approximate_Hessian_concavity(GeneralisedObjectiveFuncti
 }
 
 
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests::
+test_objective_function_Hessian_times_inputs(GeneralisedObjectiveFunction<target_type> &objective_function,
+                                             target_type &target)
+{
+  const int subset_num = 0;
+  const double org_tolerance = this->get_tolerance();
+  // use the target and a non-uniform image as inputs
+  shared_ptr<target_type> input2_sptr(target.clone());
+  {
+    float value = 1.F;
+    for (target_type::full_iterator iter = input2_sptr->begin_all(); iter != input2_sptr->end_all(); ++iter)
+      {
+        *iter *= value;
+        value = value > 2.F ? .5F : value + .1F;
+      }
+  }
+  std::vector<shared_ptr<const target_type> > inputs;
+  inputs.push_back(shared_ptr<const target_type>(target.clone()));
+  inputs.push_back(input2_sptr);
+
+  std::vector<shared_ptr<target_type> > outputs;
+  for (std::size_t k = 0; k < inputs.size(); ++k)
+    {
+      outputs.push_back(shared_ptr<target_type>(target.get_empty_copy()));
+      outputs[k]->fill(1.F); // check that result is added
+    }
+  objective_function.accumulate_sub_Hessian_times_inputs_without_penalty(outputs, target, inputs, subset_num);
+
+  for (std::size_t k = 0; k < inputs.size(); ++k)
+    {
+      shared_ptr<target_type> output_sptr(target.get_empty_copy());
+      output_sptr->fill(1.F);
+      objective_function.accumulate_sub_Hessian_times_input_without_penalty(*output_sptr, target, *inputs[k], subset_num);
+      this->set_tolerance(std::max(fabs(double(output_sptr->find_min())), double(output_sptr->find_max()))/1000);
+      check_if_equal(*output_sptr, *outputs[k], "Hessian times inputs should be equal to Hessian times input " + std::to_string(k));
+    }
+  this->set_tolerance(org_tolerance);
+}
+
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests::
+test_sensitivity_cache(PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& objective_function,
+                       const shared_ptr<target_type>& target_sptr)
+{
+  // use a new directory such that we start with an empty cache
+  const std::string cache_directory_name =
+    (boost::format("test_PoissonLogLikelihood_sensitivity_cache_%1%") % std::time(0)).str();
+  const std::string cache_directory =
+    FilePath(FilePath::get_current_working_directory(), false).append(cache_directory_name).get_as_string();
+  objective_function.set_sensitivity_cache_directory(cache_directory);
+
+  // first set_up computes the sensitivities and writes them to the cache
+  if (check(objective_function.set_up(target_sptr)==Succeeded::yes, "set-up of objective function (writing cache)"))
+    {
+      check(!objective_function.get_sensitivity_read_from_cache(), "first set-up should not find the sensitivity in the cache");
+      std::vector<shared_ptr<target_type> > org_sensitivities;
+      for (int subset_num = 0; subset_num < objective_function.get_num_subsets(); ++subset_num)
+        org_sensitivities.push_back(shared_ptr<target_type>(objective_function.get_subset_sensitivity(subset_num).clone()));
+
+      // second set_up reads them from the cache
+      if (check(objective_function.set_up(target_sptr)==Succeeded::yes, "set-up of objective function (reading cache)"))
+        {
+          check(objective_function.get_sensitivity_read_from_cache(), "second set-up should read the sensitivity from the cache");
+          for (int subset_num = 0; subset_num < objective_function.get_num_subsets(); ++subset_num)
+            check_if_equal(*org_sensitivities[subset_num], objective_function.get_subset_sensitivity(subset_num),
+                           "sensitivity read from cache for subset " + std::to_string(subset_num));
+        }
+    }
+
+  // clean-up. Removing the directory fails if there are any files left.
+  const std::string prefix = objective_function.get_sensitivity_cache_filename_prefix();
+  std::vector<std::string> basenames(1, prefix);
+  for (int subset_num = 0; subset_num < objective_function.get_num_subsets(); ++subset_num)
+    basenames.push_back((boost::format("%1%_subset%2%") % prefix % subset_num).str());
+  const char * const extensions[] = { ".txt", ".hv", ".ahv", ".v" };
+  for (std::size_t i = 0; i < basenames.size(); ++i)
+    for (std::size_t e = 0; e < sizeof(extensions)/sizeof(extensions[0]); ++e)
+      {
+        const std::string filename = basenames[i] + extensions[e];
+        if (FilePath::exists(filename))
+          check(std::remove(filename.c_str()) == 0, "removing cache file " + filename);
+      }
+  check(std::remove(cache_directory.c_str()) == 0, "removing cache directory (should be empty)");
+
+  objective_function.set_sensitivity_cache_directory("");
+}
+
+#ifdef STIR_MPI
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests::
+test_distributed_caching(PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& objective_function,
+                         const shared_ptr<target_type>& target_sptr)
+{
+  const int subset_num = 0;
+  shared_ptr<target_type> org_gradient_sptr(target_sptr->get_empty_copy());
+  objective_function.compute_sub_gradient(*org_gradient_sptr, *target_sptr, subset_num);
+
+  shared_ptr<target_type> gradient_sptr(target_sptr->get_empty_copy());
+  for (int shared_on_node = 0; shared_on_node <= 1; ++shared_on_node)
+    {
+      const std::string description = shared_on_node ? "shared distributed cache" : "distributed cache";
+      objective_function.distributed_cache_enabled = true;
+      objective_function.distributed_cache_shared_on_node = shared_on_node!=0;
+      if (!check(objective_function.set_up(target_sptr)==Succeeded::yes, "set-up of objective function with " + description))
+        break;
+      // the first computation fills the cache, the second one re-uses it
+      for (int i = 0; i < 2; ++i)
+        {
+          objective_function.compute_sub_gradient(*gradient_sptr, *target_sptr, subset_num);
+          check_if_equal(*org_gradient_sptr, *gradient_sptr,
+                         "gradient with " + description + " (computation " + std::to_string(i) + ")");
+        }
+    }
+
+  objective_function.distributed_cache_enabled = false;
+  objective_function.distributed_cache_shared_on_node = false;
+  check(objective_function.set_up(target_sptr)==Succeeded::yes, "set-up of objective function without distributed cache");
+}
+
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests::
+test_distributed_image_reduction(PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& objective_function,
+                                 const shared_ptr<target_type>& target_sptr)
+{
+  const int subset_num = 0;
+  shared_ptr<target_type> org_gradient_sptr(target_sptr->get_empty_copy());
+  objective_function.compute_sub_gradient(*org_gradient_sptr, *target_sptr, subset_num);
+
+  objective_function.distributed_image_reduction_uses_bounding_box = true;
+  if (check(objective_function.set_up(target_sptr)==Succeeded::yes, "set-up of objective function with bounding box for image reduction"))
+    {
+      shared_ptr<target_type> gradient_sptr(target_sptr->get_empty_copy());
+      objective_function.compute_sub_gradient(*gradient_sptr, *target_sptr, subset_num);
+      check_if_equal(*org_gradient_sptr, *gradient_sptr, "gradient with bounding box for image reduction");
+    }
+
+  objective_function.distributed_image_reduction_uses_bounding_box = false;
+  check(objective_function.set_up(target_sptr)==Succeeded::yes, "set-up of objective function without bounding box for image reduction");
+}
+#endif
+
 void
 PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests::
 construct_input_data(shared_ptr<target_type>& density_sptr)
@@ -372,7 +539,7 @@ construct_input_data(shared_ptr<target_type>& density_sptr)
 
   objective_function_sptr.reset(new PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>);
   PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& objective_function =
-    reinterpret_cast<  PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& >(*objective_function_sptr);
+    dynamic_cast<  PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& >(*objective_function_sptr);
   objective_function.set_proj_data_sptr(proj_data_sptr);
   objective_function.set_use_subset_sensitivities(true);
   shared_ptr<ProjMatrixByBin> proj_matrix_sptr(new ProjMatrixByBinUsingRayTracing());
@@ -399,6 +566,14 @@ run_tests()
   shared_ptr<target_type> density_sptr;
   construct_input_data(density_sptr);
   this->run_tests_for_objective_function(*this->objective_function_sptr, *density_sptr);
+  this->test_sensitivity_cache(dynamic_cast<PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& >(*this->objective_function_sptr),
+                               density_sptr);
+#ifdef STIR_MPI
+  this->test_distributed_caching(dynamic_cast<PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& >(*this->objective_function_sptr),
+                                 density_sptr);
+  this->test_distributed_image_reduction(dynamic_cast<PoissonLogLikelihoodWithLinearModelForMeanAndProjData<target_type>& >(*this->objective_function_sptr),
+                                         density_sptr);
+#endif
 #else
   // alternative that gets the objective function from an OSMAPOSL .par file
   // currently disabled
@@ -0,0 +1,231 @@
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recontest
+
+  \brief Test program for the matrix cache and the parallel computation of stir::ProjMatrixByBinSPECTUB
+
+  Computes the matrix elements for all bins serially, in parallel (when using OpenMP),
+  while writing them to the matrix cache directory and while reading them from the cache,
+  and checks that these are all identical.
+
+  \author agent
+*/
+
+#include "stir/recon_buildblock/ProjMatrixByBinSPECTUB.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/ProjDataInfoCylindricalArcCorr.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/Scanner.h"
+#include "stir/Bin.h"
+#include "stir/IndexRange3D.h"
+#include "stir/Shape/EllipsoidalCylinder.h"
+#include "stir/FilePath.h"
+#include "stir/RunTests.h"
+#include <boost/format.hpp>
+#include <vector>
+#include <cstdio>
+#include <ctime>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup recontest
+  \brief Test class for the matrix cache of ProjMatrixByBinSPECTUB
+*/
+class ProjMatrixByBinSPECTUBTests : public RunTests
+{
+public:
+  void run_tests();
+
+private:
+  shared_ptr<ProjDataInfo> proj_data_info_sptr;
+  shared_ptr<VoxelsOnCartesianGrid<float> > image_sptr;
+  shared_ptr<VoxelsOnCartesianGrid<float> > attenuation_sptr;
+
+  void set_up_geometry();
+  //! construct and set-up a matrix with 2D PSF and attenuation
+  shared_ptr<ProjMatrixByBinSPECTUB> construct_matrix(const std::string& cache_directory);
+  //! get the elements of all bins, in parallel if \a parallel is \c true (and OpenMP is enabled)
+  std::vector<ProjMatrixElemsForOneBin> get_all_elements(const ProjMatrixByBinSPECTUB& matrix, const bool parallel);
+  void check_if_equal_elements(const std::vector<ProjMatrixElemsForOneBin>& lors1,
+                               const std::vector<ProjMatrixElemsForOneBin>& lors2,
+                               const std::string& str);
+};
+
+void
+ProjMatrixByBinSPECTUBTests::set_up_geometry()
+{
+  const int num_views = 16;
+  const int num_axial_poss = 3;
+  const int num_bins = 33;
+  const float bin_size = 4.42F;
+  const float radius = 200.F;
+
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::User_defined_scanner, "SPECT test",
+                                               -1, num_axial_poss, num_bins, num_bins,
+                                               radius, 0.F, bin_size, bin_size, 0.F,
+                                               -1, -1, -1, -1, -1, -1, 1));
+  VectorWithOffset<int> num_axial_poss_per_segment(0,0);
+  num_axial_poss_per_segment[0] = num_axial_poss;
+  VectorWithOffset<int> min_ring_diff(0,0), max_ring_diff(0,0);
+  min_ring_diff[0] = 0;
+  max_ring_diff[0] = 0;
+  ProjDataInfoCylindricalArcCorr* proj_data_info_ptr =
+    new ProjDataInfoCylindricalArcCorr(scanner_sptr, bin_size,
+                                       num_axial_poss_per_segment, min_ring_diff, max_ring_diff,
+                                       num_views, num_bins);
+  VectorWithOffset<float> radii(0, num_views-1);
+  radii.fill(radius);
+  proj_data_info_ptr->set_ring_radii_for_all_views(radii);
+  proj_data_info_ptr->set_azimuthal_angle_sampling(static_cast<float>(2*_PI/num_views));
+  proj_data_info_sptr.reset(proj_data_info_ptr);
+
+  image_sptr.reset(new VoxelsOnCartesianGrid<float>(IndexRange3D(0, num_axial_poss-1, -16, 16, -16, 16),
+                                                    CartesianCoordinate3D<float>(0.F,0.F,0.F),
+                                                    CartesianCoordinate3D<float>(bin_size, bin_size, bin_size)));
+  attenuation_sptr.reset(image_sptr->get_empty_voxels_on_cartesian_grid());
+  EllipsoidalCylinder cylinder(1000.F, 50.F, 40.F, CartesianCoordinate3D<float>(0.F,5.F,0.F));
+  cylinder.construct_volume(*attenuation_sptr, CartesianCoordinate3D<int>(1,1,1));
+  *attenuation_sptr *= .15F;
+}
+
+shared_ptr<ProjMatrixByBinSPECTUB>
+ProjMatrixByBinSPECTUBTests::construct_matrix(const std::string& cache_directory)
+{
+  shared_ptr<ProjMatrixByBinSPECTUB> matrix_sptr(new ProjMatrixByBinSPECTUB);
+  matrix_sptr->set_keep_all_views_in_cache(true);
+  matrix_sptr->set_resolution_model(1.5F, .2F, false);
+  matrix_sptr->set_attenuation_image_sptr(attenuation_sptr);
+  matrix_sptr->set_matrix_cache_directory(cache_directory);
+  matrix_sptr->set_up(proj_data_info_sptr, image_sptr);
+  return matrix_sptr;
+}
+
+std::vector<ProjMatrixElemsForOneBin>
+ProjMatrixByBinSPECTUBTests::get_all_elements(const ProjMatrixByBinSPECTUB& matrix, const bool parallel)
+{
+  const int num_views = proj_data_info_sptr->get_num_views();
+  const int num_axial_poss = proj_data_info_sptr->get_num_axial_poss(0);
+  const int min_tang_pos_num = proj_data_info_sptr->get_min_tangential_pos_num();
+  const int num_tang_poss = proj_data_info_sptr->get_num_tangential_poss();
+  std::vector<ProjMatrixElemsForOneBin> lors(num_views*num_axial_poss*num_tang_poss);
+
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic) if(parallel)
+#endif
+  for (int view_num=0; view_num<num_views; ++view_num)
+    for (int axial_pos_num=0; axial_pos_num<num_axial_poss; ++axial_pos_num)
+      for (int tang_pos_num=min_tang_pos_num; tang_pos_num<min_tang_pos_num+num_tang_poss; ++tang_pos_num)
+        {
+          const Bin bin(0, view_num, axial_pos_num, tang_pos_num);
+          ProjMatrixElemsForOneBin& lor =
+            lors[(view_num*num_axial_poss + axial_pos_num)*num_tang_poss + tang_pos_num - min_tang_pos_num];
+          matrix.get_proj_matrix_elems_for_one_bin(lor, bin);
+        }
+  return lors;
+}
+
+void
+ProjMatrixByBinSPECTUBTests::
+check_if_equal_elements(const std::vector<ProjMatrixElemsForOneBin>& lors1,
+                        const std::vector<ProjMatrixElemsForOneBin>& lors2,
+                        const std::string& str)
+{
+  if (!check_if_equal(lors1.size(), lors2.size(), "number of bins " + str))
+    return;
+  for (std::size_t i=0; i<lors1.size(); ++i)
+    {
+      // values are stored as float in the cache, so they have to be identical
+      bool equal = lors1[i].size() == lors2[i].size();
+      ProjMatrixElemsForOneBin::const_iterator iter1 = lors1[i].begin();
+      ProjMatrixElemsForOneBin::const_iterator iter2 = lors2[i].begin();
+      for (; equal && iter1 != lors1[i].end(); ++iter1, ++iter2)
+        equal = iter1->get_coords() == iter2->get_coords() && iter1->get_value() == iter2->get_value();
+      if (!check(equal, boost::str(boost::format("elements for bin %1% %2%") % i % str)))
+        return;
+    }
+}
+
+void
+ProjMatrixByBinSPECTUBTests::run_tests()
+{
+  std::cerr << "Tests for ProjMatrixByBinSPECTUB\n";
+  set_up_geometry();
+
+  std::cerr << "Computing elements serially\n";
+  const std::vector<ProjMatrixElemsForOneBin> reference =
+    get_all_elements(*construct_matrix(""), false);
+  check(reference[reference.size()/2].size() > 0, "elements for central bin should be non-empty");
+
+  std::cerr << "Computing elements in parallel\n";
+  check_if_equal_elements(reference, get_all_elements(*construct_matrix(""), true), "(parallel)");
+
+  // use a new directory such that we start with an empty cache
+  const std::string cache_directory_name =
+    (boost::format("test_ProjMatrixByBinSPECTUB_cache_%1%") % std::time(0)).str();
+  const std::string cache_directory =
+    FilePath(FilePath::get_current_working_directory(), false).append(cache_directory_name).get_as_string();
+
+  std::cerr << "Computing elements and writing them to the cache\n";
+  std::vector<std::string> cache_filenames;
+  {
+    shared_ptr<ProjMatrixByBinSPECTUB> matrix_sptr = construct_matrix(cache_directory);
+    for (int view_num=0; view_num<proj_data_info_sptr->get_num_views(); ++view_num)
+      {
+        cache_filenames.push_back(matrix_sptr->get_matrix_cache_filename_for_view(view_num));
+        check(!FilePath::exists(cache_filenames.back()), boost::str(boost::format("cache file should not exist yet for view %1%") % view_num));
+      }
+    check_if_equal_elements(reference, get_all_elements(*matrix_sptr, true), "(writing to cache)");
+    for (int view_num=0; view_num<proj_data_info_sptr->get_num_views(); ++view_num)
+      check(FilePath::exists(cache_filenames[view_num]), boost::str(boost::format("cache file should exist for view %1%") % view_num));
+  }
+
+  std::cerr << "Reading elements from the cache\n";
+  {
+    shared_ptr<ProjMatrixByBinSPECTUB> matrix_sptr = construct_matrix(cache_directory);
+    check(matrix_sptr->get_matrix_cache_filename_for_view(0) == cache_filenames[0],
+          "cache filename should be the same for identical settings");
+    check_if_equal_elements(reference, get_all_elements(*matrix_sptr, true), "(reading from cache)");
+  }
+
+  std::cerr << "Checking that the cache filename depends on the image origin\n";
+  {
+    // no attenuation here, as the attenuation image needs to have the same origin as the image
+    shared_ptr<VoxelsOnCartesianGrid<float> > shifted_image_sptr(image_sptr->get_empty_voxels_on_cartesian_grid());
+    shifted_image_sptr->set_origin(CartesianCoordinate3D<float>(0.F, 0.F, 4.42F));
+    std::string filenames[2];
+    for (int shifted=0; shifted<2; ++shifted)
+      {
+        ProjMatrixByBinSPECTUB matrix;
+        matrix.set_keep_all_views_in_cache(true);
+        matrix.set_matrix_cache_directory(cache_directory);
+        matrix.set_up(proj_data_info_sptr, shifted ? shifted_image_sptr : image_sptr);
+        filenames[shifted] = matrix.get_matrix_cache_filename_for_view(0);
+      }
+    check(filenames[0] != filenames[1], "cache filename should depend on the image origin");
+  }
+
+  // clean-up. Removing the directory fails if there are any files left (e.g. temporary files).
+  for (std::size_t i=0; i<cache_filenames.size(); ++i)
+    check(std::remove(cache_filenames[i].c_str()) == 0, "removing cache file " + cache_filenames[i]);
+  check(std::remove(cache_directory.c_str()) == 0, "removing cache directory (should be empty)");
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int main()
+{
+  ProjMatrixByBinSPECTUBTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -0,0 +1,247 @@
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recontest
+
+  \brief Test program for the projection operations of stir::ProjMatrixElemsForOneBin
+  and stir::ProjMatrixElemsForOneBinWithOffsets
+
+  Checks that forward and back projection of a row give the same results when using
+  an image with nested storage, one with contiguous storage
+  (see VoxelsOnCartesianGrid::make_contiguous()) and precomputed offsets into the latter.
+  The number of voxel updates per second is reported for all cases.
+
+  \author agent
+*/
+
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBinWithOffsets.h"
+#include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/HighResWallClockTimer.h"
+#include "stir/RunTests.h"
+#include <iostream>
+#include <vector>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup recontest
+  \brief Test class for ProjMatrixElemsForOneBin and ProjMatrixElemsForOneBinWithOffsets
+*/
+class ProjMatrixElemsForOneBinTests : public RunTests
+{
+public:
+  void run_tests();
+
+private:
+  shared_ptr<VoxelsOnCartesianGrid<float> > image_sptr;
+  shared_ptr<VoxelsOnCartesianGrid<float> > contiguous_image_sptr;
+  std::vector<ProjMatrixElemsForOneBin> rows;
+  std::vector<ProjMatrixElemsForOneBinWithOffsets> rows_with_offsets;
+  //! total number of elements in all rows
+  std::size_t num_elements;
+
+  void run_tests_forward_projection();
+  void run_tests_back_projection();
+  void report_timings();
+};
+
+void
+ProjMatrixElemsForOneBinTests::run_tests_forward_projection()
+{
+  std::cerr << "\tTests on forward projection\n";
+  const float* data_ptr = contiguous_image_sptr->get_contiguous_data_ptr();
+  const BasicCoordinate<3,int> min_indices = contiguous_image_sptr->get_min_indices();
+  const BasicCoordinate<3,int> lengths = contiguous_image_sptr->get_lengths();
+  for (std::vector<ProjMatrixElemsForOneBin>::const_iterator row_iter = rows.begin();
+       row_iter != rows.end(); ++row_iter)
+    {
+      Bin bin = row_iter->get_bin();
+      bin.set_bin_value(0);
+      row_iter->forward_project(bin, *image_sptr);
+      Bin contiguous_bin = row_iter->get_bin();
+      contiguous_bin.set_bin_value(0);
+      row_iter->forward_project(contiguous_bin, data_ptr, min_indices, lengths);
+      if (!check_if_equal(bin.get_bin_value(), contiguous_bin.get_bin_value(),
+                          "forward projection with contiguous image"))
+        return;
+      Bin offsets_bin = row_iter->get_bin();
+      offsets_bin.set_bin_value(0);
+      rows_with_offsets[row_iter - rows.begin()].forward_project(offsets_bin, data_ptr);
+      if (!check_if_equal(bin.get_bin_value(), offsets_bin.get_bin_value(),
+                          "forward projection with offsets"))
+        return;
+    }
+}
+
+void
+ProjMatrixElemsForOneBinTests::run_tests_back_projection()
+{
+  std::cerr << "\tTests on back projection\n";
+  shared_ptr<VoxelsOnCartesianGrid<float> > back_projection_sptr(image_sptr->get_empty_copy());
+  shared_ptr<VoxelsOnCartesianGrid<float> > contiguous_back_projection_sptr(contiguous_image_sptr->get_empty_copy());
+  shared_ptr<VoxelsOnCartesianGrid<float> > offsets_back_projection_sptr(contiguous_image_sptr->get_empty_copy());
+  float* data_ptr = contiguous_back_projection_sptr->get_contiguous_data_ptr();
+  float* offsets_data_ptr = offsets_back_projection_sptr->get_contiguous_data_ptr();
+  check(data_ptr != 0 && offsets_data_ptr != 0, "get_empty_copy() of a contiguous image should be contiguous");
+  if (data_ptr == 0 || offsets_data_ptr == 0)
+    return;
+  const BasicCoordinate<3,int> min_indices = contiguous_back_projection_sptr->get_min_indices();
+  const BasicCoordinate<3,int> lengths = contiguous_back_projection_sptr->get_lengths();
+  for (std::vector<ProjMatrixElemsForOneBin>::const_iterator row_iter = rows.begin();
+       row_iter != rows.end(); ++row_iter)
+    {
+      Bin bin = row_iter->get_bin();
+      bin.set_bin_value(1.5F);
+      row_iter->back_project(*back_projection_sptr, bin);
+      row_iter->back_project(data_ptr, min_indices, lengths, bin);
+      rows_with_offsets[row_iter - rows.begin()].back_project(offsets_data_ptr, bin);
+    }
+  check(back_projection_sptr->find_max() > 0, "back projection should be non-zero");
+  check_if_equal(static_cast<const Array<3,float>&>(*back_projection_sptr),
+                 static_cast<const Array<3,float>&>(*contiguous_back_projection_sptr),
+                 "back projection with contiguous image");
+  check_if_equal(static_cast<const Array<3,float>&>(*back_projection_sptr),
+                 static_cast<const Array<3,float>&>(*offsets_back_projection_sptr),
+                 "back projection with offsets");
+}
+
+void
+ProjMatrixElemsForOneBinTests::report_timings()
+{
+  const int num_repetitions = 10;
+  const double num_voxel_updates = static_cast<double>(num_elements) * num_repetitions;
+  const float* data_ptr = contiguous_image_sptr->get_contiguous_data_ptr();
+  const BasicCoordinate<3,int> min_indices = contiguous_image_sptr->get_min_indices();
+  const BasicCoordinate<3,int> lengths = contiguous_image_sptr->get_lengths();
+
+  HighResWallClockTimer timer;
+  timer.reset(); timer.start();
+  for (int i = 0; i < num_repetitions; ++i)
+    for (std::vector<ProjMatrixElemsForOneBin>::const_iterator row_iter = rows.begin();
+         row_iter != rows.end(); ++row_iter)
+      {
+        Bin bin = row_iter->get_bin();
+        row_iter->forward_project(bin, *image_sptr);
+      }
+  timer.stop();
+  const double nested_time = timer.value();
+
+  timer.reset(); timer.start();
+  for (int i = 0; i < num_repetitions; ++i)
+    for (std::vector<ProjMatrixElemsForOneBin>::const_iterator row_iter = rows.begin();
+         row_iter != rows.end(); ++row_iter)
+      {
+        Bin bin = row_iter->get_bin();
+        row_iter->forward_project(bin, data_ptr, min_indices, lengths);
+      }
+  timer.stop();
+  const double contiguous_time = timer.value();
+
+  ProjMatrixElemsForOneBinWithOffsets row_with_offsets;
+  timer.reset(); timer.start();
+  for (int i = 0; i < num_repetitions; ++i)
+    for (std::vector<ProjMatrixElemsForOneBin>::const_iterator row_iter = rows.begin();
+         row_iter != rows.end(); ++row_iter)
+      {
+        Bin bin = row_iter->get_bin();
+        row_with_offsets.set(*row_iter, min_indices, lengths);
+        row_with_offsets.forward_project(bin, data_ptr);
+      }
+  timer.stop();
+  const double set_offsets_time = timer.value();
+
+  timer.reset(); timer.start();
+  for (int i = 0; i < num_repetitions; ++i)
+    for (std::vector<ProjMatrixElemsForOneBinWithOffsets>::const_iterator row_iter = rows_with_offsets.begin();
+         row_iter != rows_with_offsets.end(); ++row_iter)
+      {
+        Bin bin(0,0,0,0,0.F);
+        row_iter->forward_project(bin, data_ptr);
+      }
+  timer.stop();
+  const double offsets_time = timer.value();
+
+  std::cerr << "\tForward projection of " << num_voxel_updates << " voxel updates\n"
+            << "\t  nested image storage:                  "
+            << (nested_time > 0 ? num_voxel_updates/nested_time : 0.) << " voxel updates per second\n"
+            << "\t  contiguous image storage:              "
+            << (contiguous_time > 0 ? num_voxel_updates/contiguous_time : 0.) << " voxel updates per second\n"
+            << "\t  offsets (including computing offsets): "
+            << (set_offsets_time > 0 ? num_voxel_updates/set_offsets_time : 0.) << " voxel updates per second\n"
+            << "\t  precomputed offsets:                   "
+            << (offsets_time > 0 ? num_voxel_updates/offsets_time : 0.) << " voxel updates per second\n";
+}
+
+void
+ProjMatrixElemsForOneBinTests::run_tests()
+{
+  std::cerr << "Tests for ProjMatrixElemsForOneBin\n";
+
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E962));
+  shared_ptr<ProjDataInfo> proj_data_info_sptr(ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                                                             /*span=*/1,
+                                                                             /*max_delta=*/3,
+                                                                             /*num_views=*/48,
+                                                                             /*num_tang_poss=*/64));
+  shared_ptr<ExamInfo> exam_info_sptr(new ExamInfo(ImagingModality::PT));
+  image_sptr.reset(new VoxelsOnCartesianGrid<float>(exam_info_sptr, *proj_data_info_sptr));
+  {
+    int i = 0;
+    for (VoxelsOnCartesianGrid<float>::full_iterator iter = image_sptr->begin_all();
+         iter != image_sptr->end_all(); ++iter, ++i)
+      *iter = static_cast<float>(i % 17 + 1);
+  }
+  check(image_sptr->get_contiguous_data_ptr() == 0, "image should not be contiguous by default");
+  contiguous_image_sptr.reset(image_sptr->clone());
+  contiguous_image_sptr->make_contiguous();
+  check(contiguous_image_sptr->get_contiguous_data_ptr() != 0, "image should be contiguous after make_contiguous()");
+  if (contiguous_image_sptr->get_contiguous_data_ptr() == 0)
+    return;
+
+  ProjMatrixByBinUsingRayTracing proj_matrix;
+  proj_matrix.set_up(proj_data_info_sptr, image_sptr);
+  num_elements = 0;
+  for (int segment_num = proj_data_info_sptr->get_min_segment_num();
+       segment_num <= proj_data_info_sptr->get_max_segment_num(); ++segment_num)
+    for (int view_num = 0; view_num < proj_data_info_sptr->get_num_views(); view_num += 7)
+      for (int axial_pos_num = proj_data_info_sptr->get_min_axial_pos_num(segment_num);
+           axial_pos_num <= proj_data_info_sptr->get_max_axial_pos_num(segment_num); axial_pos_num += 3)
+        for (int tangential_pos_num = proj_data_info_sptr->get_min_tangential_pos_num();
+             tangential_pos_num <= proj_data_info_sptr->get_max_tangential_pos_num(); ++tangential_pos_num)
+          {
+            const Bin bin(segment_num, view_num, axial_pos_num, tangential_pos_num, 0.F);
+            ProjMatrixElemsForOneBin row;
+            proj_matrix.get_proj_matrix_elems_for_one_bin(row, bin);
+            num_elements += row.size();
+            rows.push_back(row);
+            rows_with_offsets.push_back(ProjMatrixElemsForOneBinWithOffsets());
+            rows_with_offsets.back().set(row, contiguous_image_sptr->get_min_indices(), contiguous_image_sptr->get_lengths());
+          }
+
+  run_tests_forward_projection();
+  run_tests_back_projection();
+  report_timings();
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int main()
+{
+  ProjMatrixElemsForOneBinTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -0,0 +1,308 @@
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recontest
+
+  \brief Test program for stir::ProjectorByBinPairUsingSPECTRotation
+
+  Tests that the back projector is the transpose of the forward projector, compares the
+  forward projection with stir::ProjMatrixByBinSPECTUB, checks the attenuation model
+  for a point source in a uniform cylinder and checks parsing.
+
+  \author agent
+*/
+
+#include "stir/recon_buildblock/ProjectorByBinPairUsingSPECTRotation.h"
+#include "stir/recon_buildblock/ForwardProjectorByBinSPECTRotation.h"
+#include "stir/recon_buildblock/BackProjectorByBinSPECTRotation.h"
+#include "stir/recon_buildblock/SPECTRotationModel.h"
+#include "stir/recon_buildblock/ProjMatrixByBinSPECTUB.h"
+#include "stir/recon_buildblock/ForwardProjectorByBinUsingProjMatrixByBin.h"
+#include "stir/ProjDataInfoCylindricalArcCorr.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/Viewgram.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/IndexRange3D.h"
+#include "stir/Shape/EllipsoidalCylinder.h"
+#include "stir/RunTests.h"
+#include "stir/Succeeded.h"
+#include "stir/is_null_ptr.h"
+#include <boost/format.hpp>
+#include <sstream>
+#include <cmath>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup recontest
+  \brief Test class for ProjectorByBinPairUsingSPECTRotation
+*/
+class SPECTRotationProjectorTests : public RunTests
+{
+public:
+  void run_tests();
+
+private:
+  shared_ptr<ProjDataInfo> proj_data_info_sptr;
+  shared_ptr<VoxelsOnCartesianGrid<float> > image_sptr;
+  shared_ptr<ExamInfo> exam_info_sptr;
+
+  void set_up_geometry();
+  void run_tests_adjoint(const shared_ptr<SPECTRotationModel>& model_sptr, const std::string& str);
+  void run_tests_compare_with_SPECTUB();
+  void run_tests_attenuation();
+  void run_tests_parsing();
+
+  static double inner_product(const ProjData& p1, const ProjData& p2);
+  static double inner_product(const DiscretisedDensity<3,float>& i1, const DiscretisedDensity<3,float>& i2);
+};
+
+void
+SPECTRotationProjectorTests::set_up_geometry()
+{
+  const int num_views = 60;
+  const int num_axial_poss = 9;
+  const int num_bins = 65;
+  const float bin_size = 4.42F;
+  const float radius = 250.F;
+
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::User_defined_scanner, "SPECT test",
+                                               -1, num_axial_poss, num_bins, num_bins,
+                                               radius, 0.F, bin_size, bin_size, 0.F,
+                                               -1, -1, -1, -1, -1, -1, 1));
+  VectorWithOffset<int> num_axial_poss_per_segment(0,0);
+  num_axial_poss_per_segment[0] = num_axial_poss;
+  VectorWithOffset<int> min_ring_diff(0,0), max_ring_diff(0,0);
+  min_ring_diff[0] = 0;
+  max_ring_diff[0] = 0;
+  ProjDataInfoCylindricalArcCorr* proj_data_info_ptr =
+    new ProjDataInfoCylindricalArcCorr(scanner_sptr, bin_size,
+                                       num_axial_poss_per_segment, min_ring_diff, max_ring_diff,
+                                       num_views, num_bins);
+  // non-circular orbit
+  VectorWithOffset<float> radii(0, num_views-1);
+  for (int view_num=0; view_num<num_views; ++view_num)
+    radii[view_num] = radius + 30.F*static_cast<float>(std::cos(2*_PI*view_num/num_views));
+  proj_data_info_ptr->set_ring_radii_for_all_views(radii);
+  proj_data_info_ptr->set_azimuthal_angle_sampling(static_cast<float>(2*_PI/num_views));
+  proj_data_info_sptr.reset(proj_data_info_ptr);
+
+  image_sptr.reset(new VoxelsOnCartesianGrid<float>(IndexRange3D(0, num_axial_poss-1, -32, 32, -32, 32),
+                                                    CartesianCoordinate3D<float>(0.F,0.F,0.F),
+                                                    CartesianCoordinate3D<float>(bin_size, bin_size, bin_size)));
+  exam_info_sptr.reset(new ExamInfo);
+}
+
+double
+SPECTRotationProjectorTests::inner_product(const ProjData& p1, const ProjData& p2)
+{
+  double sum = 0;
+  for (int view_num=p1.get_min_view_num(); view_num<=p1.get_max_view_num(); ++view_num)
+    {
+      const Viewgram<float> v1 = p1.get_viewgram(view_num, 0);
+      const Viewgram<float> v2 = p2.get_viewgram(view_num, 0);
+      Viewgram<float>::const_full_iterator iter2 = v2.begin_all();
+      for (Viewgram<float>::const_full_iterator iter1 = v1.begin_all(); iter1 != v1.end_all(); ++iter1, ++iter2)
+        sum += static_cast<double>(*iter1) * (*iter2);
+    }
+  return sum;
+}
+
+double
+SPECTRotationProjectorTests::inner_product(const DiscretisedDensity<3,float>& i1, const DiscretisedDensity<3,float>& i2)
+{
+  double sum = 0;
+  DiscretisedDensity<3,float>::const_full_iterator iter2 = i2.begin_all();
+  for (DiscretisedDensity<3,float>::const_full_iterator iter1 = i1.begin_all(); iter1 != i1.end_all(); ++iter1, ++iter2)
+    sum += static_cast<double>(*iter1) * (*iter2);
+  return sum;
+}
+
+void
+SPECTRotationProjectorTests::run_tests_adjoint(const shared_ptr<SPECTRotationModel>& model_sptr, const std::string& str)
+{
+  std::cerr << "Testing adjointness " << str << "\n";
+  ForwardProjectorByBinSPECTRotation forward_projector(model_sptr);
+  BackProjectorByBinSPECTRotation back_projector(model_sptr);
+  forward_projector.set_up(proj_data_info_sptr, image_sptr);
+  back_projector.set_up(proj_data_info_sptr, image_sptr);
+
+  // pseudo-random image and projection data
+  shared_ptr<DiscretisedDensity<3,float> > x_sptr(image_sptr->get_empty_copy());
+  {
+    int i = 0;
+    for (DiscretisedDensity<3,float>::full_iterator iter = x_sptr->begin_all(); iter != x_sptr->end_all(); ++iter, ++i)
+      *iter = static_cast<float>((i*7919) % 101)/100.F;
+  }
+  ProjDataInMemory y(exam_info_sptr, proj_data_info_sptr);
+  for (int view_num=y.get_min_view_num(); view_num<=y.get_max_view_num(); ++view_num)
+    {
+      Viewgram<float> viewgram = y.get_empty_viewgram(view_num, 0);
+      int i = view_num;
+      for (Viewgram<float>::full_iterator iter = viewgram.begin_all(); iter != viewgram.end_all(); ++iter, ++i)
+        *iter = static_cast<float>((i*104729) % 97)/97.F;
+      y.set_viewgram(viewgram);
+    }
+
+  ProjDataInMemory Ax(exam_info_sptr, proj_data_info_sptr);
+  forward_projector.forward_project(Ax, *x_sptr);
+  shared_ptr<DiscretisedDensity<3,float> > ATy_sptr(image_sptr->get_empty_copy());
+  back_projector.back_project(*ATy_sptr, y);
+
+  const double Ax_y = inner_product(Ax, y);
+  const double x_ATy = inner_product(*x_sptr, *ATy_sptr);
+  check(Ax_y > 0, "forward projection should be positive " + str);
+  check_if_equal(Ax_y/x_ATy, 1., "adjointness " + str);
+}
+
+void
+SPECTRotationProjectorTests::run_tests_compare_with_SPECTUB()
+{
+  // centred uniform cylinder
+  VoxelsOnCartesianGrid<float> image(*image_sptr);
+  image.fill(0.F);
+  EllipsoidalCylinder cylinder(1000.F, 80.F, 80.F, CartesianCoordinate3D<float>(0.F,0.F,0.F));
+  cylinder.construct_volume(image, CartesianCoordinate3D<int>(1,3,3));
+
+  const float sigma_0_in_mm = 1.5F;
+  const float slope = 0.02F;
+  for (int psf_type=0; psf_type<3; ++psf_type)
+    {
+      const std::string str = psf_type==0 ? "geometrical" : psf_type==1 ? "2D" : "3D";
+      std::cerr << "Comparing with SPECTUB (" << str << ")\n";
+      shared_ptr<ProjMatrixByBinSPECTUB> matrix_sptr(new ProjMatrixByBinSPECTUB);
+      shared_ptr<SPECTRotationModel> model_sptr(new SPECTRotationModel);
+      if (psf_type>0)
+        {
+          matrix_sptr->set_resolution_model(sigma_0_in_mm, slope*10, psf_type==2);
+          model_sptr->set_resolution_model(sigma_0_in_mm, slope, psf_type==2);
+        }
+      ForwardProjectorByBinUsingProjMatrixByBin SPECTUB_projector(matrix_sptr);
+      ForwardProjectorByBinSPECTRotation rotation_projector(model_sptr);
+      SPECTUB_projector.set_up(proj_data_info_sptr, image_sptr);
+      rotation_projector.set_up(proj_data_info_sptr, image_sptr);
+
+      ProjDataInMemory SPECTUB_proj_data(exam_info_sptr, proj_data_info_sptr);
+      ProjDataInMemory rotation_proj_data(exam_info_sptr, proj_data_info_sptr);
+      SPECTUB_projector.forward_project(SPECTUB_proj_data, image);
+      rotation_projector.forward_project(rotation_proj_data, image);
+
+      const double norm2_SPECTUB = inner_product(SPECTUB_proj_data, SPECTUB_proj_data);
+      const double norm2_rotation = inner_product(rotation_proj_data, rotation_proj_data);
+      const double cross = inner_product(SPECTUB_proj_data, rotation_proj_data);
+      // relative L2 distance
+      const double rel_distance = std::sqrt((norm2_SPECTUB + norm2_rotation - 2*cross)/norm2_SPECTUB);
+      check(rel_distance < .03, boost::str(boost::format("relative distance with SPECTUB (%1%): %2%") % str % rel_distance));
+    }
+}
+
+void
+SPECTRotationProjectorTests::run_tests_attenuation()
+{
+  std::cerr << "Testing attenuation for a point source in a uniform cylinder\n";
+  const float mu = .15F; // cm^-1
+  const float radius = 25*image_sptr->get_voxel_size().x(); // in mm
+  shared_ptr<VoxelsOnCartesianGrid<float> > attenuation_sptr(image_sptr->get_empty_voxels_on_cartesian_grid());
+  EllipsoidalCylinder cylinder(1000.F, radius, radius, CartesianCoordinate3D<float>(0.F,0.F,0.F));
+  cylinder.construct_volume(*attenuation_sptr, CartesianCoordinate3D<int>(1,5,5));
+  *attenuation_sptr *= mu;
+
+  VoxelsOnCartesianGrid<float> image(*image_sptr);
+  image.fill(0.F);
+  image[4][0][0] = 1.F;
+
+  shared_ptr<SPECTRotationModel> model_sptr(new SPECTRotationModel);
+  ForwardProjectorByBinSPECTRotation forward_projector(model_sptr);
+  forward_projector.set_up(proj_data_info_sptr, image_sptr);
+  ProjDataInMemory proj_data_no_attenuation(exam_info_sptr, proj_data_info_sptr);
+  forward_projector.forward_project(proj_data_no_attenuation, image);
+  check_if_equal(static_cast<double>(proj_data_no_attenuation.get_viewgram(0,0).sum()), 1.,
+                 "sum of forward projection of a point source (single view)");
+
+  model_sptr->set_attenuation_image_sptr(attenuation_sptr);
+  forward_projector.set_up(proj_data_info_sptr, image_sptr);
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+  forward_projector.forward_project(proj_data, image);
+  const double expected = std::exp(-mu*radius/10);
+  for (int view_num=proj_data.get_min_view_num(); view_num<=proj_data.get_max_view_num(); view_num+=7)
+    {
+      const double ratio =
+        proj_data.get_viewgram(view_num,0).sum() / proj_data_no_attenuation.get_viewgram(view_num,0).sum();
+      check(std::abs(ratio/expected - 1) < .03,
+            boost::str(boost::format("attenuation for view %1%: %2% vs expected %3%") % view_num % ratio % expected));
+    }
+}
+
+void
+SPECTRotationProjectorTests::run_tests_parsing()
+{
+  std::cerr << "Testing parsing\n";
+  ProjectorByBinPairUsingSPECTRotation parsed_pair;
+  std::istringstream parameters("Projector Pair Using SPECT Rotation Parameters:=\n"
+                                "psf type:=2D\n"
+                                "collimator sigma 0(cm):=0.15\n"
+                                "collimator slope:=0.02\n"
+                                "End Projector Pair Using SPECT Rotation Parameters:=\n");
+  check(parsed_pair.parse(parameters), "parsing");
+  check(parsed_pair.set_up(proj_data_info_sptr, image_sptr) == Succeeded::yes, "set_up of parsed pair");
+
+  shared_ptr<SPECTRotationModel> model_sptr(new SPECTRotationModel);
+  model_sptr->set_resolution_model(1.5F, .02F, false);
+  ProjectorByBinPairUsingSPECTRotation pair(model_sptr);
+  check(pair.set_up(proj_data_info_sptr, image_sptr) == Succeeded::yes, "set_up of pair");
+
+  VoxelsOnCartesianGrid<float> image(*image_sptr);
+  image.fill(0.F);
+  image[2][10][-5] = 1.F;
+  image[6][-3][12] = 2.F;
+  ProjDataInMemory proj_data1(exam_info_sptr, proj_data_info_sptr);
+  ProjDataInMemory proj_data2(exam_info_sptr, proj_data_info_sptr);
+  parsed_pair.get_forward_projector_sptr()->forward_project(proj_data1, image);
+  pair.get_forward_projector_sptr()->forward_project(proj_data2, image);
+  check_if_equal(inner_product(proj_data1, proj_data2)/inner_product(proj_data2, proj_data2), 1.,
+                 "parsed pair should be identical to constructed pair");
+}
+
+void
+SPECTRotationProjectorTests::run_tests()
+{
+  set_up_geometry();
+
+  {
+    shared_ptr<SPECTRotationModel> model_sptr(new SPECTRotationModel);
+    run_tests_adjoint(model_sptr, "(geometrical)");
+    model_sptr->set_resolution_model(1.5F, .02F, false);
+    run_tests_adjoint(model_sptr, "(2D PSF)");
+    model_sptr->set_resolution_model(1.5F, .02F, true);
+    run_tests_adjoint(model_sptr, "(3D PSF)");
+    shared_ptr<VoxelsOnCartesianGrid<float> > attenuation_sptr(image_sptr->get_empty_voxels_on_cartesian_grid());
+    EllipsoidalCylinder cylinder(1000.F, 100.F, 70.F, CartesianCoordinate3D<float>(0.F,10.F,0.F));
+    cylinder.construct_volume(*attenuation_sptr, CartesianCoordinate3D<int>(1,1,1));
+    *attenuation_sptr *= .15F;
+    model_sptr->set_attenuation_image_sptr(attenuation_sptr);
+    run_tests_adjoint(model_sptr, "(3D PSF and attenuation)");
+  }
+  run_tests_compare_with_SPECTUB();
+  run_tests_attenuation();
+  run_tests_parsing();
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int main()
+{
+  SPECTRotationProjectorTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -19,6 +19,8 @@
 #include "stir/spatial_transformation/GatedSpatialTransformation.h"
 #include "stir/spatial_transformation/warp_image.h"
 #include "stir/info.h"
+#include "stir/error.h"
+#include "stir/is_null_ptr.h"
 #include <boost/format.hpp>
 
 START_NAMESPACE_STIR
@@ -30,6 +32,7 @@ set_defaults()
   base_type::set_defaults();
   this->_transformation_filename_prefix="";
   this->_spline_type=static_cast<BSpline::BSplineType> (1);;
+  this->_precompute_warping_weights=false;
 }
 
 const char * const 
@@ -66,6 +69,7 @@ initialise_keymap()
   base_type::initialise_keymap();
   this->parser.add_start_key("Gated Spatial Transformation Parameters");
   this->parser.add_key("Gated Spatial Transformation Filenames Prefix", &this->_transformation_filename_prefix);
+  this->parser.add_key("precompute warping weights", &this->_precompute_warping_weights);
   this->parser.add_stop_key("end Gated Spatial Transformation Parameters");
 }
 
@@ -115,6 +119,7 @@ GatedSpatialTransformation::read_from_files(const std::string input_string)
 	
   this->_spatial_transformation_z= spatial_transformation_z; this->_spatial_transformation_y= spatial_transformation_y; this->_spatial_transformation_x= spatial_transformation_x; 
   this->_spatial_transformations_are_stored=true;
+  this->_warping_weights.clear();
 }     
 
 //! Implementation to write the transformation vectors
@@ -127,6 +132,46 @@ GatedSpatialTransformation::write_to_files(const std::string output_string)
   //	return Succeeded::yes; // add a no case if you cannot write
 }  
 
+// construct an image with the same characteristics as \a density (but filled with 0)
+static VoxelsOnCartesianGrid<float>
+construct_warped_image(const DiscretisedDensity<3,float>& density)
+{
+  const DiscretisedDensityOnCartesianGrid<3,float>* density_cartesian_ptr =
+    dynamic_cast<const DiscretisedDensityOnCartesianGrid<3,float>*>(&density);
+  if (density_cartesian_ptr == 0)
+    error("GatedSpatialTransformation: images need to be on a Cartesian grid");
+  return VoxelsOnCartesianGrid<float>(density.get_index_range(),
+                                      density_cartesian_ptr->get_origin(),
+                                      density_cartesian_ptr->get_grid_spacing());
+}
+
+void
+GatedSpatialTransformation::warp_gate(VoxelsOnCartesianGrid<float>& out_density,
+                                      const BSpline::BSplinesRegularGrid<3,float>& density_interpolation,
+                                      const unsigned int gate_num) const
+{
+  const DiscretisedDensity<3,float>& motion_x = *(this->_spatial_transformation_x.get_densities())[gate_num-1];
+  const DiscretisedDensity<3,float>& motion_y = *(this->_spatial_transformation_y.get_densities())[gate_num-1];
+  const DiscretisedDensity<3,float>& motion_z = *(this->_spatial_transformation_z.get_densities())[gate_num-1];
+  if (!this->_precompute_warping_weights)
+    {
+      stir::warp_image(out_density, density_interpolation, motion_x, motion_y, motion_z);
+      return;
+    }
+  shared_ptr<ImageWarpingWeights> weights_sptr;
+#ifdef STIR_OPENMP
+#pragma omp critical(GATEDSPATIALTRANSFORMATION_WEIGHTS)
+#endif
+  {
+    if (this->_warping_weights.size() < gate_num)
+      this->_warping_weights.resize(this->_spatial_transformation_x.get_densities().size());
+    if (is_null_ptr(this->_warping_weights[gate_num-1]))
+      this->_warping_weights[gate_num-1].reset(new ImageWarpingWeights(motion_x, motion_y, motion_z, BSpline::linear));
+    weights_sptr = this->_warping_weights[gate_num-1];
+  }
+  weights_sptr->warp(out_density, density_interpolation);
+}
+
 void 
 GatedSpatialTransformation::warp_image(GatedDiscretisedDensity & new_gated_image,
                           const GatedDiscretisedDensity & gated_image) const 
@@ -140,11 +185,13 @@ GatedSpatialTransformation::warp_image(GatedDiscretisedDensity & new_gated_image
   new_gated_image.fill_with_zero();
   if (this->_spatial_transformations_are_stored)
     for(unsigned int gate_num=1 ; gate_num<=gated_image.get_time_gate_definitions().get_num_gates() ; ++gate_num)
-      new_gated_image[gate_num]=stir::warp_image((gated_image.get_densities())[gate_num-1],
-                                                 (this->_spatial_transformation_x.get_densities())[gate_num-1],
-                                                 (this->_spatial_transformation_y.get_densities())[gate_num-1],
-                                                 (this->_spatial_transformation_z.get_densities())[gate_num-1], 
-                                                 BSpline::linear, false);
+      {
+        const DiscretisedDensity<3,float>& density = *(gated_image.get_densities())[gate_num-1];
+        const BSpline::BSplinesRegularGrid<3, float> density_interpolation(density, BSpline::linear);
+        VoxelsOnCartesianGrid<float> out_density = construct_warped_image(density);
+        this->warp_gate(out_density, density_interpolation, gate_num);
+        new_gated_image[gate_num]=out_density;
+      }
   else
     error("The transformation fields haven't been set properly yet.\n");
 }
@@ -161,12 +208,18 @@ void
 GatedSpatialTransformation::accumulate_warp_image(DiscretisedDensity<3, float> & new_reference_image,
                                      const GatedDiscretisedDensity & gated_image) const 
 {
-  GatedDiscretisedDensity new_gated_image(gated_image);
-  new_gated_image.fill_with_zero();
-  this->warp_image(new_gated_image,gated_image);
+  if (!this->_spatial_transformations_are_stored)
+    error("The transformation fields haven't been set properly yet.\n");
   //!todo This is not implemented as sum (or should it be the average?)
+  // warp every gate and add it to the output, without storing all warped gates
   for(unsigned int gate_num = 1;gate_num<=gated_image.get_time_gate_definitions().get_num_gates() ; ++gate_num)
-    new_reference_image += new_gated_image[gate_num];
+    {
+      const DiscretisedDensity<3,float>& density = *(gated_image.get_densities())[gate_num-1];
+      const BSpline::BSplinesRegularGrid<3, float> density_interpolation(density, BSpline::linear);
+      VoxelsOnCartesianGrid<float> out_density = construct_warped_image(density);
+      this->warp_gate(out_density, density_interpolation, gate_num);
+      new_reference_image += out_density;
+    }
   //	new_reference_image /= gated_image.get_time_gate_definitions().get_num_gates();
 }
 
@@ -182,20 +235,32 @@ GatedSpatialTransformation::warp_image(GatedDiscretisedDensity & gated_image,
     info(boost::format("Number of voxels in one motion vector gated image: %1%") % (this->_spatial_transformation_y.get_densities())[0]->size_all());
     error("GatedSpatialTransformation::warp_image needs the same sizes for motion vectors and input/output images.\n");
   }
-  const shared_ptr<DiscretisedDensity<3,float> > reference_image_sptr( reference_image.clone());
   gated_image.resize_densities(this->_gate_defs);
 	
   if (this->_spatial_transformations_are_stored)
-    for(unsigned int gate_num = 1 ; gate_num<=gated_image.get_time_gate_definitions().get_num_gates() ; ++gate_num)
-      {
-        const VoxelsOnCartesianGrid<float> density = stir::warp_image(reference_image_sptr,
-                                                                      (this->_spatial_transformation_x.get_densities())[gate_num-1],
-                                                                      (this->_spatial_transformation_y.get_densities())[gate_num-1],
-                                                                      (this->_spatial_transformation_z.get_densities())[gate_num-1], 
-                                                                      BSpline::linear, false);
-        const shared_ptr<DiscretisedDensity<3,float> >  density_sptr(density.clone());
-        gated_image.set_density_sptr(density_sptr,gate_num);
-      }
+    {
+      // compute the B-spline coefficients only once for all gates
+      const BSpline::BSplinesRegularGrid<3, float> density_interpolation(reference_image, BSpline::linear);
+      for(unsigned int gate_num = 1 ; gate_num<=gated_image.get_time_gate_definitions().get_num_gates() ; ++gate_num)
+        {
+          // re-use the current image of the gate if it is not shared with anything else
+          const shared_ptr<DiscretisedDensity<3,float> >& current_density_sptr = (gated_image.get_densities())[gate_num-1];
+          VoxelsOnCartesianGrid<float>* current_density_ptr =
+            dynamic_cast<VoxelsOnCartesianGrid<float>*>(current_density_sptr.get());
+          if (current_density_ptr != 0 && current_density_sptr.use_count() == 1 &&
+              current_density_ptr->has_same_characteristics(reference_image))
+            {
+              this->warp_gate(*current_density_ptr, density_interpolation, gate_num);
+            }
+          else
+            {
+              const shared_ptr<VoxelsOnCartesianGrid<float> >
+                density_sptr(new VoxelsOnCartesianGrid<float>(construct_warped_image(reference_image)));
+              this->warp_gate(*density_sptr, density_interpolation, gate_num);
+              gated_image.set_density_sptr(density_sptr,gate_num);
+            }
+        }
+    }
   else
     error("The transformation fields haven't been set properly yet.");	
 }
@@ -210,11 +275,20 @@ set_spatial_transformations(const GatedDiscretisedDensity & transformation_z,
   this->_spatial_transformation_y=transformation_y;
   this->_spatial_transformation_x=transformation_x;
   this->_spatial_transformations_are_stored=true;
+  this->_warping_weights.clear();
 }
 
 void 
 GatedSpatialTransformation::set_gate_defs(const TimeGateDefinitions & gate_defs)
 { this->_gate_defs=gate_defs; }
+
+void
+GatedSpatialTransformation::set_precompute_warping_weights(const bool precompute)
+{
+  this->_precompute_warping_weights=precompute;
+  if (!precompute)
+    this->_warping_weights.clear();
+}
  
 GatedDiscretisedDensity GatedSpatialTransformation::get_spatial_transformation_z() const
 { return this->_spatial_transformation_z; }
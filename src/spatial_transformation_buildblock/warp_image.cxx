@@ -10,15 +10,58 @@
 /*!
  \file
  \ingroup buildblock
- \brief Implementation of function stir::warp_image 
+ \brief Implementation of function stir::warp_image and class stir::ImageWarpingWeights
  \author Charalampos Tsoumpas
 */
 
 #include "stir/spatial_transformation/warp_image.h"
+#include "stir/error.h"
+#include <boost/format.hpp>
+#include <cmath>
 
 START_NAMESPACE_STIR
 //using namespace BSpline;
 
+// Temporary fix such that when radioactivity comes from outside is set to 0. 
+// To fix this properly we need to modify the B-Splines interpolation method by changing the periodicity extrapolation. 
+// I'm not considering the last plane if linear because it's going to use extrapolated data.
+// I haven't implemented anything for higher order
+static inline bool
+is_inside(const BasicCoordinate<3,double>& d,
+          const BasicCoordinate<3,int>& min, const BasicCoordinate<3,int>& max)
+{
+  return
+    (d[1]>static_cast<double>(min[1])) && (d[1]<static_cast<double>(max[1])) &&
+    (d[2]>static_cast<double>(min[2])) && (d[2]<static_cast<double>(max[2])) &&
+    (d[3]>static_cast<double>(min[3])) && (d[3]<static_cast<double>(max[3]));
+}
+
+// find the position (in voxel units) in the input image for voxel c
+static inline BasicCoordinate<3,double>
+warped_position(const BasicCoordinate<3,int>& c,
+                const DiscretisedDensity<3,float>& motion_x,
+                const DiscretisedDensity<3,float>& motion_y,
+                const DiscretisedDensity<3,float>& motion_z,
+                const BasicCoordinate<3,float>& grid_spacing)
+{
+  BasicCoordinate<3,double> d;
+  // for the IRTK version I had c-l, but for Christian's it seems to work as c+l
+  d[1] = static_cast<double>(c[1]) + static_cast<double>(motion_z[c]/grid_spacing[1]);
+  d[2] = static_cast<double>(c[2]) + static_cast<double>(motion_y[c]/grid_spacing[2]);
+  d[3] = static_cast<double>(c[3]) + static_cast<double>(motion_x[c]/grid_spacing[3]);
+  return d;
+}
+
+static void
+check_range(const DiscretisedDensity<3,float>& density,
+            const BasicCoordinate<3,int>& min, const BasicCoordinate<3,int>& max,
+            const char * const name)
+{
+  BasicCoordinate<3,int> current_min, current_max;
+  if (!density.get_regular_range(current_min, current_max) ||
+      current_min != min || current_max != max)
+    error(boost::format("warp_image: %1% has a different index range than the motion field") % name);
+}
 
 VoxelsOnCartesianGrid<float> 
 warp_image(const shared_ptr<DiscretisedDensity<3,float> > & density_sptr, 
@@ -50,29 +93,167 @@ warp_image(const shared_ptr<DiscretisedDensity<3,float> > & density_sptr,
 #endif
   const IndexRange<3> out_range(out_min,out_max);
   VoxelsOnCartesianGrid<float> out_density(out_range,origin,grid_spacing);
-
-  BasicCoordinate<3,int> c;
-  BasicCoordinate<3,double> d, l;
-  for (c[1]=min[1]; c[1]<=max[1]; ++c[1])
-    for (c[2]=min[2]; c[2]<=max[2]; ++c[2])
-      for (c[3]=min[3]; c[3]<=max[3]; ++c[3])
-	{
-          l[1] = static_cast<double> ((*motion_z_sptr)[c]/grid_spacing[1]); 
-          l[2] = static_cast<double> ((*motion_y_sptr)[c]/grid_spacing[2]); 
-          l[3] = static_cast<double> ((*motion_x_sptr)[c]/grid_spacing[3]);
-          d[1] = static_cast<double> (c[1]) + l[1]; // for the IRTK version I had c-l, but for Christian's it seems to work as c+l
-          d[2] = static_cast<double> (c[2]) + l[2]; 
-          d[3] = static_cast<double> (c[3]) + l[3];
-          // Temporary fix such that when radioactivity comes from outside is set to 0. 
-          // To fix this properly we need to modify the B-Splines interpolation method by changing the periodicity extrapolation. 
-          if ( (d[1]<=static_cast<double>(min[1])) || (d[1]>=static_cast<double>(max[1])) || // I'm not considering the last plane if linear
-               (d[2]<=static_cast<double>(min[2])) || (d[2]>=static_cast<double>(max[2])) || // because it's going to use extrapolated data
-               (d[3]<=static_cast<double>(min[3])) || (d[3]>=static_cast<double>(max[3])) )	 // I haven't implemented anything for higher order
-            out_density[c] = 0.F;
-          else
-            out_density[c] = density_interpolation(d);
-	}
+  warp_image(out_density, density_interpolation, *motion_x_sptr, *motion_y_sptr, *motion_z_sptr);
   return out_density;
 }
 
+void
+warp_image(VoxelsOnCartesianGrid<float>& out_density,
+           const BSpline::BSplinesRegularGrid<3,float>& density_interpolation,
+           const DiscretisedDensity<3,float>& motion_x,
+           const DiscretisedDensity<3,float>& motion_y,
+           const DiscretisedDensity<3,float>& motion_z)
+{
+  const BasicCoordinate<3,float> grid_spacing=out_density.get_grid_spacing();
+  BasicCoordinate<3,int> min;	BasicCoordinate<3,int> max;
+  if (!out_density.get_regular_range(min,max))
+    error("image is not in regular grid.\n");
+  check_range(motion_x, min, max, "motion field x");
+  check_range(motion_y, min, max, "motion field y");
+  check_range(motion_z, min, max, "motion field z");
+  if (density_interpolation.get_coefficients().get_index_range() != out_density.get_index_range())
+    error("warp_image: input and output image need to have the same index range");
+
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z=min[1]; z<=max[1]; ++z)
+    {
+      BasicCoordinate<3,int> c;
+      c[1] = z;
+      for (c[2]=min[2]; c[2]<=max[2]; ++c[2])
+        for (c[3]=min[3]; c[3]<=max[3]; ++c[3])
+          {
+            const BasicCoordinate<3,double> d =
+              warped_position(c, motion_x, motion_y, motion_z, grid_spacing);
+            if (is_inside(d, min, max))
+              out_density[c] = density_interpolation(d);
+            else
+              out_density[c] = 0.F;
+          }
+    }
+}
+
+ImageWarpingWeights::
+ImageWarpingWeights(const DiscretisedDensity<3,float>& motion_x,
+                    const DiscretisedDensity<3,float>& motion_y,
+                    const DiscretisedDensity<3,float>& motion_z,
+                    const BSpline::BSplineType spline_type)
+{
+  const DiscretisedDensityOnCartesianGrid<3,float>* motion_x_cartesian_ptr =
+    dynamic_cast<const DiscretisedDensityOnCartesianGrid<3,float>*>(&motion_x);
+  if (motion_x_cartesian_ptr == 0)
+    error("ImageWarpingWeights: motion fields need to be on a Cartesian grid");
+  const BasicCoordinate<3,float> grid_spacing = motion_x_cartesian_ptr->get_grid_spacing();
+  if (!motion_x.get_regular_range(this->min_indices, this->max_indices))
+    error("ImageWarpingWeights: motion field x is not in regular grid.");
+  check_range(motion_y, this->min_indices, this->max_indices, "motion field y");
+  check_range(motion_z, this->min_indices, this->max_indices, "motion field z");
+
+  const BSpline::PieceWiseFunction<BSpline::pos_type>& bspline = BSpline::bspline_function(spline_type);
+  this->kernel_length = bspline.kernel_total_length();
+  const BasicCoordinate<3,int> lengths = this->max_indices - this->min_indices + 1;
+  const std::size_t num_voxels =
+    static_cast<std::size_t>(lengths[1]) * lengths[2] * lengths[3];
+  const std::size_t num_elems_per_voxel = static_cast<std::size_t>(3 * this->kernel_length);
+  this->inside.resize(num_voxels);
+  this->indices.resize(num_voxels * num_elems_per_voxel);
+  this->weights.resize(num_voxels * num_elems_per_voxel);
+
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z=this->min_indices[1]; z<=this->max_indices[1]; ++z)
+    {
+      BasicCoordinate<3,int> c;
+      c[1] = z;
+      std::size_t voxel_num =
+        static_cast<std::size_t>(z - this->min_indices[1]) * lengths[2] * lengths[3];
+      for (c[2]=this->min_indices[2]; c[2]<=this->max_indices[2]; ++c[2])
+        for (c[3]=this->min_indices[3]; c[3]<=this->max_indices[3]; ++c[3], ++voxel_num)
+          {
+            const BasicCoordinate<3,double> d =
+              warped_position(c, motion_x, motion_y, motion_z, grid_spacing);
+            this->inside[voxel_num] = is_inside(d, this->min_indices, this->max_indices) ? 1 : 0;
+            if (!this->inside[voxel_num])
+              continue;
+            int * current_indices = &this->indices[voxel_num * num_elems_per_voxel];
+            float * current_weights = &this->weights[voxel_num * num_elems_per_voxel];
+            // find indices and weights in the same way as BSpline::detail::spline_convolution
+            for (int dim=1; dim<=3; ++dim)
+              {
+                const int kmin = static_cast<int>(std::ceil(d[dim] - bspline.kernel_length_right()));
+                BSpline::pos_type current_pos = d[dim] - kmin;
+                int p = bspline.find_piece(current_pos);
+                for (int k=kmin; k<kmin+this->kernel_length; ++k, --current_pos, --p)
+                  {
+                    // mirror boundary conditions
+                    int index;
+                    if (k<this->min_indices[dim]) index=2*this->min_indices[dim]-k;
+                    else if (k>this->max_indices[dim]) index=2*this->max_indices[dim]-k;
+                    else index = k;
+                    *current_indices++ = index;
+                    *current_weights++ = static_cast<float>(bspline.function_piece(current_pos, p));
+                  }
+              }
+          }
+    }
+}
+
+void
+ImageWarpingWeights::
+warp(VoxelsOnCartesianGrid<float>& out_density,
+     const BSpline::BSplinesRegularGrid<3,float>& density_interpolation) const
+{
+  BasicCoordinate<3,int> min;	BasicCoordinate<3,int> max;
+  if (!out_density.get_regular_range(min,max) ||
+      min != this->min_indices || max != this->max_indices)
+    error("ImageWarpingWeights::warp: output image has a different index range than the motion field");
+  const Array<3,float>& coeffs = density_interpolation.get_coefficients();
+  if (coeffs.get_index_range() != out_density.get_index_range())
+    error("ImageWarpingWeights::warp: input and output image need to have the same index range");
+
+  const BasicCoordinate<3,int> lengths = this->max_indices - this->min_indices + 1;
+  const int n = this->kernel_length;
+  const std::size_t num_elems_per_voxel = static_cast<std::size_t>(3 * n);
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z=min[1]; z<=max[1]; ++z)
+    {
+      std::size_t voxel_num =
+        static_cast<std::size_t>(z - min[1]) * lengths[2] * lengths[3];
+      for (int y=min[2]; y<=max[2]; ++y)
+        {
+          Array<1,float>& out_row = out_density[z][y];
+          for (int x=min[3]; x<=max[3]; ++x, ++voxel_num)
+            {
+              if (!this->inside[voxel_num])
+                {
+                  out_row[x] = 0.F;
+                  continue;
+                }
+              const int * const current_indices = &this->indices[voxel_num * num_elems_per_voxel];
+              const float * const current_weights = &this->weights[voxel_num * num_elems_per_voxel];
+              float value = 0.F;
+              for (int i=0; i<n; ++i)
+                {
+                  const Array<2,float>& plane = coeffs[current_indices[i]];
+                  float plane_value = 0.F;
+                  for (int j=0; j<n; ++j)
+                    {
+                      const Array<1,float>& row = plane[current_indices[n+j]];
+                      float row_value = 0.F;
+                      for (int k=0; k<n; ++k)
+                        row_value += row[current_indices[2*n+k]] * current_weights[2*n+k];
+                      plane_value += row_value * current_weights[n+j];
+                    }
+                  value += plane_value * current_weights[i];
+                }
+              out_row[x] = value;
+            }
+        }
+    }
+}
+
 END_NAMESPACE_STIR
@@ -549,6 +549,26 @@
   }
 } 
 
+#if defined(SWIGPYTHON)
+// functions that take a numpy array raise a TypeError for arrays of the wrong type or layout,
+// and a ValueError for arrays with the wrong number of elements
+%define %numpy_exception(METHOD)
+%exception METHOD {
+  try {
+    $action
+  } catch (const std::invalid_argument& e) {
+    SWIG_exception(SWIG_TypeError, e.what());
+  } catch (const std::length_error& e) {
+    SWIG_exception(SWIG_ValueError, e.what());
+  } catch (const std::exception& e) {
+    SWIG_exception(SWIG_RuntimeError, e.what());
+  }
+}
+%enddef
+%numpy_exception(from_numpy);
+%numpy_exception(fill);
+#endif
+
 // declare some functions that return a new pointer such that SWIG can release memory properly
 %newobject *::clone;
 %newobject *::get_empty_copy;
@@ -699,7 +719,127 @@ namespace std {
       copy_to(proj_data, array_iter);
       return array;
   }
-  
+
+#ifdef SWIGPYTHON
+  // functions and classes for sharing memory with numpy arrays
+
+  // create a numpy array that uses the memory at data_ptr (without copying)
+  // A reference to owner (the Python object that owns the memory) is kept by the
+  // numpy array, such that the owner cannot be deleted while the numpy array exists.
+  static PyObject* numpy_array_using_memory(PyObject* owner, float* data_ptr,
+                                            const int num_dimensions, npy_intp* dims)
+  {
+    PyObject* np_array = PyArray_SimpleNewFromData(num_dimensions, dims, NPY_FLOAT32, data_ptr);
+    if (np_array == NULL)
+      throw std::runtime_error("Error creating numpy array");
+    Py_INCREF(owner);
+    if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(np_array), owner) != 0)
+      {
+        Py_DECREF(np_array);
+        throw std::runtime_error("Error setting the base object of the numpy array");
+      }
+    return np_array;
+  }
+
+  // return a pointer to the data of a numpy array, checking that it can be used by STIR without copying
+  static float* get_data_ptr_of_numpy_array(PyObject* const arg, const std::size_t num_elements)
+  {
+    if (!PyArray_Check(arg))
+      throw std::invalid_argument("argument should be a numpy array");
+    PyArrayObject* np_array = reinterpret_cast<PyArrayObject*>(arg);
+    if (PyArray_TYPE(np_array) != NPY_FLOAT32 || !PyArray_IS_C_CONTIGUOUS(np_array) ||
+        !PyArray_ISALIGNED(np_array) || !PyArray_ISWRITEABLE(np_array) || !PyArray_ISNOTSWAPPED(np_array))
+      throw std::invalid_argument("numpy array needs to be writeable, C-contiguous and of type float32 to share its memory. "
+                                  "Use for instance numpy.ascontiguousarray(array, dtype=numpy.float32)");
+    if (static_cast<std::size_t>(PyArray_SIZE(np_array)) != num_elements)
+      {
+        char str[1000];
+        snprintf(str, 1000, "numpy array has %ld elements, but %lu are needed",
+                 static_cast<long>(PyArray_SIZE(np_array)), static_cast<unsigned long>(num_elements));
+        throw std::length_error(str);
+      }
+    return static_cast<float*>(PyArray_DATA(np_array));
+  }
+
+  // set all elements of a STIR object from a numpy array (of any type or memory layout)
+  // This avoids the overhead of iterating over the elements in Python.
+  template <typename T>
+    void fill_from_numpy_array(T& stir_object, PyObject* const arg, const std::size_t num_elements)
+  {
+    // convert to a float32 C-contiguous array (this does not copy if it is one already)
+    PyObject* np_array = PyArray_FROM_OTF(arg, NPY_FLOAT32, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST);
+    if (np_array == NULL)
+      throw std::invalid_argument("fill() called with an argument that cannot be converted to a numpy array of type float32");
+    if (static_cast<std::size_t>(PyArray_SIZE(reinterpret_cast<PyArrayObject*>(np_array))) != num_elements)
+      {
+        Py_DECREF(np_array);
+        throw std::length_error("fill() called with a numpy array with an incorrect number of elements");
+      }
+    const float* data_ptr = static_cast<const float*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(np_array)));
+    try
+      {
+        fill_from(stir_object, data_ptr, data_ptr + num_elements);
+      }
+    catch (...)
+      {
+        Py_DECREF(np_array);
+        throw;
+      }
+    Py_DECREF(np_array);
+  }
+
+  // release a reference to a Python object from C++ code that might not hold the GIL
+  static void release_Python_object(PyObject* object)
+  {
+    PyGILState_STATE gil_state = PyGILState_Ensure();
+    Py_DECREF(object);
+    PyGILState_Release(gil_state);
+  }
+
+  // VoxelsOnCartesianGrid that uses the memory of a numpy array, keeping a reference to it
+  class VoxelsOnCartesianGridUsingNumpyArray : public VoxelsOnCartesianGrid<float>
+  {
+  public:
+    VoxelsOnCartesianGridUsingNumpyArray(PyObject* const np_array,
+                                         const IndexRange<3>& range,
+                                         const CartesianCoordinate3D<float>& origin,
+                                         const CartesianCoordinate3D<float>& grid_spacing)
+      : VoxelsOnCartesianGrid<float>(range, origin, grid_spacing),
+        np_array(np_array)
+    {
+      this->use_existing_contiguous_data(get_data_ptr_of_numpy_array(np_array, this->size_all()));
+      Py_INCREF(np_array);
+    }
+    ~VoxelsOnCartesianGridUsingNumpyArray()
+    {
+      release_Python_object(np_array);
+    }
+  private:
+    PyObject* const np_array;
+  };
+
+  // ProjDataInMemory that uses the memory of a numpy array, keeping a reference to it
+  class ProjDataInMemoryUsingNumpyArray : public ProjDataInMemory
+  {
+  public:
+    ProjDataInMemoryUsingNumpyArray(shared_ptr<const ExamInfo> const& exam_info_sptr,
+                                    shared_ptr<const ProjDataInfo> const& proj_data_info_sptr,
+                                    PyObject* const np_array)
+      : ProjDataInMemory(exam_info_sptr, proj_data_info_sptr,
+                         get_data_ptr_of_numpy_array(np_array, proj_data_info_sptr->size_all())),
+        np_array(np_array)
+    {
+      Py_INCREF(np_array);
+    }
+    ~ProjDataInMemoryUsingNumpyArray()
+    {
+      release_Python_object(np_array);
+    }
+  private:
+    PyObject* const np_array;
+  };
+#endif // SWIGPYTHON
+
  } // end of namespace
 
   %} // end of initial code specification for inclusino in the SWIG wrapper
@@ -1016,6 +1156,46 @@ T * operator-> () const;
 	ret(read_from_file<DiscretisedDensity<3,elemT> >(filename));
       return dynamic_cast<VoxelsOnCartesianGrid<elemT> *>(ret.release());
     }
+
+#ifdef SWIGPYTHON
+  %feature("autodoc", "return a numpy array (z,y,x) that shares the memory of the image (no copy).\n"
+           "The image is first made contiguous if necessary (see make_contiguous()).\n"
+           "The numpy array keeps the image alive, and stays valid as long as the index range of the image is not changed.\n"
+           "Warning: changing the index range (e.g. with resize() or grow()) gives the changed rows new memory. A later\n"
+           "call to make_contiguous() or as_numpy() then moves all voxels to new memory and releases the old memory.\n"
+           "Numpy arrays obtained before that refer to released memory and must not be used anymore.") as_numpy;
+  PyObject* as_numpy(PyObject **PYTHON_SELF)
+  {
+    $self->make_contiguous();
+    npy_intp dims[3];
+    dims[0] = $self->get_z_size();
+    dims[1] = $self->get_y_size();
+    dims[2] = $self->get_x_size();
+    return swigstir::numpy_array_using_memory(*PYTHON_SELF, $self->get_contiguous_data_ptr(), 3, dims);
+  }
+
+  %feature("autodoc", "create an image that shares the memory of a 3D numpy array (z,y,x) (no copy).\n"
+           "The numpy array needs to be writeable, C-contiguous and of type float32. It is kept alive by the image.\n"
+           "The index range is the same as for images constructed from projection data, i.e. z starts from 0, while\n"
+           "y and x are centred around 0.") from_numpy;
+  %newobject from_numpy;
+  static stir::VoxelsOnCartesianGrid<elemT> * from_numpy(PyObject* const np_array,
+                                                         const stir::CartesianCoordinate3D<float>& origin,
+                                                         const stir::CartesianCoordinate3D<float>& grid_spacing)
+  {
+    using namespace stir;
+    if (!PyArray_Check(np_array) || PyArray_NDIM(reinterpret_cast<PyArrayObject*>(np_array)) != 3)
+      throw std::invalid_argument("from_numpy needs a 3D numpy array");
+    const npy_intp* dims = PyArray_DIMS(reinterpret_cast<PyArrayObject*>(np_array));
+    const int z_size = static_cast<int>(dims[0]);
+    const int y_size = static_cast<int>(dims[1]);
+    const int x_size = static_cast<int>(dims[2]);
+    const IndexRange3D range(0, z_size-1,
+                             -(y_size/2), -(y_size/2) + y_size-1,
+                             -(x_size/2), -(x_size/2) + x_size-1);
+    return new swigstir::VoxelsOnCartesianGridUsingNumpyArray(np_array, range, origin, grid_spacing);
+  }
+#endif
  }
 
  //%ADD_indexaccess(int,stir::BasicCoordinate::value_type,stir::BasicCoordinate);
@@ -1195,13 +1375,34 @@ namespace stir {
       return swigstir::tuple_from_coord(sizes);
     }
 
-    %feature("autodoc", "fill from a Python iterator, e.g. array.fill(numpyarray.flat)") fill;
+    %feature("autodoc", "return a copy of the array as a numpy array (copying in C++, so faster than using flat())") to_numpy;
+    PyObject* to_numpy()
+    {
+      stir::BasicCoordinate<num_dimensions,int> minind,maxind;
+      if (!$self->get_regular_range(minind, maxind))
+	throw std::range_error("to_numpy called on irregular array");
+      npy_intp dims[num_dimensions];
+      for (int d=1; d<=num_dimensions; ++d)
+        dims[d-1] = maxind[d] - minind[d] + 1;
+      PyObject* np_array = PyArray_SimpleNew(num_dimensions, dims, NPY_FLOAT32);
+      if (np_array == NULL)
+        throw std::runtime_error("Error creating numpy array");
+      std::copy($self->begin_all_const(), $self->end_all_const(),
+                static_cast<float*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(np_array))));
+      return np_array;
+    }
+
+    %feature("autodoc", "fill from a Python iterator or a numpy array, e.g. array.fill(numpyarray)") fill;
     void fill(PyObject* const arg)
     {
       if (PyIter_Check(arg))
       {
 	swigstir::fill_Array_from_Python_iterator($self, arg);
       }
+      else if (PyArray_Check(arg))
+      {
+	swigstir::fill_from_numpy_array(*$self, arg, $self->size_all());
+      }
       else
       {
 	char str[1000];
@@ -1495,7 +1696,22 @@ namespace stir {
       return array;
     }
 
-    %feature("autodoc", "fill from a Python iterator, e.g. proj_data.fill(numpyarray.flat)") fill;
+    %feature("autodoc", "return a copy of the projection data as a numpy array (num_sinograms, num_views, num_tangential_poss).\n"
+             "Sinograms are in the same order as for to_array().") to_numpy;
+    PyObject* to_numpy()
+    {
+      npy_intp dims[3];
+      dims[0] = $self->get_num_sinograms();
+      dims[1] = $self->get_num_views();
+      dims[2] = $self->get_num_tangential_poss();
+      PyObject* np_array = PyArray_SimpleNew(3, dims, NPY_FLOAT32);
+      if (np_array == NULL)
+        throw std::runtime_error("Error creating numpy array");
+      copy_to(*$self, static_cast<float*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(np_array))));
+      return np_array;
+    }
+
+    %feature("autodoc", "fill from a Python iterator or a numpy array, e.g. proj_data.fill(numpyarray)") fill;
     void fill(PyObject* const arg)
     {
       if (PyIter_Check(arg))
@@ -1505,6 +1721,10 @@ namespace stir {
 	swigstir::fill_Array_from_Python_iterator(&array, arg);
         fill_from(*$self, array.begin_all(), array.end_all());
       }
+      else if (PyArray_Check(arg))
+      {
+	swigstir::fill_from_numpy_array(*$self, arg, $self->size_all());
+      }
       else
       {
 	char str[1000];
@@ -1536,7 +1756,29 @@ namespace stir {
 %extend ProjDataInMemory
   {
 #ifdef SWIGPYTHON
-    %feature("autodoc", "fill from a Python iterator, e.g. proj_data.fill(numpyarray.flat)") fill;
+    %feature("autodoc", "return a numpy array (num_sinograms, num_views, num_tangential_poss) that shares the memory of the projection data (no copy).\n"
+             "Sinograms are in the same order as for to_array(). The numpy array keeps the projection data alive.") as_numpy;
+    PyObject* as_numpy(PyObject **PYTHON_SELF)
+    {
+      npy_intp dims[3];
+      dims[0] = $self->get_num_sinograms();
+      dims[1] = $self->get_num_views();
+      dims[2] = $self->get_num_tangential_poss();
+      return swigstir::numpy_array_using_memory(*PYTHON_SELF, &(*$self->begin_all()), 3, dims);
+    }
+
+    %feature("autodoc", "create projection data that share the memory of a numpy array (no copy).\n"
+             "The numpy array needs to be writeable, C-contiguous and of type float32, with its elements in the same order as for to_array().\n"
+             "It is kept alive by the projection data.") from_numpy;
+    %newobject from_numpy;
+    static ProjDataInMemory* from_numpy(shared_ptr<const ExamInfo> const& exam_info_sptr,
+                                        shared_ptr<const ProjDataInfo> const& proj_data_info_sptr,
+                                        PyObject* const np_array)
+    {
+      return new swigstir::ProjDataInMemoryUsingNumpyArray(exam_info_sptr, proj_data_info_sptr, np_array);
+    }
+
+    %feature("autodoc", "fill from a Python iterator or a numpy array, e.g. proj_data.fill(numpyarray)") fill;
     void fill(PyObject* const arg)
     {
       if (PyIter_Check(arg))
@@ -1545,6 +1787,10 @@ namespace stir {
 	swigstir::fill_Array_from_Python_iterator(&array, arg);
         fill_from(*$self, array.begin_all(), array.end_all());
       }
+      else if (PyArray_Check(arg))
+      {
+	swigstir::fill_from_numpy_array(*$self, arg, $self->size_all());
+      }
       else
       {
 	char str[1000];
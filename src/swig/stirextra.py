@@ -61,7 +61,15 @@ def get_physical_coordinates_for_grid(image):
 def to_numpy(stirdata):
     """
     return the data in a STIR image or other Array as a numpy array
+
+    The data are copied. Use stirdata.as_numpy() for images and ProjDataInMemory
+    to get a numpy array that shares memory with the STIR object.
     """
+    try:
+        # copy in C++ if possible
+        return stirdata.to_numpy()
+    except AttributeError:
+        pass
     # construct a numpy array using the "flat" STIR iterator
     try:
         npstirdata=numpy.fromiter(stirdata.flat(), dtype=numpy.float32);
@@ -11,6 +11,16 @@
 #
 #    See STIR/LICENSE.txt for details
 
+try:
+    import pytest
+except ImportError:
+    # No pytest, try older py.test
+    try:
+        import py.test as pytest
+    except ImportError:
+        raise ImportError('Tests require pytest or py<1.4')
+
+import numpy
 from stir import *
 import stirextra
 # for Python2 and itertools.zip->zip (as in Python 3) 
@@ -79,3 +89,88 @@ def test_ProjData():
     seg0=stirextra.to_numpy(projdata.get_segment_by_sinogram(0))
     assert(seg0.max() == 2)
 
+
+def test_fill_from_numpy_array():
+    minind=Int3BasicCoordinate((3,3,5));
+    a=FloatArray3D(IndexRange3D(minind, Int3BasicCoordinate((9,8,7))))
+    np=stirextra.to_numpy(a)
+    np+=3
+    # fill without using the (slow) Python iterator
+    a.fill(np)
+    ind=Int3BasicCoordinate((4,5,6));
+    assert a[ind]==3
+    # also works for other types and memory layouts
+    a.fill(numpy.asfortranarray(np*2, dtype=numpy.float64))
+    assert a[ind]==6
+    # but the number of elements has to be correct
+    with pytest.raises(ValueError):
+        a.fill(numpy.zeros(3))
+
+def test_FloatVoxelsOnCartesianGrid_as_numpy():
+    origin=FloatCartesianCoordinate3D(0,1,6)
+    gridspacing=FloatCartesianCoordinate3D(1,1,2)
+    indrange=IndexRange3D(Int3BasicCoordinate((0,-2,-3)), Int3BasicCoordinate((4,3,2)))
+    image=FloatVoxelsOnCartesianGrid(indrange, origin,gridspacing)
+    image.fill(2)
+    np=image.as_numpy()
+    assert np.shape==(5,6,6)
+    assert np[(0,0,0)]==2
+    # modifying the numpy array modifies the image and vice versa
+    np[(1,2,3)]=4
+    assert image[(1,0,0)]==4
+    image[(2,1,-1)]=5
+    assert np[(2,3,2)]==5
+    # numpy array keeps the image alive
+    del image
+    assert np[(1,2,3)]==4
+
+def test_FloatVoxelsOnCartesianGrid_from_numpy():
+    origin=FloatCartesianCoordinate3D(0,1,6)
+    gridspacing=FloatCartesianCoordinate3D(1,1,2)
+    np=numpy.zeros((3,4,5), dtype=numpy.float32)
+    np[(1,2,2)]=3
+    image=FloatVoxelsOnCartesianGrid.from_numpy(np, origin, gridspacing)
+    assert image.get_origin()==origin
+    assert image.get_grid_spacing()==gridspacing
+    assert image[(1,0,0)]==3
+    # image shares memory with the numpy array
+    image[(0,-2,-2)]=4
+    assert np[(0,0,0)]==4
+    # image keeps the numpy array alive
+    del np
+    assert image[(1,0,0)]==3
+    # copies use their own memory
+    image_copy=image.clone()
+    image_copy.fill(1)
+    assert image[(1,0,0)]==3
+    # only arrays of the correct type and layout can be shared
+    with pytest.raises(TypeError):
+        FloatVoxelsOnCartesianGrid.from_numpy(numpy.zeros((3,4,5)), origin, gridspacing)
+    with pytest.raises(TypeError):
+        FloatVoxelsOnCartesianGrid.from_numpy(numpy.zeros((5,4,3), dtype=numpy.float32).T, origin, gridspacing)
+
+def test_ProjDataInMemory_as_from_numpy():
+    s=Scanner.get_scanner_from_name("ECAT 962")
+    projdatainfo=ProjDataInfo.construct_proj_data_info(s,3,9,8,6)
+    projdata=ProjDataInMemory(ExamInfo(), projdatainfo)
+    for seg_idx in range(projdata.get_min_segment_num(),projdata.get_max_segment_num()+1):
+        segment=projdata.get_empty_segment_by_sinogram(seg_idx)
+        segment.fill(seg_idx)
+        projdata.set_segment(segment)
+    # same order as to_array()
+    np=projdata.as_numpy()
+    assert (np==stirextra.to_numpy(projdata.to_array())).all()
+    assert (np==projdata.to_numpy()).all()
+    # modifying the numpy array modifies the projection data
+    np+=2
+    assert projdata.get_segment_by_sinogram(0).find_min()==2
+    # share memory with a numpy array
+    np2=numpy.zeros(np.shape, dtype=numpy.float32)
+    np2+=5
+    projdata2=ProjDataInMemory.from_numpy(ExamInfo(), projdatainfo, np2)
+    assert projdata2.get_segment_by_sinogram(1).find_max()==5
+    projdata2.fill(np)
+    assert (np2==np).all()
+    # the number of elements has to be correct
+    with pytest.raises(ValueError):
+        ProjDataInMemory.from_numpy(ExamInfo(), projdatainfo, np2[1:])
@@ -0,0 +1,272 @@
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup test
+  \ingroup GE
+  \brief Test program for stir::GE::RDF_HDF5::InputStreamWithRecordsFromHDF5
+
+  Writes a small file with the structure of a GE RDF9 listmode file, containing records
+  of varying size, and checks that these records are read correctly with and without
+  asynchronous reading, for several buffer sizes and after going back to a saved position.
+
+  \author agent
+*/
+
+#include "stir/IO/InputStreamWithRecordsFromHDF5.h"
+#include "stir/RunTests.h"
+#include "stir/Succeeded.h"
+#include <boost/format.hpp>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <ctime>
+
+START_NAMESPACE_STIR
+
+namespace {
+
+//! A record whose size (between 6 and 16 bytes) is encoded in its first byte
+class TestRecord
+{
+public:
+  std::size_t size_of_record_at_ptr(const char * const data_ptr, const std::size_t, const bool) const
+  {
+    return 6 + static_cast<unsigned char>(data_ptr[0]) % 11;
+  }
+
+  Succeeded init_from_data_ptr(const char * const data_ptr, const std::size_t size, const bool)
+  {
+    this->data.assign(data_ptr, data_ptr + size);
+    return Succeeded::yes;
+  }
+
+  std::vector<char> data;
+};
+
+} // end of anonymous namespace
+
+using GE::RDF_HDF5::InputStreamWithRecordsFromHDF5;
+
+/*!
+  \ingroup test
+  \ingroup GE
+  \brief Test class for InputStreamWithRecordsFromHDF5
+*/
+class InputStreamWithRecordsFromHDF5Tests : public RunTests
+{
+public:
+  void run_tests();
+
+private:
+  std::string filename;
+  //! the records in the file (apart from the last one, which is not read by the stream)
+  std::vector<std::vector<char> > records;
+  static const hsize_t chunk_size = 1000;
+
+  void create_group(H5::H5File& file, const std::string& name);
+  template <class T>
+  void write_scalar(H5::H5File& file, const std::string& name, const T value, const H5::PredType& type);
+  void write_string(H5::H5File& file, const std::string& name, const std::string& value);
+  void write_file();
+
+  void check_records(InputStreamWithRecordsFromHDF5<TestRecord>& stream, const std::size_t first_record,
+                     const std::size_t num_records, const std::string& str);
+  void test_stream(const std::size_t buffer_size, const bool asynchronous);
+};
+
+const hsize_t InputStreamWithRecordsFromHDF5Tests::chunk_size;
+
+void
+InputStreamWithRecordsFromHDF5Tests::
+create_group(H5::H5File& file, const std::string& name)
+{
+  // create all parent groups first
+  const std::string::size_type pos = name.rfind('/');
+  if (pos != 0)
+    create_group(file, name.substr(0, pos));
+  if (H5Lexists(file.getId(), name.c_str(), H5P_DEFAULT) <= 0)
+    file.createGroup(name);
+}
+
+template <class T>
+void
+InputStreamWithRecordsFromHDF5Tests::
+write_scalar(H5::H5File& file, const std::string& name, const T value, const H5::PredType& type)
+{
+  create_group(file, name.substr(0, name.rfind('/')));
+  H5::DataSet dataset = file.createDataSet(name, type, H5::DataSpace(H5S_SCALAR));
+  dataset.write(&value, type);
+}
+
+void
+InputStreamWithRecordsFromHDF5Tests::
+write_string(H5::H5File& file, const std::string& name, const std::string& value)
+{
+  // GEHDF5Wrapper reads strings with this length
+  const H5::StrType str_type(0, 37);
+  create_group(file, name.substr(0, name.rfind('/')));
+  H5::DataSet dataset = file.createDataSet(name, str_type, H5::DataSpace(H5S_SCALAR));
+  dataset.write(value, str_type);
+}
+
+void
+InputStreamWithRecordsFromHDF5Tests::
+write_file()
+{
+  // construct records of varying size
+  std::vector<char> list_data;
+  for (int i = 0; list_data.size() < 20*chunk_size; ++i)
+    {
+      const std::size_t size = 6 + (i*7) % 11;
+      std::vector<char> record(size);
+      record[0] = static_cast<char>(size - 6);
+      for (std::size_t b = 1; b < size; ++b)
+        record[b] = static_cast<char>(i + b);
+      records.push_back(record);
+      list_data.insert(list_data.end(), record.begin(), record.end());
+    }
+  // the stream stops reading at the last record signature, so add one
+  list_data.insert(list_data.end(), 6, 0);
+
+  H5::H5File file(filename, H5F_ACC_TRUNC);
+  write_string(file, "/HeaderData/ExamData/manufacturer", "GE MEDICAL SYSTEMS");
+  write_string(file, "/HeaderData/ExamData/scannerDesc", "GE Signa PET/MR");
+  const H5::PredType& u32 = H5::PredType::NATIVE_UINT32;
+  const H5::PredType& i32 = H5::PredType::NATIVE_INT32;
+  const H5::PredType& f32 = H5::PredType::NATIVE_FLOAT;
+  write_scalar(file, "/HeaderData/RDFConfiguration/fileVersion/majorVersion", 9U, u32);
+  write_scalar(file, "/HeaderData/RDFConfiguration/isListFile", 1U, u32);
+  write_scalar(file, "/HeaderData/ListHeader/isListCompressed", 0U, u32);
+  // geometry of the Signa PET/MR
+  write_scalar(file, "/HeaderData/SystemGeometry/effectiveRingDiameter", 2*(311.8F+8.5F), f32);
+  write_scalar(file, "/HeaderData/SystemGeometry/axialBlocksPerModule", 5U, u32);
+  write_scalar(file, "/HeaderData/SystemGeometry/radialBlocksPerModule", 4U, u32);
+  write_scalar(file, "/HeaderData/SystemGeometry/axialBlocksPerUnit", 5U, u32);
+  write_scalar(file, "/HeaderData/SystemGeometry/radialBlocksPerUnit", 4U, u32);
+  write_scalar(file, "/HeaderData/SystemGeometry/axialUnitsPerModule", 1U, u32);
+  write_scalar(file, "/HeaderData/SystemGeometry/radialUnitsPerModule", 1U, u32);
+  write_scalar(file, "/HeaderData/SystemGeometry/axialModulesPerSystem", 1U, u32);
+  write_scalar(file, "/HeaderData/SystemGeometry/radialModulesPerSystem", 28U, u32);
+  write_scalar(file, "/HeaderData/SystemGeometry/detectorAxialSize", 45*5.56F, f32);
+  write_scalar(file, "/HeaderData/SystemGeometry/transaxial_crystal_0_offset", -5.23F, f32);
+  write_scalar(file, "/HeaderData/SystemGeometry/axialCrystalsPerBlock", 9U, u32);
+  write_scalar(file, "/HeaderData/SystemGeometry/radialCrystalsPerBlock", 4U, u32);
+  write_scalar(file, "/HeaderData/Sorter/dimension1Size", 357U, u32);
+  write_scalar(file, "/HeaderData/AcqParameters/LandmarkParameters/absTableLongitude", 0, i32);
+  write_scalar(file, "/HeaderData/AcqParameters/LandmarkParameters/tableElevation", 0, i32);
+  write_scalar(file, "/HeaderData/AcqParameters/LandmarkParameters/patientEntry", 0U, u32);
+  write_scalar(file, "/HeaderData/AcqParameters/LandmarkParameters/patientPosition", 0U, u32);
+  write_scalar(file, "/HeaderData/AcqParameters/EDCATParameters/lower_energy_limit", 425U, u32);
+  write_scalar(file, "/HeaderData/AcqParameters/EDCATParameters/upper_energy_limit", 650U, u32);
+  write_scalar(file, "/HeaderData/AcqStats/scanStartTime", 1000U, u32);
+  write_scalar(file, "/HeaderData/AcqStats/frameStartTime", 1000U, u32);
+  write_scalar(file, "/HeaderData/AcqStats/frameDuration", 10000U, u32);
+  write_scalar(file, "/HeaderData/SinglesHeader/numValidSamples", 1U, u32);
+
+  // the list data, in chunks
+  create_group(file, "/ListData");
+  const hsize_t size = list_data.size();
+  H5::DSetCreatPropList create_plist;
+  create_plist.setChunk(1, &chunk_size);
+  H5::DataSet dataset = file.createDataSet("/ListData/listData", H5::PredType::STD_U8LE,
+                                           H5::DataSpace(1, &size), create_plist);
+  dataset.write(&list_data[0], H5::PredType::STD_U8LE);
+}
+
+void
+InputStreamWithRecordsFromHDF5Tests::
+check_records(InputStreamWithRecordsFromHDF5<TestRecord>& stream, const std::size_t first_record,
+              const std::size_t num_records, const std::string& str)
+{
+  TestRecord record;
+  for (std::size_t i = first_record; i < first_record + num_records; ++i)
+    {
+      if (!check(stream.get_next_record(record) == Succeeded::yes,
+                 boost::str(boost::format("reading record %1% %2%") % i % str)))
+        return;
+      if (!check(record.data == records[i], boost::str(boost::format("record %1% %2%") % i % str)))
+        return;
+    }
+}
+
+void
+InputStreamWithRecordsFromHDF5Tests::
+test_stream(const std::size_t buffer_size, const bool asynchronous)
+{
+  const std::string str =
+    boost::str(boost::format("(buffer size %1%, asynchronous %2%)") % buffer_size % asynchronous);
+  std::cerr << "Reading records " << str << "\n";
+
+  InputStreamWithRecordsFromHDF5<TestRecord> stream(filename, 6, 16, buffer_size);
+  stream.set_asynchronous_reading(asynchronous);
+  check(stream.get_asynchronous_reading() == asynchronous, "asynchronous reading " + str);
+  if (buffer_size == 0)
+    check(stream.get_buffer_size() % chunk_size == 0,
+          "default buffer size should be a multiple of the chunk size");
+
+  // read the first half, remember the position, and read the rest
+  const std::size_t half = records.size()/2;
+  check_records(stream, 0, half, str);
+  const InputStreamWithRecordsFromHDF5<TestRecord>::SavedPosition pos = stream.save_get_position();
+  check_records(stream, half, records.size() - half, str);
+  TestRecord record;
+  check(stream.get_next_record(record) == Succeeded::no, "there should be no records after the last one " + str);
+
+  // go back to the saved position and the start
+  check(stream.set_get_position(pos) == Succeeded::yes, "going back to saved position " + str);
+  check_records(stream, half, records.size() - half, str + " after going back to saved position");
+  check(stream.reset() == Succeeded::yes, "reset " + str);
+  check_records(stream, 0, records.size(), str + " after reset");
+}
+
+void
+InputStreamWithRecordsFromHDF5Tests::
+run_tests()
+{
+  std::cerr << "Tests for InputStreamWithRecordsFromHDF5\n";
+  std::cerr << "The HDF5 library is " << (InputStreamWithRecordsFromHDF5<TestRecord>::is_HDF5_library_threadsafe() ? "" : "not ")
+            << "thread-safe\n";
+
+  // GEHDF5Wrapper checks for datasets that do not exist in a listmode file, don't let HDF5 print these errors
+  H5::Exception::dontPrint();
+  filename = (boost::format("test_IO_InputStreamWithRecordsFromHDF5_%1%.h5") % std::time(0)).str();
+  try
+    {
+      write_file();
+      // buffer sizes that are not a multiple of the record sizes and smaller than a chunk,
+      // such that records cross buffer boundaries, and the default
+      const std::size_t buffer_sizes[] = { 17, 999, 4096, 0 };
+      for (std::size_t b = 0; b < sizeof(buffer_sizes)/sizeof(buffer_sizes[0]); ++b)
+        for (int asynchronous = 0; asynchronous < 2; ++asynchronous)
+          test_stream(buffer_sizes[b], asynchronous != 0);
+    }
+  catch (std::exception& e)
+    {
+      std::cerr << "\nHere's the error:\n\t" << e.what() << "\n\n";
+      everything_ok = false;
+    }
+  catch (H5::Exception& e)
+    {
+      std::cerr << "\nHDF5 error:\n\t" << e.getDetailMsg() << "\n\n";
+      everything_ok = false;
+    }
+  check(std::remove(filename.c_str()) == 0, "removing " + filename);
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int main()
+{
+  InputStreamWithRecordsFromHDF5Tests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
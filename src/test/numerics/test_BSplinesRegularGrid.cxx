@@ -25,7 +25,10 @@
 #include "stir/stream.h"
 #include "stir/assign.h"
 #include "stir/numerics/BSplinesRegularGrid.h"
+#include "stir/numerics/sampling_functions.h"
+#include "stir/IndexRange3D.h"
 #include <iostream>
+#include <cmath>
 #include "stir/shared_ptr.h"
 #ifndef STIR_NO_NAMESPACES
 using std::cerr;
@@ -45,6 +48,9 @@ namespace BSpline {
     {}
     void run_tests();
   private:  
+    //! compare sample_function_on_regular_grid for B-splines with the generic version
+    void check_sample_function_on_regular_grid();
+
     template <class elemT>
     bool check_at_sample_points(const Array<2,elemT>& v,
                                 const BSplinesRegularGrid<2, elemT, elemT>& interpolator,
@@ -495,6 +501,7 @@ namespace BSpline {
                           "check BSplines implementation for linear_cubic interpolation.\nProblems at half way!");
       } 
     }   
+    check_sample_function_on_regular_grid();
     /*  {       
         cerr << "\nTesting BSplinesRegularGrid: Linear interpolation values and constructor using a 2D diamond array as input..." << endl;                                
         Array<1,elemT> random_1D_1 =  make_1d_array(-14., 8., -1., 13., -1., -2., 11., 1., -8.);                
@@ -509,6 +516,47 @@ namespace BSpline {
         }*/
   }             
 
+  namespace
+  {
+    // function object that only calls the interpolator, such that the generic version
+    // of sample_function_on_regular_grid is used
+    class InterpolatorCaller
+    {
+    public:
+      explicit InterpolatorCaller(const BSplinesRegularGrid<3,float>& interpolator)
+        : interpolator(interpolator) {}
+      float operator()(const BasicCoordinate<3,double>& relative_positions) const
+      { return interpolator(relative_positions); }
+    private:
+      const BSplinesRegularGrid<3,float>& interpolator;
+    };
+  }
+
+  void BSplinesRegularGrid_Tests::check_sample_function_on_regular_grid()
+  {
+    cerr << "\nTesting sample_function_on_regular_grid for a 3D BSplinesRegularGrid" << endl;
+    Array<3,float> input(IndexRange3D(0,6,0,8,-5,5));
+    for (int z=input.get_min_index(); z<=input.get_max_index(); ++z)
+      for (int y=input[z].get_min_index(); y<=input[z].get_max_index(); ++y)
+        for (int x=input[z][y].get_min_index(); x<=input[z][y].get_max_index(); ++x)
+          input[z][y][x] = std::sin(z + 2.F*y) + std::cos(.3F*x*z) + 2;
+
+    BasicCoordinate<3,BSplineType> spline_types;
+    spline_types[1]=cubic; spline_types[2]=linear; spline_types[3]=quadratic;
+    const BSplinesRegularGrid<3,float> interpolator(input, spline_types);
+
+    BasicCoordinate<3,double> offset, step;
+    offset[1]=-.3; offset[2]=.7; offset[3]=-1.2;
+    step[1]=.5; step[2]=1.; step[3]=.8;
+    // the output is larger than the range where the function is sampled (which is left at 0)
+    Array<3,float> out(IndexRange3D(0,15,-2,10,-8,12));
+    Array<3,float> expected(out.get_index_range());
+    sample_function_on_regular_grid(out, interpolator, offset, step);
+    sample_function_on_regular_grid(expected, InterpolatorCaller(interpolator), offset, step);
+    check_if_equal(out, expected, "sample_function_on_regular_grid for BSplinesRegularGrid");
+    check(out.find_max() > 0, "sample_function_on_regular_grid for BSplinesRegularGrid has to give non-zero values");
+  }
+
 } // end namespace BSpline
 
 END_NAMESPACE_STIR
@@ -27,6 +27,11 @@
 #include "stir/ArcCorrection.h"
 #include "stir/round.h"
 #include "stir/index_at_maximum.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ExamInfo.h"
+#include "stir/SegmentBySinogram.h"
+#include "stir/numerics/overlap_interpolate.h"
+#include <cmath>
 
 using std::cerr;
 
@@ -46,6 +51,10 @@ START_NAMESPACE_STIR
 
   This is currently only done on sinograms and viewgrams.
 
+  In addition, the result for a non-uniform viewgram is compared with
+  overlap_interpolate() (which ArcCorrection used before precomputing its weights),
+  and the results for segments and ProjData are compared with the ones for viewgrams.
+
   The tests are performed both at the default arc-corrected bin-size, 
   but also at twice as large bin-size.
 */
@@ -55,6 +64,8 @@ public:
   void run_tests();
 protected:
   void run_tests_for_specific_proj_data_info(const ArcCorrection&);
+  //! compare with overlap_interpolate, and segments and ProjData with viewgrams
+  void run_tests_for_consistency(const ArcCorrection&);
 };
 
 void
@@ -144,6 +155,83 @@ run_tests_for_specific_proj_data_info(const ArcCorrection& arc_correction)
 }
 
 
+void
+ArcCorrectionTests::
+run_tests_for_consistency(const ArcCorrection& arc_correction)
+{
+  const ProjDataInfoCylindricalArcCorr& proj_data_info_arc_corr =
+    arc_correction.get_arc_corrected_proj_data_info();
+  const ProjDataInfoCylindricalNoArcCorr& proj_data_info_noarc_corr =
+    arc_correction.get_not_arc_corrected_proj_data_info();
+  shared_ptr<ExamInfo> exam_info_sptr(new ExamInfo);
+  ProjDataInMemory noarccorr_proj_data(exam_info_sptr, arc_correction.get_not_arc_corrected_proj_data_info_sptr());
+  for (int segment_num=noarccorr_proj_data.get_min_segment_num(); segment_num<=noarccorr_proj_data.get_max_segment_num(); ++segment_num)
+    {
+      SegmentBySinogram<float> segment = noarccorr_proj_data.get_empty_segment_by_sinogram(segment_num);
+      for (int axial_pos_num=segment.get_min_axial_pos_num(); axial_pos_num<=segment.get_max_axial_pos_num(); ++axial_pos_num)
+        for (int view_num=segment.get_min_view_num(); view_num<=segment.get_max_view_num(); ++view_num)
+          for (int tangential_pos_num=segment.get_min_tangential_pos_num(); tangential_pos_num<=segment.get_max_tangential_pos_num(); ++tangential_pos_num)
+            segment[axial_pos_num][view_num][tangential_pos_num] =
+              1 + segment_num*segment_num + axial_pos_num + (view_num%4) + std::cos(tangential_pos_num/10.F);
+      noarccorr_proj_data.set_segment(segment);
+    }
+
+  // comparison with overlap_interpolate
+  {
+    const int min_in = proj_data_info_noarc_corr.get_min_tangential_pos_num();
+    const int max_in = proj_data_info_noarc_corr.get_max_tangential_pos_num();
+    const int min_out = proj_data_info_arc_corr.get_min_tangential_pos_num();
+    const int max_out = proj_data_info_arc_corr.get_max_tangential_pos_num();
+    const float sampling_in_s = proj_data_info_arc_corr.get_tangential_sampling();
+    Array<1,float> noarccorr_coords(min_in, max_in+1);
+    for (int tangential_pos_num=min_in; tangential_pos_num<=max_in+1; ++tangential_pos_num)
+      noarccorr_coords[tangential_pos_num] =
+        proj_data_info_noarc_corr.get_ring_radius() *
+        sin((tangential_pos_num-.5F)*proj_data_info_noarc_corr.get_angular_increment());
+    Array<1,float> arccorr_coords(min_out, max_out+1);
+    for (int tangential_pos_num=min_out; tangential_pos_num<=max_out+1; ++tangential_pos_num)
+      arccorr_coords[tangential_pos_num] = (tangential_pos_num-.5F)*sampling_in_s;
+
+    const Viewgram<float> noarccorr_viewgram = noarccorr_proj_data.get_viewgram(3, 0);
+    const Viewgram<float> arccorr_viewgram = arc_correction.do_arc_correction(noarccorr_viewgram);
+    for (int axial_pos_num=noarccorr_viewgram.get_min_axial_pos_num(); axial_pos_num<=noarccorr_viewgram.get_max_axial_pos_num(); ++axial_pos_num)
+      {
+        Array<1,float> expected(min_out, max_out);
+        overlap_interpolate(expected.begin(), expected.end(),
+                            arccorr_coords.begin(), arccorr_coords.end(),
+                            noarccorr_viewgram[axial_pos_num].begin(), noarccorr_viewgram[axial_pos_num].end(),
+                            noarccorr_coords.begin(), noarccorr_coords.end());
+        expected /= sampling_in_s;
+        if (!check_if_equal(arccorr_viewgram[axial_pos_num], expected, "comparison with overlap_interpolate"))
+          break;
+      }
+  }
+
+  // segments and ProjData
+  {
+    ProjDataInMemory arccorr_proj_data(exam_info_sptr, arc_correction.get_arc_corrected_proj_data_info_sptr());
+    check(arc_correction.do_arc_correction(arccorr_proj_data, noarccorr_proj_data) == Succeeded::yes,
+          "arc-correction of ProjData");
+    for (int segment_num=noarccorr_proj_data.get_min_segment_num(); segment_num<=noarccorr_proj_data.get_max_segment_num(); ++segment_num)
+      {
+        const SegmentBySinogram<float> arccorr_segment =
+          arc_correction.do_arc_correction(noarccorr_proj_data.get_segment_by_sinogram(segment_num));
+        for (int view_num=noarccorr_proj_data.get_min_view_num(); view_num<=noarccorr_proj_data.get_max_view_num(); ++view_num)
+          {
+            const Viewgram<float> arccorr_viewgram =
+              arc_correction.do_arc_correction(noarccorr_proj_data.get_viewgram(view_num, segment_num));
+            if (!check_if_equal(arccorr_proj_data.get_viewgram(view_num, segment_num), arccorr_viewgram,
+                                "arc-correction of ProjData and viewgram"))
+              return;
+            for (int axial_pos_num=arccorr_viewgram.get_min_axial_pos_num(); axial_pos_num<=arccorr_viewgram.get_max_axial_pos_num(); ++axial_pos_num)
+              if (!check_if_equal(arccorr_segment[axial_pos_num][view_num], arccorr_viewgram[axial_pos_num],
+                                  "arc-correction of segment and viewgram"))
+                return;
+          }
+      }
+  }
+}
+
 void
 ArcCorrectionTests::run_tests()
 { 
@@ -158,6 +246,7 @@ ArcCorrectionTests::run_tests()
   {
     arc_correction.set_up(proj_data_info_ptr);
     run_tests_for_specific_proj_data_info(arc_correction);
+    run_tests_for_consistency(arc_correction);
   }
   cerr << "Using non-default range and bin-size\n";
   {
@@ -165,6 +254,7 @@ ArcCorrectionTests::run_tests()
 			  128,
 			  scanner_ptr->get_default_bin_size()*2);
     run_tests_for_specific_proj_data_info(arc_correction);
+    run_tests_for_consistency(arc_correction);
   }
 }
 
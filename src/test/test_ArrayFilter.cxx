@@ -26,6 +26,11 @@
 #include "stir/IndexRange2D.h"
 #include "stir/ArrayFilter3DUsingConvolution.h"
 #include "stir/IndexRange3D.h"
+#include "stir/MedianArrayFilter3D.h"
+#include "stir/MinimalArrayFilter3D.h"
+#include "stir/MaximalArrayFilter3D.h"
+#include "stir/Coordinate3D.h"
+#include "stir/HighResWallClockTimer.h"
 #include "stir/Succeeded.h"
 #include "stir/modulo.h"
 #include "stir/RunTests.h"
@@ -52,6 +57,10 @@ class ArrayFilterTests : public RunTests
 public:
   void run_tests();
 private:
+  //! compare median, minimal and maximal filters with a straightforward implementation
+  void test_rank_filters(const Array<3,float>& test, const Coordinate3D<int>& mask_radius);
+  //! compare timings of the median filter with finding the median for every voxel using std::nth_element
+  void time_median_filter(const Array<3,float>& test, const Coordinate3D<int>& mask_radius);
 
 
 
@@ -160,6 +169,82 @@ compare_results_2arg(const ArrayFunctionObject<num_dimensions,float>& filter1,
 }
 
 };
+void
+ArrayFilterTests::
+test_rank_filters(const Array<3,float>& test, const Coordinate3D<int>& mask_radius)
+{
+  Array<3,float> median_ref(test.get_index_range());
+  Array<3,float> min_ref(test.get_index_range());
+  Array<3,float> max_ref(test.get_index_range());
+  std::vector<float> neighbours;
+  for (int z=test.get_min_index(); z<=test.get_max_index(); ++z)
+    for (int y=test[z].get_min_index(); y<=test[z].get_max_index(); ++y)
+      for (int x=test[z][y].get_min_index(); x<=test[z][y].get_max_index(); ++x)
+        {
+          neighbours.clear();
+          for (int zn=std::max(z-mask_radius[1], test.get_min_index()); zn<=std::min(z+mask_radius[1], test.get_max_index()); ++zn)
+            for (int yn=std::max(y-mask_radius[2], test[zn].get_min_index()); yn<=std::min(y+mask_radius[2], test[zn].get_max_index()); ++yn)
+              for (int xn=std::max(x-mask_radius[3], test[zn][yn].get_min_index()); xn<=std::min(x+mask_radius[3], test[zn][yn].get_max_index()); ++xn)
+                neighbours.push_back(test[zn][yn][xn]);
+          std::sort(neighbours.begin(), neighbours.end());
+          const std::size_t n = neighbours.size();
+          min_ref[z][y][x] = neighbours[0];
+          max_ref[z][y][x] = neighbours[n-1];
+          median_ref[z][y][x] = n%2==1 ? neighbours[n/2] : (neighbours[n/2]+neighbours[n/2-1])/2;
+        }
+
+  set_tolerance(1.E-6);
+  Array<3,float> out(test.get_index_range());
+  const MedianArrayFilter3D<float> median_filter(mask_radius);
+  median_filter(out, test);
+  check_if_equal(out, median_ref, "median filter");
+  const MinimalArrayFilter3D<float> min_filter(mask_radius);
+  min_filter(out, test);
+  check_if_equal(out, min_ref, "minimal filter");
+  const MaximalArrayFilter3D<float> max_filter(mask_radius);
+  max_filter(out, test);
+  check_if_equal(out, max_ref, "maximal filter");
+}
+
+void
+ArrayFilterTests::
+time_median_filter(const Array<3,float>& test, const Coordinate3D<int>& mask_radius)
+{
+  HighResWallClockTimer timer;
+  timer.start();
+  Array<3,float> median_ref(test.get_index_range());
+  std::vector<float> neighbours;
+  for (int z=test.get_min_index(); z<=test.get_max_index(); ++z)
+    for (int y=test[z].get_min_index(); y<=test[z].get_max_index(); ++y)
+      for (int x=test[z][y].get_min_index(); x<=test[z][y].get_max_index(); ++x)
+        {
+          neighbours.clear();
+          for (int zn=std::max(z-mask_radius[1], test.get_min_index()); zn<=std::min(z+mask_radius[1], test.get_max_index()); ++zn)
+            for (int yn=std::max(y-mask_radius[2], test[zn].get_min_index()); yn<=std::min(y+mask_radius[2], test[zn].get_max_index()); ++yn)
+              for (int xn=std::max(x-mask_radius[3], test[zn][yn].get_min_index()); xn<=std::min(x+mask_radius[3], test[zn][yn].get_max_index()); ++xn)
+                neighbours.push_back(test[zn][yn][xn]);
+          const std::size_t n = neighbours.size();
+          std::nth_element(neighbours.begin(), neighbours.begin() + n/2, neighbours.end());
+          median_ref[z][y][x] = neighbours[n/2];
+          if (n%2==0)
+            median_ref[z][y][x] =
+              (median_ref[z][y][x] + *std::max_element(neighbours.begin(), neighbours.begin() + n/2))/2;
+        }
+  timer.stop();
+  const double time_ref = timer.value();
+
+  timer.reset();
+  timer.start();
+  Array<3,float> out(test.get_index_range());
+  const MedianArrayFilter3D<float> median_filter(mask_radius);
+  median_filter(out, test);
+  timer.stop();
+  std::cerr << "\tmedian filter with mask radius " << mask_radius
+            << ": " << timer.value() << "s (with std::nth_element: " << time_ref << "s)\n";
+  set_tolerance(1.E-6);
+  check_if_equal(out, median_ref, "median filter (compared with std::nth_element)");
+}
+
 void
 ArrayFilterTests::run_tests()
 { 
@@ -428,6 +513,60 @@ ArrayFilterTests::run_tests()
       std::cerr <<"Comparing DFT and Convolution with input positive offset\n";
       compare_results_2arg(DFT_filter, conv_filter, test_pos_offset);
       compare_results_1arg(DFT_filter, conv_filter, test_pos_offset);
+
+      check(!conv_filter.kernel_is_separable(), "conv kernel should not be separable");
+      std::cerr <<"Comparing direct and DFT-based Convolution\n";
+      ArrayFilter3DUsingConvolution<float> conv_filter_DFT(kernel_for_conv);
+      conv_filter_DFT.set_method(ArrayFilter3DUsingConvolution<float>::DFT);
+      compare_results_2arg(conv_filter, conv_filter_DFT, test_neg_offset);
+      compare_results_1arg(conv_filter, conv_filter_DFT, test_pos_offset);
+    }
+    {
+      std::cerr <<"Comparing methods for Convolution with a separable kernel\n";
+      Array<3,float> separable_kernel(IndexRange3D(-1,1,-2,2,-3,2));
+      for (int k=-1; k<=1; ++k)
+        for (int j=-2; j<=2; ++j)
+          for (int i=-3; i<=2; ++i)
+            separable_kernel[k][j][i] = (1.F+k*k)*(3.F-j)*(i+4.F);
+      Array<3,float> varying_test(test_neg_offset);
+      {
+        Array<3,float>::full_iterator iter = varying_test.begin_all();
+        for (int i=-100; iter != varying_test.end_all(); ++i, ++iter)
+          *iter = i*i*.02F-i+10.F;
+      }
+      ArrayFilter3DUsingConvolution<float> conv_filter_auto(separable_kernel);
+      check(conv_filter_auto.kernel_is_separable(), "separable kernel should be detected");
+      ArrayFilter3DUsingConvolution<float> conv_filter_direct(separable_kernel);
+      conv_filter_direct.set_method(ArrayFilter3DUsingConvolution<float>::direct);
+      ArrayFilter3DUsingConvolution<float> conv_filter_DFT(separable_kernel);
+      conv_filter_DFT.set_method(ArrayFilter3DUsingConvolution<float>::DFT);
+      set_tolerance(varying_test.find_max()*separable_kernel.sum()*1.E-6);
+      compare_results_2arg(conv_filter_direct, conv_filter_auto, varying_test);
+      compare_results_1arg(conv_filter_direct, conv_filter_auto, varying_test);
+      compare_results_2arg(conv_filter_direct, conv_filter_DFT, varying_test);
+      compare_results_1arg(conv_filter_direct, conv_filter_DFT, varying_test);
+    }
+    {
+      std::cerr <<"Comparing median, minimal and maximal filters with a straightforward implementation\n";
+      Array<3,float> test(IndexRange3D(-2,6,1,10,-4,8));
+      Array<3,float>::full_iterator iter = test.begin_all();
+      for (int i=0; iter != test.end_all(); ++i, ++iter)
+        *iter = static_cast<float>((i*7919)%101) - 30.F;
+      test_rank_filters(test, Coordinate3D<int>(1,1,1));
+      test_rank_filters(test, Coordinate3D<int>(2,1,3));
+      test_rank_filters(test, Coordinate3D<int>(0,2,0));
+      test_rank_filters(test, Coordinate3D<int>(5,6,7));
+    }
+    {
+      std::cerr <<"Timings of the median filter\n";
+      Array<3,float> test(IndexRange3D(0,31,-32,31,-32,31));
+      Array<3,float>::full_iterator iter = test.begin_all();
+      for (int i=0; iter != test.end_all(); ++i, ++iter)
+        *iter = static_cast<float>((i*7919)%1009)*.1F + static_cast<float>(i%64);
+      time_median_filter(test, Coordinate3D<int>(1,1,1));
+      time_median_filter(test, Coordinate3D<int>(2,2,2));
+      time_median_filter(test, Coordinate3D<int>(3,3,3));
+      time_median_filter(test, Coordinate3D<int>(1,1,7));
     }
   }
 
@@ -60,6 +60,7 @@ public:
                                            const shared_ptr<ProjDataInfoBlocksOnCylindricalNoArcCorr> proj_data_info_ptr);
 private:
   void run_coordinate_test_for_flat_first_bucket();
+  void run_inverse_lookup_test();
 };
 
 float
@@ -179,6 +180,38 @@ DetectionPosMapTests::run_coordinate_test_for_flat_first_bucket()
 }
 
 
+/*!
+  Checks that find_detection_position_given_cartesian_coordinate() is the inverse of
+  get_coordinate_for_det_pos() for all crystals, also when slightly perturbing the coordinates.
+*/
+void
+DetectionPosMapTests::run_inverse_lookup_test()
+{
+    auto scanner_ptr=std::make_shared<Scanner> (Scanner::SAFIRDualRingPrototype);
+    scanner_ptr->set_scanner_geometry("BlocksOnCylindrical");
+    scanner_ptr->set_up();
+    shared_ptr<const DetectorCoordinateMap> map_sptr = scanner_ptr->get_detector_map_sptr();
+
+    const CartesianCoordinate3D<float> perturbation(.03F, -.02F, .04F);
+    bool all_ok = true;
+    DetectionPosition<> det_pos(0,0,0);
+    for (det_pos.axial_coord()=0; det_pos.axial_coord()<map_sptr->get_num_axial_coords(); ++det_pos.axial_coord())
+      for (det_pos.tangential_coord()=0; det_pos.tangential_coord()<map_sptr->get_num_tangential_coords(); ++det_pos.tangential_coord())
+        {
+          const CartesianCoordinate3D<float> coord = map_sptr->get_coordinate_for_det_pos(det_pos);
+          DetectionPosition<> found_det_pos, found_det_pos_perturbed;
+          all_ok &= map_sptr->find_detection_position_given_cartesian_coordinate(found_det_pos, coord) == Succeeded::yes;
+          all_ok &= found_det_pos == det_pos;
+          all_ok &= map_sptr->find_detection_position_given_cartesian_coordinate(found_det_pos_perturbed, coord + perturbation) == Succeeded::yes;
+          all_ok &= found_det_pos_perturbed == det_pos;
+        }
+    check(all_ok, "inverse look-up of all crystals");
+
+    DetectionPosition<> det_pos_not_found;
+    check(map_sptr->find_detection_position_given_cartesian_coordinate(det_pos_not_found, CartesianCoordinate3D<float>(0.F,0.F,0.F))
+          == Succeeded::no, "inverse look-up of the centre of the scanner should fail");
+}
+
 void
 DetectionPosMapTests::
 run_tests()
@@ -186,6 +219,7 @@ run_tests()
     
     std::cerr << "-------- Testing DetectorCoordinateMap --------\n";
     run_coordinate_test_for_flat_first_bucket();
+    run_inverse_lookup_test();
 }
 END_NAMESPACE_STIR
 
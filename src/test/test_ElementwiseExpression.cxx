@@ -0,0 +1,135 @@
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup test
+
+  \brief Test program for stir::ElementwiseExpression
+
+  \author agent
+*/
+
+#include "stir/ElementwiseExpression.h"
+#include "stir/RunTests.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for ElementwiseExpression
+*/
+class ElementwiseExpressionTests : public RunTests
+{
+public:
+  void run_tests();
+
+private:
+  //! check that parsing \a str fails
+  void check_parse_error(const std::string& str);
+};
+
+void
+ElementwiseExpressionTests::check_parse_error(const std::string& str)
+{
+  try
+    {
+      ElementwiseExpression expression(str);
+      check(false, "parsing '" + str + "' should fail");
+    }
+  catch (...)
+    {
+      // ok, error() throws an exception
+    }
+}
+
+void
+ElementwiseExpressionTests::run_tests()
+{
+  std::cerr << "Tests for ElementwiseExpression\n";
+
+  std::vector<float> inputs(3);
+  inputs[0] = 2.F; inputs[1] = 3.F; inputs[2] = -1.5F;
+
+  std::cerr << "\tTests on single elements\n";
+  check_if_equal(ElementwiseExpression("4.5").evaluate(inputs), 4.5, "constant");
+  check_if_equal(ElementwiseExpression("1e-1").evaluate(inputs), 0.1, "constant with exponent");
+  check_if_equal(ElementwiseExpression("a+b*c").evaluate(inputs), 2. + 3.*-1.5, "precedence of * and +");
+  check_if_equal(ElementwiseExpression("(a+b)*c").evaluate(inputs), (2. + 3.)*-1.5, "parentheses");
+  check_if_equal(ElementwiseExpression("a-b-c").evaluate(inputs), 2. - 3. + 1.5, "- is left-associative");
+  check_if_equal(ElementwiseExpression("a/b/a").evaluate(inputs), 2./3./2., "/ is left-associative");
+  check_if_equal(ElementwiseExpression("a^b^a").evaluate(inputs), std::pow(2., 9.), "^ is right-associative");
+  check_if_equal(ElementwiseExpression("-a^2").evaluate(inputs), -4., "unary minus and ^");
+  check_if_equal(ElementwiseExpression("a^-1").evaluate(inputs), .5, "^ with negative exponent");
+  check_if_equal(ElementwiseExpression(" ( a * b + c ) ^ 2 ").evaluate(inputs), std::pow(2.*3. - 1.5, 2.), "spaces");
+  check_if_equal(ElementwiseExpression("min(max(c,0),1)").evaluate(inputs), 0., "thresholding");
+  check_if_equal(ElementwiseExpression("max(min(b,2.5),-1)").evaluate(inputs), 2.5, "thresholding");
+  check_if_equal(ElementwiseExpression("exp(log(b))").evaluate(inputs), 3., "exp and log");
+  check_if_equal(ElementwiseExpression("sqrt(abs(c*b))").evaluate(inputs), std::sqrt(4.5), "sqrt and abs");
+  check_if_equal(ElementwiseExpression("c").get_num_inputs(), 3, "number of inputs");
+  check_if_equal(ElementwiseExpression("b*2").get_num_inputs(), 2, "number of inputs");
+  check_if_equal(ElementwiseExpression("2").get_num_inputs(), 0, "number of inputs");
+
+  std::cerr << "\tTests on invalid expressions\n";
+  check_parse_error("");
+  check_parse_error("a+");
+  check_parse_error("(a+b");
+  check_parse_error("a+b)");
+  check_parse_error("2a");
+  check_parse_error("foo(a)");
+  check_parse_error("min(a)");
+  check_parse_error("A");
+  check_parse_error("a$b");
+
+  std::cerr << "\tTests on arrays\n";
+  {
+    // use a size that is not a multiple of the internal block size
+    const std::size_t size = 1000;
+    std::vector<float> a(size), b(size), output(size);
+    for (std::size_t i = 0; i < size; ++i)
+      {
+        a[i] = static_cast<float>(i)/10.F - 20.F;
+        b[i] = static_cast<float>(i % 7) + 1.F;
+      }
+    const ElementwiseExpression expression("min(max((a*b + 3)^2, 1), 1000)/b");
+    std::vector<const float *> input_ptrs(2);
+    input_ptrs[0] = &a[0];
+    input_ptrs[1] = &b[0];
+    expression.evaluate(&output[0], input_ptrs, size);
+    for (std::size_t i = 0; i < size; ++i)
+      {
+        const float expected =
+          std::min(std::max(std::pow(a[i]*b[i] + 3.F, 2.F), 1.F), 1000.F)/b[i];
+        if (!check_if_equal(output[i], expected, "compound expression on an array"))
+          break;
+      }
+
+    // in-place evaluation
+    const ElementwiseExpression in_place_expression("a*b - a");
+    std::vector<float> a_copy(a);
+    input_ptrs[0] = &a_copy[0];
+    in_place_expression.evaluate(&a_copy[0], input_ptrs, size);
+    for (std::size_t i = 0; i < size; ++i)
+      if (!check_if_equal(a_copy[i], a[i]*b[i] - a[i], "in-place evaluation"))
+        break;
+  }
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int main()
+{
+  ElementwiseExpressionTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
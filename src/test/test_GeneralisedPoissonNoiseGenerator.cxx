@@ -20,6 +20,10 @@
 #include "stir/RunTests.h"
 #include "stir/Array.h"
 #include "stir/GeneralisedPoissonNoiseGenerator.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics.hpp>
 #include <boost/format.hpp>
@@ -32,13 +36,16 @@ START_NAMESPACE_STIR
 /*!
   \brief Tests GeneralisedPoissonNoiseGenerator functionality
   \ingroup test
-  Currently contains only simple tests to check mean and variance.
+  Currently contains only simple tests to check mean and variance, and
+  reproducibility of noise realisations of projection data.
 */
 class GeneralisedPoissonNoiseGeneratorTests : public RunTests
 {
 private:
   void
   run_one_test(const int size, const float mu, const float scaling_factor, const bool preserve_mean);
+  void
+  run_tests_for_proj_data();
     
 public:
   void run_tests();
@@ -75,6 +82,64 @@ run_one_test(const int size, const float mu, const float scaling_factor, const b
   check_if_equal(variance(acc), actual_variance, "test variance with " + formatter.str());
 }
 
+void
+GeneralisedPoissonNoiseGeneratorTests::
+run_tests_for_proj_data()
+{
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E953));
+  shared_ptr<ProjDataInfo> proj_data_info_sptr(
+    ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                  /*span*/3, 2,/*views*/ 32, /*tang_pos*/32, /*arc_corrected*/ false));
+  shared_ptr<ExamInfo> exam_info_sptr(new ExamInfo);
+  const float mu = 10.F;
+  ProjDataInMemory input(exam_info_sptr, proj_data_info_sptr);
+  input.fill(mu);
+
+  ProjDataInMemory output(exam_info_sptr, proj_data_info_sptr);
+  ProjDataInMemory output_again(exam_info_sptr, proj_data_info_sptr);
+  ProjDataInMemory output_reproduced(exam_info_sptr, proj_data_info_sptr);
+  std::vector<shared_ptr<ProjDataInMemory> > outputs;
+  std::vector<shared_ptr<ProjData> > output_sptrs;
+  for (int r=0; r<2; ++r)
+    {
+      outputs.push_back(shared_ptr<ProjDataInMemory>(new ProjDataInMemory(exam_info_sptr, proj_data_info_sptr)));
+      output_sptrs.push_back(outputs[r]);
+    }
+
+  {
+    GeneralisedPoissonNoiseGenerator generator;
+    generator.seed(7);
+    generator.generate_random(output, input);
+    // second call has to give a new realisation
+    generator.generate_random(output_again, input);
+  }
+  {
+    GeneralisedPoissonNoiseGenerator generator;
+    generator.seed(7);
+    generator.generate_random(output_reproduced, input);
+  }
+  {
+    GeneralisedPoissonNoiseGenerator generator;
+    generator.seed(7);
+    generator.generate_random(output_sptrs, input);
+  }
+  check(std::equal(output.begin_all(), output.end_all(), output_reproduced.begin_all()),
+        "projection data noise has to be reproducible for the same seed");
+  check(!std::equal(output.begin_all(), output.end_all(), output_again.begin_all()),
+        "subsequent calls have to give different realisations");
+  check(std::equal(output.begin_all(), output.end_all(), outputs[0]->begin_all()),
+        "first realisation has to be equal to the single realisation");
+  check(!std::equal(outputs[0]->begin_all(), outputs[0]->end_all(), outputs[1]->begin_all()),
+        "different realisations have to be different");
+
+  using namespace boost::accumulators;
+  accumulator_set< float, features< tag::variance, tag::mean > > acc;
+  acc = std::for_each( outputs[1]->begin_all(), outputs[1]->end_all(), acc );
+  set_tolerance(.03);
+  check_if_equal(mean(acc), mu, "test mean of projection data noise");
+  check_if_equal(variance(acc), mu, "test variance of projection data noise");
+}
+
 void
 GeneralisedPoissonNoiseGeneratorTests::run_tests()
 {
@@ -88,6 +153,8 @@ GeneralisedPoissonNoiseGeneratorTests::run_tests()
   run_one_test(1000, 4.2F, 1.0F, true);
   run_one_test(1000, 4.2F, 3.0F, true);
   run_one_test(1000, 4.2F, 3.0F, false);
+
+  run_tests_for_proj_data();
 }
 
 END_NAMESPACE_STIR
@@ -28,6 +28,8 @@
 #include "stir/IndexRange2D.h"
 #include "stir/numerics/norm.h"
 #include "stir/num_threads.h"
+#include "stir/HighResWallClockTimer.h"
+#include "stir/CPUTimer.h"
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
@@ -45,6 +47,8 @@ public:
   void run_tests();
 protected:  
   void test_proj_data_info(shared_ptr<const ProjDataInfoCylindricalNoArcCorr> proj_data_info_sptr);
+  //! estimate efficiencies for synthetic data of a uniform cylinder, and report timings
+  void test_iterate_efficiencies(shared_ptr<const ProjDataInfoCylindricalNoArcCorr> proj_data_info_sptr);
 };
 
 void
@@ -60,6 +64,7 @@ ML_normTests::run_tests()
                                                                                        /*tang_pos*/64, 
                                                                                        /*arc_corrected*/ false));
     test_proj_data_info(dynamic_pointer_cast<ProjDataInfoCylindricalNoArcCorr>(proj_data_info_sptr));
+    test_iterate_efficiencies(dynamic_pointer_cast<ProjDataInfoCylindricalNoArcCorr>(proj_data_info_sptr));
   }
   {
     std::cerr << "\n-------- Testing ECAT E1080 (with gaps) --------\n";
@@ -164,6 +169,64 @@ test_proj_data_info(shared_ptr<const ProjDataInfoCylindricalNoArcCorr> proj_data
   }
 }
 
+void
+ML_normTests::
+test_iterate_efficiencies(shared_ptr<const ProjDataInfoCylindricalNoArcCorr> proj_data_info_sptr)
+{
+  // model for a uniform cylinder without attenuation: all LORs have the same value
+  auto exam_info_sptr = std::make_shared<ExamInfo>();
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+  proj_data.fill(1.F);
+
+  FanProjData model_fan_data;
+  make_fan_data_remove_gaps(model_fan_data, proj_data);
+  const int num_rings = model_fan_data.get_num_rings();
+  const int num_detectors_per_ring = model_fan_data.get_num_detectors_per_ring();
+
+  // "measured" data: model with some known efficiencies
+  DetectorEfficiencies true_efficiencies(IndexRange2D(num_rings, num_detectors_per_ring));
+  for (int ra = 0; ra < num_rings; ++ra)
+    for (int a = 0; a < num_detectors_per_ring; ++a)
+      true_efficiencies[ra][a] = 1.F + .2F*static_cast<float>(sin(a*.3 + ra*.7));
+  FanProjData measured_fan_data = model_fan_data;
+  apply_efficiencies(measured_fan_data, true_efficiencies);
+
+  Array<2,float> data_fan_sums(IndexRange2D(num_rings, num_detectors_per_ring));
+  make_fan_sum_data(data_fan_sums, measured_fan_data);
+
+  DetectorEfficiencies efficiencies(IndexRange2D(num_rings, num_detectors_per_ring));
+  efficiencies.fill(sqrt(data_fan_sums.sum()/model_fan_data.sum()));
+
+  HighResWallClockTimer wall_clock_timer;
+  CPUTimer cpu_timer;
+  wall_clock_timer.start();
+  cpu_timer.start();
+  const int num_eff_iterations = 30;
+  for (int eff_iter_num = 1; eff_iter_num <= num_eff_iterations; ++eff_iter_num)
+    iterate_efficiencies(efficiencies, data_fan_sums, model_fan_data);
+  wall_clock_timer.stop();
+  cpu_timer.stop();
+  std::cerr << "Timing for " << num_eff_iterations << " efficiency iterations: wall-clock "
+            << wall_clock_timer.value() << "s, CPU " << cpu_timer.value() << "s\n";
+
+  {
+    FanProjData fan_data = model_fan_data;
+    wall_clock_timer.reset(); wall_clock_timer.start();
+    apply_efficiencies(fan_data, efficiencies);
+    const double KL_value = KL(measured_fan_data, fan_data, 0.);
+    wall_clock_timer.stop();
+    std::cerr << "Timing for apply_efficiencies and KL: wall-clock " << wall_clock_timer.value() << "s\n";
+    check(KL_value >= 0, "KL should be non-negative");
+    check_if_zero(KL_value/measured_fan_data.sum(), "KL after efficiency estimation");
+  }
+  {
+    const double old_tolerance = get_tolerance();
+    set_tolerance(.01);
+    check_if_equal(efficiencies, true_efficiencies, "estimated efficiencies for cylinder");
+    set_tolerance(old_tolerance);
+  }
+}
+
 END_NAMESPACE_STIR
 
 
@@ -0,0 +1,236 @@
+/*
+    Copyright (C) 2026, agent
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup test
+  \ingroup projdata
+
+  \brief Test program for stir::SSRB and stir::inverse_SSRB
+
+  The results are compared with straightforward implementations that handle one sinogram at a time.
+
+  \author agent
+*/
+
+#include "stir/SSRB.h"
+#include "stir/inverse_SSRB.h"
+#include "stir/RunTests.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataInfoCylindrical.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/SegmentBySinogram.h"
+#include "stir/Sinogram.h"
+#include "stir/Bin.h"
+#include "stir/Succeeded.h"
+#include <boost/format.hpp>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for SSRB and inverse_SSRB
+*/
+class SSRBTests : public RunTests
+{
+public:
+  void run_tests();
+
+private:
+  //! fill with values that differ for every bin
+  static void fill_non_uniform(ProjData& proj_data);
+  //! SSRB, one output sinogram at a time
+  static void SSRB_sinogram_by_sinogram(ProjData& out_proj_data, const ProjData& in_proj_data, const bool do_norm);
+  //! inverse_SSRB, one output sinogram at a time
+  static void inverse_SSRB_sinogram_by_sinogram(ProjData& proj_data_4D, const ProjData& proj_data_3D);
+
+  void check_if_equal_proj_data(const ProjData& proj_data, const ProjData& reference, const std::string& str);
+};
+
+void
+SSRBTests::fill_non_uniform(ProjData& proj_data)
+{
+  for (int segment_num = proj_data.get_min_segment_num(); segment_num <= proj_data.get_max_segment_num(); ++segment_num)
+    {
+      SegmentBySinogram<float> segment = proj_data.get_empty_segment_by_sinogram(segment_num);
+      for (int ax_pos_num = segment.get_min_axial_pos_num(); ax_pos_num <= segment.get_max_axial_pos_num(); ++ax_pos_num)
+        for (int view_num = segment.get_min_view_num(); view_num <= segment.get_max_view_num(); ++view_num)
+          for (int tangential_pos_num = segment.get_min_tangential_pos_num();
+               tangential_pos_num <= segment.get_max_tangential_pos_num();
+               ++tangential_pos_num)
+            segment[ax_pos_num][view_num][tangential_pos_num] =
+              100.F + 10*segment_num + ax_pos_num + .5F*(view_num % 5) + .1F*tangential_pos_num;
+      proj_data.set_segment(segment);
+    }
+}
+
+void
+SSRBTests::SSRB_sinogram_by_sinogram(ProjData& out_proj_data, const ProjData& in_proj_data, const bool do_norm)
+{
+  const ProjDataInfoCylindrical& in_info =
+    dynamic_cast<const ProjDataInfoCylindrical&>(*in_proj_data.get_proj_data_info_sptr());
+  const ProjDataInfoCylindrical& out_info =
+    dynamic_cast<const ProjDataInfoCylindrical&>(*out_proj_data.get_proj_data_info_sptr());
+  const int num_views_to_combine = in_proj_data.get_num_views()/out_proj_data.get_num_views();
+  const int min_tangential_pos_num =
+    std::max(in_proj_data.get_min_tangential_pos_num(), out_proj_data.get_min_tangential_pos_num());
+  const int max_tangential_pos_num =
+    std::min(in_proj_data.get_max_tangential_pos_num(), out_proj_data.get_max_tangential_pos_num());
+
+  for (int out_segment_num = out_proj_data.get_min_segment_num(); out_segment_num <= out_proj_data.get_max_segment_num(); ++out_segment_num)
+    for (int out_ax_pos_num = out_proj_data.get_min_axial_pos_num(out_segment_num);
+         out_ax_pos_num <= out_proj_data.get_max_axial_pos_num(out_segment_num);
+         ++out_ax_pos_num)
+      {
+        Sinogram<float> out_sino = out_proj_data.get_empty_sinogram(out_ax_pos_num, out_segment_num);
+        const float out_m = out_info.get_m(Bin(out_segment_num, 0, out_ax_pos_num, 0));
+        int num_in_ax_pos = 0;
+        for (int in_segment_num = in_proj_data.get_min_segment_num(); in_segment_num <= in_proj_data.get_max_segment_num(); ++in_segment_num)
+          {
+            if (in_info.get_min_ring_difference(in_segment_num) < out_info.get_min_ring_difference(out_segment_num) ||
+                in_info.get_max_ring_difference(in_segment_num) > out_info.get_max_ring_difference(out_segment_num))
+              continue;
+            for (int in_ax_pos_num = in_proj_data.get_min_axial_pos_num(in_segment_num);
+                 in_ax_pos_num <= in_proj_data.get_max_axial_pos_num(in_segment_num);
+                 ++in_ax_pos_num)
+              {
+                if (std::fabs(in_info.get_m(Bin(in_segment_num, 0, in_ax_pos_num, 0)) - out_m) > 1E-4)
+                  continue;
+                ++num_in_ax_pos;
+                const Sinogram<float> in_sino = in_proj_data.get_sinogram(in_ax_pos_num, in_segment_num);
+                for (int in_view_num = in_sino.get_min_view_num(); in_view_num <= in_sino.get_max_view_num(); ++in_view_num)
+                  for (int tangential_pos_num = min_tangential_pos_num; tangential_pos_num <= max_tangential_pos_num; ++tangential_pos_num)
+                    out_sino[in_view_num/num_views_to_combine][tangential_pos_num] += in_sino[in_view_num][tangential_pos_num];
+              }
+          }
+        if (do_norm && num_in_ax_pos != 0)
+          out_sino /= static_cast<float>(num_in_ax_pos*num_views_to_combine);
+        out_proj_data.set_sinogram(out_sino);
+      }
+}
+
+void
+SSRBTests::inverse_SSRB_sinogram_by_sinogram(ProjData& proj_data_4D, const ProjData& proj_data_3D)
+{
+  const ProjDataInfo& info_3D = *proj_data_3D.get_proj_data_info_sptr();
+  const ProjDataInfo& info_4D = *proj_data_4D.get_proj_data_info_sptr();
+  for (int out_segment_num = proj_data_4D.get_min_segment_num(); out_segment_num <= proj_data_4D.get_max_segment_num(); ++out_segment_num)
+    for (int out_ax_pos_num = proj_data_4D.get_min_axial_pos_num(out_segment_num);
+         out_ax_pos_num <= proj_data_4D.get_max_axial_pos_num(out_segment_num);
+         ++out_ax_pos_num)
+      {
+        Sinogram<float> sino_4D = proj_data_4D.get_empty_sinogram(out_ax_pos_num, out_segment_num);
+        const float out_m = info_4D.get_m(Bin(out_segment_num, 0, out_ax_pos_num, 0));
+        for (int in_ax_pos_num = proj_data_3D.get_min_axial_pos_num(0); in_ax_pos_num <= proj_data_3D.get_max_axial_pos_num(0); ++in_ax_pos_num)
+          {
+            const float in_m = info_3D.get_m(Bin(0, 0, in_ax_pos_num, 0));
+            if (std::fabs(out_m - in_m) < 1E-2)
+              {
+                sino_4D += proj_data_3D.get_sinogram(in_ax_pos_num, 0);
+                break;
+              }
+            if (in_ax_pos_num < proj_data_3D.get_max_axial_pos_num(0) &&
+                std::fabs(out_m - .5F*(in_m + info_3D.get_m(Bin(0, 0, in_ax_pos_num+1, 0)))) < 1E-2)
+              {
+                sino_4D += proj_data_3D.get_sinogram(in_ax_pos_num, 0);
+                sino_4D += proj_data_3D.get_sinogram(in_ax_pos_num+1, 0);
+                sino_4D *= .5F;
+                break;
+              }
+          }
+        proj_data_4D.set_sinogram(sino_4D);
+      }
+}
+
+void
+SSRBTests::check_if_equal_proj_data(const ProjData& proj_data, const ProjData& reference, const std::string& str)
+{
+  for (int segment_num = reference.get_min_segment_num(); segment_num <= reference.get_max_segment_num(); ++segment_num)
+    {
+      const SegmentBySinogram<float> segment = proj_data.get_segment_by_sinogram(segment_num);
+      const SegmentBySinogram<float> reference_segment = reference.get_segment_by_sinogram(segment_num);
+      if (!check_if_equal(segment, reference_segment, boost::str(boost::format("%1%: segment %2%") % str % segment_num)))
+        return;
+    }
+}
+
+void
+SSRBTests::run_tests()
+{
+  std::cerr << "Tests for SSRB and inverse_SSRB\n";
+
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E953));
+  shared_ptr<ExamInfo> exam_info_sptr(new ExamInfo);
+  shared_ptr<ProjDataInfo> in_proj_data_info_sptr(
+    ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                  /*span*/1, /*max_delta*/ 5, /*views*/ 24, /*tang_pos*/ 20, /*arc_corrected*/ false));
+  ProjDataInMemory in_proj_data(exam_info_sptr, in_proj_data_info_sptr);
+  fill_non_uniform(in_proj_data);
+
+  {
+    std::cerr << "\tSSRB of span 1 data\n";
+    // combine 3 segments and 2 views, and trim the tangential positions
+    shared_ptr<ProjDataInfo> out_proj_data_info_sptr(SSRB(*in_proj_data_info_sptr, 3, 2, 2));
+    ProjDataInMemory out_proj_data(exam_info_sptr, out_proj_data_info_sptr);
+    ProjDataInMemory reference_proj_data(exam_info_sptr, out_proj_data_info_sptr);
+    for (int do_norm = 0; do_norm <= 1; ++do_norm)
+      {
+        SSRB(out_proj_data, in_proj_data, do_norm != 0);
+        SSRB_sinogram_by_sinogram(reference_proj_data, in_proj_data, do_norm != 0);
+        check_if_equal_proj_data(out_proj_data, reference_proj_data,
+                                 do_norm ? "SSRB with normalisation" : "SSRB without normalisation");
+      }
+
+    // with normalisation, uniform data has to stay uniform
+    ProjDataInMemory uniform_proj_data(exam_info_sptr, in_proj_data_info_sptr);
+    uniform_proj_data.fill(2.F);
+    SSRB(out_proj_data, uniform_proj_data, true);
+    check_if_equal(*std::min_element(out_proj_data.begin_all(), out_proj_data.end_all()), 2.F,
+                   "SSRB of uniform data: minimum");
+    check_if_equal(*std::max_element(out_proj_data.begin_all(), out_proj_data.end_all()), 2.F,
+                   "SSRB of uniform data: maximum");
+  }
+  {
+    std::cerr << "\tSSRB to 2D data\n";
+    shared_ptr<ProjDataInfo> out_proj_data_info_sptr(SSRB(*in_proj_data_info_sptr, in_proj_data.get_num_segments(), 1));
+    ProjDataInMemory out_proj_data(exam_info_sptr, out_proj_data_info_sptr);
+    ProjDataInMemory reference_proj_data(exam_info_sptr, out_proj_data_info_sptr);
+    SSRB(out_proj_data, in_proj_data);
+    SSRB_sinogram_by_sinogram(reference_proj_data, in_proj_data, true);
+    check_if_equal_proj_data(out_proj_data, reference_proj_data, "SSRB to 2D");
+  }
+  {
+    std::cerr << "\tinverse_SSRB\n";
+    // only direct sinograms, such that sinograms with odd ring differences need averaging
+    shared_ptr<ProjDataInfo> proj_data_info_3D_sptr(
+      ProjDataInfo::ProjDataInfoCTI(scanner_sptr,
+                                    /*span*/1, /*max_delta*/ 0, /*views*/ 24, /*tang_pos*/ 20, /*arc_corrected*/ false));
+    ProjDataInMemory proj_data_3D(exam_info_sptr, proj_data_info_3D_sptr);
+    fill_non_uniform(proj_data_3D);
+    ProjDataInMemory proj_data_4D(exam_info_sptr, in_proj_data_info_sptr);
+    ProjDataInMemory reference_proj_data(exam_info_sptr, in_proj_data_info_sptr);
+    check(inverse_SSRB(proj_data_4D, proj_data_3D) == Succeeded::yes, "inverse_SSRB return value");
+    inverse_SSRB_sinogram_by_sinogram(reference_proj_data, proj_data_3D);
+    check_if_equal_proj_data(proj_data_4D, reference_proj_data, "inverse_SSRB");
+  }
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int main()
+{
+  SSRBTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -34,6 +34,7 @@
 #include <iostream>
 #include <math.h>
 #include <algorithm>
+#include <vector>
 #include "stir/RunTests.h"
 
 using std::cerr;
@@ -352,6 +353,70 @@ VoxelsOnCartesianGridTests::run_tests()
                      ffp_image.get_LPS_coordinates_for_indices(indices)),
                    "FFP inverse consistency");
   }
+
+  {
+    cerr << "Tests on contiguous storage\n";
+
+    VoxelsOnCartesianGrid<float> image(range, origin, grid_spacing);
+    {
+      float value = 1.F;
+      for (VoxelsOnCartesianGrid<float>::full_iterator iter = image.begin_all();
+           iter != image.end_all(); ++iter, value += 1.F)
+        *iter = value;
+    }
+    const Array<3,float> org_array = image;
+    check(image.get_contiguous_data_ptr() == 0, "image should not be contiguous by default");
+
+    image.make_contiguous();
+    check(image.is_contiguous(), "is_contiguous() after make_contiguous()");
+    check_if_equal(static_cast<const Array<3,float>&>(image), org_array, "values after make_contiguous()");
+    const float* data_ptr = image.get_contiguous_data_ptr();
+    check(data_ptr != 0, "get_contiguous_data_ptr() after make_contiguous()");
+    if (data_ptr != 0)
+      {
+        const int z = 2, y = -3, x = 7;
+        check_if_equal(data_ptr[((z - image.get_min_z())*image.get_y_size() + y - image.get_min_y())*image.get_x_size()
+                                + x - image.get_min_x()],
+                       image[z][y][x], "offset in contiguous data");
+      }
+
+    shared_ptr<VoxelsOnCartesianGrid<float> > copy_sptr(image.clone());
+    check(copy_sptr->get_contiguous_data_ptr() != 0, "clone() of contiguous image should be contiguous");
+    check(copy_sptr->get_contiguous_data_ptr() != data_ptr, "clone() of contiguous image should use new memory");
+    check_if_equal(static_cast<const Array<3,float>&>(*copy_sptr), org_array, "values of clone() of contiguous image");
+    shared_ptr<VoxelsOnCartesianGrid<float> > empty_copy_sptr(image.get_empty_copy());
+    check(empty_copy_sptr->get_contiguous_data_ptr() != 0, "get_empty_copy() of contiguous image should be contiguous");
+    check_if_zero(*empty_copy_sptr, "get_empty_copy() of contiguous image should be zero");
+
+    *empty_copy_sptr = image;
+    check(empty_copy_sptr->get_contiguous_data_ptr() != 0, "assigning to contiguous image should keep it contiguous");
+    check_if_equal(static_cast<const Array<3,float>&>(*empty_copy_sptr), org_array, "values after assignment");
+
+    image.grow_z_range(image.get_min_z(), image.get_max_z() + 1);
+    check(image.get_contiguous_data_ptr() == 0, "image should not be contiguous after grow_z_range()");
+    check_if_equal(image[2], org_array[2], "values after grow_z_range() on contiguous image");
+    image.make_contiguous();
+    check(image.get_contiguous_data_ptr() != 0, "make_contiguous() after grow_z_range()");
+    check_if_equal(image[2], org_array[2], "values after grow_z_range() and make_contiguous()");
+
+    // use existing memory
+    VoxelsOnCartesianGrid<float> existing_data_image(range, origin, grid_spacing);
+    std::vector<float> existing_data(org_array.begin_all(), org_array.end_all());
+    existing_data_image.use_existing_contiguous_data(&existing_data[0]);
+    check(existing_data_image.get_contiguous_data_ptr() == &existing_data[0],
+          "get_contiguous_data_ptr() after use_existing_contiguous_data()");
+    check_if_equal(static_cast<const Array<3,float>&>(existing_data_image), org_array,
+                   "values after use_existing_contiguous_data()");
+    existing_data_image[2][-3][7] = -1.F;
+    check_if_equal(existing_data[((2 - existing_data_image.get_min_z())*existing_data_image.get_y_size()
+                                  - 3 - existing_data_image.get_min_y())*existing_data_image.get_x_size()
+                                 + 7 - existing_data_image.get_min_x()],
+                   -1.F, "modifying an image that uses existing memory");
+    shared_ptr<VoxelsOnCartesianGrid<float> > existing_data_copy_sptr(existing_data_image.clone());
+    check(existing_data_copy_sptr->get_contiguous_data_ptr() != 0 &&
+          existing_data_copy_sptr->get_contiguous_data_ptr() != &existing_data[0],
+          "clone() of image using existing memory should be contiguous and use new memory");
+  }
 }
 
 END_NAMESPACE_STIR
@@ -255,6 +255,22 @@ run_tests()
   run_tests_on_proj_data(proj_data_in_memory);
   run_tests_in_memory_only(proj_data_in_memory);
 
+  std::cerr << "\n-----------------Repeating tests but now with existing memory\n";
+  {
+    std::vector<float> existing_data(proj_data_in_memory.size_all());
+    copy_to(proj_data_in_memory, existing_data.begin());
+    ProjDataInMemory proj_data_existing_memory(exam_info_sptr, proj_data_info_sptr, &existing_data[0]);
+    check(proj_data_existing_memory.get_const_data_ptr() == &existing_data[0],
+          "constructor with existing memory should use that memory");
+    proj_data_existing_memory.release_const_data_ptr();
+    check_if_equal(proj_data_existing_memory.get_sinogram(0,0), proj_data_in_memory.get_sinogram(0,0),
+                   "constructor with existing memory should use its values");
+    run_tests_on_proj_data(proj_data_existing_memory);
+    run_tests_in_memory_only(proj_data_existing_memory);
+    check_if_equal(*proj_data_existing_memory.begin_all(), existing_data[0],
+                   "ProjDataInMemory should modify the existing memory");
+  }
+
   std::cerr<< "\n-----------------Repeating tests but now with interfile input\n";
 
   ProjDataInterfile(exam_info_sptr, proj_data_info_sptr,
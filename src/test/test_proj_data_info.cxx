@@ -262,6 +262,70 @@ ProjDataInfoTests::test_generic_proj_data_info(ProjDataInfo& proj_data_info)
   cerr << "Max Deviation:  segment = " << max_diff_segment_num << ", axial pos " << max_diff_axial_pos_num
        << ", view = " << max_diff_view_num << ", tangential_pos_num = " << max_diff_tangential_pos_num << "\n";
 
+  cerr << "\tTests on get_LOR_endpoints\n";
+  {
+    const float radius = proj_data_info.get_scanner_ptr()->get_inner_ring_radius();
+    const bool org_cache_enabled = proj_data_info.get_LOR_endpoints_cache_enabled();
+    for (int cache_enabled = 0; cache_enabled <= 1; ++cache_enabled)
+      {
+        proj_data_info.set_LOR_endpoints_cache_enabled(cache_enabled != 0);
+        LORInAxialAndNoArcCorrSinogramCoordinates<float> lor;
+        LORAs2Points<float> lor_points;
+        for (int segment_num = proj_data_info.get_min_segment_num(); segment_num <= proj_data_info.get_max_segment_num();
+             segment_num += std::max(1, proj_data_info.get_num_segments() / 4))
+          for (int view_num = proj_data_info.get_min_view_num(); view_num <= proj_data_info.get_max_view_num();
+               view_num += std::max(1, proj_data_info.get_num_views() / 5))
+            {
+              // call twice to check that cached values are returned correctly
+              const shared_ptr<const LOREndPoints> first_end_points_sptr =
+                proj_data_info.get_LOR_endpoints(view_num, segment_num);
+              const shared_ptr<const LOREndPoints> end_points_sptr =
+                proj_data_info.get_LOR_endpoints(view_num, segment_num);
+              if (cache_enabled)
+                check(first_end_points_sptr == end_points_sptr, "get_LOR_endpoints: cache should not copy");
+              const LOREndPoints& end_points = *end_points_sptr;
+              if (!check_if_equal(end_points.size(),
+                                  static_cast<size_t>(proj_data_info.get_num_axial_poss(segment_num)
+                                                      * proj_data_info.get_num_tangential_poss()),
+                                  "get_LOR_endpoints: size"))
+                continue;
+              size_t index = 0;
+              Bin bin(segment_num, view_num, 0, 0);
+              for (bin.axial_pos_num() = proj_data_info.get_min_axial_pos_num(segment_num);
+                   bin.axial_pos_num() <= proj_data_info.get_max_axial_pos_num(segment_num); ++bin.axial_pos_num())
+                for (bin.tangential_pos_num() = proj_data_info.get_min_tangential_pos_num();
+                     bin.tangential_pos_num() <= proj_data_info.get_max_tangential_pos_num(); ++bin.tangential_pos_num(), ++index)
+                  {
+                    proj_data_info.get_LOR(lor, bin);
+                    lor.get_intersections_with_cylinder(lor_points, radius);
+                    const CartesianCoordinate3D<float> p1(end_points.z1[index], end_points.y1[index], end_points.x1[index]);
+                    const CartesianCoordinate3D<float> p2(end_points.z2[index], end_points.y2[index], end_points.x2[index]);
+                    if (!check_if_equal(p1, lor_points.p1(), "get_LOR_endpoints: first point")
+                        || !check_if_equal(p2, lor_points.p2(), "get_LOR_endpoints: second point"))
+                      cerr << "\tProblem at    segment = " << segment_num << ", axial pos " << bin.axial_pos_num()
+                           << ", view = " << view_num << ", tangential_pos_num = " << bin.tangential_pos_num()
+                           << ", cache enabled = " << cache_enabled << "\n";
+                  }
+            }
+      }
+    // check that the cache is invalidated when the size changes
+    {
+      shared_ptr<ProjDataInfo> smaller(proj_data_info.clone());
+      const shared_ptr<const LOREndPoints> org_end_points_sptr =
+        smaller->get_LOR_endpoints(smaller->get_min_view_num(), 0);
+      const std::size_t org_size = org_end_points_sptr->size();
+      smaller->set_min_tangential_pos_num(smaller->get_min_tangential_pos_num() + 1);
+      const shared_ptr<const LOREndPoints> end_points_sptr =
+        smaller->get_LOR_endpoints(smaller->get_min_view_num(), 0);
+      check_if_equal(org_end_points_sptr->size(), org_size,
+                     "get_LOR_endpoints: previously returned end-points should not change");
+      check_if_equal(end_points_sptr->size(),
+                     static_cast<size_t>(smaller->get_num_axial_poss(0) * smaller->get_num_tangential_poss()),
+                     "get_LOR_endpoints: size after changing the number of tangential positions");
+    }
+    proj_data_info.set_LOR_endpoints_cache_enabled(org_cache_enabled);
+  }
+
   // test on reduce_segment_range and operator>=
   {
     shared_ptr<ProjDataInfo> smaller(proj_data_info.clone());
@@ -174,6 +174,17 @@ stir_mathTests::run_tests()
       calc_data += (data1*data1 + data2*data2 + data3*data3)*3.2F;      
       check_if_equal( calc_data, *out_data_ptr,"test with power and scalar multiplication with --including-first");    
     }
+    // expression
+    if (run_stir_math("--expression \"max(a*b - c, 0)/2\" STIRtmpout.v STIRtmp1.hv STIRtmp2.hv STIRtmp3.hv"))
+    {
+      out_data_ptr = read_from_file<DiscretisedDensity<3,float> >("STIRtmpout.hv");
+      calc_data = data1;
+      calc_data *= data2;
+      calc_data -= data3;
+      threshold_lower(calc_data.begin_all(), calc_data.end_all(), 0.F);
+      calc_data /= 2.F;
+      check_if_equal( calc_data, *out_data_ptr,"test with --expression");
+    }
     // add with power etc and accumulate 
     if (run_stir_math("--accumulate --power 2 --times-scalar 3.2  --add-scalar 3.1 --divide-scalar 2.1 --mult STIRtmp1.hv STIRtmp3.hv"))
     {
@@ -303,6 +314,28 @@ stir_mathTests::run_tests()
       check_if_equal( calc_data, out_data_ptr->get_segment_by_view(0),
 		      "test with power and scalar multiplication with --including-first");    
     }
+    // add per sinogram
+    if (run_stir_math("-s --chunk sinogram STIRtmpout.hs STIRtmp1.hs STIRtmp2.hs STIRtmp3.hs"))
+    {
+      out_data_ptr = ProjData::read_from_file("STIRtmpout.hs");
+      calc_data = data1;
+      calc_data += data2 + data3;
+
+      check_if_equal( calc_data, out_data_ptr->get_segment_by_view(0),
+		      "test on adding with --chunk sinogram");
+    }
+    // expression
+    if (run_stir_math("-s --expression \"max(a*b - c, 0)/2\" STIRtmpout.hs STIRtmp1.hs STIRtmp2.hs STIRtmp3.hs"))
+    {
+      out_data_ptr = ProjData::read_from_file("STIRtmpout.hs");
+      calc_data = data1;
+      calc_data *= data2;
+      calc_data -= data3;
+      threshold_lower(calc_data.begin_all(), calc_data.end_all(), 0.F);
+      calc_data /= 2.F;
+      check_if_equal( calc_data, out_data_ptr->get_segment_by_view(0),
+		      "test with --expression");
+    }
     // add with power etc and accumulate 
     if (run_stir_math("-s --accumulate --power 2 --times-scalar 3.2 --divide-scalar 1.9 --add-scalar 3.1 --mult STIRtmp1.hs STIRtmp3.hs"))
     {
@@ -26,6 +26,7 @@
 #include "stir/spatial_transformation/GatedSpatialTransformation.h"
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 
 #ifndef STIR_NO_NAMESPACES
 using std::cerr;
@@ -160,6 +161,90 @@ warp_imageTests::run_tests()
     check_if_equal(accumulated_image[indices], 2.F, "testing the accumulated image at the original location of non-zero point");
     check_if_equal(accumulated_image[new_indices], 0.F, "testing the accumulated image at the location where the non-zero point had moved");
   }
+
+  std::cerr << "Tests for warping with precomputed coefficients and weights" << std::endl;
+  {
+    // use a smooth image and a non-uniform motion field with non-integer displacements
+    VoxelsOnCartesianGrid<float> smooth_image(range, origin, grid_spacing);
+    VoxelsOnCartesianGrid<float> smooth_motion_x(range, origin, grid_spacing);
+    VoxelsOnCartesianGrid<float> smooth_motion_y(range, origin, grid_spacing);
+    VoxelsOnCartesianGrid<float> smooth_motion_z(range, origin, grid_spacing);
+    BasicCoordinate<3,int> c;
+    for (c[1]=range.get_min_index(); c[1]<=range.get_max_index(); ++c[1])
+      for (c[2]=range[c[1]].get_min_index(); c[2]<=range[c[1]].get_max_index(); ++c[2])
+        for (c[3]=range[c[1]][c[2]].get_min_index(); c[3]<=range[c[1]][c[2]].get_max_index(); ++c[3])
+          {
+            smooth_image[c] = static_cast<float>(1 + std::sin(c[1]/3.) * std::cos(c[2]/5.) + c[3]/100.);
+            smooth_motion_x[c] = static_cast<float>(1.3*grid_spacing[3]*std::sin(c[1]/7.));
+            smooth_motion_y[c] = static_cast<float>(-.7*grid_spacing[2]*std::cos(c[3]/4.));
+            smooth_motion_z[c] = static_cast<float>(.4*grid_spacing[1]);
+          }
+    const shared_ptr<VoxelsOnCartesianGrid<float> > smooth_image_sptr(smooth_image.clone());
+    const shared_ptr<VoxelsOnCartesianGrid<float> > smooth_motion_x_sptr(smooth_motion_x.clone());
+    const shared_ptr<VoxelsOnCartesianGrid<float> > smooth_motion_y_sptr(smooth_motion_y.clone());
+    const shared_ptr<VoxelsOnCartesianGrid<float> > smooth_motion_z_sptr(smooth_motion_z.clone());
+    const VoxelsOnCartesianGrid<float> warped_image =
+      warp_image(smooth_image_sptr, smooth_motion_x_sptr, smooth_motion_y_sptr, smooth_motion_z_sptr, BSpline::linear, 0);
+    check(warped_image.find_max() > 0, "warped image should be non-zero");
+
+    const BSpline::BSplinesRegularGrid<3,float> interpolation(smooth_image, BSpline::linear);
+    VoxelsOnCartesianGrid<float> warped_image_with_coefficients(range, origin, grid_spacing);
+    warp_image(warped_image_with_coefficients, interpolation, smooth_motion_x, smooth_motion_y, smooth_motion_z);
+    check_if_equal(warped_image, warped_image_with_coefficients, "warping with precomputed coefficients");
+
+    const ImageWarpingWeights weights(smooth_motion_x, smooth_motion_y, smooth_motion_z, BSpline::linear);
+    VoxelsOnCartesianGrid<float> warped_image_with_weights(range, origin, grid_spacing);
+    weights.warp(warped_image_with_weights, interpolation);
+    check_if_equal(warped_image, warped_image_with_weights, "warping with precomputed weights");
+
+    // cubic B-splines
+    const VoxelsOnCartesianGrid<float> warped_image_cubic =
+      warp_image(smooth_image_sptr, smooth_motion_x_sptr, smooth_motion_y_sptr, smooth_motion_z_sptr, BSpline::cubic, 0);
+    const BSpline::BSplinesRegularGrid<3,float> cubic_interpolation(smooth_image, BSpline::cubic);
+    const ImageWarpingWeights cubic_weights(smooth_motion_x, smooth_motion_y, smooth_motion_z, BSpline::cubic);
+    cubic_weights.warp(warped_image_with_weights, cubic_interpolation);
+    check_if_equal(warped_image_cubic, warped_image_with_weights, "warping with precomputed weights for cubic B-splines");
+
+    // GatedSpatialTransformation with and without precomputed weights
+    const shared_ptr<VoxelsOnCartesianGrid<float> > warped_image_sptr(warped_image.clone());
+    GatedDiscretisedDensity smooth_gated_image(smooth_image_sptr,2);
+    smooth_gated_image.set_density_sptr(smooth_image_sptr,1);
+    smooth_gated_image.set_density_sptr(warped_image_sptr,2);
+    smooth_gated_image.set_time_gate_definitions(gate_defs);
+    GatedDiscretisedDensity gated_motion_x(image_sptr,2);
+    gated_motion_x.set_density_sptr(reverse_motion1_x_sptr,1);
+    gated_motion_x.set_density_sptr(smooth_motion_x_sptr,2);
+    gated_motion_x.set_time_gate_definitions(gate_defs);
+    GatedDiscretisedDensity gated_motion_y(image_sptr,2);
+    gated_motion_y.set_density_sptr(reverse_motion1_y_sptr,1);
+    gated_motion_y.set_density_sptr(smooth_motion_y_sptr,2);
+    gated_motion_y.set_time_gate_definitions(gate_defs);
+    GatedDiscretisedDensity gated_motion_z(image_sptr,2);
+    gated_motion_z.set_density_sptr(reverse_motion1_z_sptr,1);
+    gated_motion_z.set_density_sptr(smooth_motion_z_sptr,2);
+    gated_motion_z.set_time_gate_definitions(gate_defs);
+    GatedSpatialTransformation transformation;
+    transformation.set_gate_defs(gate_defs);
+    transformation.set_spatial_transformations(gated_motion_z, gated_motion_y, gated_motion_x);
+
+    VoxelsOnCartesianGrid<float> accumulated_image(range, origin, grid_spacing);
+    transformation.warp_image(accumulated_image, smooth_gated_image);
+    GatedDiscretisedDensity warped_gated_image(smooth_gated_image);
+    transformation.warp_image(warped_gated_image, smooth_image);
+    check_if_equal(static_cast<const Array<3,float>&>(warped_gated_image.get_density(2)), static_cast<const Array<3,float>&>(warped_image), "warping reference image to gates");
+
+    transformation.set_precompute_warping_weights(true);
+    // call twice to use the weights computed in the first call
+    for (int i=0; i<2; ++i)
+      {
+        VoxelsOnCartesianGrid<float> accumulated_image_with_weights(range, origin, grid_spacing);
+        transformation.warp_image(accumulated_image_with_weights, smooth_gated_image);
+        check_if_equal(accumulated_image, accumulated_image_with_weights, "accumulating gates with precomputed weights");
+        GatedDiscretisedDensity warped_gated_image_with_weights(smooth_gated_image);
+        transformation.warp_image(warped_gated_image_with_weights, smooth_image);
+        check_if_equal(static_cast<const Array<3,float>&>(warped_gated_image_with_weights.get_density(2)), static_cast<const Array<3,float>&>(warped_image), "warping reference image to gates with precomputed weights");
+      }
+  }
 }
 END_NAMESPACE_STIR
 
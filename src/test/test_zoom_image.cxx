@@ -22,8 +22,13 @@
 #include "stir/IndexRange.h"
 #include "stir/zoom.h"
 #include "stir/centre_of_gravity.h"
+#include "stir/PixelsOnCartesianGrid.h"
+#include "stir/IndexRange2D.h"
+#include "stir/IndexRange3D.h"
+#include "stir/interpolate.h"
 
 #include <iostream>
+#include <algorithm>
 #include <math.h>
 #include "stir/RunTests.h"
 
@@ -36,13 +41,115 @@ START_NAMESPACE_STIR
   The tests check if a point source remains in the same physical location
   after zooming. This is done by checking the centre of gravity of the
   zoomed image.
+
+  In addition, results are compared with zooming by calling
+  stir::overlap_interpolate for every row (the original implementation).
 */
 class zoom_imageTests : public RunTests
 {
 public:
   void run_tests();
+private:
+  //! compare zoom_image with the reference implementation for all scaling options
+  void check_consistency(const VoxelsOnCartesianGrid<float>& image,
+                         const VoxelsOnCartesianGrid<float>& new_image_template,
+                         const std::string& str);
+  //! compare the transaxial-only version of zoom_image with zooming every plane
+  void check_consistency_2D(const VoxelsOnCartesianGrid<float>& image);
 };
 
+//! zoom using overlap_interpolate for every row, then every plane, then the whole image
+static void
+zoom_image_reference(VoxelsOnCartesianGrid<float>& image_out,
+                     const VoxelsOnCartesianGrid<float>& image_in,
+                     const ZoomOptions zoom_options)
+{
+  const CartesianCoordinate3D<float> zooms =
+    image_in.get_voxel_size() / image_out.get_voxel_size();
+  const CartesianCoordinate3D<float> offsets =
+    (image_out.get_origin() - image_in.get_origin()) / image_in.get_voxel_size();
+
+  Array<3,float>
+    temp(IndexRange3D(image_in.get_min_z(), image_in.get_max_z(),
+                      image_in.get_min_y(), image_in.get_max_y(),
+                      image_out.get_min_x(), image_out.get_max_x()));
+  for (int z=image_in.get_min_z(); z<=image_in.get_max_z(); z++)
+    for (int y=image_in.get_min_y(); y<=image_in.get_max_y(); y++)
+      overlap_interpolate(temp[z][y], image_in[z][y], zooms.x(), offsets.x());
+
+  Array<3,float> temp2(IndexRange3D(image_in.get_min_z(), image_in.get_max_z(),
+                                    image_out.get_min_y(), image_out.get_max_y(),
+                                    image_out.get_min_x(), image_out.get_max_x()));
+  for (int z=image_in.get_min_z(); z<=image_in.get_max_z(); z++)
+    overlap_interpolate(temp2[z], temp[z], zooms.y(), offsets.y());
+
+  overlap_interpolate(image_out, temp2, zooms.z(), offsets.z());
+
+  switch (zoom_options.get_scaling_option())
+    {
+    case ZoomOptions::preserve_values:
+      image_out *= zooms.x()*zooms.y()*zooms.z(); break;
+    case ZoomOptions::preserve_projections:
+      image_out *= zooms.y()*zooms.z(); break;
+    case ZoomOptions::preserve_sum:
+      break;
+    }
+}
+
+void
+zoom_imageTests::check_consistency(const VoxelsOnCartesianGrid<float>& image,
+                                   const VoxelsOnCartesianGrid<float>& new_image_template,
+                                   const std::string& str)
+{
+  const ZoomOptions::Scaling scalings[] =
+    { ZoomOptions::preserve_sum, ZoomOptions::preserve_values, ZoomOptions::preserve_projections };
+  for (int i=0; i<3; ++i)
+    {
+      VoxelsOnCartesianGrid<float> new_image(new_image_template);
+      VoxelsOnCartesianGrid<float> reference(new_image_template);
+      zoom_image(new_image, image, scalings[i]);
+      zoom_image_reference(reference, image, scalings[i]);
+      new_image -= reference;
+      check_if_zero(std::max(new_image.find_max(), -new_image.find_min()),
+                    str + ": comparison with overlap_interpolate");
+    }
+}
+
+void
+zoom_imageTests::check_consistency_2D(const VoxelsOnCartesianGrid<float>& image)
+{
+  const float zoom = 1.7F;
+  const float x_offset_in_mm = 2.F;
+  const float y_offset_in_mm = -3.5F;
+  const int new_size = 41;
+  const VoxelsOnCartesianGrid<float> new_image =
+    zoom_image(image, zoom, x_offset_in_mm, y_offset_in_mm, new_size, ZoomOptions::preserve_values);
+  for (int z = image.get_min_z(); z <= image.get_max_z(); ++z)
+    {
+      PixelsOnCartesianGrid<float> plane = new_image.get_plane(z);
+      zoom_image(plane, image.get_plane(z), ZoomOptions::preserve_values);
+      plane -= new_image.get_plane(z);
+      check_if_zero(std::max(plane.find_max(), -plane.find_min()),
+                    "test on multiple argument (2d) zoom_image: comparison with 2D zoom_image");
+
+      // compare 2D zoom_image with overlap_interpolate
+      PixelsOnCartesianGrid<float> reference = new_image.get_plane(z);
+      const float zoom_x = image.get_voxel_size().x() / new_image.get_voxel_size().x();
+      const float zoom_y = image.get_voxel_size().y() / new_image.get_voxel_size().y();
+      Array<2,float> temp(IndexRange2D(image.get_min_y(), image.get_max_y(),
+                                       reference.get_min_x(), reference.get_max_x()));
+      for (int y = image.get_min_y(); y <= image.get_max_y(); ++y)
+        overlap_interpolate(temp[y], image[z][y], zoom_x,
+                            (new_image.get_origin().x() - image.get_origin().x()) / image.get_voxel_size().x());
+      overlap_interpolate(reference, temp, zoom_y,
+                          (new_image.get_origin().y() - image.get_origin().y()) / image.get_voxel_size().y());
+      reference *= zoom_x*zoom_y;
+      reference -= new_image.get_plane(z);
+      check_if_zero(std::max(reference.find_max(), -reference.find_min()),
+                    "test on 2D zoom_image: comparison with overlap_interpolate");
+    }
+}
+
 
 void
 zoom_imageTests::run_tests()
@@ -158,6 +265,36 @@ zoom_imageTests::run_tests()
     }
   }
 
+  // comparisons with overlap_interpolate on non-trivial data
+  {
+    VoxelsOnCartesianGrid<float> random_image(image);
+    for (int z=random_image.get_min_z(); z<=random_image.get_max_z(); ++z)
+      for (int y=random_image.get_min_y(); y<=random_image.get_max_y(); ++y)
+        for (int x=random_image.get_min_x(); x<=random_image.get_max_x(); ++x)
+          random_image[z][y][x] = static_cast<float>((z*7 + y*3 + x*x) % 11) + .5F*z;
+
+    // note: all differences are only due to rounding errors
+    this->set_tolerance(.001);
+    {
+      VoxelsOnCartesianGrid<float>
+        new_image(IndexRange<3>(CartesianCoordinate3D<int>(-1,-16,-17),
+                                CartesianCoordinate3D<int>(5,15,20)),
+                  CartesianCoordinate3D<float>(4.F,5.F,6.F),
+                  CartesianCoordinate3D<float>(2.2F,3.1F,4.3F));
+      check_consistency(random_image, new_image, "test on 2-argument zoom_image");
+    }
+    {
+      // same planes, such that the planes are zoomed directly into the output
+      VoxelsOnCartesianGrid<float>
+        new_image(IndexRange<3>(CartesianCoordinate3D<int>(1,-10,-12),
+                                CartesianCoordinate3D<int>(6,11,9)),
+                  CartesianCoordinate3D<float>(origin.z(),5.F,6.F),
+                  CartesianCoordinate3D<float>(grid_spacing.z(),3.1F,7.3F));
+      check_consistency(random_image, new_image, "test on 2-argument zoom_image with the same planes");
+    }
+    check_consistency_2D(random_image);
+    this->set_tolerance(old_tolerance);
+  }
 }
 
 END_NAMESPACE_STIR
@@ -11,7 +11,7 @@
   \code
   poisson_noise [-p | --preserve-mean] \
         output_filename input_projdata_filename \
-        scaling_factor seed-unsigned-int
+        scaling_factor seed-unsigned-int [num_realisations]
   \endcode
   The \c scaling_factor is used to multiply the input data before generating
   the Poisson random number. This means that a \c scaling_factor larger than 1
@@ -20,7 +20,10 @@
   Without the -p option, the mean of the output data will
   be equal to <tt>scaling_factor*mean_of_input</tt>, otherwise it
   will be equal to mean_of_input.<br>
-  The options -p and --preserve-mean are identical.
+  The options -p and --preserve-mean are identical.<br>
+  If \c num_realisations is larger than 1, the realisations are written to
+  <tt>output_filename_1</tt>, <tt>output_filename_2</tt>, etc. They are all generated
+  with a single pass over the input data.
 */
 /*
     Copyright (C) 2000 - 2004, Hammersmith Imanet Ltd
@@ -34,24 +37,27 @@
 
 #include "stir/GeneralisedPoissonNoiseGenerator.h"
 #include "stir/ProjDataInterfile.h"
+#include <boost/format.hpp>
+#include <vector>
 
 USING_NAMESPACE_STIR
 
 void usage()
 {
     using std::cerr;
-    cerr <<"Usage: poisson_noise [-p | --preserve-mean] <output_filename (no extension)> <input_projdata_filename> scaling_factor seed-unsigned-int\n"
+    cerr <<"Usage: poisson_noise [-p | --preserve-mean] <output_filename (no extension)> <input_projdata_filename> scaling_factor seed-unsigned-int [num_realisations]\n"
          <<"The seed value for the random number generator has to be strictly positive.\n"
          << "Without the -p option, the mean of the output data will"
 	 << " be equal to\nscaling_factor*mean_of_input, otherwise it"
 	 << "will be equal to mean_of_input.\n"
-	 << "The options -p and --preserve-mean are identical.\n";
+	 << "The options -p and --preserve-mean are identical.\n"
+	 << "With num_realisations>1, output is written to output_filename_1, output_filename_2 etc.\n";
 }
 
 int
 main (int argc,char *argv[])
 {
-  if(argc<5)
+  if(argc<5 || argc>7)
   {
     usage();
     return(EXIT_FAILURE);
@@ -70,7 +76,12 @@ main (int argc,char *argv[])
 	  usage();
 	  return(EXIT_FAILURE);
 	}  
-      ++argv;
+      ++argv; --argc;
+    }
+  if (argc<5 || argc>6)
+    {
+      usage();
+      return(EXIT_FAILURE);
     }
 	  
   const char *const filename = argv[1];
@@ -78,14 +89,23 @@ main (int argc,char *argv[])
   shared_ptr<ProjData>  in_data = ProjData::read_from_file(argv[2]);
 
   unsigned int seed = atoi(argv[4]);
+  const int num_realisations = argc>5 ? atoi(argv[5]) : 1;
+  if (num_realisations<1)
+    error("poisson_noise: number of realisations has to be at least 1");
 
   GeneralisedPoissonNoiseGenerator generator(scaling_factor, preserve_mean);
   generator.seed(seed);
 
-  ProjDataInterfile new_data(in_data->get_exam_info_sptr(),in_data->get_proj_data_info_sptr()->create_shared_clone(), filename);
-
+  std::vector<shared_ptr<ProjData> > new_data_sptrs;
+  for (int r=1; r<=num_realisations; ++r)
+    {
+      const std::string output_filename =
+        num_realisations==1 ? std::string(filename) : boost::str(boost::format("%1%_%2%") % filename % r);
+      new_data_sptrs.push_back(shared_ptr<ProjData>(
+        new ProjDataInterfile(in_data->get_exam_info_sptr(),in_data->get_proj_data_info_sptr()->create_shared_clone(), output_filename)));
+    }
   
-  generator.generate_random(new_data,*in_data);
+  generator.generate_random(new_data_sptrs,*in_data);
   
   return EXIT_SUCCESS;
 }
@@ -19,7 +19,7 @@
   \code
   [--output-format parameter-filename ]
   [--parametric || --dynamic]
-  [-s [--max_segment_num_to_process number] ] 
+  [-s [--max_segment_num_to_process number] [--chunk viewgram|sinogram] ]
   [--add | --mult] 
   [--power power_float] 
   [--times-scalar mult_scalar_float] 
@@ -48,6 +48,15 @@
   [--verbose]
   out_and_input_filename in_data2 [in_data3 [in_data4...]]
   \endcode
+  or
+  \code
+  [--output-format parameter-filename ]
+  [-s [--max_segment_num_to_process number] [--chunk viewgram|sinogram] ]
+  [--accumulate]
+  [--verbose]
+  --expression expression
+  output_filename_with_extension in_data1 [in_data2 [in_data3...]]
+  \endcode
 
   '--add' is default, and outputs the sum of the result of processed data.
   '--mult' outputs the multiplication of the result of processed data.<br>
@@ -70,6 +79,19 @@
   The order of the manipulations is as follows:<br>
   (1) thresholding (2) power (3) scalar multiplication (4) scalar addition.
 
+  With '--expression', the output is computed from the input data using the given
+  expression, where \c a refers to the first input, \c b to the second etc.
+  See stir::ElementwiseExpression for the syntax. This can be used for compound
+  operations that are not possible with the other options, and is computed in a single
+  pass over the data. The other math options cannot be used together with '--expression'.
+  This option is currently not supported for parametric or dynamic images.
+
+  Projection data are processed in chunks of 1 viewgram (default) or 1 sinogram (see the '--chunk' option),
+  such that memory use is small even for large data sets. Images are read one at a time and accumulated
+  in the output, such that only 2 images are in memory. With '--expression', all input images are kept
+  in memory, as the expression needs all of them at once.
+  When STIR is compiled with OpenMP, chunks (or image planes) are processed in parallel.
+
   The '--output-format' option can be used to write the output in 
   a different file format then the default (although this currently only
   works for images). The parameter file should have the following format:
@@ -90,12 +112,13 @@
   \code stir_math --mult --power -1 --min-threshold .1 output in1 in2 \endcode
   <li> Dividing 2 files, with first file set to the quotient<br>
   \code stir_math --accumulate --mult --power -1 in1 in2 \endcode
+  <li> Multiplying 2 files, adding a third, taking the square and thresholding the result<br>
+  \code stir_math --expression "max((a*b + c)^2, 0.1)" output in1 in2 in3 \endcode
 
   </ul>
-  \warning There is no check that the data sizes and other info are compatible 
-  and the output will have the largest data size in the input, 
-  and the characteristics (like voxel-size or so) are taken from the first input data. 
-  Hence, lots of funny effects can happen if data are not compatible.
+  \warning There is no check that the data characteristics (like voxel-size or so) are compatible.
+  They are taken from the first input data. The data sizes of all input data have to be the same
+  (except for parametric and dynamic images).
 
   \warning When '--accumulate' is not used, the output file HAS to be different from all
   the input files.
@@ -110,6 +133,9 @@
 #include "stir/ArrayFunction.h"
 #include "stir/DiscretisedDensity.h"
 #include "stir/SegmentByView.h"
+#include "stir/Viewgram.h"
+#include "stir/Sinogram.h"
+#include "stir/ElementwiseExpression.h"
 #include "stir/IO/OutputFileFormat.h"
 #include "stir/IO/read_from_file.h"
 #include "stir/Succeeded.h"
@@ -123,12 +149,17 @@
 #include "stir/modelling/ParametricDiscretisedDensity.h"
 #include "stir/DynamicDiscretisedDensity.h"
 #include "stir/stir_math.h"
+#include "stir/error.h"
+#include "stir/warning.h"
+#include <boost/format.hpp>
 
 #include <fstream> 
 #include <iostream> 
 #include <functional>
 #include <algorithm>
 #include <memory>
+#include <vector>
+#include <string.h>
 #ifndef STIR_NO_NAMESPACES
 using std::cerr;
 using std::cout;
@@ -251,6 +282,181 @@ void process_data(const string& output_file_name,
   output_format.write_to_file(output_file_name, *dyn_image_sptr);
 }
 
+//! function that computes an output row from the corresponding rows of all input data
+typedef std::function<void (float * const, const std::vector<const float *>&, const std::size_t)> RowFunction;
+
+//! computes \a output from \a inputs row by row
+/*! All arrays need to have the same index range. \a output can be one of the inputs. */
+void
+apply_row_function(Array<2,float>& output,
+                   const std::vector<const Array<2,float> *>& inputs,
+                   const RowFunction& row_function)
+{
+  std::vector<const float *> input_row_ptrs(inputs.size());
+  for (int y = output.get_min_index(); y <= output.get_max_index(); ++y)
+    {
+      Array<1,float>& output_row = output[y];
+      if (output_row.size() == 0)
+        continue;
+      for (std::size_t i = 0; i < inputs.size(); ++i)
+        input_row_ptrs[i] = &*(*inputs[i])[y].begin();
+      row_function(&*output_row.begin(), input_row_ptrs, output_row.size());
+    }
+}
+
+//! computes \a output from \a inputs plane by plane (in parallel when using OpenMP)
+/*! All images need to have the same index range. \a output can be one of the inputs. */
+void
+apply_row_function(DiscretisedDensity<3,float>& output,
+                   const std::vector<const DiscretisedDensity<3,float> *>& inputs,
+                   const RowFunction& row_function)
+{
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z = output.get_min_index(); z <= output.get_max_index(); ++z)
+    {
+      std::vector<const Array<2,float> *> planes(inputs.size());
+      for (std::size_t i=0; i<inputs.size(); ++i)
+        planes[i] = &(*inputs[i])[z];
+      apply_row_function(output[z], planes, row_function);
+    }
+}
+
+shared_ptr<DiscretisedDensity<3,float> >
+read_image(const char * const filename, const DiscretisedDensity<3,float> * const first_image_ptr, const bool verbose)
+{
+  if (verbose)
+    cout << "Reading image " << filename << endl;
+  shared_ptr<DiscretisedDensity<3,float> > image_sptr(read_from_file<DiscretisedDensity<3,float> >(filename));
+  if (first_image_ptr != 0 && image_sptr->get_index_range() != first_image_ptr->get_index_range())
+    error(boost::format("stir_math: image %1% has a different size than the first image") % filename);
+  return image_sptr;
+}
+
+//! computes the output from all images at once, which are all kept in memory
+void process_images(const string& output_file_name,
+                    const int num_files, char **argv,
+                    const bool verbose,
+                    const RowFunction& row_function,
+                    const OutputFileFormat<DiscretisedDensity<3,float> >& output_format)
+{
+  std::vector<shared_ptr<DiscretisedDensity<3,float> > > images(num_files);
+  std::vector<const DiscretisedDensity<3,float> *> image_ptrs(num_files);
+  for (int i=0; i<num_files; ++i)
+    {
+      images[i] = read_image(argv[i], i==0 ? 0 : images[0].get(), verbose);
+      image_ptrs[i] = images[i].get();
+    }
+
+  // the output is written in the first image
+  DiscretisedDensity<3,float>& output = *images[0];
+  apply_row_function(output, image_ptrs, row_function);
+
+  if (verbose)
+    cout << "Writing output image " << output_file_name << endl;
+  output_format.write_to_file(output_file_name, output);
+}
+
+//! computes the output by reading the images one at a time and accumulating them in the first one
+/*! \a first_row_function is applied to the first image. \a accumulate_row_function computes the new output
+    from the current output (its first input) and the next image (its second input).
+    Only 2 images are kept in memory. */
+void accumulate_images(const string& output_file_name,
+                       const int num_files, char **argv,
+                       const bool verbose,
+                       const RowFunction& first_row_function,
+                       const RowFunction& accumulate_row_function,
+                       const OutputFileFormat<DiscretisedDensity<3,float> >& output_format)
+{
+  const shared_ptr<DiscretisedDensity<3,float> > output_sptr = read_image(argv[0], 0, verbose);
+  DiscretisedDensity<3,float>& output = *output_sptr;
+  apply_row_function(output, std::vector<const DiscretisedDensity<3,float> *>(1, &output), first_row_function);
+
+  std::vector<const DiscretisedDensity<3,float> *> inputs(2, &output);
+  for (int i=1; i<num_files; ++i)
+    {
+      const shared_ptr<const DiscretisedDensity<3,float> > current_image_sptr = read_image(argv[i], &output, verbose);
+      inputs[1] = current_image_sptr.get();
+      apply_row_function(output, inputs, accumulate_row_function);
+    }
+
+  if (verbose)
+    cout << "Writing output image " << output_file_name << endl;
+  output_format.write_to_file(output_file_name, output);
+}
+
+// functions to handle viewgrams and sinograms in the same way in process_proj_data()
+// (the last argument is only used to select the type)
+inline int get_min_chunk_num(const ProjData& proj_data, const int, const Viewgram<float> *)
+{ return proj_data.get_min_view_num(); }
+inline int get_max_chunk_num(const ProjData& proj_data, const int, const Viewgram<float> *)
+{ return proj_data.get_max_view_num(); }
+inline Viewgram<float> get_chunk(const ProjData& proj_data, const int view_num, const int segment_num, const Viewgram<float> *)
+{ return proj_data.get_viewgram(view_num, segment_num); }
+inline Viewgram<float> get_empty_chunk(const ProjData& proj_data, const int view_num, const int segment_num, const Viewgram<float> *)
+{ return proj_data.get_empty_viewgram(view_num, segment_num); }
+inline Succeeded set_chunk(ProjData& proj_data, const Viewgram<float>& viewgram)
+{ return proj_data.set_viewgram(viewgram); }
+
+inline int get_min_chunk_num(const ProjData& proj_data, const int segment_num, const Sinogram<float> *)
+{ return proj_data.get_min_axial_pos_num(segment_num); }
+inline int get_max_chunk_num(const ProjData& proj_data, const int segment_num, const Sinogram<float> *)
+{ return proj_data.get_max_axial_pos_num(segment_num); }
+inline Sinogram<float> get_chunk(const ProjData& proj_data, const int ax_pos_num, const int segment_num, const Sinogram<float> *)
+{ return proj_data.get_sinogram(ax_pos_num, segment_num); }
+inline Sinogram<float> get_empty_chunk(const ProjData& proj_data, const int ax_pos_num, const int segment_num, const Sinogram<float> *)
+{ return proj_data.get_empty_sinogram(ax_pos_num, segment_num); }
+inline Succeeded set_chunk(ProjData& proj_data, const Sinogram<float>& sinogram)
+{ return proj_data.set_sinogram(sinogram); }
+
+//! computes the output projection data chunk by chunk, where ChunkT is Viewgram<float> or Sinogram<float>
+/*! Chunks are processed in parallel when using OpenMP. Reading and writing is done sequentially. */
+template <class ChunkT>
+void process_proj_data(ProjData& output,
+                       const std::vector<shared_ptr<ProjData> >& inputs,
+                       const bool verbose,
+                       const RowFunction& row_function)
+{
+  const ChunkT * const chunk_type_ptr = 0;
+  const int num_files = static_cast<int>(inputs.size());
+  for (int segment_num = output.get_min_segment_num();
+       segment_num <= output.get_max_segment_num();
+       ++segment_num)
+    {
+      if (verbose)
+        cout << "Processing segment num " << segment_num << " for all files" << endl;
+#ifdef STIR_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (int chunk_num = get_min_chunk_num(output, segment_num, chunk_type_ptr);
+           chunk_num <= get_max_chunk_num(output, segment_num, chunk_type_ptr);
+           ++chunk_num)
+        {
+          std::vector<shared_ptr<ChunkT> > input_chunks(num_files);
+#ifdef STIR_OPENMP
+#pragma omp critical(STIR_MATH_IO)
+#endif
+          for (int i=0; i<num_files; ++i)
+            input_chunks[i].reset(new ChunkT(get_chunk(*inputs[i], chunk_num, segment_num, chunk_type_ptr)));
+
+          ChunkT output_chunk = get_empty_chunk(output, chunk_num, segment_num, chunk_type_ptr);
+          std::vector<const Array<2,float> *> input_arrays(num_files);
+          for (int i=0; i<num_files; ++i)
+            input_arrays[i] = input_chunks[i].get();
+          apply_row_function(output_chunk, input_arrays, row_function);
+
+          Succeeded succeeded = Succeeded::yes;
+#ifdef STIR_OPENMP
+#pragma omp critical(STIR_MATH_IO)
+#endif
+          succeeded = set_chunk(output, output_chunk);
+          if (succeeded != Succeeded::yes)
+            warning(boost::format("stir_math: error writing data for segment %1%") % segment_num);
+        }
+    }
+}
+
 template <class DataT>
 shared_ptr<OutputFileFormat<DataT> >
 find_output_format(const std::string& filename)
@@ -279,7 +485,7 @@ main(int argc, char **argv)
       cerr<< "Usage: " << argv[0] << "\n\t"
 	  << "[--output-format parameter-filename ]\n\t"
 	  << "[--parametric || --dynamic]\n\t"
-	  << "[-s [--max_segment_num_to_process number] ]\n\t"
+	  << "[-s [--max_segment_num_to_process number] [--chunk viewgram|sinogram] ]\n\t"
 	  << "[--accumulate] [--add | --mult]\n\t"
 	  << "[--power power_float]\n\t"
 	  << "[--times-scalar mult_scalar_float]\n\t"
@@ -288,6 +494,12 @@ main(int argc, char **argv)
 	  << "[--min-threshold min_threshold]\n\t"
 	  << "[--max-threshold max_threshold]\n\t"
 	  << "[--including-first] [--verbose]\n\t"
+	  << "output_filename_with_extension in_data1 [in_data2 [in_data3...]]\n"
+	  << "or\n\t"
+	  << "[--output-format parameter-filename ]\n\t"
+	  << "[-s [--max_segment_num_to_process number] [--chunk viewgram|sinogram] ]\n\t"
+	  << "[--accumulate] [--verbose]\n\t"
+	  << "--expression expression\n\t"
 	  << "output_filename_with_extension in_data1 [in_data2 [in_data3...]]\n\n"
 	  << "(but everything on 1 line).\n"
 	  << "'--add' is default, and outputs the sum of the result of processed data.\n"
@@ -309,11 +521,16 @@ main(int argc, char **argv)
 	  << "For projection data, you can restrict the number of segments read/written\n"
 	  << "using the --max_segment_num_to_process option (unless --accumulate is used).\n"
 	  << "For example, using 2 as an argument of this option, will read/write"
-	  << "segments -2,-1,0,1,2.\n\n"
-	  << "WARNING: there is no check that the data sizes and other info are compatible "
-	  << "and the output will have the largest data size in the input, "
-	  << "and the characteristics (like voxel-size or so) are taken from the first input data. "
-	  << "Hence, lots of funny effects can happen if data are not compatible.\n\n"
+	  << "segments -2,-1,0,1,2.\n"
+	  << "Projection data are processed per viewgram (default) or per sinogram (see '--chunk').\n\n"
+	  << "With '--expression', the output is computed from the input data using the expression,\n"
+	  << "where 'a' refers to the first input, 'b' to the second etc. For example\n\t"
+	  << "--expression \"max((a*b + c)^2, 0.1)\"\n"
+	  << "Operators + - * / ^ and functions min(x,y) max(x,y) exp(x) log(x) sqrt(x) abs(x) can be used.\n"
+	  << "No other math options can be used together with '--expression'.\n\n"
+	  << "WARNING: there is no check that the data characteristics (like voxel-size or so) are compatible. "
+	  << "They are taken from the first input data. The data sizes of all input data have to be the same "
+	  << "(except for parametric and dynamic images).\n\n"
 	  << "WARNING: For future compatibility, it is recommended to put \n"
 	  << "the command line arguments in the order that they will be\n"
 	  << "executed (i.e. as listed above). It might be that\n"
@@ -339,6 +556,10 @@ main(int argc, char **argv)
   bool dynamic = false;
   std::string output_format_filename;
   int max_segment_num_to_process = -1;
+  bool process_sinograms = false;
+  std::string expression;
+  // keep track of options that cannot be used with --expression
+  bool math_option_used = false;
 
   // first process command line options
 
@@ -351,6 +572,25 @@ main(int argc, char **argv)
 	  max_segment_num_to_process = atoi(argv[1]);
 	  argc-=2; argv+=2;
 	} 
+      else if (strcmp(argv[0], "--chunk")==0)
+	{
+	  if (argc<2)
+	    { cerr << "Option '--chunk' expects an argument\n"; exit(EXIT_FAILURE); }
+	  if (strcmp(argv[1], "viewgram")==0)
+	    process_sinograms = false;
+	  else if (strcmp(argv[1], "sinogram")==0)
+	    process_sinograms = true;
+	  else
+	    { cerr << "Option '--chunk' expects 'viewgram' or 'sinogram' as argument\n"; exit(EXIT_FAILURE); }
+	  argc-=2; argv+=2;
+	} 
+      else if (strcmp(argv[0], "--expression")==0)
+	{
+	  if (argc<2)
+	    { cerr << "Option '--expression' expects an argument\n"; exit(EXIT_FAILURE); }
+	  expression = argv[1];
+	  argc-=2; argv+=2;
+	} 
       else if (strcmp(argv[0], "--output-format")==0)
 	{
 	  if (argc<2)
@@ -407,6 +647,7 @@ main(int argc, char **argv)
       else  if (strcmp(argv[0], "--including-first")==0)
 	{
 	  except_first = false;
+	  math_option_used = true;
 	  argc-=1; argv+=1;
 	}
       else  if (strcmp(argv[0], "--verbose")==0)
@@ -432,11 +673,13 @@ main(int argc, char **argv)
       else  if (strcmp(argv[0], "--add")==0)
 	{
 	  do_add = true;
+	  math_option_used = true;
 	  argc-=1; argv+=1;
 	}
       else  if (strcmp(argv[0], "--mult")==0)
 	{
 	  do_add = false;
+	  math_option_used = true;
 	  argc-=1; argv+=1;
 	}
       else  if (strcmp(argv[0], "--accumulate")==0)
@@ -469,25 +712,98 @@ main(int argc, char **argv)
     max_threshold == NumericInfo<float>().max_value();
 
 
+  shared_ptr<ElementwiseExpression> expression_sptr;
+  if (!expression.empty())
+    {
+      if (math_option_used || !no_math_on_data)
+	error("stir_math: '--expression' cannot be used together with other math options");
+      if (parametric || dynamic)
+	error("stir_math: '--expression' is not supported for parametric or dynamic images");
+      expression_sptr.reset(new ElementwiseExpression(expression));
+      if (expression_sptr->get_num_inputs() > num_files)
+	error(boost::format("stir_math: expression '%1%' needs %2% input files, but only %3% are given")
+	      % expression % expression_sptr->get_num_inputs() % num_files);
+      if (expression_sptr->get_num_inputs() < num_files)
+	warning(boost::format("stir_math: expression '%1%' uses only %2% of the %3% input files")
+		% expression % expression_sptr->get_num_inputs() % num_files);
+    }
+
   if (verbose)
     {
-      cout << program_name << ": "
-	   << (do_add ? "adding " : "multiplying ")
-	   << num_files;
-      if (!no_math_on_data)
-	cout <<" files after thresholding to a min value of "
-	     << min_threshold << "\n and a max value of "
-	     << max_threshold << "\n and then taking a power of "
-	     << power << "\n and then multiplying with "
-	     << mult_scalar << "\n and then adding  "
-	     << add_scalar
-	     << (except_first?"\n except for" : " including")
-	     <<" the first file";
+      if (!expression.empty())
+	cout << program_name << ": computing '" << expression << "' from "
+	     << num_files << " files";
+      else
+	{
+	  cout << program_name << ": "
+	       << (do_add ? "adding " : "multiplying ")
+	       << num_files;
+	  if (!no_math_on_data)
+	    cout <<" files after thresholding to a min value of "
+		 << min_threshold << "\n and a max value of "
+		 << max_threshold << "\n and then taking a power of "
+		 << power << "\n and then multiplying with "
+		 << mult_scalar << "\n and then adding  "
+		 << add_scalar
+		 << (except_first?"\n except for" : " including")
+		 <<" the first file";
+	}
       cout << endl;
     }
 
   // construct function object that does the manipulations on each data
-  pow_times_add pow_times_add_object(add_scalar, mult_scalar, power, min_threshold, max_threshold);
+  const pow_times_add pow_times_add_object(add_scalar, mult_scalar, power, min_threshold, max_threshold);
+
+  // construct function that computes a row of the output from the rows of all input data
+  RowFunction row_function;
+  // without expression, the output can be accumulated one input at a time:
+  // first_row_function processes the first input, accumulate_row_function adds (or multiplies)
+  // the processed second input to the first one
+  RowFunction first_row_function, accumulate_row_function;
+  if (!is_null_ptr(expression_sptr))
+    {
+      row_function =
+	[expression_sptr](float * const output, const std::vector<const float *>& inputs, const std::size_t num_elements)
+	{
+	  expression_sptr->evaluate(output, inputs, num_elements);
+	};
+    }
+  else
+    {
+      first_row_function =
+	[pow_times_add_object, no_math_on_data, except_first]
+	(float * const output, const std::vector<const float *>& inputs, const std::size_t num_elements)
+	{
+	  for (std::size_t j = 0; j < num_elements; ++j)
+	    output[j] = (!no_math_on_data && !except_first) ? pow_times_add_object(inputs[0][j]) : inputs[0][j];
+	};
+      accumulate_row_function =
+	[pow_times_add_object, no_math_on_data, do_add]
+	(float * const output, const std::vector<const float *>& inputs, const std::size_t num_elements)
+	{
+	  for (std::size_t j = 0; j < num_elements; ++j)
+	    {
+	      const float current_value =
+		no_math_on_data ? inputs[1][j] : pow_times_add_object(inputs[1][j]);
+	      if (do_add)
+		output[j] = inputs[0][j] + current_value;
+	      else
+		output[j] = inputs[0][j] * current_value;
+	    }
+	};
+      row_function =
+	[first_row_function, accumulate_row_function]
+	(float * const output, const std::vector<const float *>& inputs, const std::size_t num_elements)
+	{
+	  first_row_function(output, inputs, num_elements);
+	  std::vector<const float *> current_inputs(2, output);
+	  for (std::size_t i = 1; i < inputs.size(); ++i)
+	    {
+	      current_inputs[1] = inputs[i];
+	      accumulate_row_function(output, current_inputs, num_elements);
+	    }
+	};
+    }
 
   // start the main processing
   if (!do_projdata)
@@ -495,14 +811,18 @@ main(int argc, char **argv)
  
       if (!parametric && !dynamic)
 	{
-	  process_data(output_file_name,
-		       num_files, argv, 
-		       no_math_on_data,
-		       except_first,
-		       verbose,
-		       do_add,
-		       pow_times_add_object,
-		       *find_output_format<DiscretisedDensity<3,float> >(output_format_filename));
+	  if (!is_null_ptr(expression_sptr))
+	    process_images(output_file_name,
+			   num_files, argv,
+			   verbose,
+			   row_function,
+			   *find_output_format<DiscretisedDensity<3,float> >(output_format_filename));
+	  else
+	    accumulate_images(output_file_name,
+			      num_files, argv,
+			      verbose,
+			      first_row_function, accumulate_row_function,
+			      *find_output_format<DiscretisedDensity<3,float> >(output_format_filename));
 	}
       else if (parametric)
 	{
@@ -568,32 +888,31 @@ main(int argc, char **argv)
       for (int i=1; i<num_files; ++i)
 	all_proj_data[i] =  ProjData::read_from_file(argv[i]); 
 
-      // do reading/writing in a loop over segments
-      for (int segment_num = out_proj_data_ptr->get_min_segment_num();
-	   segment_num <= out_proj_data_ptr->get_max_segment_num();
-	   ++segment_num)
-	{   
-	  if (verbose)
-	    cout << "Processing segment num " << segment_num << " for all files" << endl;
-	  SegmentByView<float> segment_by_view = 
-	    (*all_proj_data[0]).get_segment_by_view(segment_num);
-	  if (!no_math_on_data && !except_first )
-	    in_place_apply_function(segment_by_view, pow_times_add_object);
-	  for (int i=1; i<num_files; ++i)
-	    {
-	      SegmentByView<float> current_segment_by_view = 
-		(*all_proj_data[i]).get_segment_by_view(segment_num);
-	      if (!no_math_on_data)
-		in_place_apply_function(current_segment_by_view, pow_times_add_object);
-	      if(do_add)
-		segment_by_view += current_segment_by_view;
-	      else
-		segment_by_view *= current_segment_by_view;
-	    }
-    
-	  if (!(out_proj_data_ptr->set_segment(segment_by_view) == Succeeded::yes))
-	    warning("Error set_segment %d\n", segment_num);   
+      // check sizes before doing any processing
+      for (int i=0; i<num_files; ++i)
+	{
+	  const ProjData& proj_data = *all_proj_data[i];
+	  bool compatible =
+	    proj_data.get_min_segment_num() <= out_proj_data_ptr->get_min_segment_num() &&
+	    proj_data.get_max_segment_num() >= out_proj_data_ptr->get_max_segment_num() &&
+	    proj_data.get_min_view_num() == out_proj_data_ptr->get_min_view_num() &&
+	    proj_data.get_max_view_num() == out_proj_data_ptr->get_max_view_num() &&
+	    proj_data.get_min_tangential_pos_num() == out_proj_data_ptr->get_min_tangential_pos_num() &&
+	    proj_data.get_max_tangential_pos_num() == out_proj_data_ptr->get_max_tangential_pos_num();
+	  for (int segment_num = out_proj_data_ptr->get_min_segment_num();
+	       compatible && segment_num <= out_proj_data_ptr->get_max_segment_num();
+	       ++segment_num)
+	    compatible =
+	      proj_data.get_min_axial_pos_num(segment_num) == out_proj_data_ptr->get_min_axial_pos_num(segment_num) &&
+	      proj_data.get_max_axial_pos_num(segment_num) == out_proj_data_ptr->get_max_axial_pos_num(segment_num);
+	  if (!compatible)
+	    error(boost::format("stir_math: projection data %1% has a different size than the output") % argv[i]);
 	}
+
+      if (process_sinograms)
+	process_proj_data<Sinogram<float> >(*out_proj_data_ptr, all_proj_data, verbose, row_function);
+      else
+	process_proj_data<Viewgram<float> >(*out_proj_data_ptr, all_proj_data, verbose, row_function);
     } 
   return EXIT_SUCCESS;
 }